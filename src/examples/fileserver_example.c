@@ -29,19 +29,15 @@
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif /* HAVE_UNISTD_H */
-#ifdef HAVE_SYS_STAT_H
-#include <sys/stat.h>
-#endif /* HAVE_SYS_STAT_H */
-#ifdef HAVE_FCNTL_H
-#include <fcntl.h>
-#endif /* HAVE_FCNTL_H */
 
 #define PAGE \
   "<html><head><title>File not found</title></head><body>File not found</body></html>"
 
-#ifndef S_ISREG
-#define S_ISREG(x) (S_IFREG == (x & S_IFREG))
-#endif /* S_ISREG */
+/**
+ * The cache of the opened files
+ */
+static struct MHD_FileCache *file_cache;
+
 
 static enum MHD_Result
 ahc_echo (void *cls,
@@ -55,8 +51,6 @@ ahc_echo (void *cls,
   static int aptr;
   struct MHD_Response *response;
   enum MHD_Result ret;
-  int fd;
-  struct stat buf;
   (void) cls;               /* Unused. Silent compiler warning. */
   (void) version;           /* Unused. Silent compiler warning. */
   (void) upload_data;       /* Unused. Silent compiler warning. */
@@ -77,21 +71,10 @@ ahc_echo (void *cls,
    * functions. Always check validity of data before using.
    */
   if (NULL != strstr (url, "../")) /* Very simplified check! */
-    fd = -1;                       /* Do not allow usage of parent directories. */
-  else
-    fd = open (url + 1, O_RDONLY);
-  if (-1 != fd)
-  {
-    if ( (0 != fstat (fd, &buf)) ||
-         (! S_ISREG (buf.st_mode)) )
-    {
-      /* not a regular file, refuse to serve */
-      if (0 != close (fd))
-        abort ();
-      fd = -1;
-    }
-  }
-  if (-1 == fd)
+    response = NULL;               /* Do not allow usage of parent directories. */
+  else /* Only regular files are served from the cache */
+    response = MHD_file_cache_get_response (file_cache, url + 1);
+  if (NULL == response)
   {
     response = MHD_create_response_from_buffer_static (strlen (PAGE),
                                                        PAGE);
@@ -100,13 +83,6 @@ ahc_echo (void *cls,
   }
   else
   {
-    response = MHD_create_response_from_fd64 ((uint64_t) buf.st_size, fd);
-    if (NULL == response)
-    {
-      if (0 != close (fd))
-        abort ();
-      return MHD_NO;
-    }
     ret = MHD_queue_response (connection, MHD_HTTP_OK, response);
     MHD_destroy_response (response);
   }
@@ -133,13 +109,22 @@ main (int argc, char *const *argv)
     return 1;
   }
 
+  /* Up to 1024 files, 64 MiB in total, checked again after 10 seconds */
+  file_cache = MHD_file_cache_create (1024, 64 * 1024 * 1024, 10,
+                                      MHD_RF_ACCEPT_RANGES);
+  if (NULL == file_cache)
+    return 1;
   d = MHD_start_daemon (MHD_USE_THREAD_PER_CONNECTION
                         | MHD_USE_INTERNAL_POLLING_THREAD | MHD_USE_ERROR_LOG,
                         (uint16_t) port,
                         NULL, NULL, &ahc_echo, NULL, MHD_OPTION_END);
   if (d == NULL)
+  {
+    MHD_file_cache_destroy (file_cache);
     return 1;
+  }
   (void) getc (stdin);
   MHD_stop_daemon (d);
+  MHD_file_cache_destroy (file_cache);
   return 0;
 }
@@ -101,7 +101,7 @@ MHD_C_DECLRATIONS_START_HERE_
  * they are parsed as decimal numbers.
  * Example: 0x01093001 = 1.9.30-1.
  */
-#define MHD_VERSION 0x01000101
+#define MHD_VERSION 0x01000102
 
 /* If generic headers don't work on your platform, include headers
    which define 'va_list', 'size_t', 'ssize_t', 'intptr_t', 'off_t',
@@ -185,6 +185,12 @@ enum MHD_Result
 
 #define MHD_CONTENT_READER_END_OF_STREAM ((ssize_t) -1)
 #define MHD_CONTENT_READER_END_WITH_ERROR ((ssize_t) -2)
+/**
+ * The data is not ready yet, the content reader is not called again for
+ * the connection until #MHD_content_reader_ready() is called.
+ * @note Available since #MHD_VERSION 0x01000102
+ */
+#define MHD_CONTENT_READER_PENDING ((ssize_t) -3)
 
 #ifndef _MHD_EXTERN
 #if defined(_WIN32) && defined(MHD_W32LIB)
@@ -2197,6 +2203,288 @@ enum MHD_OPTION
    * @note Available since #MHD_VERSION 0x00097709
    */
   MHD_OPTION_DIGEST_AUTH_DEFAULT_MAX_NC = 42
+  ,
+  /**
+   * Limit on the rate of requests made to the server from the same IP
+   * address (or from the same network, see
+   * #MHD_OPTION_PER_IP_RATE_PREFIX_IPV4 and
+   * #MHD_OPTION_PER_IP_RATE_PREFIX_IPV6), in requests per second.
+   * The requests are counted by the token bucket of the size specified
+   * by #MHD_OPTION_PER_IP_RATE_BURST.  The requests over the limit are
+   * rejected before the parsed request is passed to the application,
+   * the client gets "429 Too Many Requests" response (or the connection
+   * is closed, see #MHD_OPTION_PER_IP_RATE_DROP).  New connections are
+   * not accepted from clients who have already used all their tokens.
+   * The buckets are kept in the table of fixed size.  When the table is
+   * full, the bucket of the least recently seen client is reused, the new
+   * client gets the full bucket.  When IPv6 clients are limited by
+   * network prefix longer than 64 bits, the requests from each /64 network
+   * are also limited in total to 16 times of the limit and the burst of
+   * the single client, so cycling through the addresses of one network
+   * does not give a client more requests.
+   * This option should be followed by an `unsigned int`.  The default is
+   * zero, which means no limit on the rate of requests.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_OPTION_PER_IP_RATE_LIMIT = 43
+  ,
+  /**
+   * The maximum number of requests allowed from the same IP address
+   * (or from the same network) in a burst, when #MHD_OPTION_PER_IP_RATE_LIMIT
+   * is used.
+   * This option should be followed by an `unsigned int`.  The default
+   * (and the value used if zero is specified) is the value of
+   * #MHD_OPTION_PER_IP_RATE_LIMIT, i.e. requests of one second.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_OPTION_PER_IP_RATE_BURST = 44
+  ,
+  /**
+   * The length of IPv4 network prefix used to group the clients for
+   * #MHD_OPTION_PER_IP_RATE_LIMIT.  For example, use 24 to limit
+   * the rate of requests for each /24 network.
+   * This option should be followed by an `unsigned int`.  Values larger
+   * than 32 are treated as 32, which is also the default (each IPv4
+   * address is limited separately).
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_OPTION_PER_IP_RATE_PREFIX_IPV4 = 45
+  ,
+  /**
+   * The length of IPv6 network prefix used to group the clients for
+   * #MHD_OPTION_PER_IP_RATE_LIMIT.  For example, use 64 to limit
+   * the rate of requests for each /64 network.
+   * This option should be followed by an `unsigned int`.  Values larger
+   * than 128 are treated as 128, which is also the default (each IPv6
+   * address is limited separately, with the total limit for each /64
+   * network, see #MHD_OPTION_PER_IP_RATE_LIMIT).
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_OPTION_PER_IP_RATE_PREFIX_IPV6 = 46
+  ,
+  /**
+   * If set to non-zero value, the connections of the clients exceeding
+   * #MHD_OPTION_PER_IP_RATE_LIMIT are closed without any reply instead
+   * of replying with "429 Too Many Requests".
+   * This option should be followed by an `int` argument.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_OPTION_PER_IP_RATE_DROP = 47
+  ,
+  /**
+   * The maximum number of connections accepted in a row when the listen
+   * socket is reported as ready.  Accepting stops earlier when there are
+   * no more pending connections or when the connection limit is reached.
+   * Larger values help to absorb bursts of new connections with fewer
+   * wakeups, smaller values give more time to already accepted
+   * connections.
+   * Used only if the listen socket is non-blocking, otherwise only one
+   * connection is accepted per wakeup.
+   * This option should be followed by an `unsigned int`.  The default
+   * value is 10, zero is treated as one.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_OPTION_ACCEPT_BATCH_SIZE = 48
+  ,
+  /**
+   * If set to non-zero value, the payload of the chunks of the chunked
+   * request body is compacted in the read buffer and all payload data
+   * available in the buffer is given to the #MHD_AccessHandlerCallback
+   * in one call, instead of one call per chunk.
+   * Reduces the number of the callback calls when the client sends
+   * many small chunks.  The data not processed by the callback is kept
+   * in the buffer and is given to the next call together with the new
+   * data.
+   * This option should be followed by an `int` argument.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_OPTION_COALESCE_CHUNKED_UPLOAD = 49
+  ,
+  /**
+   * Enable decoding of the request body compressed with "gzip" or
+   * "deflate" content coding (as specified by the "Content-Encoding"
+   * request header).
+   * When enabled, the #MHD_AccessHandlerCallback (and therefore the
+   * #MHD_PostProcessor) gets the decoded (decompressed) data.  The request
+   * body with any other content coding is given to the application
+   * as is.  The "Content-Encoding" header is not removed from the request.
+   * The decoding uses a buffer allocated from the connection's memory pool
+   * and the decompressor state allocated outside the pool (about 40 KiB
+   * per each connection receiving the compressed body).
+   * Broken compressed data is rejected with #MHD_HTTP_BAD_REQUEST
+   * response.
+   * This option should be followed by a `size_t` argument with the
+   * maximum size of the decoded request body.  Requests with larger
+   * decoded body are rejected with #MHD_HTTP_CONTENT_TOO_LARGE response.
+   * Zero (default) disables decoding.
+   * Check #MHD_FEATURE_BODY_DECODING for availability of decoding.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_OPTION_DECOMPRESS_REQUEST_BODY = 50
+  ,
+  /**
+   * Set the compression level used for responses with #MHD_RF_COMPRESS
+   * flag.
+   * This option should be followed by an `int` argument with the level
+   * from 1 (the fastest) to 9 (the best compression).
+   * Zero (default) uses the default level of the compression library
+   * (level 6).
+   * The compressor state is allocated outside the connection's memory
+   * pool (about 256 KiB for each connection sending the compressed body),
+   * the idle compressors are reused for the next responses.
+   * Check #MHD_FEATURE_RESPONSE_COMPRESSION for availability of
+   * compression.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_OPTION_RESPONSE_COMPRESSION_LEVEL = 51
+  ,
+  /**
+   * Enable the cache of the responses in the daemon.
+   * The responses with #MHD_RO_CACHE_TTL option are kept in the cache
+   * and used to answer the next GET and HEAD requests (without body) with
+   * the same method, the same "Host" header, the same URL, the same query
+   * arguments and the same values of the request headers listed in
+   * the "Vary" header of the response.
+   * The cache is checked as soon as the request headers are received,
+   * before the first call of the access handler callback; the callback is
+   * not called at all for the requests answered from the cache, so any
+   * access checks done by the callback are skipped for such requests.
+   * The requests with "Authorization" or "Cookie" header are answered
+   * from the cache (and their responses are cached) only if the "Vary"
+   * header of the response lists these headers.
+   * This option should be followed by a `size_t` argument with
+   * the maximum memory used by the cache (including the size of the
+   * memory-based response bodies).  When the limit is reached, the least
+   * recently used responses are removed.
+   * Zero (default) disables the cache.
+   * @sa #MHD_DAEMON_INFO_RESPONSE_CACHE_HITS,
+   *     #MHD_DAEMON_INFO_RESPONSE_CACHE_MISSES
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_OPTION_RESPONSE_CACHE_SIZE = 52
+  ,
+  /**
+   * Read the data of the file-based responses to the page cache by
+   * the separate threads, so the polling thread is never blocked by
+   * the disk reads.  When the next part of the file is not in the page
+   * cache, the connection is suspended until the data is read by one
+   * of the I/O threads, the following part of the file is prefetched
+   * in the background.
+   * This option should be followed by an `unsigned int` argument with
+   * the number of the I/O threads.
+   * Zero (default) reads the files in the polling thread.
+   * The files are read in the polling thread as well if the system cannot
+   * check whether the data is in the page cache (no preadv2() with
+   * RWF_NOWAIT).
+   * Used only with #MHD_USE_INTERNAL_POLLING_THREAD, ignored with
+   * #MHD_USE_THREAD_PER_CONNECTION (each connection has its own thread)
+   * and without internal threads.
+   * Check #MHD_FEATURE_FILE_IO_THREADS for availability.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_OPTION_FILE_IO_THREADS = 53
+  ,
+  /**
+   * Select how the connections added by #MHD_add_connection() are
+   * distributed between the threads of the thread pool.
+   * This option should be followed by an `unsigned int` argument with
+   * one of #MHD_WorkerDistribution values.  When not specified,
+   * #MHD_WD_SOCKET is used.
+   * The connections accepted by the threads of the pool from the listen
+   * socket are not affected: the thread that accepts the connection
+   * handles it.
+   * Used only with #MHD_OPTION_THREAD_POOL_SIZE.
+   * @sa #MHD_DAEMON_INFO_WORKER_CONNECTIONS
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_OPTION_WORKER_DISTRIBUTION = 54
+  ,
+  /**
+   * Bind the internal threads of the daemon to the CPUs.
+   * This option should be followed by two arguments: an `unsigned int`
+   * with the number of the elements in the array and a pointer to the
+   * array of `unsigned int` with the numbers of the CPUs.
+   * The thread number N of the thread pool is bound to the CPU
+   * number N (modulo the size of the array) in the array; without
+   * the thread pool the internal polling thread is bound to the first
+   * CPU in the array.
+   * The memory pools of the connections are allocated by the bound
+   * threads, so on NUMA systems this memory is normally placed by
+   * the OS on the node of the CPU.
+   * The array is used only during the #MHD_start_daemon() call.
+   * Used only with #MHD_USE_INTERNAL_POLLING_THREAD, not compatible
+   * with #MHD_USE_THREAD_PER_CONNECTION.
+   * Check #MHD_FEATURE_THREAD_CPU_AFFINITY for availability.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_OPTION_THREAD_CPU_AFFINITY = 55
+  ,
+  /**
+   * Reuse the threads of the closed connections for the new connections
+   * in thread-per-connection mode.  When the connection is closed, its
+   * thread is parked and waits for the next connection instead of
+   * exiting, so the thread creation is avoided for the following
+   * connections.  The processing of each connection is not changed:
+   * the connection is still processed by a single thread from the start
+   * to the end.
+   * This option should be followed by an `unsigned int` argument with
+   * the maximum number of the parked threads.  When the limit is reached,
+   * the threads of the closed connections exit.
+   * Zero (default) disables the reuse of the threads.
+   * Used only with #MHD_USE_THREAD_PER_CONNECTION.
+   * @sa #MHD_OPTION_CONNECTION_THREADS_IDLE_TIMEOUT
+   * Check #MHD_FEATURE_CONNECTION_THREADS_REUSE for availability.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_OPTION_CONNECTION_THREADS_IDLE_MAX = 56
+  ,
+  /**
+   * The time after which the parked connection thread exits if it is not
+   * reused for any new connection.
+   * This option should be followed by an `unsigned int` argument with
+   * the number of seconds.  The default is 10 seconds, zero makes the
+   * threads wait for the new connections until the daemon is stopped.
+   * Used only with #MHD_OPTION_CONNECTION_THREADS_IDLE_MAX.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_OPTION_CONNECTION_THREADS_IDLE_TIMEOUT = 57
+  ,
+  /**
+   * Call the #MHD_AccessHandlerCallback by the separate handler threads,
+   * so the polling threads are not blocked by the application (like
+   * when the handler waits for a database).
+   * The connection is automatically suspended while the handler is
+   * called by the handler thread and resumed when the handler returns,
+   * the response queued by the handler is sent by the polling thread.
+   * The calls with the request body data (@a upload_data) are made by
+   * the polling threads.
+   * The handler may suspend the connection as usual, the connection is
+   * then kept suspended when the handler returns.
+   * This option should be followed by an `unsigned int` argument with
+   * the number of the handler threads.
+   * Zero (default) calls the handler in the polling threads.
+   * Used only with #MHD_USE_INTERNAL_POLLING_THREAD, ignored with
+   * #MHD_USE_THREAD_PER_CONNECTION (each connection has its own thread)
+   * and without internal threads.
+   * @sa #MHD_OPTION_HANDLER_QUEUE_SIZE
+   * Check #MHD_FEATURE_HANDLER_THREADS for availability.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_OPTION_HANDLER_THREADS = 58
+  ,
+  /**
+   * The maximum number of the handler calls waiting for the handler
+   * threads.  When the queue is full, the handler is called by
+   * the polling thread, which does not process the other connections
+   * until the handler returns, so the new connections and requests are
+   * not accepted faster than they are handled.
+   * This option should be followed by an `unsigned int` argument with
+   * the size of the queue.  Zero (default) uses 16 calls per handler
+   * thread.
+   * Used only with #MHD_OPTION_HANDLER_THREADS.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_OPTION_HANDLER_QUEUE_SIZE = 59
 
 } _MHD_FIXED_ENUM;
 
@@ -2215,6 +2503,50 @@ enum MHD_DisableSanityCheck
 } _MHD_FIXED_FLAGS_ENUM;
 
 
+/**
+ * The policies of the distribution of the connections between the threads
+ * of the thread pool, for #MHD_OPTION_WORKER_DISTRIBUTION.
+ * In all policies the threads at their connection limit are skipped.
+ * @note Available since #MHD_VERSION 0x01000102
+ */
+enum MHD_WorkerDistribution
+{
+  /**
+   * The thread is selected by the value of the socket.
+   * This is the default.
+   */
+  MHD_WD_SOCKET = 0
+  ,
+  /**
+   * The thread with the smallest number of the connections is used.
+   * All threads of the pool are checked for each new connection.
+   */
+  MHD_WD_LEAST_CONNECTIONS = 1
+  ,
+  /**
+   * Two threads are picked pseudo-randomly and the thread with the smaller
+   * number of the connections is used ("power of two choices").
+   * Gives almost the same balance as #MHD_WD_LEAST_CONNECTIONS at
+   * a constant cost for large pools.
+   */
+  MHD_WD_TWO_CHOICES = 2
+  ,
+  /**
+   * The thread is selected by the number of the CPU that has processed
+   * the incoming packets of the connection (as reported by
+   * `SO_INCOMING_CPU` socket option), so the connection is handled
+   * close to its network queue.  The thread bound to this CPU by
+   * #MHD_OPTION_THREAD_CPU_AFFINITY is used, if any, otherwise the CPU
+   * number is used as the index of the thread (modulo the pool size).
+   * Works best when the number of the threads matches the number of
+   * the network queues.
+   * If the CPU is not known, #MHD_WD_TWO_CHOICES is used.
+   */
+  MHD_WD_INCOMING_CPU = 3
+
+} _MHD_FIXED_ENUM;
+
+
 /**
  * Entry in an #MHD_OPTION_ARRAY.
  */
@@ -2621,6 +2953,36 @@ enum MHD_DaemonInfoType
    * value will be real port number.
    */
   MHD_DAEMON_INFO_BIND_PORT
+  ,
+  /**
+   * Request the number of requests answered from the response cache.
+   * No extra arguments should be passed.
+   * @sa #MHD_OPTION_RESPONSE_CACHE_SIZE
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_DAEMON_INFO_RESPONSE_CACHE_HITS
+  ,
+  /**
+   * Request the number of GET and HEAD requests not found in the response
+   * cache.
+   * No extra arguments should be passed.
+   * @sa #MHD_OPTION_RESPONSE_CACHE_SIZE
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_DAEMON_INFO_RESPONSE_CACHE_MISSES
+  ,
+  /**
+   * Request the number of current connections handled by one thread of
+   * the thread pool.
+   * This should be followed by an `unsigned int` argument with the index
+   * of the thread, from zero to the size of the pool minus one.
+   * Returns NULL if the daemon does not use the thread pool or if
+   * the index is too large.
+   * The result is #MHD_DaemonInfo::num_connections.
+   * @sa #MHD_OPTION_WORKER_DISTRIBUTION
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_DAEMON_INFO_WORKER_CONNECTIONS
 } _MHD_FIXED_ENUM;
 
 
@@ -2834,6 +3196,8 @@ typedef enum MHD_Result
  * Note that returning zero will cause libmicrohttpd to try again.
  * Thus, returning zero should only be used in conjunction
  * with MHD_suspend_connection() to avoid busy waiting.
+ * Return #MHD_CONTENT_READER_PENDING instead to wait for the data
+ * without suspending the connection.
  *
  * @param cls extra argument to the callback
  * @param pos position in the datastream to access;
@@ -2851,6 +3215,9 @@ typedef enum MHD_Result
  *    (since this would cause busy-waiting); 0 in "external" sockets
  *    polling mode will cause this function to be called again once
  *    any MHD_run*() function is called;
+ *  #MHD_CONTENT_READER_PENDING (-3) if the data is not ready yet, the
+ *    callback is called again for the same @a pos after the application
+ *    calls #MHD_content_reader_ready() for the connection;
  *  #MHD_CONTENT_READER_END_OF_STREAM (-1) for the regular
  *    end of transmission (with chunked encoding, MHD will then
  *    terminate the chunk and send any HTTP footers that might be
@@ -3803,6 +4170,41 @@ _MHD_EXTERN void
 MHD_resume_connection (struct MHD_Connection *connection);
 
 
+/**
+ * Signal that the data for the response of the connection is ready.
+ * The #MHD_ContentReaderCallback, which has returned
+ * #MHD_CONTENT_READER_PENDING for the connection, is called again.
+ *
+ * Unlike #MHD_resume_connection(), the connection is not removed from
+ * the event loop while waiting for the data: it is not polled for
+ * sending, but the disconnects by the client are detected and the
+ * connection timeout is applied (except thread-per-connection mode).
+ * Several calls made before the daemon processes the connection are
+ * combined into one.
+ *
+ * Can be called from any thread, including the content reader callback
+ * itself, and at any time until the request completion is notified by
+ * #MHD_OPTION_NOTIFY_COMPLETED.  If the data has been signalled before
+ * the content reader returned #MHD_CONTENT_READER_PENDING, the callback
+ * is called again immediately.  If the response is shared by several
+ * connections, this function must be called for every waiting
+ * connection.
+ *
+ * With the internal polling threads (except thread-per-connection mode)
+ * the daemon must be started with #MHD_USE_ITC (or
+ * #MHD_ALLOW_SUSPEND_RESUME), otherwise
+ * #MHD_CONTENT_READER_PENDING is handled as zero returned by the content
+ * reader.  If you are using this function in "external" sockets polling
+ * mode, the same requirements as for #MHD_resume_connection() apply.
+ *
+ * @param connection the connection waiting for the data
+ * @note Available since #MHD_VERSION 0x01000102
+ * @ingroup response
+ */
+_MHD_EXTERN void
+MHD_content_reader_ready (struct MHD_Connection *connection);
+
+
 /* **************** Response manipulation functions ***************** */
 
 
@@ -3890,6 +4292,53 @@ enum MHD_ResponseFlags
    * @note Available since #MHD_VERSION 0x00097701
    */
   MHD_RF_HEAD_ONLY_RESPONSE = 1 << 4
+  ,
+  /**
+   * Compress the response body on the fly with "gzip" or "deflate"
+   * content coding, if the client accepts it (as specified by the
+   * "Accept-Encoding" request header).
+   * The body compressed on the fly is sent with chunked transfer encoding,
+   * therefore such compression is used only for HTTP/1.1 clients.
+   * The buffer-based responses are compressed only once, on the first use,
+   * the compressed data is kept by the response and used for all
+   * replies; such replies are sent with "Content-Length" header.
+   * The body is not compressed if the response has "Content-Encoding" or
+   * "Content-Length" header set by the application, or if the response
+   * body is too small.
+   * The "Vary: Accept-Encoding" header is added automatically, unless
+   * the response has the "Vary" header set by the application.
+   * The entity-tag of the "ETag" header gets the name of the content
+   * coding as the suffix for the compressed replies.
+   * The flag has no effect if response compression is not supported,
+   * check #MHD_FEATURE_RESPONSE_COMPRESSION for availability.
+   * @sa #MHD_OPTION_RESPONSE_COMPRESSION_LEVEL,
+   *     #MHD_add_response_variant_static()
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_RF_COMPRESS = 1 << 5
+  ,
+  /**
+   * Serve the "Range" requests automatically.
+   * If the response is used with #MHD_HTTP_OK code to answer GET request
+   * with the "Range" header, the reply is sent with
+   * #MHD_HTTP_PARTIAL_CONTENT code and only the requested part of
+   * the body (or several parts as "multipart/byteranges" body).
+   * If none of the requested ranges can be satisfied, the reply is sent
+   * with #MHD_HTTP_RANGE_NOT_SATISFIABLE code.  The "If-Range" request
+   * header is checked against the "ETag" and "Last-Modified" headers of
+   * the response.  The header "Accept-Ranges: bytes" is added
+   * automatically, unless the response has this header set by
+   * the application.
+   * Only the responses with the body of the known size created from
+   * the buffer, from the array of buffers or from the file (but not from
+   * the pipe) are served partially, the "Range" header is ignored for
+   * other responses.  The "Range" header is ignored also if too many
+   * ranges are requested or if the ranges overlap too much.
+   * The ranges of the responses created from the file are sent by
+   * sendfile() when possible.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_RF_ACCEPT_RANGES = 1 << 6
 } _MHD_FIXED_FLAGS_ENUM;
 
 
@@ -3902,6 +4351,64 @@ enum MHD_ResponseOptions
    * End of the list of options.
    */
   MHD_RO_END = 0
+  ,
+  /**
+   * Set the entity-tag of the response body and answer the conditional
+   * requests automatically.
+   * Followed by the 'const char *' argument with the entity-tag in
+   * the quotes, optionally with the weakness indicator (like "\"abc\"" or
+   * "W/\"abc\"").  The "ETag" header is added to the response.
+   * If the response is used with #MHD_HTTP_OK code to answer GET or HEAD
+   * request with the "If-None-Match" header matching the entity-tag, then
+   * the reply is sent with #MHD_HTTP_NOT_MODIFIED code and without
+   * the body, the body data is not read.
+   * The response must not have the "ETag" header.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_RO_ETAG = 1
+  ,
+  /**
+   * Set the modification time of the response body and answer
+   * the conditional requests automatically.
+   * Followed by the 'uint64_t' argument with the number of seconds since
+   * the epoch (1970-01-01 00:00:00 UTC).  The "Last-Modified" header is
+   * added to the response.
+   * If the response is used with #MHD_HTTP_OK code to answer GET or HEAD
+   * request without the "If-None-Match" header and with
+   * the "If-Modified-Since" header with the time not earlier than
+   * the modification time, then the reply is sent with
+   * #MHD_HTTP_NOT_MODIFIED code and without the body.
+   * The response must not have the "Last-Modified" header.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_RO_LAST_MODIFIED = 2
+  ,
+  /**
+   * Set the entity-tag and the modification time of the response body
+   * from the file of the response and answer the conditional requests
+   * automatically, as with #MHD_RO_ETAG and #MHD_RO_LAST_MODIFIED.
+   * The entity-tag is derived from the modification time and the size of
+   * the file.
+   * No argument follows this option.
+   * The response must be created from the file (not from the pipe) and
+   * must not have the "ETag" and "Last-Modified" headers.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_RO_VALIDATORS_FROM_FD = 3
+  ,
+  /**
+   * Keep the response in the cache of the daemon and answer the next
+   * matching requests without calling the access handler callback.
+   * Followed by the 'unsigned int' argument with the time (in seconds)
+   * the response is kept in the cache, zero disables caching.
+   * Used only if the cache is enabled by #MHD_OPTION_RESPONSE_CACHE_SIZE
+   * and the response is used to answer GET or HEAD request without
+   * the body.  The response is not cached if it has "Vary" header with
+   * "*" value.
+   * The cached response must not be modified.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_RO_CACHE_TTL = 4
 } _MHD_FIXED_ENUM;
 
 
@@ -4360,6 +4867,36 @@ enum MHD_UpgradeAction
    * Disable CORKing on the underlying socket.
    */
   MHD_UPGRADE_ACTION_CORK_OFF = 2
+  ,
+  /**
+   * Let MHD forward all data between the client and the given file
+   * descriptor in both directions.
+   *
+   * Takes one extra 'int' argument: the file descriptor (a connected
+   * socket) to forward data to and from.  On success MHD takes ownership
+   * of this file descriptor and switches it to the non-blocking mode.
+   * The data is moved by the kernel by splice() through the internal
+   * pipes, without copying to user space.
+   * The end of stream in one direction is reflected by shutdown() of
+   * the other side for writing.  When both directions are finished (or
+   * on any unrecoverable error) MHD closes the file descriptor and
+   * finishes the upgraded connection like after #MHD_UPGRADE_ACTION_CLOSE,
+   * so the application must not use #MHD_UPGRADE_ACTION_CLOSE after
+   * successful tunnel action.
+   *
+   * Any data given to the application as @a extra_in of
+   * #MHD_UpgradeHandler must be written to the file descriptor by
+   * the application before this action.
+   *
+   * Supported only for connections without TLS, with #MHD_USE_EPOLL
+   * (without thread-per-connection), on platforms with splice() and
+   * only when SIGPIPE is blocked or handled by application (see
+   * #MHD_OPTION_SIGPIPE_HANDLED_BY_APP).  Returns #MHD_NO if not
+   * supported; the application still owns the file descriptor in this
+   * case and may forward the data by itself.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_UPGRADE_ACTION_TUNNEL = 3
 
 } _MHD_FIXED_ENUM;
 
@@ -4613,6 +5150,130 @@ MHD_get_response_header (struct MHD_Response *response,
                          const char *key);
 
 
+/**
+ * Add the variant of the response body encoded with the content coding.
+ *
+ * The variant is used instead of the response body if the client accepts
+ * the content coding (as specified by the "Accept-Encoding" request header).
+ * If several variants (or the variants compressed by MHD, see
+ * #MHD_RF_COMPRESS) are acceptable, the variant with the highest weight
+ * is used, the variants added earlier are preferred for the equal
+ * weights.  The reply with the variant has the same headers as
+ * the response plus "Content-Encoding" header, the "ETag" header gets
+ * the name of the content coding as the suffix of the entity-tag (for
+ * example, "abc" becomes "abc-br"), so each variant has its own
+ * validator.  The "Vary" header with
+ * "Accept-Encoding" value is added automatically to all replies with
+ * the response, unless the response has "Vary" header.
+ *
+ * The variants are not used for the responses with "Content-Encoding"
+ * header, for the responses with #MHD_HTTP_PARTIAL_CONTENT and for
+ * the replies without the body.
+ *
+ * This function must be used before the response is queued for
+ * the first time.
+ *
+ * The buffer with the variant data is not copied, it must be valid until
+ * all replies with the response are completed (for example, until
+ * the daemon is stopped).
+ *
+ * @param response the response to add the variant to
+ * @param encoding the name of the content coding (like "br" or "zstd"),
+ *                 must not be "identity", must be unique for the response
+ * @param size the size of the encoded data
+ * @param buffer the encoded data
+ * @return #MHD_YES on success,
+ *         #MHD_NO on error (invalid parameters, duplicated coding or
+ *         out of memory)
+ * @note Available since #MHD_VERSION 0x01000102
+ * @ingroup response
+ */
+_MHD_EXTERN enum MHD_Result
+MHD_add_response_variant_static (struct MHD_Response *response,
+                                 const char *encoding,
+                                 size_t size,
+                                 const void *buffer);
+
+
+/* ********************** File cache functions ********************** */
+
+/**
+ * Handle for the cache of the file-based responses.
+ *
+ * The cache keeps the opened files together with the ready responses, so
+ * repeated requests for the same file are answered without opening and
+ * checking the file again.
+ * @note Available since #MHD_VERSION 0x01000102
+ */
+struct MHD_FileCache;
+
+
+/**
+ * Create the cache of the file-based responses.
+ *
+ * The cached files are checked again (and reopened if the file has been
+ * modified or replaced) when the entry is older than @a ttl seconds.
+ * When the limits are reached, the least recently used entries are
+ * removed from the cache.  The responses are created with
+ * #MHD_RO_VALIDATORS_FROM_FD option, so the conditional requests are
+ * answered automatically.
+ *
+ * The cache can be used by any number of daemons and threads.
+ *
+ * @param max_entries the maximum number of the cached files,
+ *                    must not be zero
+ * @param max_size the maximum total size of the cached files, the larger
+ *                 files are served without caching
+ * @param ttl the time (in seconds) after which the cached file is checked
+ *            again, zero to check the file every time it is used
+ * @param flags the flags for the responses (like #MHD_RF_ACCEPT_RANGES)
+ * @return the new cache,
+ *         NULL on error (invalid parameters or out of memory)
+ * @note Available since #MHD_VERSION 0x01000102
+ * @ingroup response
+ */
+_MHD_EXTERN struct MHD_FileCache *
+MHD_file_cache_create (unsigned int max_entries,
+                       uint64_t max_size,
+                       unsigned int ttl,
+                       enum MHD_ResponseFlags flags);
+
+
+/**
+ * Get the response with the content of the regular file.
+ *
+ * The returned response is shared by all users of the cache, it must not
+ * be modified (no headers can be added).  The response must be destroyed
+ * by #MHD_destroy_response() when it is not needed anymore (typically
+ * right after #MHD_queue_response()).
+ *
+ * @param cache the cache to use
+ * @param filename the name of the file
+ * @return the response with the content of the file,
+ *         NULL if the file cannot be opened, is not a regular file or
+ *         on error (out of memory)
+ * @note Available since #MHD_VERSION 0x01000102
+ * @ingroup response
+ */
+_MHD_EXTERN struct MHD_Response *
+MHD_file_cache_get_response (struct MHD_FileCache *cache,
+                             const char *filename);
+
+
+/**
+ * Destroy the cache of the file-based responses.
+ *
+ * The responses obtained from the cache remain valid until destroyed by
+ * #MHD_destroy_response().
+ *
+ * @param cache the cache to destroy
+ * @note Available since #MHD_VERSION 0x01000102
+ * @ingroup response
+ */
+_MHD_EXTERN void
+MHD_file_cache_destroy (struct MHD_FileCache *cache);
+
+
 /* ********************** PostProcessor functions ********************** */
 
 /**
@@ -4665,6 +5326,40 @@ MHD_post_process (struct MHD_PostProcessor *pp,
                   size_t post_data_len);
 
 
+/**
+ * Parse and process POST data, the same as #MHD_post_process(), but
+ * the post processor is allowed to modify the @a post_data.
+ *
+ * For "application/x-www-form-urlencoded" encoding the values are decoded
+ * in place and each value (or the part of the value available in
+ * @a post_data) is given to #MHD_PostDataIterator in one call instead of
+ * copying it to the internal buffer in small pieces.  Unlike
+ * #MHD_post_process(), the value data given to the iterator is not
+ * zero-terminated.
+ * For other encodings this function works like #MHD_post_process().
+ *
+ * The "upload_data" of #MHD_AccessHandlerCallback is read-only and must
+ * not be given to this function.  To process the request body without
+ * copying, the application can receive the body into its own buffer
+ * with #MHD_CONNECTION_OPTION_UPLOAD_BUFFER: the "upload_data" then
+ * points into this buffer and the application can give the same data
+ * to this function by its own (non-const) pointer to the buffer.
+ *
+ * @param pp the post processor
+ * @param post_data @a post_data_len bytes of POST data, the content is
+ *                  modified by this function
+ * @param post_data_len length of @a post_data
+ * @return #MHD_YES on success, #MHD_NO on error
+ *         (out-of-memory, iterator aborted, parse error)
+ * @note Available since #MHD_VERSION 0x01000102
+ * @ingroup request
+ */
+_MHD_EXTERN enum MHD_Result
+MHD_post_process_in_place (struct MHD_PostProcessor *pp,
+                           char *post_data,
+                           size_t post_data_len);
+
+
 /**
  * Release PostProcessor resources.
  *
@@ -6127,7 +6822,34 @@ enum MHD_CONNECTION_OPTION
    * Values larger than (UINT64_MAX / 2000 - 1) will
    * be clipped to this number.
    */
-  MHD_CONNECTION_OPTION_TIMEOUT
+  MHD_CONNECTION_OPTION_TIMEOUT = 0
+  ,
+
+  /**
+   * Receive the request body into the application-provided buffer
+   * instead of the buffer in the connection's memory pool.
+   * Followed by the pointer to the buffer (`void *`) and the size of
+   * the buffer (`size_t`).
+   * Could be set only by the #MHD_AccessHandlerCallback on the first
+   * call for the request with the body (when @a upload_data_size is
+   * zero) and before the response is queued.
+   * The data is read directly into the buffer, larger buffer results in
+   * fewer system calls and fewer calls of the access handler callback
+   * with larger portions of the upload data.  The @a upload_data given
+   * to the callback points to this buffer, the application may modify
+   * the data by its own pointer to the buffer (for example, with
+   * #MHD_post_process_in_place()), as MHD does not use the data after it
+   * is reported as processed by the callback.  MHD still processes the
+   * framing of the body (the content length or the chunked encoding).
+   * The buffer must be valid until the callback is called for
+   * the request with zero @a upload_data_size after the body, until
+   * a response is queued or until the request is terminated.  When
+   * the response is queued before the body is received, the data in
+   * the buffer is discarded.  The buffer should be at least several
+   * kilobytes.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_CONNECTION_OPTION_UPLOAD_BUFFER = 1
 
 } _MHD_FIXED_ENUM;
 
@@ -6147,6 +6869,38 @@ MHD_set_connection_option (struct MHD_Connection *connection,
                            ...);
 
 
+/**
+ * Write the rest of the request body directly to the file descriptor
+ * instead of giving it to the access handler callback.
+ *
+ * Must be called from the #MHD_AccessHandlerCallback before the upload
+ * is complete (on the first call for the request or on any call with
+ * the upload data).  Upload data given to the current call of the
+ * callback and marked as processed is not written to the @a fd.
+ * When the whole body has been written, the callback is called
+ * once more with zero @a upload_data_size, as usual.
+ *
+ * When possible (no TLS, no chunked encoding, the size of the body is
+ * known and the @a fd is a regular file not opened in "append" mode),
+ * the data is moved by the kernel without copying it to the user space.
+ * The data is written at the current position of the @a fd.
+ * The @a fd should be in the blocking mode.  MHD does not close the @a fd.
+ * If writing to the @a fd fails, the connection is closed.
+ *
+ * @param connection the connection to use
+ * @param fd the file descriptor to write the request body to
+ * @return #MHD_YES on success,
+ *         #MHD_NO if not called from the access handler callback, if
+ *         the body has been already received or if the FD has been
+ *         already set for this request
+ * @note Available since #MHD_VERSION 0x01000102
+ * @ingroup request
+ */
+_MHD_EXTERN enum MHD_Result
+MHD_set_connection_upload_fd (struct MHD_Connection *connection,
+                              int fd);
+
+
 /**
  * Information about an MHD daemon.
  */
@@ -6180,7 +6934,8 @@ union MHD_DaemonInfo
   int epoll_fd;
 
   /**
-   * Number of active connections, for #MHD_DAEMON_INFO_CURRENT_CONNECTIONS.
+   * Number of active connections, for #MHD_DAEMON_INFO_CURRENT_CONNECTIONS
+   * and #MHD_DAEMON_INFO_WORKER_CONNECTIONS.
    */
   unsigned int num_connections;
 
@@ -6191,6 +6946,12 @@ union MHD_DaemonInfo
    * daemon, especially if #MHD_USE_AUTO was set.
    */
   enum MHD_FLAG flags;
+
+  /**
+   * The number of requests, for #MHD_DAEMON_INFO_RESPONSE_CACHE_HITS and
+   * #MHD_DAEMON_INFO_RESPONSE_CACHE_MISSES.
+   */
+  uint64_t num_requests;
 };
 
 
@@ -6504,6 +7265,67 @@ enum MHD_FEATURE
    * @note Available since #MHD_VERSION 0x00097705
    */
   MHD_FEATURE_FLEXIBLE_FD_SETSIZE = 34
+  ,
+
+  /**
+   * Get whether #MHD_UPGRADE_ACTION_TUNNEL is supported.
+   * The action requires the splice() system call and is available only
+   * for plain-text connections when #MHD_USE_EPOLL is used without
+   * #MHD_USE_THREAD_PER_CONNECTION.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_FEATURE_UPGRADE_TUNNEL = 35
+  ,
+
+  /**
+   * Get whether decoding of the compressed request body is supported.
+   * If supported then #MHD_OPTION_DECOMPRESS_REQUEST_BODY could be used.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_FEATURE_BODY_DECODING = 36
+  ,
+
+  /**
+   * Get whether on-the-fly compression of the response body is supported.
+   * If supported then #MHD_RF_COMPRESS flag and
+   * #MHD_OPTION_RESPONSE_COMPRESSION_LEVEL could be used.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_FEATURE_RESPONSE_COMPRESSION = 37
+  ,
+
+  /**
+   * Get whether reading of the files by the separate I/O threads is
+   * supported.
+   * If supported then #MHD_OPTION_FILE_IO_THREADS could be used.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_FEATURE_FILE_IO_THREADS = 38
+  ,
+  /**
+   * Get whether binding of the internal threads to the CPUs is
+   * supported.
+   * If supported then #MHD_OPTION_THREAD_CPU_AFFINITY could be used.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_FEATURE_THREAD_CPU_AFFINITY = 39
+  ,
+  /**
+   * Get whether the reuse of the connection threads in
+   * thread-per-connection mode is supported.
+   * If supported then #MHD_OPTION_CONNECTION_THREADS_IDLE_MAX could be
+   * used.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_FEATURE_CONNECTION_THREADS_REUSE = 40
+  ,
+  /**
+   * Get whether calling of the access handler callback by the separate
+   * handler threads is supported.
+   * If supported then #MHD_OPTION_HANDLER_THREADS could be used.
+   * @note Available since #MHD_VERSION 0x01000102
+   */
+  MHD_FEATURE_HANDLER_THREADS = 41
 };
 
 #define MHD_FEATURE_HTTPS_COOKIE_PARSING _MHD_DEPR_IN_MACRO ( \
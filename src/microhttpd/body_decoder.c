@@ -0,0 +1,312 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     This library is free software; you can redistribute it and/or
+     modify it under the terms of the GNU Lesser General Public
+     License as published by the Free Software Foundation; either
+     version 2.1 of the License, or (at your option) any later version.
+
+     This library is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     Lesser General Public License for more details.
+
+     You should have received a copy of the GNU Lesser General Public
+     License along with this library; if not, write to the Free Software
+     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+/**
+ * @file microhttpd/body_decoder.c
+ * @brief  Decoding of the request body compressed with "gzip" or "deflate"
+ *
+ * The decompressor state (with the history window) is too large for
+ * the connection's memory pool and is allocated by zlib by malloc().
+ * The buffer for the decoded data is allocated in the pool, its size is
+ * limited by the free space in the pool.
+ */
+
+#include "body_decoder.h"
+#include "connection.h"
+#include "memorypool.h"
+#include "mhd_str.h"
+#include "mhd_compat.h"
+#include "mhd_assert.h"
+#include <zlib.h>
+
+
+/**
+ * The preferred size of the buffer for the decoded data
+ */
+#define MHD_BODY_DECODER_BUF_SIZE (16 * 1024)
+
+/**
+ * The minimal size of the buffer for the decoded data
+ */
+#define MHD_BODY_DECODER_BUF_MIN_SIZE 512
+
+
+/**
+ * The decoder of the compressed request body
+ */
+struct MHD_BodyDecoder
+{
+  /**
+   * The zlib stream
+   */
+  z_stream strm;
+
+  /**
+   * The buffer for the decoded data, allocated in the connection's pool
+   */
+  char *buf;
+
+  /**
+   * The size of the @a buf
+   */
+  size_t buf_size;
+
+  /**
+   * The size of the decoded data in the @a buf not processed by
+   * the application yet
+   */
+  size_t pending;
+
+  /**
+   * The total size of the decoded data
+   */
+  uint64_t total_out;
+
+  /**
+   * Set to true if the "gzip" format is decoded (several gzip members
+   * could be concatenated)
+   */
+  bool gzip;
+
+  /**
+   * Set to true if the end of the compressed stream has been reached
+   */
+  bool stream_end;
+};
+
+
+enum MHD_BodyDecoderResult
+MHD_body_decoder_init_ (struct MHD_Connection *connection)
+{
+  struct MHD_Connection *const c = connection; /* a short alias */
+  struct MHD_BodyDecoder *d;
+  const char *enc;
+  size_t enc_len;
+  size_t buf_size;
+  size_t avail;
+  bool gzip;
+
+  mhd_assert (NULL == c->rq.decoder);
+  if (0 == c->daemon->body_decoding_limit)
+    return MHD_BODY_DECODER_OK;
+  if (MHD_NO ==
+      MHD_lookup_connection_value_n (c,
+                                     MHD_HEADER_KIND,
+                                     MHD_HTTP_HEADER_CONTENT_ENCODING,
+                                     MHD_STATICSTR_LEN_ ( \
+                                       MHD_HTTP_HEADER_CONTENT_ENCODING),
+                                     &enc,
+                                     &enc_len))
+    return MHD_BODY_DECODER_OK;
+  if (MHD_str_equal_caseless_s_bin_n_ ("gzip", enc, enc_len) ||
+      MHD_str_equal_caseless_s_bin_n_ ("x-gzip", enc, enc_len))
+    gzip = true;
+  else if (MHD_str_equal_caseless_s_bin_n_ ("deflate", enc, enc_len))
+    gzip = false;
+  else
+    return MHD_BODY_DECODER_OK; /* Give the body to the application as is */
+
+  /* Leave at least a half of the free space for the read buffer */
+  avail = MHD_pool_get_free (c->pool);
+  if ((NULL != c->read_buffer) && (! c->rq.upload_buf_ext))
+    avail += c->read_buffer_size - c->read_buffer_offset;
+  buf_size = avail / 2;
+  if (MHD_BODY_DECODER_BUF_SIZE < buf_size)
+    buf_size = MHD_BODY_DECODER_BUF_SIZE;
+  else if (MHD_BODY_DECODER_BUF_MIN_SIZE > buf_size)
+    buf_size = MHD_BODY_DECODER_BUF_MIN_SIZE;
+
+  d = (struct MHD_BodyDecoder *) MHD_calloc_ (1, sizeof(*d));
+  if (NULL == d)
+    return MHD_BODY_DECODER_NO_MEMORY;
+  d->buf = (char *) MHD_connection_alloc_memory_ (c, buf_size);
+  if (NULL == d->buf)
+  {
+    free (d);
+    return MHD_BODY_DECODER_NO_MEMORY;
+  }
+  d->buf_size = buf_size;
+  d->gzip = gzip;
+  d->strm.zalloc = Z_NULL;
+  d->strm.zfree = Z_NULL;
+  d->strm.opaque = Z_NULL;
+  /* "gzip" is decoded with gzip wrapper (window bits + 16),
+     "deflate" is the zlib format (RFC 9110, section 8.4.1.2) */
+  if (Z_OK != inflateInit2 (&d->strm,
+                            gzip ? (MAX_WBITS + 16) : MAX_WBITS))
+  {
+    free (d);
+    return MHD_BODY_DECODER_NO_MEMORY;
+  }
+  c->rq.decoder = d;
+  return MHD_BODY_DECODER_OK;
+}
+
+
+/**
+ * Give the pending decoded data to the application.
+ *
+ * @param connection the connection to use
+ * @param deliver the function to give the decoded data to
+ * @param[out] progress set to true if the application processed any data
+ * @return #MHD_BODY_DECODER_OK if all pending data has been processed,
+ *         #MHD_BODY_DECODER_PENDING if some data left unprocessed,
+ *         #MHD_BODY_DECODER_CLOSED if connection has been closed
+ */
+static enum MHD_BodyDecoderResult
+body_decoder_flush (struct MHD_Connection *connection,
+                    MHD_BodyDecoderDeliver_ deliver,
+                    bool *progress)
+{
+  struct MHD_BodyDecoder *const d = connection->rq.decoder;
+  size_t left;
+  size_t processed;
+
+  *progress = false;
+  if (0 == d->pending)
+    return MHD_BODY_DECODER_OK;
+  left = d->pending;
+  if (! deliver (connection,
+                 d->buf,
+                 &left))
+    return MHD_BODY_DECODER_CLOSED;
+  processed = d->pending - left;
+  *progress = (0 != processed);
+  if ((0 != processed) && (0 != left))
+    memmove (d->buf,
+             d->buf + processed,
+             left);
+  d->pending = left;
+  return (0 == left) ? MHD_BODY_DECODER_OK : MHD_BODY_DECODER_PENDING;
+}
+
+
+enum MHD_BodyDecoderResult
+MHD_body_decoder_process_ (struct MHD_Connection *connection,
+                           const char *data,
+                           size_t *size,
+                           MHD_BodyDecoderDeliver_ deliver)
+{
+  struct MHD_BodyDecoder *const d = connection->rq.decoder;
+  const size_t limit = connection->daemon->body_decoding_limit;
+  z_stream *const strm = &d->strm;
+  size_t in_left;
+
+  in_left = *size;
+  while (1)
+  {
+    enum MHD_BodyDecoderResult res;
+    size_t in_chunk;
+    size_t produced;
+    bool progress;
+    int ret;
+
+    res = body_decoder_flush (connection,
+                              deliver,
+                              &progress);
+    if (MHD_BODY_DECODER_CLOSED == res)
+      return res;
+    if ((MHD_BODY_DECODER_PENDING == res) &&
+        ((! progress) || connection->suspended))
+      break; /* The application needs more time to process the data */
+    if (MHD_BODY_DECODER_PENDING == res)
+      continue; /* Some data processed, give the rest of the data */
+    if (0 == in_left)
+      break;
+    if (d->stream_end)
+    {
+      /* Some data after the end of the compressed stream */
+      if (! d->gzip)
+        return MHD_BODY_DECODER_CORRUPT;
+      /* Next gzip member (RFC 1952, section 2.2) */
+      if (Z_OK != inflateReset (strm))
+        return MHD_BODY_DECODER_CORRUPT;
+      d->stream_end = false;
+    }
+    in_chunk = in_left;
+    if ((uInt) in_chunk != in_chunk)
+      in_chunk = (size_t) ((uInt) ~((uInt) 0));
+    strm->next_in = (Bytef *) (void *) (data + (*size - in_left));
+    strm->avail_in = (uInt) in_chunk;
+    strm->next_out = (Bytef *) (void *) (d->buf + d->pending);
+    strm->avail_out = (uInt) (d->buf_size - d->pending);
+    ret = inflate (strm,
+                   Z_NO_FLUSH);
+    in_left -= in_chunk - strm->avail_in;
+    produced = (d->buf_size - d->pending) - strm->avail_out;
+    d->pending += produced;
+    d->total_out += produced;
+    if (d->total_out > limit)
+      return MHD_BODY_DECODER_TOO_LARGE;
+    if (Z_STREAM_END == ret)
+      d->stream_end = true;
+    else if (Z_MEM_ERROR == ret)
+      return MHD_BODY_DECODER_NO_MEMORY;
+    else if ((Z_OK != ret) && (Z_BUF_ERROR != ret))
+      return MHD_BODY_DECODER_CORRUPT;
+  }
+  *size = in_left;
+  return MHD_BODY_DECODER_OK;
+}
+
+
+enum MHD_BodyDecoderResult
+MHD_body_decoder_finish_ (struct MHD_Connection *connection,
+                          MHD_BodyDecoderDeliver_ deliver)
+{
+  struct MHD_BodyDecoder *const d = connection->rq.decoder;
+  enum MHD_BodyDecoderResult res;
+  bool progress;
+
+  do
+  {
+    res = body_decoder_flush (connection,
+                              deliver,
+                              &progress);
+  } while ((MHD_BODY_DECODER_PENDING == res) && progress &&
+           (! connection->suspended));
+  if (MHD_BODY_DECODER_OK != res)
+    return res;
+  if (! d->stream_end)
+    return MHD_BODY_DECODER_CORRUPT; /* Truncated compressed data */
+  return MHD_BODY_DECODER_OK;
+}
+
+
+bool
+MHD_body_decoder_has_pending_ (struct MHD_Connection *connection)
+{
+  return (NULL != connection->rq.decoder) &&
+         (0 != connection->rq.decoder->pending);
+}
+
+
+void
+MHD_body_decoder_cleanup_ (struct MHD_Connection *connection)
+{
+  struct MHD_BodyDecoder *const d = connection->rq.decoder;
+
+  if (NULL == d)
+    return;
+  /* The buffer is allocated in the pool and is freed with the pool */
+  inflateEnd (&d->strm);
+  free (d);
+  connection->rq.decoder = NULL;
+}
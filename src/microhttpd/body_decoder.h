@@ -0,0 +1,159 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     This library is free software; you can redistribute it and/or
+     modify it under the terms of the GNU Lesser General Public
+     License as published by the Free Software Foundation; either
+     version 2.1 of the License, or (at your option) any later version.
+
+     This library is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     Lesser General Public License for more details.
+
+     You should have received a copy of the GNU Lesser General Public
+     License along with this library; if not, write to the Free Software
+     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+/**
+ * @file microhttpd/body_decoder.h
+ * @brief  Decoding of the compressed request body
+ */
+
+#ifndef MHD_BODY_DECODER_H
+#define MHD_BODY_DECODER_H 1
+
+#include "internal.h"
+
+#ifdef BODY_DECODING_SUPPORT
+
+/**
+ * The result of the request body decoding
+ */
+enum MHD_BodyDecoderResult
+{
+  /**
+   * Success
+   */
+  MHD_BODY_DECODER_OK = 0,
+
+  /**
+   * Some decoded data has not been processed by the application yet
+   */
+  MHD_BODY_DECODER_PENDING,
+
+  /**
+   * The compressed data is broken or truncated
+   */
+  MHD_BODY_DECODER_CORRUPT,
+
+  /**
+   * The decoded data is larger than allowed by the daemon settings
+   */
+  MHD_BODY_DECODER_TOO_LARGE,
+
+  /**
+   * Not enough memory
+   */
+  MHD_BODY_DECODER_NO_MEMORY,
+
+  /**
+   * The connection has been closed by the delivery callback
+   */
+  MHD_BODY_DECODER_CLOSED
+};
+
+
+/**
+ * Give the decoded request body data to the application.
+ *
+ * @param connection the connection to use
+ * @param data the decoded data
+ * @param[in,out] size the size of the @a data, updated with the size of
+ *                     the data left unprocessed by the application
+ * @return true on success, false if connection has been closed
+ */
+typedef bool
+(*MHD_BodyDecoderDeliver_)(struct MHD_Connection *connection,
+                           const char *data,
+                           size_t *size);
+
+
+/**
+ * Create the decoder for the request body, if decoding is enabled for
+ * the daemon and the request has supported "Content-Encoding".
+ *
+ * @param connection the connection to use
+ * @return #MHD_BODY_DECODER_OK on success (or if decoding is not needed),
+ *         #MHD_BODY_DECODER_NO_MEMORY if memory allocation failed
+ */
+enum MHD_BodyDecoderResult
+MHD_body_decoder_init_ (struct MHD_Connection *connection);
+
+
+/**
+ * Decode the compressed request body data and give the decoded data
+ * to the application.
+ *
+ * The decoded data left unprocessed by the application is kept by
+ * the decoder and given to the application before any new data.  While
+ * the decoder has pending data, the new compressed data is not consumed.
+ * With zero @a size only the pending decoded data is given.
+ *
+ * @param connection the connection to use
+ * @param data the compressed data
+ * @param[in,out] size the size of the @a data, updated with the size of
+ *                     the compressed data not consumed by the decoder
+ * @param deliver the function to give the decoded data to
+ * @return #MHD_BODY_DECODER_OK on success,
+ *         error code otherwise
+ */
+enum MHD_BodyDecoderResult
+MHD_body_decoder_process_ (struct MHD_Connection *connection,
+                           const char *data,
+                           size_t *size,
+                           MHD_BodyDecoderDeliver_ deliver);
+
+
+/**
+ * Give the rest of the decoded data to the application and check
+ * whether the compressed data has been terminated properly.
+ * Must be called when the whole request body has been processed.
+ *
+ * @param connection the connection to use
+ * @param deliver the function to give the decoded data to
+ * @return #MHD_BODY_DECODER_OK on success,
+ *         #MHD_BODY_DECODER_PENDING if the application has not processed
+ *         all decoded data,
+ *         error code otherwise
+ */
+enum MHD_BodyDecoderResult
+MHD_body_decoder_finish_ (struct MHD_Connection *connection,
+                          MHD_BodyDecoderDeliver_ deliver);
+
+
+/**
+ * Check whether the decoder has decoded data not processed by
+ * the application.
+ *
+ * @param connection the connection to use
+ * @return true if some decoded data is pending, false otherwise
+ */
+bool
+MHD_body_decoder_has_pending_ (struct MHD_Connection *connection);
+
+
+/**
+ * Release the decoder of the request body, if any.
+ *
+ * @param connection the connection to use
+ */
+void
+MHD_body_decoder_cleanup_ (struct MHD_Connection *connection);
+
+#endif /* BODY_DECODING_SUPPORT */
+
+#endif /* ! MHD_BODY_DECODER_H */
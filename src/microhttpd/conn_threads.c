@@ -0,0 +1,459 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     This library is free software; you can redistribute it and/or
+     modify it under the terms of the GNU Lesser General Public
+     License as published by the Free Software Foundation; either
+     version 2.1 of the License, or (at your option) any later version.
+
+     This library is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     Lesser General Public License for more details.
+
+     You should have received a copy of the GNU Lesser General Public
+     License along with this library; if not, write to the Free Software
+     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+/**
+ * @file microhttpd/conn_threads.c
+ * @brief  The reuse of the connection threads in thread-per-connection mode
+ *
+ * When the connection is closed, its thread is not finished, but parked
+ * in the pool of the idle threads (up to the limit set by the
+ * application).  The new connection is given to the most recently parked
+ * thread, which is woken up by its own inter-thread communication
+ * channel.  The new thread is created only if no idle thread is
+ * available.  The idle threads exit after the timeout and are joined by
+ * the daemon thread.
+ *
+ * As the thread is not finished when the connection is closed, the
+ * thread sets 'thread_joined' of the connection instead, when it does
+ * not use the connection anymore, and signals the daemon to clean up
+ * the connection.
+ */
+
+#include "conn_threads.h"
+
+#ifdef MHD_CONN_THREADS_SUPPORT
+
+#include "mhd_itc.h"
+#include "mhd_compat.h"
+#include "mhd_assert.h"
+#include "mhd_locks.h"
+#include "mhd_mono_clock.h"
+#include "mhd_limits.h"
+
+
+/**
+ * The connection thread
+ */
+struct MHD_ConnThread
+{
+  /**
+   * The next thread in the list of all threads of the pool
+   */
+  struct MHD_ConnThread *next;
+
+  /**
+   * The previous thread in the list of all threads of the pool
+   */
+  struct MHD_ConnThread *prev;
+
+  /**
+   * The next thread in the list of the idle threads
+   */
+  struct MHD_ConnThread *next_idle;
+
+  /**
+   * The pool of the thread
+   */
+  struct MHD_ConnThreadPool *pool;
+
+  /**
+   * The connection to process, NULL while the thread is idle
+   */
+  struct MHD_Connection *connection;
+
+  /**
+   * The handle of the thread
+   */
+  MHD_thread_handle_ID_ tid;
+
+  /**
+   * Set to true when the thread does not process the connections
+   * anymore and must be joined
+   */
+  bool exited;
+
+  /**
+   * The channel to wake up the idle thread
+   */
+  struct MHD_itc_ itc;
+};
+
+
+/**
+ * The pool of the connection threads
+ */
+struct MHD_ConnThreadPool
+{
+  /**
+   * The daemon of the connections
+   */
+  struct MHD_Daemon *daemon;
+
+  /**
+   * The function processing the connection
+   */
+  MHD_THREAD_START_ROUTINE_ routine;
+
+  /**
+   * The first thread in the list of all threads.
+   * The list is modified only by the daemon thread.
+   */
+  struct MHD_ConnThread *head;
+
+  /**
+   * The last thread in the list of all threads
+   */
+  struct MHD_ConnThread *tail;
+
+  /**
+   * The idle threads, the most recently parked first
+   */
+  struct MHD_ConnThread *idle;
+
+  /**
+   * The number of the idle threads
+   */
+  unsigned int num_idle;
+
+  /**
+   * Set to true when the threads must exit
+   */
+  bool shutdown;
+
+  /**
+   * The lock for the list of the idle threads, the 'connection' and
+   * the 'exited' members of the threads and @e shutdown
+   */
+  MHD_mutex_ lock;
+};
+
+
+/**
+ * Park the thread in the list of the idle threads and wait for the next
+ * connection.
+ *
+ * @param t the thread
+ * @return the next connection to process,
+ *         NULL if the thread must exit
+ */
+static struct MHD_Connection *
+wait_for_connection (struct MHD_ConnThread *t)
+{
+  struct MHD_ConnThreadPool *const pool = t->pool;
+  struct MHD_Daemon *const daemon = pool->daemon;
+  const uint64_t timeout_ms =
+    ((uint64_t) daemon->conn_threads_idle_timeout) * 1000;
+  const uint64_t start = MHD_monotonic_msec_counter ();
+  struct MHD_Connection *c;
+
+  MHD_mutex_lock_chk_ (&pool->lock);
+  t->connection = NULL;
+  if ( (pool->shutdown) ||
+       (pool->num_idle >= daemon->conn_threads_idle_max) )
+  {
+    t->exited = true;
+    MHD_mutex_unlock_chk_ (&pool->lock);
+    return NULL;
+  }
+  t->next_idle = pool->idle;
+  pool->idle = t;
+  pool->num_idle++;
+  MHD_mutex_unlock_chk_ (&pool->lock);
+
+  while (1)
+  {
+    struct pollfd p;
+    uint64_t elapsed;
+    int wait_ms;
+
+    elapsed = MHD_monotonic_msec_counter () - start;
+    if (elapsed >= timeout_ms)
+      wait_ms = 0;
+    else if (timeout_ms - elapsed > INT_MAX)
+      wait_ms = INT_MAX;
+    else
+      wait_ms = (int) (timeout_ms - elapsed);
+    p.fd = MHD_itc_r_fd_ (t->itc);
+    p.events = POLLIN;
+    p.revents = 0;
+    if (0 < MHD_sys_poll_ (&p, 1, wait_ms))
+      MHD_itc_clear_ (t->itc);
+
+    MHD_mutex_lock_chk_ (&pool->lock);
+    c = t->connection;
+    if (NULL != c)
+      break; /* Already removed from the idle list */
+    if ( (pool->shutdown) ||
+         (0 == wait_ms) )
+    {
+      struct MHD_ConnThread **pp;
+
+      for (pp = &pool->idle; t != *pp; pp = &((*pp)->next_idle))
+        mhd_assert (NULL != *pp);
+      *pp = t->next_idle;
+      pool->num_idle--;
+      t->exited = true;
+      break;
+    }
+    MHD_mutex_unlock_chk_ (&pool->lock);
+  }
+  MHD_mutex_unlock_chk_ (&pool->lock);
+  return c;
+}
+
+
+/**
+ * The main function of the connection thread.
+ *
+ * @param cls the connection thread
+ * @return always zero
+ */
+static MHD_THRD_RTRN_TYPE_ MHD_THRD_CALL_SPEC_
+conn_thread_main (void *cls)
+{
+  struct MHD_ConnThread *const t = (struct MHD_ConnThread *) cls;
+  struct MHD_ConnThreadPool *const pool = t->pool;
+  struct MHD_Daemon *const daemon = pool->daemon;
+  struct MHD_Connection *c;
+
+  MHD_mutex_lock_chk_ (&pool->lock);
+  c = t->connection;
+  MHD_mutex_unlock_chk_ (&pool->lock);
+  while (NULL != c)
+  {
+    (void) pool->routine (c);
+    /* The connection is not used by this thread anymore */
+    MHD_mutex_lock_chk_ (&daemon->cleanup_connection_mutex);
+    c->thread_joined = true;
+    MHD_mutex_unlock_chk_ (&daemon->cleanup_connection_mutex);
+    if (! MHD_itc_activate_ (daemon->itc, "t"))
+    {
+#ifdef HAVE_MESSAGES
+      MHD_DLOG (daemon,
+                _ ("Failed to signal thread termination via inter-thread " \
+                   "communication channel.\n"));
+#endif /* HAVE_MESSAGES */
+    }
+    c = wait_for_connection (t);
+  }
+  /* Let the daemon thread join this thread */
+  (void) MHD_itc_activate_ (daemon->itc, "t");
+  return (MHD_THRD_RTRN_TYPE_) 0;
+}
+
+
+bool
+MHD_conn_threads_init_ (struct MHD_Daemon *daemon,
+                        MHD_THREAD_START_ROUTINE_ routine)
+{
+  struct MHD_ConnThreadPool *pool;
+
+  mhd_assert (NULL == daemon->master);
+  daemon->conn_threads = NULL;
+  if (0 == daemon->conn_threads_idle_max)
+    return true;
+  mhd_assert (MHD_D_IS_USING_THREAD_PER_CONN_ (daemon));
+
+  pool = (struct MHD_ConnThreadPool *) MHD_calloc_ (1, sizeof(*pool));
+  if (NULL == pool)
+    return false;
+  if (! MHD_mutex_init_ (&pool->lock))
+  {
+    free (pool);
+    return false;
+  }
+  pool->daemon = daemon;
+  pool->routine = routine;
+  daemon->conn_threads = pool;
+  return true;
+}
+
+
+bool
+MHD_conn_threads_start_ (struct MHD_Connection *c)
+{
+  struct MHD_Daemon *const daemon = c->daemon;
+  struct MHD_ConnThreadPool *const pool = daemon->conn_threads;
+  struct MHD_ConnThread *t;
+  int eno;
+
+  mhd_assert (NULL != pool);
+  mhd_assert (MHD_ITC_IS_VALID_ (daemon->itc));
+  c->thread_reused = true;
+
+  MHD_mutex_lock_chk_ (&pool->lock);
+  t = pool->idle;
+  if (NULL != t)
+  {
+    pool->idle = t->next_idle;
+    pool->num_idle--;
+    MHD_thread_handle_ID_set_native_handle_ ( \
+      &c->tid, MHD_thread_handle_ID_get_native_handle_ (t->tid));
+    t->connection = c;
+    MHD_mutex_unlock_chk_ (&pool->lock);
+    if (! MHD_itc_activate_ (t->itc, "c"))
+    {
+      /* The thread takes the connection after the idle timeout */
+#ifdef HAVE_MESSAGES
+      MHD_DLOG (daemon,
+                _ ("Failed to signal idle connection thread via " \
+                   "inter-thread communication channel.\n"));
+#endif /* HAVE_MESSAGES */
+    }
+    return true;
+  }
+  MHD_mutex_unlock_chk_ (&pool->lock);
+
+  /* No idle threads, start the new one */
+  t = (struct MHD_ConnThread *) MHD_calloc_ (1, sizeof(*t));
+  if (NULL == t)
+  {
+#if defined(ENOMEM) && (ENOMEM + 0 != 0)
+    errno = ENOMEM;
+#endif
+    return false;
+  }
+  if (! MHD_itc_init_ (t->itc))
+  {
+    eno = errno;
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("Failed to create inter-thread communication channel " \
+                 "for connection thread: %s\n"),
+              MHD_itc_last_strerror_ ());
+#endif /* HAVE_MESSAGES */
+    free (t);
+    errno = eno;
+    return false;
+  }
+  t->pool = pool;
+  t->connection = c;
+  MHD_mutex_lock_chk_ (&pool->lock);
+  DLL_insert (pool->head,
+              pool->tail,
+              t);
+  MHD_mutex_unlock_chk_ (&pool->lock);
+  if (! MHD_create_named_thread_ (&t->tid,
+                                  "MHD-connection",
+                                  daemon->thread_stack_size,
+                                  &conn_thread_main,
+                                  t))
+  {
+    eno = errno;
+    MHD_mutex_lock_chk_ (&pool->lock);
+    DLL_remove (pool->head,
+                pool->tail,
+                t);
+    MHD_mutex_unlock_chk_ (&pool->lock);
+    MHD_itc_destroy_chk_ (t->itc);
+    free (t);
+    errno = eno;
+    return false;
+  }
+  /* Only the handle is set here, the ID is set by the thread itself */
+  MHD_thread_handle_ID_set_native_handle_ ( \
+    &c->tid, MHD_thread_handle_ID_get_native_handle_ (t->tid));
+  return true;
+}
+
+
+void
+MHD_conn_threads_cleanup_ (struct MHD_Daemon *daemon)
+{
+  struct MHD_ConnThreadPool *const pool = daemon->conn_threads;
+  struct MHD_ConnThread *t;
+
+  if (NULL == pool)
+    return;
+  MHD_mutex_lock_chk_ (&pool->lock);
+  t = pool->head;
+  while (NULL != t)
+  {
+    struct MHD_ConnThread *const next = t->next;
+
+    if (t->exited)
+    {
+      DLL_remove (pool->head,
+                  pool->tail,
+                  t);
+      MHD_mutex_unlock_chk_ (&pool->lock);
+      if (! MHD_thread_handle_ID_join_thread_ (t->tid))
+        MHD_PANIC (_ ("Failed to join a thread.\n"));
+      MHD_itc_destroy_chk_ (t->itc);
+      free (t);
+      MHD_mutex_lock_chk_ (&pool->lock);
+    }
+    t = next;
+  }
+  MHD_mutex_unlock_chk_ (&pool->lock);
+}
+
+
+void
+MHD_conn_threads_stop_ (struct MHD_Daemon *daemon)
+{
+  struct MHD_ConnThreadPool *const pool = daemon->conn_threads;
+  struct MHD_ConnThread *t;
+
+  mhd_assert (NULL == daemon->master);
+  if (NULL == pool)
+    return;
+  MHD_mutex_lock_chk_ (&pool->lock);
+  pool->shutdown = true;
+  for (t = pool->idle; NULL != t; t = t->next_idle)
+  {
+    if (! MHD_itc_activate_ (t->itc, "e"))
+      MHD_PANIC (_ ("Failed to signal shutdown via inter-thread " \
+                    "communication channel.\n"));
+  }
+  MHD_mutex_unlock_chk_ (&pool->lock);
+
+  /* No threads are added after setting 'shutdown' */
+  while (NULL != (t = pool->head))
+  {
+    DLL_remove (pool->head,
+                pool->tail,
+                t);
+    if (! MHD_thread_handle_ID_join_thread_ (t->tid))
+      MHD_PANIC (_ ("Failed to join a thread.\n"));
+    MHD_itc_destroy_chk_ (t->itc);
+    free (t);
+  }
+  mhd_assert (NULL == pool->idle);
+}
+
+
+void
+MHD_conn_threads_deinit_ (struct MHD_Daemon *daemon)
+{
+  struct MHD_ConnThreadPool *const pool = daemon->conn_threads;
+
+  mhd_assert (NULL == daemon->master);
+  if (NULL == pool)
+    return;
+  MHD_conn_threads_stop_ (daemon);
+  MHD_mutex_destroy_chk_ (&pool->lock);
+  free (pool);
+  daemon->conn_threads = NULL;
+}
+
+#endif /* MHD_CONN_THREADS_SUPPORT */
+
+/* end of conn_threads.c */
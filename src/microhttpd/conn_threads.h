@@ -0,0 +1,109 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     This library is free software; you can redistribute it and/or
+     modify it under the terms of the GNU Lesser General Public
+     License as published by the Free Software Foundation; either
+     version 2.1 of the License, or (at your option) any later version.
+
+     This library is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     Lesser General Public License for more details.
+
+     You should have received a copy of the GNU Lesser General Public
+     License along with this library; if not, write to the Free Software
+     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+/**
+ * @file microhttpd/conn_threads.h
+ * @brief  The reuse of the connection threads in thread-per-connection mode
+ */
+
+#ifndef MHD_CONN_THREADS_H
+#define MHD_CONN_THREADS_H 1
+
+#include "internal.h"
+
+#ifdef MHD_CONN_THREADS_SUPPORT
+
+/**
+ * Create the pool of the connection threads, if the reuse of the
+ * threads is enabled for the @a daemon.
+ *
+ * @param daemon the master daemon
+ * @param routine the function processing the connection in the thread,
+ *                called with the connection as the argument
+ * @return true on success (or if the threads are not reused),
+ *         false if failed to allocate the memory or to create the mutex
+ */
+bool
+MHD_conn_threads_init_ (struct MHD_Daemon *daemon,
+                        MHD_THREAD_START_ROUTINE_ routine);
+
+
+/**
+ * Start processing of the new connection by the idle thread from
+ * the pool or by the new thread.
+ * The thread sets 'thread_joined' of the connection when it does not
+ * use the connection anymore and signals the daemon.
+ * @remark To be called only from thread that process
+ * daemon's select()/poll()/etc.
+ *
+ * @param c the new connection
+ * @return true on success, false if failed to start the new thread
+ *         (with errno set)
+ */
+bool
+MHD_conn_threads_start_ (struct MHD_Connection *c);
+
+
+/**
+ * Join the threads exited after the idle timeout.
+ * @remark To be called only from thread that process
+ * daemon's select()/poll()/etc.
+ *
+ * @param daemon the master daemon
+ */
+void
+MHD_conn_threads_cleanup_ (struct MHD_Daemon *daemon);
+
+
+/**
+ * Stop all threads of the pool and wait until they exit.
+ * The threads processing the connections exit when the connections are
+ * closed.  All connections are released by the threads when this
+ * function returns.
+ * Must not be called with the "cleanup" mutex of the daemon locked.
+ * Can be called several times.
+ *
+ * @param daemon the master daemon
+ */
+void
+MHD_conn_threads_stop_ (struct MHD_Daemon *daemon);
+
+
+/**
+ * Stop the threads (if not stopped yet) and free the resources.
+ *
+ * @param daemon the master daemon
+ */
+void
+MHD_conn_threads_deinit_ (struct MHD_Daemon *daemon);
+
+#else  /* ! MHD_CONN_THREADS_SUPPORT */
+
+#define MHD_conn_threads_init_(d,r) (((void) (d)), ! 0)
+
+#define MHD_conn_threads_cleanup_(d) ((void) (d))
+
+#define MHD_conn_threads_stop_(d) ((void) (d))
+
+#define MHD_conn_threads_deinit_(d) ((void) (d))
+
+#endif /* ! MHD_CONN_THREADS_SUPPORT */
+
+#endif /* ! MHD_CONN_THREADS_H */
@@ -30,6 +30,7 @@
 #include "connection.h"
 #include "memorypool.h"
 #include "response.h"
+#include "response_range.h"
 #include "mhd_mono_clock.h"
 #include "mhd_str.h"
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
@@ -55,6 +56,15 @@
 #endif /* HAVE_SYS_PARAM_H */
 #include "mhd_send.h"
 #include "mhd_assert.h"
+#include "mhd_ratelimit.h"
+#include "upload_fd.h"
+#include "response_cache.h"
+#include "file_io.h"
+#include "handler_threads.h"
+#include "response_compress.h"
+#ifdef BODY_DECODING_SUPPORT
+#include "body_decoder.h"
+#endif /* BODY_DECODING_SUPPORT */
 
 /**
  * Get whether bare LF in HTTP header and other protocol elements
@@ -521,6 +531,43 @@
 #define REQUEST_CHUNK_TOO_LARGE ""
 #endif
 
+#ifdef BODY_DECODING_SUPPORT
+/**
+ * Response text used when the compressed request body cannot be decoded.
+ */
+#ifdef HAVE_MESSAGES
+#define REQUEST_BODY_DECODING_FAILED \
+  "<html><head><title>Request malformed</title></head>" \
+  "<body>The compressed request body is broken.</body></html>"
+#else
+#define REQUEST_BODY_DECODING_FAILED ""
+#endif
+
+/**
+ * Response text used when the decoded request body is too large.
+ */
+#ifdef HAVE_MESSAGES
+#define REQUEST_BODY_DECODED_TOO_LARGE \
+  "<html><head><title>Request content too large</title></head>" \
+  "<body>The decompressed request body is too large.</body></html>"
+#else
+#define REQUEST_BODY_DECODED_TOO_LARGE ""
+#endif
+
+/**
+ * Response text used when no memory is left for decoding of
+ * the request body.
+ */
+#ifdef HAVE_MESSAGES
+#define REQUEST_BODY_DECODING_NO_MEMORY \
+  "<html><head><title>Internal server error</title></head>" \
+  "<body>Not enough memory to decompress the request body." \
+  "</body></html>"
+#else
+#define REQUEST_BODY_DECODING_NO_MEMORY ""
+#endif
+#endif /* BODY_DECODING_SUPPORT */
+
 /**
  * Response text used when the request HTTP content is too large.
  */
@@ -585,6 +632,18 @@
 #define REQ_HTTP_VER_IS_NOT_SUPPORTED ""
 #endif
 
+/**
+ * Response text used when the client exceeded the request rate limit.
+ */
+#ifdef HAVE_MESSAGES
+#define ERR_MSG_TOO_MANY_REQUESTS \
+  "<html><head><title>Too many requests</title></head>" \
+  "<body>Too many requests have been sent from your " \
+  "address.</body></html>"
+#else
+#define ERR_MSG_TOO_MANY_REQUESTS ""
+#endif
+
 
 /**
  * sendfile() chuck size
@@ -684,9 +743,10 @@ MHD_connection_alloc_memory_ (struct MHD_Connection *connection,
     else
       return NULL;
   }
-  else if (MHD_pool_is_resizable_inplace (pool,
-                                          c->read_buffer,
-                                          c->read_buffer_size))
+  else if ( (! c->rq.upload_buf_ext) &&
+            MHD_pool_is_resizable_inplace (pool,
+                                           c->read_buffer,
+                                           c->read_buffer_size) )
   {
     if (c->read_buffer_size - c->read_buffer_offset >= need_to_be_freed)
     {
@@ -1261,6 +1321,13 @@ MHD_connection_close_ (struct MHD_Connection *connection,
                               &connection->rq.client_context,
                               termination_code);
   connection->rq.client_aware = false;
+  MHD_upload_fd_cleanup_ (connection);
+#ifdef BODY_DECODING_SUPPORT
+  MHD_body_decoder_cleanup_ (connection);
+#endif /* BODY_DECODING_SUPPORT */
+#ifdef RESPONSE_COMPRESSION_SUPPORT
+  MHD_resp_compress_release_ (connection, true);
+#endif /* RESPONSE_COMPRESSION_SUPPORT */
   if (NULL != resp)
   {
     connection->rp.response = NULL;
@@ -1443,6 +1510,23 @@ try_ready_normal_body (struct MHD_Connection *connection)
        (response->data_size + response->data_start >
         connection->rp.rsp_write_position) )
     return MHD_YES; /* response already ready */
+#ifdef MHD_FILE_IO_SUPPORT
+  if ( (-1 != response->fd) &&
+       (! response->is_pipe) &&
+       (! MHD_file_io_is_ready_ (connection)) )
+  {
+    /* The connection is suspended until the data is read by I/O thread.
+       This could be called from the sending of the reply, do not try to
+       send more data when the connection is resumed, the state is checked
+       again by MHD_connection_handle_idle() first. */
+    connection->state = MHD_CONNECTION_NORMAL_BODY_UNREADY;
+    connection->event_loop_info = MHD_EVENT_LOOP_INFO_PROCESS;
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+    MHD_mutex_unlock_chk_ (&response->mutex);
+#endif
+    return MHD_NO;
+  }
+#endif /* MHD_FILE_IO_SUPPORT */
 #if defined(_MHD_HAVE_SENDFILE)
   if (MHD_resp_sender_sendfile == connection->rp.resp_sender)
   {
@@ -1457,6 +1541,21 @@ try_ready_normal_body (struct MHD_Connection *connection)
                        (size_t) MHD_MIN ((uint64_t) response->data_buffer_size,
                                          response->total_size
                                          - connection->rp.rsp_write_position));
+  if ( (MHD_CONTENT_READER_PENDING == ret) &&
+       (MHD_D_IS_USING_THREADS_ (connection->daemon)) &&
+       (! MHD_D_IS_USING_THREAD_PER_CONN_ (connection->daemon)) &&
+       (! MHD_ITC_IS_VALID_ (connection->daemon->itc)) )
+    ret = 0; /* Cannot be woken up, poll the content reader as for zero */
+  if (MHD_CONTENT_READER_PENDING == ret)
+  {
+    /* Wait for MHD_content_reader_ready() */
+    connection->rp.crc_waiting = true;
+    connection->state = MHD_CONNECTION_NORMAL_BODY_UNREADY;
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+    MHD_mutex_unlock_chk_ (&response->mutex);
+#endif
+    return MHD_NO;
+  }
   if (0 > ret)
   {
     /* either error or http 1.0 transfer, close socket! */
@@ -1518,7 +1617,12 @@ try_ready_chunked_body (struct MHD_Connection *connection,
   size_t size_to_fill;
 
   response = connection->rp.response;
+#ifdef RESPONSE_COMPRESSION_SUPPORT
+  mhd_assert (NULL != response->crc || NULL != response->data || \
+              (MHD_RESP_ENC_IDENTITY != connection->rp.props.encoding));
+#else  /* ! RESPONSE_COMPRESSION_SUPPORT */
   mhd_assert (NULL != response->crc || NULL != response->data);
+#endif /* ! RESPONSE_COMPRESSION_SUPPORT */
 
   mhd_assert (0 == connection->write_buffer_append_offset);
 
@@ -1557,6 +1661,10 @@ try_ready_chunked_body (struct MHD_Connection *connection,
 
   if (MHD_SIZE_UNKNOWN == response->total_size)
     left_to_send = MHD_SIZE_UNKNOWN;
+#ifdef RESPONSE_COMPRESSION_SUPPORT
+  else if (MHD_RESP_ENC_IDENTITY != connection->rp.props.encoding)
+    left_to_send = MHD_SIZE_UNKNOWN; /* The compressed size is not known */
+#endif /* RESPONSE_COMPRESSION_SUPPORT */
   else
     left_to_send = response->total_size
                    - connection->rp.rsp_write_position;
@@ -1568,6 +1676,14 @@ try_ready_chunked_body (struct MHD_Connection *connection,
   if (left_to_send < size_to_fill)
     size_to_fill = (size_t) left_to_send;
 
+#ifdef RESPONSE_COMPRESSION_SUPPORT
+  if (MHD_RESP_ENC_IDENTITY != connection->rp.props.encoding)
+    /* The write position is advanced by the compressor */
+    ret = MHD_resp_compress_fill_ (connection,
+                                   &connection->write_buffer[max_chunk_hdr_len],
+                                   size_to_fill);
+  else
+#endif /* RESPONSE_COMPRESSION_SUPPORT */
   if (0 == left_to_send)
     /* nothing to send, don't bother calling crc */
     ret = MHD_CONTENT_READER_END_OF_STREAM;
@@ -1607,6 +1723,21 @@ try_ready_chunked_body (struct MHD_Connection *connection,
                          &connection->write_buffer[max_chunk_hdr_len],
                          size_to_fill);
   }
+  if ( (MHD_CONTENT_READER_PENDING == ret) &&
+       (MHD_D_IS_USING_THREADS_ (connection->daemon)) &&
+       (! MHD_D_IS_USING_THREAD_PER_CONN_ (connection->daemon)) &&
+       (! MHD_ITC_IS_VALID_ (connection->daemon->itc)) )
+    ret = 0; /* Cannot be woken up, poll the content reader as for zero */
+  if (MHD_CONTENT_READER_PENDING == ret)
+  {
+    /* Wait for MHD_content_reader_ready() */
+    connection->rp.crc_waiting = true;
+    connection->state = MHD_CONNECTION_CHUNKED_BODY_UNREADY;
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+    MHD_mutex_unlock_chk_ (&response->mutex);
+#endif
+    return MHD_NO;
+  }
   if (MHD_CONTENT_READER_END_WITH_ERROR == ret)
   {
     /* error, close socket! */
@@ -1659,12 +1790,34 @@ try_ready_chunked_body (struct MHD_Connection *connection,
   connection->write_buffer[max_chunk_hdr_len - 1] = '\n';
   connection->write_buffer[max_chunk_hdr_len + (size_t) ret] = '\r';
   connection->write_buffer[max_chunk_hdr_len + (size_t) ret + 1] = '\n';
+#ifdef RESPONSE_COMPRESSION_SUPPORT
+  if (MHD_RESP_ENC_IDENTITY == connection->rp.props.encoding)
+#endif /* RESPONSE_COMPRESSION_SUPPORT */
   connection->rp.rsp_write_position += (size_t) ret;
   connection->write_buffer_append_offset = max_chunk_hdr_len + (size_t) ret + 2;
   return MHD_YES;
 }
 
 
+/**
+ * Check whether the whole chunked reply body has been prepared for sending.
+ *
+ * @param connection the connection to check
+ * @return true if no more chunks left, false otherwise
+ */
+static bool
+is_chunked_body_complete (struct MHD_Connection *connection)
+{
+#ifdef RESPONSE_COMPRESSION_SUPPORT
+  if (MHD_RESP_ENC_IDENTITY != connection->rp.props.encoding)
+    return MHD_resp_compress_is_finished_ (connection);
+#endif /* RESPONSE_COMPRESSION_SUPPORT */
+  return (0 == connection->rp.response->total_size) ||
+         (connection->rp.rsp_write_position ==
+          connection->rp.response->total_size);
+}
+
+
 /**
  * Are we allowed to keep the given connection alive?
  * We can use the TCP stream for a second request if the connection
@@ -1882,6 +2035,8 @@ try_grow_read_buffer (struct MHD_Connection *connection,
   const size_t def_grow_size = connection->daemon->pool_increment;
   void *rb;
 
+  if (connection->rq.upload_buf_ext)
+    return false;               /* The application's buffer cannot be grown */
   avail_size = MHD_pool_get_free (connection->pool);
   if (0 == avail_size)
     return false;               /* No more space available */
@@ -1960,6 +2115,8 @@ connection_shrink_read_buffer (struct MHD_Connection *connection)
   struct MHD_Connection *const c = connection; /**< a short alias */
   void *new_buf;
 
+  /* The application-provided buffer is not in the pool */
+  mhd_assert (! c->rq.upload_buf_ext);
   if ((NULL == c->read_buffer) || (0 == c->read_buffer_size))
   {
     mhd_assert (0 == c->read_buffer_size);
@@ -2081,6 +2238,69 @@ connection_shrink_write_buffer (struct MHD_Connection *connection)
 #endif /* unused function */
 
 
+/**
+ * Drop the application-provided buffer used as the read buffer.
+ * The data in the buffer (if any) is discarded.
+ *
+ * @param connection the connection to use
+ */
+static void
+connection_drop_upload_buffer (struct MHD_Connection *connection)
+{
+  struct MHD_Connection *const c = connection; /**< a short alias */
+
+  mhd_assert (c->rq.upload_buf_ext);
+  c->rq.upload_buf_ext = false;
+  c->read_buffer = NULL;
+  c->read_buffer_size = 0;
+  c->read_buffer_offset = 0;
+}
+
+
+/**
+ * Switch the read buffer back from the application-provided buffer
+ * to the buffer in the memory pool.  The data after the request body
+ * (if any) is copied to the new buffer.
+ * The connection is closed if the data does not fit the pool.
+ *
+ * @param connection the connection to use
+ * @return true on success, false if connection has been closed
+ */
+static bool
+connection_restore_read_buffer (struct MHD_Connection *connection)
+{
+  struct MHD_Connection *const c = connection; /**< a short alias */
+  const char *const ext_buf = c->read_buffer;
+  const size_t data_size = c->read_buffer_offset;
+  size_t new_size;
+
+  mhd_assert (c->rq.upload_buf_ext);
+  c->rq.upload_buf_ext = false;
+  c->read_buffer_size = 0;
+  c->read_buffer_offset = 0;
+  /* The pool has no read buffer now, allocate a new one in the same way
+     as when the connection is reset */
+  new_size = MHD_pool_get_free (c->pool) / 2;
+  if (data_size > new_size)
+    new_size = data_size;
+  c->read_buffer = (0 == new_size) ?
+                   NULL : MHD_pool_allocate (c->pool, new_size, false);
+  if (NULL == c->read_buffer)
+  {
+    CONNECTION_CLOSE_ERROR (c,
+                            _ ("Not enough memory in the pool for the data " \
+                               "received after the request body, " \
+                               "closing connection."));
+    return false;
+  }
+  c->read_buffer_size = new_size;
+  if (0 != data_size)
+    memcpy (c->read_buffer, ext_buf, data_size);
+  c->read_buffer_offset = data_size;
+  return true;
+}
+
+
 /**
  * Switch connection from recv mode to send mode.
  *
@@ -2214,6 +2434,13 @@ setup_reply_properties (struct MHD_Connection *connection)
                (RP_BODY_NONE == use_rp_body) );
 #endif /* UPGRADE_SUPPORT */
 
+#ifdef RESPONSE_COMPRESSION_SUPPORT
+  c->rp.props.encoding = MHD_RESP_ENC_IDENTITY;
+  if ( (c->rp.props.use_reply_body_headers) &&
+       (MHD_HTTP_PARTIAL_CONTENT != c->rp.responseCode) )
+    c->rp.props.encoding = MHD_resp_compress_select_ (c);
+#endif /* RESPONSE_COMPRESSION_SUPPORT */
+
   if (c->rp.props.use_reply_body_headers)
   {
     if ((MHD_SIZE_UNKNOWN == r->total_size) ||
@@ -2235,6 +2462,10 @@ setup_reply_properties (struct MHD_Connection *connection)
          * the client. */
         use_chunked = true;
     }
+#ifdef RESPONSE_COMPRESSION_SUPPORT
+    else if (MHD_RESP_ENC_IDENTITY != c->rp.props.encoding)
+      use_chunked = true; /* The size of the compressed body is unknown */
+#endif /* RESPONSE_COMPRESSION_SUPPORT */
     else
       use_chunked = false;
 
@@ -2476,6 +2707,7 @@ build_header_response (struct MHD_Connection *connection)
   unsigned rcode;                                /**< the response code */
   bool use_conn_close;                           /**< Use "Connection: close" header */
   bool use_conn_k_alive;                         /**< Use "Connection: Keep-Alive" header */
+  bool vary_enc;                                 /**< Use "Vary: Accept-Encoding" header */
 
   mhd_assert (NULL != r);
 
@@ -2651,6 +2883,24 @@ build_header_response (struct MHD_Connection *connection)
                                "chunked\r\n"))
           return MHD_NO;
       }
+#ifdef RESPONSE_COMPRESSION_SUPPORT
+      if (MHD_RESP_ENC_IDENTITY != c->rp.props.encoding)
+      { /* The body is compressed by MHD */
+        const char *enc_name;
+        size_t enc_name_len;
+
+        enc_name = MHD_resp_compress_enc_name_ (c->rp.props.encoding,
+                                                &enc_name_len);
+        if (! buffer_append_s (buf, &pos, buf_size,
+                               MHD_HTTP_HEADER_CONTENT_ENCODING ": "))
+          return MHD_NO;
+        if (! buffer_append (buf, &pos, buf_size,
+                             enc_name, enc_name_len))
+          return MHD_NO;
+        if (! buffer_append_s (buf, &pos, buf_size, "\r\n"))
+          return MHD_NO;
+      }
+#endif /* RESPONSE_COMPRESSION_SUPPORT */
     }
     else /* Chunked encoding is not used */
     {
@@ -2674,6 +2924,48 @@ build_header_response (struct MHD_Connection *connection)
         }
       }
     }
+    /* The body coding depends on the client's "Accept-Encoding" */
+    vary_enc = (NULL != r->first_variant);
+#ifdef RESPONSE_COMPRESSION_SUPPORT
+    if (0 != (r->flags & MHD_RF_COMPRESS))
+      vary_enc = true;
+#endif /* RESPONSE_COMPRESSION_SUPPORT */
+    if ( vary_enc &&
+         (NULL == MHD_get_response_element_n_ (r, MHD_HEADER_KIND,
+                                               MHD_HTTP_HEADER_VARY,
+                                               MHD_STATICSTR_LEN_ ( \
+                                                 MHD_HTTP_HEADER_VARY))) )
+    {
+      if (! buffer_append_s (buf, &pos, buf_size,
+                             MHD_HTTP_HEADER_VARY ": " \
+                             MHD_HTTP_HEADER_ACCEPT_ENCODING "\r\n"))
+        return MHD_NO;
+    }
+    /* The client may request the parts of the body */
+    if (0 != (r->flags & MHD_RF_ACCEPT_RANGES))
+    {
+      bool ranges;
+
+      if (MHD_HTTP_PARTIAL_CONTENT == rcode)
+        ranges = true;
+      else
+        ranges = (MHD_HTTP_OK == rcode) && MHD_response_is_rangeable_ (r);
+#ifdef RESPONSE_COMPRESSION_SUPPORT
+      if (MHD_RESP_ENC_IDENTITY != c->rp.props.encoding)
+        ranges = false; /* The body compressed on the fly */
+#endif /* RESPONSE_COMPRESSION_SUPPORT */
+      if (ranges &&
+          (NULL == MHD_get_response_element_n_ (r, MHD_HEADER_KIND,
+                                                MHD_HTTP_HEADER_ACCEPT_RANGES,
+                                                MHD_STATICSTR_LEN_ ( \
+                                                  MHD_HTTP_HEADER_ACCEPT_RANGES)))
+          )
+      {
+        if (! buffer_append_s (buf, &pos, buf_size,
+                               MHD_HTTP_HEADER_ACCEPT_RANGES ": bytes\r\n"))
+          return MHD_NO;
+      }
+    }
   }
 
   /* * Header termination * */
@@ -2819,6 +3111,8 @@ transmit_error_response_len (struct MHD_Connection *connection,
   }
   /* TODO: remove when special error queue function is implemented */
   connection->state = MHD_CONNECTION_FULL_REQ_RECEIVED;
+  if (connection->rq.upload_buf_ext)
+    connection_drop_upload_buffer (connection); /* Not needed anymore */
   if (0 != connection->read_buffer_size)
   {
     /* Read buffer is not needed anymore, discard it
@@ -2960,11 +3254,17 @@ static bool
 has_unprocessed_upload_body_data_in_buffer (struct MHD_Connection *c)
 {
   mhd_assert (MHD_CONNECTION_BODY_RECEIVING == c->state);
+#ifdef BODY_DECODING_SUPPORT
+  if (MHD_body_decoder_has_pending_ (c))
+    return true; /* Decoded data not processed by the application */
+#endif /* BODY_DECODING_SUPPORT */
   if (! c->rq.have_chunked_upload)
     return 0 != c->read_buffer_offset;
 
   /* Chunked upload */
   mhd_assert (0 != c->rq.remaining_upload_size); /* Must not be possible in MHD_CONNECTION_BODY_RECEIVING state */
+  if (0 != c->rq.dechunked_size)
+    return true; /* De-chunked payload data in the read buffer */
   if (c->rq.current_chunk_offset == c->rq.current_chunk_size)
   {
     /* 0 == c->rq.current_chunk_size: Waiting the chunk size (chunk header).
@@ -3794,6 +4094,14 @@ MHD_connection_update_event_loop_info (struct MHD_Connection *connection)
         connection->event_loop_info = MHD_EVENT_LOOP_INFO_READ;
       break;
     case MHD_CONNECTION_BODY_RECEIVED:
+#ifdef BODY_DECODING_SUPPORT
+      if (MHD_body_decoder_has_pending_ (connection))
+      {
+        /* Give the rest of the decoded data to the application again */
+        connection->event_loop_info = MHD_EVENT_LOOP_INFO_PROCESS;
+        break;
+      }
+#endif /* BODY_DECODING_SUPPORT */
       mhd_assert (0);
       break;
     case MHD_CONNECTION_FOOTERS_RECEIVING:
@@ -3816,13 +4124,17 @@ MHD_connection_update_event_loop_info (struct MHD_Connection *connection)
       mhd_assert (0);
       break;
     case MHD_CONNECTION_NORMAL_BODY_UNREADY:
-      connection->event_loop_info = MHD_EVENT_LOOP_INFO_PROCESS;
+      connection->event_loop_info = connection->rp.crc_waiting ?
+                                    MHD_EVENT_LOOP_INFO_WAIT :
+                                    MHD_EVENT_LOOP_INFO_PROCESS;
       break;
     case MHD_CONNECTION_NORMAL_BODY_READY:
       connection->event_loop_info = MHD_EVENT_LOOP_INFO_WRITE;
       break;
     case MHD_CONNECTION_CHUNKED_BODY_UNREADY:
-      connection->event_loop_info = MHD_EVENT_LOOP_INFO_PROCESS;
+      connection->event_loop_info = connection->rp.crc_waiting ?
+                                    MHD_EVENT_LOOP_INFO_WAIT :
+                                    MHD_EVENT_LOOP_INFO_PROCESS;
       break;
     case MHD_CONNECTION_CHUNKED_BODY_READY:
       connection->event_loop_info = MHD_EVENT_LOOP_INFO_WRITE;
@@ -4363,11 +4675,29 @@ call_connection_handler (struct MHD_Connection *connection)
 {
   struct MHD_Daemon *daemon = connection->daemon;
   size_t processed;
+#ifdef MHD_HANDLER_THREADS_SUPPORT
+  bool failed;
+
+  if (MHD_handler_threads_finish_ (connection,
+                                   &failed))
+  {
+    /* The handler has been called by the handler thread */
+    if (failed)
+      CONNECTION_CLOSE_ERROR (connection,
+                              _ ("Application reported internal error, " \
+                                 "closing connection."));
+    return;
+  }
+#endif /* MHD_HANDLER_THREADS_SUPPORT */
 
   if (NULL != connection->rp.response)
     return;                     /* already queued a response */
   processed = 0;
   connection->rq.client_aware = true;
+#ifdef MHD_HANDLER_THREADS_SUPPORT
+  if (MHD_handler_threads_queue_ (connection))
+    return;                     /* called by the handler thread */
+#endif /* MHD_HANDLER_THREADS_SUPPORT */
   connection->in_access_handler = true;
   if (MHD_NO ==
       daemon->default_handler (daemon->default_handler_cls,
@@ -4390,6 +4720,223 @@ call_connection_handler (struct MHD_Connection *connection)
 }
 
 
+/**
+ * Answer the request with the response from the response cache of the
+ * daemon, if the matching response is cached.
+ *
+ * @param connection the connection to use
+ * @return true if the response has been queued,
+ *         false if the application handler must be called
+ */
+static bool
+reply_from_response_cache (struct MHD_Connection *connection)
+{
+  struct MHD_Response *response;
+  unsigned int status_code;
+  enum MHD_Result ret;
+
+  mhd_assert (MHD_CONNECTION_HEADERS_PROCESSED == connection->state);
+  response = MHD_response_cache_lookup_ (connection,
+                                         &status_code);
+  if (NULL == response)
+    return false;
+  /* The request has no body, the response is not an "early" response */
+  connection->state = MHD_CONNECTION_FULL_REQ_RECEIVED;
+  connection->rq.resp_cache_reply = true;
+  connection->in_access_handler = true;
+  ret = MHD_queue_response (connection,
+                            status_code,
+                            response);
+  connection->in_access_handler = false;
+  MHD_destroy_response (response);
+  if (MHD_NO != ret)
+    return true;
+  connection->state = MHD_CONNECTION_HEADERS_PROCESSED;
+  connection->rq.resp_cache_reply = false;
+  return false;
+}
+
+
+/**
+ * Pass the (decoded) request body data to the application: write it to
+ * the upload FD (if set) or give it to the access handler callback.
+ *
+ * @param connection the connection to use
+ * @param data the request body data
+ * @param[in,out] size the size of the @a data, updated with the size of
+ *                     the data left unprocessed by the application
+ * @return true on success, false if connection has been closed
+ */
+static bool
+deliver_plain_body_data (struct MHD_Connection *connection,
+                         const char *data,
+                         size_t *size)
+{
+  struct MHD_Daemon *daemon = connection->daemon;
+  const size_t data_size = *size;
+
+  if (connection->rq.upload_to_fd)
+  {
+    /* The application asked to write the body directly to the FD */
+    if (! MHD_upload_fd_write_ (connection,
+                                data,
+                                data_size))
+    {
+      CONNECTION_CLOSE_ERROR (connection,
+                              _ ("Failed to write the request body " \
+                                 "to the upload FD, closing connection."));
+      return false;
+    }
+    *size = 0;
+    return true;
+  }
+  connection->rq.client_aware = true;
+  connection->in_access_handler = true;
+  if (MHD_NO ==
+      daemon->default_handler (daemon->default_handler_cls,
+                               connection,
+                               connection->rq.url,
+                               connection->rq.method,
+                               connection->rq.version,
+                               data,
+                               size,
+                               &connection->rq.client_context))
+  {
+    connection->in_access_handler = false;
+    /* serious internal error, close connection */
+    CONNECTION_CLOSE_ERROR (connection,
+                            _ ("Application reported internal error, " \
+                               "closing connection."));
+    return false;
+  }
+  connection->in_access_handler = false;
+
+  if (*size > data_size)
+    MHD_PANIC (_ ("libmicrohttpd API violation.\n"));
+
+#ifdef HAVE_MESSAGES
+  if ((0 != *size) && (*size == data_size) &&
+      (! connection->suspended))
+  {
+    /* client did not process any upload data, complain if
+       the setup was incorrect, which may prevent us from
+       handling the rest of the request */
+    if (MHD_D_IS_USING_THREADS_ (daemon))
+      MHD_DLOG (daemon,
+                _ ("WARNING: Access Handler Callback has not processed " \
+                   "any upload data and connection is not suspended. " \
+                   "This may result in hung connection.\n"));
+  }
+#endif /* HAVE_MESSAGES */
+  return true;
+}
+
+
+#ifdef BODY_DECODING_SUPPORT
+/**
+ * Reply with the error response for the request body decoding failure.
+ *
+ * @param connection the connection to use
+ * @param res the result of the decoder
+ */
+static void
+handle_body_decoding_error (struct MHD_Connection *connection,
+                            enum MHD_BodyDecoderResult res)
+{
+  switch (res)
+  {
+  case MHD_BODY_DECODER_CORRUPT:
+    transmit_error_response_static (connection,
+                                    MHD_HTTP_BAD_REQUEST,
+                                    REQUEST_BODY_DECODING_FAILED);
+    break;
+  case MHD_BODY_DECODER_TOO_LARGE:
+    transmit_error_response_static (connection,
+                                    MHD_HTTP_CONTENT_TOO_LARGE,
+                                    REQUEST_BODY_DECODED_TOO_LARGE);
+    break;
+  case MHD_BODY_DECODER_NO_MEMORY:
+    transmit_error_response_static (connection,
+                                    MHD_HTTP_INTERNAL_SERVER_ERROR,
+                                    REQUEST_BODY_DECODING_NO_MEMORY);
+    break;
+  case MHD_BODY_DECODER_CLOSED:
+    break; /* Connection has been closed already */
+  case MHD_BODY_DECODER_PENDING: /* Not an error, the delivery is retried */
+  case MHD_BODY_DECODER_OK:
+  default:
+    mhd_assert (0);
+    break;
+  }
+}
+
+
+#endif /* BODY_DECODING_SUPPORT */
+
+/**
+ * Pass the request body data to the application, decode the data first
+ * if the request body is compressed.
+ *
+ * @param connection the connection to use
+ * @param data the request body data
+ * @param[in,out] size the size of the @a data, updated with the size of
+ *                     the data left unprocessed
+ * @return true on success, false if connection has been closed or
+ *         the error response has been queued
+ */
+static bool
+deliver_request_body_data (struct MHD_Connection *connection,
+                           const char *data,
+                           size_t *size)
+{
+#ifdef BODY_DECODING_SUPPORT
+  if (NULL != connection->rq.decoder)
+  {
+    enum MHD_BodyDecoderResult res;
+
+    res = MHD_body_decoder_process_ (connection,
+                                     data,
+                                     size,
+                                     &deliver_plain_body_data);
+    if (MHD_BODY_DECODER_OK == res)
+      return true;
+    handle_body_decoding_error (connection,
+                                res);
+    return false;
+  }
+#endif /* BODY_DECODING_SUPPORT */
+  return deliver_plain_body_data (connection,
+                                  data,
+                                  size);
+}
+
+
+#ifdef BODY_DECODING_SUPPORT
+/**
+ * Give the decoded request body data left unprocessed by the application
+ * to the application again, when no new request body data is available
+ * in the read buffer (for example, when the connection has been resumed).
+ *
+ * @param connection the connection to use
+ */
+static void
+deliver_pending_decoded_data (struct MHD_Connection *connection)
+{
+  size_t no_data = 0;
+
+  mhd_assert (MHD_body_decoder_has_pending_ (connection));
+  if (! deliver_request_body_data (connection,
+                                   connection->read_buffer,
+                                   &no_data))
+    return;
+  if (MHD_body_decoder_has_pending_ (connection))
+    connection->rq.some_payload_processed = false; /* Wait for resume */
+}
+
+
+#endif /* BODY_DECODING_SUPPORT */
+
+
 /**
  * Call the handler of the application for this
  * connection.  Handles chunking of the upload
@@ -4413,11 +4960,17 @@ process_request_body (struct MHD_Connection *connection)
   /* Allow "Bad WhiteSpace" in chunk extension.
      RFC 9112, Section 7.1.1, Paragraph 2 */
   const bool allow_bws = (2 < discp_lvl);
+  /* Give the payload of several chunks to the application in one call */
+  const bool coalesce = connection->rq.have_chunked_upload
+                        && daemon->coalesce_chunked_upload;
+  char *dechunked_end;
 
   mhd_assert (NULL == connection->rp.response);
+  mhd_assert (coalesce || (0 == connection->rq.dechunked_size));
 
-  buffer_head = connection->read_buffer;
-  available = connection->read_buffer_offset;
+  /* The de-chunked data (if any) is followed by the received data */
+  buffer_head = connection->read_buffer + connection->rq.dechunked_size;
+  available = connection->read_buffer_offset - connection->rq.dechunked_size;
   do
   {
     size_t to_be_processed;
@@ -4425,6 +4978,9 @@ process_request_body (struct MHD_Connection *connection)
     size_t processed_size;
 
     instant_retry = false;
+    if (coalesce &&
+        ((0 == available) || connection->rq.dechunked_final))
+      break; /* Only de-chunked data is left to be processed */
     if (connection->rq.have_chunked_upload)
     {
       mhd_assert (MHD_SIZE_UNKNOWN == connection->rq.remaining_upload_size);
@@ -4579,7 +5135,10 @@ process_request_body (struct MHD_Connection *connection)
 
             if (0 == chunk_size)
             { /* The final (termination) chunk */
-              connection->rq.remaining_upload_size = 0;
+              if (0 != connection->rq.dechunked_size)
+                connection->rq.dechunked_final = true; /* Deliver data first */
+              else
+                connection->rq.remaining_upload_size = 0;
               break;
             }
             if (available > 0)
@@ -4611,51 +5170,28 @@ process_request_body (struct MHD_Connection *connection)
         to_be_processed = available;
     }
     left_unprocessed = to_be_processed;
-    connection->rq.client_aware = true;
-    connection->in_access_handler = true;
-    if (MHD_NO ==
-        daemon->default_handler (daemon->default_handler_cls,
-                                 connection,
-                                 connection->rq.url,
-                                 connection->rq.method,
-                                 connection->rq.version,
-                                 buffer_head,
-                                 &left_unprocessed,
-                                 &connection->rq.client_context))
+    if (coalesce)
     {
-      connection->in_access_handler = false;
-      /* serious internal error, close connection */
-      CONNECTION_CLOSE_ERROR (connection,
-                              _ ("Application reported internal error, " \
-                                 "closing connection."));
-      return;
+      /* Move the chunk payload next to the already de-chunked data,
+         the data is given to the application after the loop */
+      dechunked_end = connection->read_buffer + connection->rq.dechunked_size;
+      if (dechunked_end != buffer_head)
+        memmove (dechunked_end,
+                 buffer_head,
+                 to_be_processed);
+      connection->rq.dechunked_size += to_be_processed;
+      left_unprocessed = 0;
     }
-    connection->in_access_handler = false;
-
-    if (left_unprocessed > to_be_processed)
-      MHD_PANIC (_ ("libmicrohttpd API violation.\n"));
+    else if (! deliver_request_body_data (connection,
+                                          buffer_head,
+                                          &left_unprocessed))
+      return;
 
     connection->rq.some_payload_processed =
       (left_unprocessed != to_be_processed);
 
     if (0 != left_unprocessed)
-    {
       instant_retry = false; /* client did not process everything */
-#ifdef HAVE_MESSAGES
-      if ((! connection->rq.some_payload_processed) &&
-          (! connection->suspended))
-      {
-        /* client did not process any upload data, complain if
-           the setup was incorrect, which may prevent us from
-           handling the rest of the request */
-        if (MHD_D_IS_USING_THREADS_ (daemon))
-          MHD_DLOG (daemon,
-                    _ ("WARNING: Access Handler Callback has not processed " \
-                       "any upload data and connection is not suspended. " \
-                       "This may result in hung connection.\n"));
-      }
-#endif /* HAVE_MESSAGES */
-    }
     processed_size = to_be_processed - left_unprocessed;
     /* dh left "processed" bytes in buffer for next time... */
     buffer_head += processed_size;
@@ -4671,16 +5207,44 @@ process_request_body (struct MHD_Connection *connection)
       connection->rq.current_chunk_offset += processed_size;
     }
   } while (instant_retry);
+  if (0 != connection->rq.dechunked_size)
+  {
+    size_t left_unprocessed;
+    size_t processed_size;
+
+    mhd_assert (coalesce);
+    left_unprocessed = connection->rq.dechunked_size;
+    if (! deliver_request_body_data (connection,
+                                     connection->read_buffer,
+                                     &left_unprocessed))
+      return;
+    processed_size = connection->rq.dechunked_size - left_unprocessed;
+    connection->rq.some_payload_processed = (0 != processed_size);
+    if ( (0 != processed_size) &&
+         (0 != left_unprocessed) )
+      memmove (connection->read_buffer,
+               connection->read_buffer + processed_size,
+               left_unprocessed);
+    connection->rq.dechunked_size = left_unprocessed;
+    if ( (0 == left_unprocessed) &&
+         (connection->rq.dechunked_final) )
+    {
+      connection->rq.dechunked_final = false;
+      connection->rq.remaining_upload_size = 0;
+    }
+  }
   /* TODO: zero out reused memory region */
+  dechunked_end = connection->read_buffer + connection->rq.dechunked_size;
   if ( (available > 0) &&
-       (buffer_head != connection->read_buffer) )
-    memmove (connection->read_buffer,
+       (buffer_head != dechunked_end) )
+    memmove (dechunked_end,
              buffer_head,
              available);
   else
     mhd_assert ((0 == available) || \
-                (connection->read_buffer_offset == available));
-  connection->read_buffer_offset = available;
+                (connection->read_buffer_offset == \
+                 connection->rq.dechunked_size + available));
+  connection->read_buffer_offset = connection->rq.dechunked_size + available;
 }
 
 
@@ -4708,6 +5272,40 @@ check_write_done (struct MHD_Connection *connection,
 }
 
 
+/**
+ * Check the request rate limit for the client before the request is
+ * passed to the application.
+ * If the limit is exceeded, the error reply is queued or the connection
+ * is closed.
+ *
+ * @param c the connection to check
+ * @return true if request can be processed,
+ *         false if request has been rejected
+ */
+static bool
+check_request_rate (struct MHD_Connection *c)
+{
+  struct MHD_Daemon *const daemon = c->daemon;
+
+  if (MHD_rate_limit_check_ (daemon,
+                             c->addr,
+                             c->addr_len,
+                             true))
+    return true;
+  if (MHD_get_master (daemon)->per_ip_rate_drop)
+  {
+    CONNECTION_CLOSE_ERROR (c,
+                            _ ("Client exceeded request rate limit. " \
+                               "Closing connection.\n"));
+    return false;
+  }
+  transmit_error_response_static (c,
+                                  MHD_HTTP_TOO_MANY_REQUESTS,
+                                  ERR_MSG_TOO_MANY_REQUESTS);
+  return false;
+}
+
+
 /**
  * Parse the various headers; figure out the size
  * of the upload and make sure the headers follow
@@ -6413,6 +7011,7 @@ MHD_connection_handle_read (struct MHD_Connection *connection,
                             bool socket_error)
 {
   ssize_t bytes_read;
+  size_t buf_space;
 
   if ( (MHD_CONNECTION_CLOSED == connection->state) ||
        (connection->suspended) )
@@ -6428,15 +7027,52 @@ MHD_connection_handle_read (struct MHD_Connection *connection,
   }
 #endif /* HTTPS_SUPPORT */
 
+#ifdef MHD_UPLOAD_SPLICE_SUPPORT
+  if ( (connection->rq.upload_to_fd) &&
+       (MHD_CONNECTION_BODY_RECEIVING == connection->state) &&
+       (! connection->rq.have_chunked_upload) &&
+       (0 == connection->read_buffer_offset) &&
+       (! socket_error) )
+  {
+    enum MHD_UploadSpliceResult res;
+
+    res = MHD_upload_fd_splice_ (connection);
+    if (MHD_UPLOAD_SPLICE_OK == res)
+      return;
+    if (MHD_UPLOAD_SPLICE_WRITE_ERROR == res)
+    {
+      CONNECTION_CLOSE_ERROR (connection,
+                              _ ("Failed to write the request body " \
+                                 "to the upload FD, closing connection."));
+      return;
+    }
+    /* Receive the data in the usual way */
+  }
+#endif /* MHD_UPLOAD_SPLICE_SUPPORT */
+
   mhd_assert (NULL != connection->read_buffer);
   if (connection->read_buffer_size == connection->read_buffer_offset)
     return; /* No space for receiving data. */
 
+  buf_space = connection->read_buffer_size - connection->read_buffer_offset;
+  if ( (connection->rq.upload_buf_ext) &&
+       (! connection->rq.have_chunked_upload) )
+  {
+    /* Do not read the data after the body into the application's buffer */
+    mhd_assert (connection->rq.remaining_upload_size >= \
+                connection->read_buffer_offset);
+    if (connection->rq.remaining_upload_size - connection->read_buffer_offset
+        < (uint64_t) buf_space)
+      buf_space = (size_t) (connection->rq.remaining_upload_size
+                            - connection->read_buffer_offset);
+    if (0 == buf_space)
+      return;
+  }
+
   bytes_read = connection->recv_cls (connection,
                                      &connection->read_buffer
                                      [connection->read_buffer_offset],
-                                     connection->read_buffer_size
-                                     - connection->read_buffer_offset);
+                                     buf_space);
   if ((bytes_read < 0) || socket_error)
   {
     if ((MHD_ERR_AGAIN_ == bytes_read) && ! socket_error)
@@ -6854,8 +7490,7 @@ MHD_connection_handle_write (struct MHD_Connection *connection)
     if (MHD_CONNECTION_CHUNKED_BODY_READY != connection->state)
       return;
     check_write_done (connection,
-                      (connection->rp.response->total_size ==
-                       connection->rp.rsp_write_position) ?
+                      is_chunked_body_complete (connection) ?
                       MHD_CONNECTION_CHUNKED_BODY_SENT :
                       MHD_CONNECTION_CHUNKED_BODY_UNREADY);
     return;
@@ -7018,7 +7653,13 @@ cleanup_connection (struct MHD_Connection *connection)
   DLL_insert (daemon->cleanup_head,
               daemon->cleanup_tail,
               connection);
-  connection->resuming = false;
+  if (connection->resuming)
+  {
+    RDLL_remove (daemon->resuming_head,
+                 daemon->resuming_tail,
+                 connection);
+    connection->resuming = false;
+  }
   connection->in_idle = false;
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
   MHD_mutex_unlock_chk_ (&daemon->cleanup_connection_mutex);
@@ -7136,8 +7777,16 @@ connection_reset (struct MHD_Connection *connection,
       (0 == c->read_buffer_offset) ?
       MHD_EVENT_LOOP_INFO_READ : MHD_EVENT_LOOP_INFO_PROCESS;
 
+    MHD_upload_fd_cleanup_ (c);
+#ifdef BODY_DECODING_SUPPORT
+    MHD_body_decoder_cleanup_ (c);
+#endif /* BODY_DECODING_SUPPORT */
+    mhd_assert (! c->rq.upload_buf_ext);
     memset (&c->rq, 0, sizeof(c->rq));
 
+#ifdef RESPONSE_COMPRESSION_SUPPORT
+    MHD_resp_compress_release_ (c, false);
+#endif /* RESPONSE_COMPRESSION_SUPPORT */
     /* iov (if any) will be deallocated by MHD_pool_reset */
     memset (&c->rp, 0, sizeof(c->rp));
 
@@ -7236,11 +7885,28 @@ MHD_connection_handle_idle (struct MHD_Connection *connection)
       parse_connection_headers (connection);
       if (MHD_CONNECTION_HEADERS_RECEIVED != connection->state)
         continue;
+      if (! check_request_rate (connection))
+        continue;
+#ifdef BODY_DECODING_SUPPORT
+      if (0 != connection->rq.remaining_upload_size)
+      {
+        const enum MHD_BodyDecoderResult res =
+          MHD_body_decoder_init_ (connection);
+        if (MHD_BODY_DECODER_OK != res)
+        {
+          handle_body_decoding_error (connection,
+                                      res);
+          continue;
+        }
+      }
+#endif /* BODY_DECODING_SUPPORT */
       connection->state = MHD_CONNECTION_HEADERS_PROCESSED;
       if (connection->suspended)
         break;
       continue;
     case MHD_CONNECTION_HEADERS_PROCESSED:
+      if (reply_from_response_cache (connection))
+        continue;
       call_connection_handler (connection);     /* first call */
       if (MHD_CONNECTION_HEADERS_PROCESSED != connection->state)
         continue;
@@ -7288,6 +7954,14 @@ MHD_connection_handle_idle (struct MHD_Connection *connection)
         if (MHD_CONNECTION_BODY_RECEIVING != connection->state)
           continue;
       }
+#ifdef BODY_DECODING_SUPPORT
+      else if (MHD_body_decoder_has_pending_ (connection))
+      {
+        deliver_pending_decoded_data (connection);
+        if (MHD_CONNECTION_BODY_RECEIVING != connection->state)
+          continue;
+      }
+#endif /* BODY_DECODING_SUPPORT */
       /* Modify here when queueing of the response during data processing
          will be supported */
       mhd_assert (! connection->discard_request);
@@ -7301,6 +7975,27 @@ MHD_connection_handle_idle (struct MHD_Connection *connection)
     case MHD_CONNECTION_BODY_RECEIVED:
       mhd_assert (! connection->discard_request);
       mhd_assert (NULL == connection->rp.response);
+#ifdef BODY_DECODING_SUPPORT
+      if (NULL != connection->rq.decoder)
+      {
+        const enum MHD_BodyDecoderResult res =
+          MHD_body_decoder_finish_ (connection,
+                                    &deliver_plain_body_data);
+        if (MHD_BODY_DECODER_PENDING == res)
+          break; /* Try again when the connection is resumed or
+                    on the next processing round */
+        if (MHD_BODY_DECODER_OK != res)
+        {
+          handle_body_decoding_error (connection,
+                                      res);
+          continue;
+        }
+        MHD_body_decoder_cleanup_ (connection);
+      }
+#endif /* BODY_DECODING_SUPPORT */
+      if ( (connection->rq.upload_buf_ext) &&
+           (! connection_restore_read_buffer (connection)) )
+        continue;
       if (0 == connection->rq.remaining_upload_size)
       {
         if (connection->rq.have_chunked_upload)
@@ -7332,6 +8027,9 @@ MHD_connection_handle_idle (struct MHD_Connection *connection)
       connection->state = MHD_CONNECTION_FULL_REQ_RECEIVED;
       continue;
     case MHD_CONNECTION_FULL_REQ_RECEIVED:
+      if ( (connection->rq.upload_buf_ext) &&
+           (! connection_restore_read_buffer (connection)) )
+        continue;
       call_connection_handler (connection);     /* "final" call */
       if (connection->state != MHD_CONNECTION_FULL_REQ_RECEIVED)
         continue;
@@ -7402,6 +8100,8 @@ MHD_connection_handle_idle (struct MHD_Connection *connection)
     case MHD_CONNECTION_NORMAL_BODY_UNREADY:
       mhd_assert (connection->rp.props.send_reply_body);
       mhd_assert (! connection->rp.props.chunked);
+      if (connection->rp.crc_waiting)
+        break; /* Wait for MHD_content_reader_ready() */
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
       if (NULL != connection->rp.response->crc)
         MHD_mutex_lock_chk_ (&connection->rp.response->mutex);
@@ -7440,13 +8140,13 @@ MHD_connection_handle_idle (struct MHD_Connection *connection)
     case MHD_CONNECTION_CHUNKED_BODY_UNREADY:
       mhd_assert (connection->rp.props.send_reply_body);
       mhd_assert (connection->rp.props.chunked);
+      if (connection->rp.crc_waiting)
+        break; /* Wait for MHD_content_reader_ready() */
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
       if (NULL != connection->rp.response->crc)
         MHD_mutex_lock_chk_ (&connection->rp.response->mutex);
 #endif
-      if ( (0 == connection->rp.response->total_size) ||
-           (connection->rp.rsp_write_position ==
-            connection->rp.response->total_size) )
+      if (is_chunked_body_complete (connection))
       {
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
         if (NULL != connection->rp.response->crc)
@@ -7724,6 +8424,48 @@ MHD_get_connection_info (struct MHD_Connection *connection,
 }
 
 
+/**
+ * Switch the read buffer of the connection to the application-provided
+ * buffer for receiving of the request body.
+ *
+ * @param connection the connection to use
+ * @param buf the buffer to use
+ * @param buf_size the size of the @a buf
+ * @return #MHD_YES on success, #MHD_NO if buffer cannot be used
+ */
+static enum MHD_Result
+connection_set_upload_buffer (struct MHD_Connection *connection,
+                              char *buf,
+                              size_t buf_size)
+{
+  struct MHD_Connection *const c = connection; /**< a short alias */
+  size_t data_size;
+
+  if ( (NULL == buf) ||
+       (! c->in_access_handler) ||
+       (MHD_CONNECTION_HEADERS_PROCESSED != c->state) ||
+       (NULL != c->rp.response) ||
+       (0 == c->rq.remaining_upload_size) ||
+       (c->rq.upload_buf_ext) )
+    return MHD_NO;
+  if ( (MHD_CHUNK_HEADER_REASONABLE_LEN > buf_size) ||
+       (c->read_buffer_offset >= buf_size) )
+    return MHD_NO; /* The buffer is too small */
+
+  data_size = c->read_buffer_offset;
+  if (0 != data_size)
+    memcpy (buf, c->read_buffer, data_size);
+  /* Release the buffer in the pool */
+  c->read_buffer_offset = 0;
+  connection_shrink_read_buffer (c);
+  c->read_buffer = buf;
+  c->read_buffer_size = buf_size;
+  c->read_buffer_offset = data_size;
+  c->rq.upload_buf_ext = true;
+  return MHD_YES;
+}
+
+
 /**
  * Set a custom option for the given connection, overriding defaults.
  *
@@ -7741,6 +8483,8 @@ MHD_set_connection_option (struct MHD_Connection *connection,
   va_list ap;
   struct MHD_Daemon *daemon;
   unsigned int ui_val;
+  void *buf;
+  size_t buf_size;
 
   daemon = connection->daemon;
   switch (option)
@@ -7795,6 +8539,14 @@ MHD_set_connection_option (struct MHD_Connection *connection,
 #endif
     }
     return MHD_YES;
+  case MHD_CONNECTION_OPTION_UPLOAD_BUFFER:
+    va_start (ap, option);
+    buf = va_arg (ap, void *);
+    buf_size = va_arg (ap, size_t);
+    va_end (ap);
+    return connection_set_upload_buffer (connection,
+                                         (char *) buf,
+                                         buf_size);
   default:
     return MHD_NO;
   }
@@ -8036,7 +8788,36 @@ MHD_queue_response (struct MHD_Connection *connection,
   }
 #endif
 
-  MHD_increment_response_rc (response);
+  MHD_response_cache_store_ (connection,
+                             response,
+                             status_code | (reply_icy ? MHD_ICY_FLAG : 0));
+
+  if (1)
+  {
+    struct MHD_Response *const variant =
+      MHD_response_select_variant_ (connection,
+                                    response,
+                                    status_code);
+    struct MHD_Response *ranged;
+
+    if (NULL != variant)
+      response = variant; /* The reference is already counted */
+    else
+      MHD_increment_response_rc (response);
+    /* Checked after the variant selection as each variant has its own
+       entity-tag. The body is not sent and not read for "Not Modified". */
+    if (MHD_response_is_not_modified_ (connection, response, status_code))
+      status_code = MHD_HTTP_NOT_MODIFIED;
+    ranged = MHD_response_select_range_ (connection,
+                                         response,
+                                         &status_code);
+    if (NULL != ranged)
+    {
+      /* The partial response keeps its own reference to the response */
+      MHD_destroy_response (response);
+      response = ranged;
+    }
+  }
   connection->rp.response = response;
   connection->rp.responseCode = status_code;
   connection->rp.responseIcy = reply_icy;
@@ -8076,6 +8857,10 @@ MHD_queue_response (struct MHD_Connection *connection,
     connection->discard_request = true;
     connection->state = MHD_CONNECTION_START_REPLY;
     connection->rq.remaining_upload_size = 0;
+    /* The body is not read anymore, the application's buffer must not
+       be used after return from the access handler */
+    if (connection->rq.upload_buf_ext)
+      connection_drop_upload_buffer (connection);
   }
   if (! connection->in_idle)
     (void) MHD_connection_handle_idle (connection);
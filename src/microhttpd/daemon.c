@@ -46,12 +46,13 @@
 #include "mhd_send.h"
 #include "mhd_align.h"
 #include "mhd_str.h"
-
-#ifdef MHD_USE_SYS_TSEARCH
-#include <search.h>
-#else  /* ! MHD_USE_SYS_TSEARCH */
-#include "tsearch.h"
-#endif /* ! MHD_USE_SYS_TSEARCH */
+#include "upgrade_tunnel.h"
+#include "mhd_ratelimit.h"
+#include "response_cache.h"
+#include "file_io.h"
+#include "conn_threads.h"
+#include "handler_threads.h"
+#include "response_compress.h"
 
 #ifdef HTTPS_SUPPORT
 #include "connection_https.h"
@@ -114,6 +115,19 @@ MHD_fini (void);
 static void
 close_all_connections (struct MHD_Daemon *daemon);
 
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+/**
+ * Main function of the thread that handles an individual connection
+ * in thread-per-connection mode.
+ *
+ * @param data the `struct MHD_Connection` this thread will handle
+ * @return always 0
+ */
+static MHD_THRD_RTRN_TYPE_ MHD_THRD_CALL_SPEC_
+thread_main_handle_connection (void *data);
+
+#endif
+
 #ifdef EPOLL_SUPPORT
 
 /**
@@ -244,63 +258,353 @@ struct MHD_IPCount
   } addr;
 
   /**
-   * Counter.
+   * Counter.  Zero for unused slots.
    */
   unsigned int count;
 };
 
 
 /**
- * Lock shared structure for IP connection counts and connection DLLs.
+ * The initial number of slots in each shard of per-IP counts table.
+ * Must be a power of two.
+ */
+#define MHD_IP_COUNT_SHARD_INIT_SIZE 16
+
+
+/**
+ * Initialise the table of per-IP connection counts, the table of
+ * per-IP request rates, the response cache, the I/O threads, the pool
+ * of the connection threads and the handler threads.
+ *
+ * @param daemon the master daemon
+ * @return true on success, false if failed to initialise the mutexes,
+ *         to allocate the memory or to start the threads
+ */
+static bool
+MHD_ip_count_init (struct MHD_Daemon *daemon)
+{
+  unsigned int i;
+
+  mhd_assert (NULL == daemon->master);
+  for (i = 0; i < MHD_IP_COUNT_SHARDS; i++)
+  {
+    struct MHD_IPCountShard *const shard = daemon->per_ip_count + i;
+
+    shard->slots = NULL;
+    shard->size = 0;
+    shard->used = 0;
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+    if (! MHD_mutex_init_ (&shard->lock))
+    {
+      while (0 != i--)
+        MHD_mutex_destroy_chk_ (&daemon->per_ip_count[i].lock);
+      return false;
+    }
+#endif
+  }
+  daemon->per_ip_count_salt =
+    ((uint32_t) (uintptr_t) daemon)
+    ^ ((uint32_t) MHD_monotonic_msec_counter () * 2654435761U);
+  if (! MHD_rate_limit_init_ (daemon))
+  {
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+    for (i = 0; i < MHD_IP_COUNT_SHARDS; i++)
+      MHD_mutex_destroy_chk_ (&daemon->per_ip_count[i].lock);
+#endif
+    return false;
+  }
+  if (! MHD_response_cache_init_ (daemon))
+  {
+    MHD_rate_limit_deinit_ (daemon);
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+    for (i = 0; i < MHD_IP_COUNT_SHARDS; i++)
+      MHD_mutex_destroy_chk_ (&daemon->per_ip_count[i].lock);
+#endif
+    return false;
+  }
+  if (! MHD_file_io_init_ (daemon))
+  {
+    MHD_response_cache_deinit_ (daemon);
+    MHD_rate_limit_deinit_ (daemon);
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+    for (i = 0; i < MHD_IP_COUNT_SHARDS; i++)
+      MHD_mutex_destroy_chk_ (&daemon->per_ip_count[i].lock);
+#endif
+    return false;
+  }
+  if (! MHD_conn_threads_init_ (daemon,
+                                &thread_main_handle_connection))
+  {
+    MHD_file_io_deinit_ (daemon);
+    MHD_response_cache_deinit_ (daemon);
+    MHD_rate_limit_deinit_ (daemon);
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+    for (i = 0; i < MHD_IP_COUNT_SHARDS; i++)
+      MHD_mutex_destroy_chk_ (&daemon->per_ip_count[i].lock);
+#endif
+    return false;
+  }
+  if (! MHD_handler_threads_init_ (daemon))
+  {
+    MHD_conn_threads_deinit_ (daemon);
+    MHD_file_io_deinit_ (daemon);
+    MHD_response_cache_deinit_ (daemon);
+    MHD_rate_limit_deinit_ (daemon);
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+    for (i = 0; i < MHD_IP_COUNT_SHARDS; i++)
+      MHD_mutex_destroy_chk_ (&daemon->per_ip_count[i].lock);
+#endif
+    return false;
+  }
+  return true;
+}
+
+
+/**
+ * Deinitialise the table of per-IP connection counts, the table of
+ * per-IP request rates, the response cache, the I/O threads, the pool
+ * of the connection threads and the handler threads and free the memory.
  *
- * @param daemon handle to daemon where lock is
+ * @param daemon the master daemon
  */
 static void
-MHD_ip_count_lock (struct MHD_Daemon *daemon)
+MHD_ip_count_deinit (struct MHD_Daemon *daemon)
 {
+  unsigned int i;
+
   mhd_assert (NULL == daemon->master);
+  for (i = 0; i < MHD_IP_COUNT_SHARDS; i++)
+  {
+    struct MHD_IPCountShard *const shard = daemon->per_ip_count + i;
+
+    mhd_assert (0 == shard->used);
+    free (shard->slots);
+    shard->slots = NULL;
+    shard->size = 0;
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+    MHD_mutex_destroy_chk_ (&shard->lock);
+#endif
+  }
+  MHD_rate_limit_deinit_ (daemon);
+  MHD_response_cache_deinit_ (daemon);
+  MHD_file_io_deinit_ (daemon);
+  MHD_conn_threads_deinit_ (daemon);
+  MHD_handler_threads_deinit_ (daemon);
+}
+
+
+/**
+ * Lock the shard of the table of IP connection counts.
+ *
+ * @param shard the shard to lock
+ */
+static void
+MHD_ip_count_lock (struct MHD_IPCountShard *shard)
+{
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
-  MHD_mutex_lock_chk_ (&daemon->per_ip_connection_mutex);
+  MHD_mutex_lock_chk_ (&shard->lock);
 #else
-  (void) daemon;
+  (void) shard;
 #endif
 }
 
 
 /**
- * Unlock shared structure for IP connection counts and connection DLLs.
+ * Unlock the shard of the table of IP connection counts.
  *
- * @param daemon handle to daemon where lock is
+ * @param shard the shard to unlock
  */
 static void
-MHD_ip_count_unlock (struct MHD_Daemon *daemon)
+MHD_ip_count_unlock (struct MHD_IPCountShard *shard)
 {
-  mhd_assert (NULL == daemon->master);
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
-  MHD_mutex_unlock_chk_ (&daemon->per_ip_connection_mutex);
+  MHD_mutex_unlock_chk_ (&shard->lock);
 #else
-  (void) daemon;
+  (void) shard;
 #endif
 }
 
 
 /**
- * Tree comparison function for IP addresses (supplied to tsearch() family).
+ * Compare IP addresses.
  * We compare everything in the struct up through the beginning of the
  * 'count' field.
  *
  * @param a1 first address to compare
  * @param a2 second address to compare
- * @return -1, 0 or 1 depending on result of compare
+ * @return true if addresses are equal, false otherwise
  */
-static int
-MHD_ip_addr_compare (const void *a1,
-                     const void *a2)
+static bool
+MHD_ip_addr_equal (const struct MHD_IPCount *a1,
+                   const struct MHD_IPCount *a2)
+{
+  return 0 == memcmp (a1,
+                      a2,
+                      offsetof (struct MHD_IPCount,
+                                count));
+}
+
+
+/**
+ * Calculate the hash of the IP address (FNV-1a variant).
+ *
+ * @param daemon the master daemon
+ * @param key the IP address
+ * @return the hash value
+ */
+static uint32_t
+MHD_ip_addr_hash (const struct MHD_Daemon *daemon,
+                  const struct MHD_IPCount *key)
+{
+  const uint8_t *const data = (const uint8_t *) key;
+  size_t len;
+  size_t i;
+  uint32_t hash;
+
+  len = offsetof (struct MHD_IPCount, addr);
+  if (AF_INET == key->family)
+    len += sizeof(key->addr.ipv4);
+  else
+    len += sizeof(key->addr);
+  hash = 2166136261U ^ daemon->per_ip_count_salt;
+  for (i = 0; i < len; i++)
+  {
+    hash ^= data[i];
+    hash *= 16777619U;
+  }
+  /* Final mixing: both the low and the high bits are used */
+  hash ^= hash >> 15;
+  hash *= 0x2c1b3c6dU;
+  hash ^= hash >> 12;
+  return hash;
+}
+
+
+/**
+ * Get the shard of the table for the hash value.
+ *
+ * @param daemon the master daemon
+ * @param hash the hash of the IP address
+ * @return the shard to use
+ */
+_MHD_static_inline struct MHD_IPCountShard *
+MHD_ip_count_shard (struct MHD_Daemon *daemon,
+                    uint32_t hash)
+{
+  return daemon->per_ip_count + ((hash >> 24) & (MHD_IP_COUNT_SHARDS - 1));
+}
+
+
+/**
+ * Find the slot for the @a key in the @a shard.
+ * The shard must be allocated and must have at least one unused slot.
+ *
+ * @param shard the locked shard to search
+ * @param key the IP address to find
+ * @param hash the hash of the IP address
+ * @return the slot with the @a key or the unused slot where
+ *         the @a key should be placed
+ */
+static struct MHD_IPCount *
+MHD_ip_count_find_slot (struct MHD_IPCountShard *shard,
+                        const struct MHD_IPCount *key,
+                        uint32_t hash)
+{
+  const size_t mask = shard->size - 1;
+  size_t pos;
+
+  mhd_assert (shard->used < shard->size);
+  for (pos = (size_t) hash & mask; true; pos = (pos + 1) & mask)
+  {
+    struct MHD_IPCount *const slot = shard->slots + pos;
+
+    if ( (0 == slot->count) ||
+         MHD_ip_addr_equal (slot, key) )
+      return slot;
+  }
+}
+
+
+/**
+ * Enlarge the shard so the new element can be added.
+ *
+ * @param daemon the master daemon
+ * @param shard the locked shard to enlarge
+ * @return true on success, false if memory allocation failed
+ */
+static bool
+MHD_ip_count_shard_grow (struct MHD_Daemon *daemon,
+                         struct MHD_IPCountShard *shard)
+{
+  struct MHD_IPCount *old_slots;
+  size_t old_size;
+  size_t new_size;
+  size_t i;
+
+  new_size = (0 == shard->size) ?
+             MHD_IP_COUNT_SHARD_INIT_SIZE : shard->size * 2;
+  if (new_size <= shard->size)
+    return false; /* Overflow */
+  old_slots = shard->slots;
+  old_size = shard->size;
+  shard->slots = (struct MHD_IPCount *)
+                 MHD_calloc_ (new_size, sizeof(struct MHD_IPCount));
+  if (NULL == shard->slots)
+  {
+    shard->slots = old_slots;
+    return false;
+  }
+  shard->size = new_size;
+  for (i = 0; i < old_size; i++)
+  {
+    if (0 != old_slots[i].count)
+      *MHD_ip_count_find_slot (shard,
+                               old_slots + i,
+                               MHD_ip_addr_hash (daemon,
+                                                 old_slots + i)) =
+        old_slots[i];
+  }
+  free (old_slots);
+  return true;
+}
+
+
+/**
+ * Remove the unused slot from the shard by moving back the elements
+ * placed after it (no "deleted" markers are used).
+ *
+ * @param daemon the master daemon
+ * @param shard the locked shard
+ * @param slot the slot with zero count
+ */
+static void
+MHD_ip_count_shard_remove (struct MHD_Daemon *daemon,
+                           struct MHD_IPCountShard *shard,
+                           struct MHD_IPCount *slot)
 {
-  return memcmp (a1,
-                 a2,
-                 offsetof (struct MHD_IPCount,
-                           count));
+  const size_t mask = shard->size - 1;
+  size_t hole;
+  size_t pos;
+
+  mhd_assert (0 == slot->count);
+  hole = (size_t) (slot - shard->slots);
+  for (pos = (hole + 1) & mask; 0 != shard->slots[pos].count;
+       pos = (pos + 1) & mask)
+  {
+    const size_t home =
+      (size_t) MHD_ip_addr_hash (daemon, shard->slots + pos) & mask;
+
+    /* Move the element to the hole if the hole is located cyclically
+     * between the home position of the element and its current
+     * position. */
+    if (((pos - home) & mask) >= ((pos - hole) & mask))
+    {
+      shard->slots[hole] = shard->slots[pos];
+      shard->slots[pos].count = 0;
+      hole = pos;
+    }
+  }
+  shard->used--;
 }
 
 
@@ -370,9 +674,10 @@ MHD_ip_limit_add (struct MHD_Daemon *daemon,
                   const struct sockaddr_storage *addr,
                   socklen_t addrlen)
 {
-  struct MHD_IPCount *newkeyp;
-  struct MHD_IPCount *keyp;
-  struct MHD_IPCount **nodep;
+  struct MHD_IPCount key;
+  struct MHD_IPCountShard *shard;
+  struct MHD_IPCount *slot;
+  uint32_t hash;
   enum MHD_Result result;
 
   daemon = MHD_get_master (daemon);
@@ -380,46 +685,40 @@ MHD_ip_limit_add (struct MHD_Daemon *daemon,
   if (0 == daemon->per_ip_connection_limit)
     return MHD_YES;
 
-  newkeyp = (struct MHD_IPCount *) malloc (sizeof(struct MHD_IPCount));
-  if (NULL == newkeyp)
-    return MHD_NO;
-
   /* Initialize key */
   if (MHD_NO == MHD_ip_addr_to_key (addr,
                                     addrlen,
-                                    newkeyp))
-  {
-    free (newkeyp);
+                                    &key))
     return MHD_YES; /* Allow unhandled address types through */
-  }
 
-  MHD_ip_count_lock (daemon);
+  hash = MHD_ip_addr_hash (daemon, &key);
+  shard = MHD_ip_count_shard (daemon, hash);
+  MHD_ip_count_lock (shard);
 
-  /* Search for the IP address */
-  nodep = (struct MHD_IPCount **) tsearch (newkeyp,
-                                           &daemon->per_ip_connection_count,
-                                           &MHD_ip_addr_compare);
-  if (NULL == nodep)
+  /* Keep load factor not higher than 1/2 */
+  if ( (shard->size < (shard->used + 1) * 2) &&
+       (! MHD_ip_count_shard_grow (daemon, shard)) )
   {
-    MHD_ip_count_unlock (daemon);
-    free (newkeyp);
+    MHD_ip_count_unlock (shard);
 #ifdef HAVE_MESSAGES
     MHD_DLOG (daemon,
               _ ("Failed to add IP connection count node.\n"));
 #endif
     return MHD_NO;
   }
-  keyp = *nodep;
+  /* Search for the IP address */
+  slot = MHD_ip_count_find_slot (shard, &key, hash);
+  if (0 == slot->count)
+  {
+    *slot = key;
+    shard->used++;
+  }
   /* Test if there is room for another connection; if so,
    * increment count */
-  result = (keyp->count < daemon->per_ip_connection_limit) ? MHD_YES : MHD_NO;
+  result = (slot->count < daemon->per_ip_connection_limit) ? MHD_YES : MHD_NO;
   if (MHD_NO != result)
-    ++keyp->count;
-  MHD_ip_count_unlock (daemon);
-
-  /* If we got an existing node back, free the one we created */
-  if (keyp != newkeyp)
-    free (newkeyp);
+    ++slot->count;
+  MHD_ip_count_unlock (shard);
 
   return result;
 }
@@ -439,8 +738,9 @@ MHD_ip_limit_del (struct MHD_Daemon *daemon,
                   socklen_t addrlen)
 {
   struct MHD_IPCount search_key;
+  struct MHD_IPCountShard *shard;
   struct MHD_IPCount *found_key;
-  void **nodep;
+  uint32_t hash;
 
   daemon = MHD_get_master (daemon);
   /* Ignore if no connection limit assigned */
@@ -452,34 +752,23 @@ MHD_ip_limit_del (struct MHD_Daemon *daemon,
                                     &search_key))
     return;
 
-  MHD_ip_count_lock (daemon);
+  hash = MHD_ip_addr_hash (daemon, &search_key);
+  shard = MHD_ip_count_shard (daemon, hash);
+  MHD_ip_count_lock (shard);
 
   /* Search for the IP address */
-  if (NULL == (nodep = tfind (&search_key,
-                              &daemon->per_ip_connection_count,
-                              &MHD_ip_addr_compare)))
+  found_key = (NULL != shard->slots) ?
+              MHD_ip_count_find_slot (shard, &search_key, hash) : NULL;
+  if ((NULL == found_key) || (0 == found_key->count))
   {
     /* Something's wrong if we couldn't find an IP address
      * that was previously added */
     MHD_PANIC (_ ("Failed to find previously-added IP address.\n"));
   }
-  found_key = (struct MHD_IPCount *) *nodep;
-  /* Validate existing count for IP address */
-  if (0 == found_key->count)
-  {
-    MHD_PANIC (_ ("Previously-added IP address had counter of zero.\n"));
-  }
-  /* Remove the node entirely if count reduces to 0 */
+  /* Remove the element entirely if count reduces to 0 */
   if (0 == --found_key->count)
-  {
-    tdelete (found_key,
-             &daemon->per_ip_connection_count,
-             &MHD_ip_addr_compare);
-    MHD_ip_count_unlock (daemon);
-    free (found_key);
-  }
-  else
-    MHD_ip_count_unlock (daemon);
+    MHD_ip_count_shard_remove (daemon, shard, found_key);
+  MHD_ip_count_unlock (shard);
 }
 
 
@@ -1077,6 +1366,7 @@ internal_get_fdset2 (struct MHD_Daemon *daemon,
 #endif /* MHD_POSIX_SOCKETS */
       break;
     case MHD_EVENT_LOOP_INFO_PROCESS:
+    case MHD_EVENT_LOOP_INFO_WAIT:
       if ( (NULL == except_fd_set) ||
            ! MHD_add_to_fd_set_ (pos->socket_fd,
                                  except_fd_set,
@@ -1413,6 +1703,10 @@ cleanup_upgraded_connection (struct MHD_Connection *connection)
 
   if (NULL == urh)
     return;
+#ifdef MHD_UPGRADE_TUNNEL_SUPPORT
+  /* Application closed the connection while tunnel was active */
+  MHD_upgrade_tunnel_close_ (urh);
+#endif /* MHD_UPGRADE_TUNNEL_SUPPORT */
 #ifdef HTTPS_SUPPORT
   /* Signal remote client the end of TLS connection by
    * gracefully closing TLS session. */
@@ -1425,6 +1719,11 @@ cleanup_upgraded_connection (struct MHD_Connection *connection)
 
   if (MHD_INVALID_SOCKET != urh->app.socket)
     MHD_socket_close_chk_ (urh->app.socket);
+
+  if (urh->in_buffer_malloced)
+    free (urh->in_buffer);
+  if (urh->out_buffer_malloced)
+    free (urh->out_buffer);
 #endif /* HTTPS_SUPPORT */
   connection->urh = NULL;
   free (urh);
@@ -1435,6 +1734,71 @@ cleanup_upgraded_connection (struct MHD_Connection *connection)
 
 
 #if defined(HTTPS_SUPPORT) && defined(UPGRADE_SUPPORT)
+/**
+ * The maximum size of each forwarding buffer of the upgraded HTTPS
+ * connection.  Large enough to hold several full-size TLS records.
+ */
+#define MHD_URH_BUF_MAX_SIZE (4 * 16 * 1024)
+
+/**
+ * The minimal size of the enlarged forwarding buffer.
+ */
+#define MHD_URH_BUF_MIN_GROW_SIZE (4 * 1024)
+
+
+/**
+ * Enlarge the full forwarding buffer of the upgraded HTTPS connection.
+ * The buffer is enlarged only if the amount of data already forwarded
+ * in this direction is not less than the current buffer size, so buffers
+ * grow only for connections with sustained data flow.
+ * The buffer is not changed if memory allocation fails, the forwarding
+ * continues with the old buffer.
+ *
+ * @param[in,out] buf the pointer to the buffer
+ * @param[in,out] buf_size the pointer to the size of the buffer
+ * @param buf_used the number of bytes used in the buffer
+ * @param[in,out] is_malloced the pointer to the flag which indicates
+ *                            that the buffer was allocated by malloc()
+ * @param forwarded the number of bytes forwarded in this direction
+ * @return true if buffer has been enlarged,
+ *         false otherwise
+ */
+static bool
+urh_buffer_grow (char **buf,
+                 size_t *buf_size,
+                 size_t buf_used,
+                 bool *is_malloced,
+                 uint64_t forwarded)
+{
+  size_t new_size;
+  char *new_buf;
+
+  mhd_assert (buf_used <= *buf_size);
+  if (MHD_URH_BUF_MAX_SIZE <= *buf_size)
+    return false;
+  if (forwarded < *buf_size)
+    return false;
+
+  new_size = *buf_size * 2;
+  if (MHD_URH_BUF_MIN_GROW_SIZE > new_size)
+    new_size = MHD_URH_BUF_MIN_GROW_SIZE;
+  if (MHD_URH_BUF_MAX_SIZE < new_size)
+    new_size = MHD_URH_BUF_MAX_SIZE;
+
+  new_buf = (char *) malloc (new_size);
+  if (NULL == new_buf)
+    return false;
+  if (0 != buf_used)
+    memcpy (new_buf, *buf, buf_used);
+  if (*is_malloced)
+    free (*buf);
+  *buf = new_buf;
+  *buf_size = new_size;
+  *is_malloced = true;
+  return true;
+}
+
+
 /**
  * Performs bi-directional forwarding on upgraded HTTPS connections
  * based on the readiness state stored in the @a urh handle.
@@ -1514,10 +1878,12 @@ process_urh (struct MHD_UpgradeResponseHandle *urh)
   /*
    * handle reading from remote TLS client
    */
-  if (((0 != ((MHD_EPOLL_STATE_ERROR | MHD_EPOLL_STATE_READ_READY)
-              & urh->app.celi)) ||
-       (connection->tls_read_ready)) &&
-      (urh->in_buffer_used < urh->in_buffer_size))
+  /* Drain all TLS records available without waiting, enlarging the buffer
+   * if the data flows faster than it can be held by the buffer. */
+  while (((0 != ((MHD_EPOLL_STATE_ERROR | MHD_EPOLL_STATE_READ_READY)
+                 & urh->app.celi)) ||
+          (connection->tls_read_ready)) &&
+         (urh->in_buffer_used < urh->in_buffer_size))
   {
     ssize_t res;
     size_t buf_size;
@@ -1545,13 +1911,17 @@ process_urh (struct MHD_UpgradeResponseHandle *urh)
           urh->in_buffer_size = 0;
         }
       }
+      break;
     }
-    else   /* 0 < res */
-    {
-      urh->in_buffer_used += (size_t) res;
-      connection->tls_read_ready =
-        (0 < gnutls_record_check_pending (connection->tls_session));
-    }
+    urh->in_buffer_used += (size_t) res;
+    connection->tls_read_ready =
+      (0 < gnutls_record_check_pending (connection->tls_session));
+    if (urh->in_buffer_used == urh->in_buffer_size)
+      urh_buffer_grow (&urh->in_buffer,
+                       &urh->in_buffer_size,
+                       urh->in_buffer_used,
+                       &urh->in_buffer_malloced,
+                       urh->in_forwarded);
   }
 
   /*
@@ -1562,10 +1932,10 @@ process_urh (struct MHD_UpgradeResponseHandle *urh)
    * as 'ready' (signal may arrive after poll()/select()).
    * Socketpair for forwarding is always in non-blocking mode
    * so no risk that recv() will block the thread. */
-  if (((0 != ((MHD_EPOLL_STATE_ERROR | MHD_EPOLL_STATE_READ_READY)
-              & urh->mhd.celi))
-       || was_closed) /* Force last reading from app if app has closed the connection */
-      && (urh->out_buffer_used < urh->out_buffer_size))
+  while (((0 != ((MHD_EPOLL_STATE_ERROR | MHD_EPOLL_STATE_READ_READY)
+                 & urh->mhd.celi))
+          || was_closed) /* Force last reading from app if app has closed the connection */
+         && (urh->out_buffer_used < urh->out_buffer_size))
   {
     ssize_t res;
     size_t buf_size;
@@ -1598,13 +1968,20 @@ process_urh (struct MHD_UpgradeResponseHandle *urh)
           urh->out_buffer_size = 0;
         }
       }
+      break;
     }
-    else   /* 0 < res */
+    urh->out_buffer_used += (size_t) res;
+    if (buf_size > (size_t) res)
     {
-      urh->out_buffer_used += (size_t) res;
-      if (buf_size > (size_t) res)
-        urh->mhd.celi &= ~((enum MHD_EpollState) MHD_EPOLL_STATE_READ_READY);
+      urh->mhd.celi &= ~((enum MHD_EpollState) MHD_EPOLL_STATE_READ_READY);
+      break;
     }
+    if (urh->out_buffer_used == urh->out_buffer_size)
+      urh_buffer_grow (&urh->out_buffer,
+                       &urh->out_buffer_size,
+                       urh->out_buffer_used,
+                       &urh->out_buffer_malloced,
+                       urh->out_forwarded);
   }
 
   /*
@@ -1613,51 +1990,58 @@ process_urh (struct MHD_UpgradeResponseHandle *urh)
   if ( (0 != (MHD_EPOLL_STATE_WRITE_READY & urh->app.celi)) &&
        (urh->out_buffer_used > 0) )
   {
-    ssize_t res;
-    size_t data_size;
-
-    data_size = urh->out_buffer_used;
-    if (data_size > SSIZE_MAX)
-      data_size = SSIZE_MAX;
+    size_t sent;
 
-    res = gnutls_record_send (connection->tls_session,
-                              urh->out_buffer,
-                              data_size);
-    if (0 >= res)
+    /* Each call sends at most one TLS record, push all buffered data
+     * until the socket is not writable anymore */
+    sent = 0;
+    while (sent < urh->out_buffer_used)
     {
-      if (GNUTLS_E_INTERRUPTED != res)
+      ssize_t res;
+      size_t data_size;
+
+      data_size = urh->out_buffer_used - sent;
+      if (data_size > SSIZE_MAX)
+        data_size = SSIZE_MAX;
+
+      res = gnutls_record_send (connection->tls_session,
+                                &urh->out_buffer[sent],
+                                data_size);
+      if (0 >= res)
       {
-        urh->app.celi &= ~((enum MHD_EpollState) MHD_EPOLL_STATE_WRITE_READY);
-        if (GNUTLS_E_AGAIN != res)
+        if (GNUTLS_E_INTERRUPTED != res)
         {
-          /* TLS connection shut down or
-           * persistent / unrecoverable error. */
+          urh->app.celi &= ~((enum MHD_EpollState) MHD_EPOLL_STATE_WRITE_READY);
+          if (GNUTLS_E_AGAIN != res)
+          {
+            /* TLS connection shut down or
+             * persistent / unrecoverable error. */
 #ifdef HAVE_MESSAGES
-          MHD_DLOG (daemon,
-                    _ ("Failed to forward to remote client %" PRIu64 \
-                       " bytes of data received from application: %s\n"),
-                    (uint64_t) urh->out_buffer_used,
-                    gnutls_strerror ((int) res));
-#endif
-          /* Discard any data unsent to remote. */
-          urh->out_buffer_used = 0;
-          /* Do not try to pull more data from application. */
-          urh->out_buffer_size = 0;
-          urh->mhd.celi &= ~((enum MHD_EpollState) MHD_EPOLL_STATE_READ_READY);
+            MHD_DLOG (daemon,
+                      _ ("Failed to forward to remote client %" PRIu64 \
+                         " bytes of data received from application: %s\n"),
+                      (uint64_t) (urh->out_buffer_used - sent),
+                      gnutls_strerror ((int) res));
+#endif
+            /* Discard any data unsent to remote. */
+            sent = urh->out_buffer_used;
+            /* Do not try to pull more data from application. */
+            urh->out_buffer_size = 0;
+            urh->mhd.celi &= ~((enum MHD_EpollState) MHD_EPOLL_STATE_READ_READY);
+          }
         }
+        break;
       }
+      sent += (size_t) res;
+      urh->out_forwarded += (uint64_t) res;
     }
-    else   /* 0 < res */
+    if (sent < urh->out_buffer_used)
     {
-      const size_t next_out_buffer_used = urh->out_buffer_used - (size_t) res;
-      if (0 != next_out_buffer_used)
-      {
-        memmove (urh->out_buffer,
-                 &urh->out_buffer[res],
-                 next_out_buffer_used);
-      }
-      urh->out_buffer_used = next_out_buffer_used;
+      memmove (urh->out_buffer,
+               &urh->out_buffer[sent],
+               urh->out_buffer_used - sent);
     }
+    urh->out_buffer_used -= sent;
     if ( (0 == urh->out_buffer_used) &&
          (0 != (MHD_EPOLL_STATE_ERROR & urh->app.celi)) )
     {
@@ -1677,56 +2061,64 @@ process_urh (struct MHD_UpgradeResponseHandle *urh)
   if ( (0 != (MHD_EPOLL_STATE_WRITE_READY & urh->mhd.celi)) &&
        (urh->in_buffer_used > 0) )
   {
-    ssize_t res;
-    size_t data_size;
+    size_t sent;
 
-    data_size = urh->in_buffer_used;
-    if (data_size > MHD_SCKT_SEND_MAX_SIZE_)
-      data_size = MHD_SCKT_SEND_MAX_SIZE_;
-
-    res = MHD_send_ (urh->mhd.socket,
-                     urh->in_buffer,
-                     data_size);
-    if (0 >= res)
+    sent = 0;
+    while (sent < urh->in_buffer_used)
     {
-      const int err = MHD_socket_get_error_ ();
-      if ( (! MHD_SCKT_ERR_IS_EINTR_ (err)) &&
-           (! MHD_SCKT_ERR_IS_LOW_RESOURCES_ (err)) )
+      ssize_t res;
+      size_t data_size;
+
+      data_size = urh->in_buffer_used - sent;
+      if (data_size > MHD_SCKT_SEND_MAX_SIZE_)
+        data_size = MHD_SCKT_SEND_MAX_SIZE_;
+
+      res = MHD_send_ (urh->mhd.socket,
+                       &urh->in_buffer[sent],
+                       data_size);
+      if (0 >= res)
       {
-        urh->mhd.celi &= ~((enum MHD_EpollState) MHD_EPOLL_STATE_WRITE_READY);
-        if (! MHD_SCKT_ERR_IS_EAGAIN_ (err))
+        const int err = MHD_socket_get_error_ ();
+        if ( (! MHD_SCKT_ERR_IS_EINTR_ (err)) &&
+             (! MHD_SCKT_ERR_IS_LOW_RESOURCES_ (err)) )
         {
-          /* Socketpair connection shut down or
-           * persistent / unrecoverable error. */
+          urh->mhd.celi &= ~((enum MHD_EpollState) MHD_EPOLL_STATE_WRITE_READY);
+          if (! MHD_SCKT_ERR_IS_EAGAIN_ (err))
+          {
+            /* Socketpair connection shut down or
+             * persistent / unrecoverable error. */
 #ifdef HAVE_MESSAGES
-          MHD_DLOG (daemon,
-                    _ ("Failed to forward to application %" PRIu64 \
-                       " bytes of data received from remote side: %s\n"),
-                    (uint64_t) urh->in_buffer_used,
-                    MHD_socket_strerr_ (err));
-#endif
-          /* Discard any data received from remote. */
-          urh->in_buffer_used = 0;
-          /* Reading from remote client is not required anymore. */
-          urh->in_buffer_size = 0;
-          urh->app.celi &= ~((enum MHD_EpollState) MHD_EPOLL_STATE_READ_READY);
-          connection->tls_read_ready = false;
+            MHD_DLOG (daemon,
+                      _ ("Failed to forward to application %" PRIu64 \
+                         " bytes of data received from remote side: %s\n"),
+                      (uint64_t) (urh->in_buffer_used - sent),
+                      MHD_socket_strerr_ (err));
+#endif
+            /* Discard any data received from remote. */
+            sent = urh->in_buffer_used;
+            /* Reading from remote client is not required anymore. */
+            urh->in_buffer_size = 0;
+            urh->app.celi &= ~((enum MHD_EpollState) MHD_EPOLL_STATE_READ_READY);
+            connection->tls_read_ready = false;
+          }
         }
+        break;
       }
-    }
-    else   /* 0 < res */
-    {
-      const size_t next_in_buffer_used = urh->in_buffer_used - (size_t) res;
-      if (0 != next_in_buffer_used)
+      sent += (size_t) res;
+      urh->in_forwarded += (uint64_t) res;
+      if (data_size > (size_t) res)
       {
-        memmove (urh->in_buffer,
-                 &urh->in_buffer[res],
-                 next_in_buffer_used);
-        if (data_size > (size_t) res)
-          urh->mhd.celi &= ~((enum MHD_EpollState) MHD_EPOLL_STATE_WRITE_READY);
+        urh->mhd.celi &= ~((enum MHD_EpollState) MHD_EPOLL_STATE_WRITE_READY);
+        break;
       }
-      urh->in_buffer_used = next_in_buffer_used;
     }
+    if (sent < urh->in_buffer_used)
+    {
+      memmove (urh->in_buffer,
+               &urh->in_buffer[sent],
+               urh->in_buffer_used - sent);
+    }
+    urh->in_buffer_used -= sent;
     if ( (0 == urh->in_buffer_used) &&
          (0 != (MHD_EPOLL_STATE_ERROR & urh->mhd.celi)) )
     {
@@ -2031,6 +2423,92 @@ thread_main_handle_connection (void *data)
     static const void *const urh = NULL;
 #endif /* ! UPGRADE_SUPPORT */
 
+    if ( (con->rp.crc_waiting) &&
+         (! con->suspended) &&
+         (NULL == urh) )
+    {
+      /* Connection is waiting for the data of the content reader */
+      bool data_ready;
+      MHD_mutex_lock_chk_ (&daemon->cleanup_connection_mutex);
+      data_ready = con->crc_ready;
+      con->crc_ready = false;
+      if ( (! data_ready) &&
+           (! MHD_ITC_IS_VALID_ (con->crc_itc)) &&
+           (! MHD_itc_init_ (con->crc_itc)) )
+      {
+        MHD_itc_set_invalid_ (con->crc_itc);
+#ifdef HAVE_MESSAGES
+        MHD_DLOG (con->daemon,
+                  _ ("Failed to create inter-thread communication channel " \
+                     "for the connection.\n"));
+#endif
+        data_ready = true; /* Cannot wait, call the content reader again */
+      }
+      MHD_mutex_unlock_chk_ (&daemon->cleanup_connection_mutex);
+      if (data_ready)
+      {
+        con->rp.crc_waiting = false;
+        MHD_update_last_activity_ (con);     /* Reset timeout timer. */
+        MHD_connection_handle_idle (con);
+        continue;
+      }
+      if (! use_poll)
+      {
+        FD_ZERO (&rs);
+        if (! MHD_add_to_fd_set_ (MHD_itc_r_fd_ (con->crc_itc),
+                                  &rs,
+                                  NULL,
+                                  FD_SETSIZE))
+        {
+#ifdef HAVE_MESSAGES
+          MHD_DLOG (con->daemon,
+                    _ ("Failed to add FD to fd_set.\n"));
+#endif
+          goto exit;
+        }
+        if (0 > MHD_SYS_select_ (MHD_itc_r_fd_ (con->crc_itc) + 1,
+                                 &rs,
+                                 NULL,
+                                 NULL,
+                                 NULL))
+        {
+          const int err = MHD_socket_get_error_ ();
+
+          if (MHD_SCKT_ERR_IS_EINTR_ (err))
+            continue;
+#ifdef HAVE_MESSAGES
+          MHD_DLOG (con->daemon,
+                    _ ("Error during select (%d): `%s'\n"),
+                    err,
+                    MHD_socket_strerr_ (err));
+#endif
+          break;
+        }
+      }
+#ifdef HAVE_POLL
+      else     /* use_poll */
+      {
+        p[0].events = POLLIN;
+        p[0].fd = MHD_itc_r_fd_ (con->crc_itc);
+        p[0].revents = 0;
+        if (0 > MHD_sys_poll_ (p,
+                               1,
+                               -1))
+        {
+          if (MHD_SCKT_LAST_ERR_IS_ (MHD_SCKT_EINTR_))
+            continue;
+#ifdef HAVE_MESSAGES
+          MHD_DLOG (con->daemon,
+                    _ ("Error during poll: `%s'\n"),
+                    MHD_socket_last_strerr_ ());
+#endif
+          break;
+        }
+      }
+#endif /* HAVE_POLL */
+      MHD_itc_clear_ (con->crc_itc);
+      continue; /* Check again for the data and for shutdown. */
+    }
     if ( (con->suspended) &&
          (NULL == urh) )
     {
@@ -2159,6 +2637,7 @@ thread_main_handle_connection (void *data)
           err_state = true;
         break;
       case MHD_EVENT_LOOP_INFO_PROCESS:
+      case MHD_EVENT_LOOP_INFO_WAIT:
         if (! MHD_add_to_fd_set_ (con->socket_fd,
                                   &es,
                                   &maxsock,
@@ -2258,6 +2737,7 @@ thread_main_handle_connection (void *data)
         p[0].events |= POLLOUT | MHD_POLL_EVENTS_ERR_DISC;
         break;
       case MHD_EVENT_LOOP_INFO_PROCESS:
+      case MHD_EVENT_LOOP_INFO_WAIT:
         p[0].events |= MHD_POLL_EVENTS_ERR_DISC;
         break;
       case MHD_EVENT_LOOP_INFO_CLEANUP:
@@ -2551,6 +3031,23 @@ new_connection_prepare_ (struct MHD_Daemon *daemon,
             client_socket);
 #endif
 #endif
+  if (! MHD_rate_limit_check_ (daemon,
+                               addr,
+                               addrlen,
+                               false))
+  {
+    /* Client has used all allowed requests - reject */
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("Client exceeded request rate limit. " \
+                 "Closing inbound connection.\n"));
+#endif
+    MHD_socket_close_chk_ (client_socket);
+#if defined(EACCESS) && (EACCESS + 0 != 0)
+    errno = EACCESS;
+#endif
+    return NULL;
+  }
   if ( (daemon->connections == daemon->connection_limit) ||
        (MHD_NO == MHD_ip_limit_add (daemon,
                                     addr,
@@ -2607,6 +3104,7 @@ new_connection_prepare_ (struct MHD_Daemon *daemon,
     return NULL;
   }
 
+  MHD_itc_set_invalid_ (connection->crc_itc);
   if (! external_add)
   {
     connection->sk_corked = _MHD_OFF;
@@ -2932,12 +3430,20 @@ new_connection_process_ (struct MHD_Daemon *daemon,
 #ifdef MHD_USE_THREADS
       if (MHD_D_IS_USING_THREAD_PER_CONN_ (daemon))
       {
+        bool started;
+
         mhd_assert (! MHD_D_IS_USING_EPOLL_ (daemon));
-        if (! MHD_create_named_thread_ (&connection->tid,
-                                        "MHD-connection",
-                                        daemon->thread_stack_size,
-                                        &thread_main_handle_connection,
-                                        connection))
+#ifdef MHD_CONN_THREADS_SUPPORT
+        if (NULL != daemon->conn_threads)
+          started = MHD_conn_threads_start_ (connection);
+        else
+#endif /* MHD_CONN_THREADS_SUPPORT */
+        started = MHD_create_named_thread_ (&connection->tid,
+                                            "MHD-connection",
+                                            daemon->thread_stack_size,
+                                            &thread_main_handle_connection,
+                                            connection);
+        if (! started)
         {
           eno = errno;
 #ifdef HAVE_MESSAGES
@@ -3142,17 +3648,22 @@ internal_add_connection (struct MHD_Daemon *daemon,
   if ((external_add) &&
       MHD_D_IS_THREAD_SAFE_ (daemon))
   {
+    bool need_signal;
     /* Connection is added externally and MHD is thread safe mode. */
     MHD_mutex_lock_chk_ (&daemon->new_connections_mutex);
     DLL_insert (daemon->new_connections_head,
                 daemon->new_connections_tail,
                 connection);
+    /* The daemon thread is already signalled if the list was not
+       processed yet, a burst of added connections needs one signal. */
+    need_signal = ! daemon->have_new;
     daemon->have_new = true;
     MHD_mutex_unlock_chk_ (&daemon->new_connections_mutex);
 
     /* The rest of connection processing must be handled in
      * the daemon thread. */
-    if ((MHD_ITC_IS_VALID_ (daemon->itc)) &&
+    if ((need_signal) &&
+        (MHD_ITC_IS_VALID_ (daemon->itc)) &&
         (! MHD_itc_activate_ (daemon->itc, "n")))
     {
 #ifdef HAVE_MESSAGES
@@ -3211,6 +3722,31 @@ new_connections_list_process_ (struct MHD_Daemon *daemon)
 }
 
 
+/**
+ * Mark the suspended connection as resuming and add it to the daemon's
+ * list of the resuming connections, so only the resuming connections
+ * are processed by resume_suspended_connections().
+ * @remark To be called with the daemon's @e cleanup_connection_mutex
+ * locked.
+ *
+ * @param connection the connection to resume
+ */
+static void
+mark_connection_resuming (struct MHD_Connection *connection)
+{
+  struct MHD_Daemon *daemon = connection->daemon;
+
+  if (! connection->resuming)
+  {
+    RDLL_insert (daemon->resuming_head,
+                 daemon->resuming_tail,
+                 connection);
+    connection->resuming = true;
+  }
+  daemon->resuming = true;
+}
+
+
 /**
  * Internal version of ::MHD_suspend_connection().
  *
@@ -3235,6 +3771,9 @@ internal_suspend_connection_ (struct MHD_Connection *connection)
   if (connection->resuming)
   {
     /* suspending again while we didn't even complete resuming yet */
+    RDLL_remove (daemon->resuming_head,
+                 daemon->resuming_tail,
+                 connection);
     connection->resuming = false;
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
     MHD_mutex_unlock_chk_ (&daemon->cleanup_connection_mutex);
@@ -3323,15 +3862,20 @@ MHD_suspend_connection (struct MHD_Connection *connection)
 {
   struct MHD_Daemon *const daemon = connection->daemon;
 
+  if (0 == (daemon->options & MHD_TEST_ALLOW_SUSPEND_RESUME))
+    MHD_PANIC (_ ("Cannot suspend connections without " \
+                  "enabling MHD_ALLOW_SUSPEND_RESUME!\n"));
+#ifdef MHD_HANDLER_THREADS_SUPPORT
+  if (MHD_handler_threads_suspend_ (connection))
+    return; /* Kept suspended when the handler thread returns */
+#endif /* MHD_HANDLER_THREADS_SUPPORT */
+
 #ifdef MHD_USE_THREADS
   mhd_assert ( (! MHD_D_IS_USING_THREADS_ (daemon)) || \
                MHD_D_IS_USING_THREAD_PER_CONN_ (daemon) || \
                MHD_thread_handle_ID_is_current_thread_ (daemon->tid) );
 #endif /* MHD_USE_THREADS */
 
-  if (0 == (daemon->options & MHD_TEST_ALLOW_SUSPEND_RESUME))
-    MHD_PANIC (_ ("Cannot suspend connections without " \
-                  "enabling MHD_ALLOW_SUSPEND_RESUME!\n"));
 #ifdef UPGRADE_SUPPORT
   if (NULL != connection->urh)
   {
@@ -3363,20 +3907,37 @@ MHD_suspend_connection (struct MHD_Connection *connection)
  */
 _MHD_EXTERN void
 MHD_resume_connection (struct MHD_Connection *connection)
+{
+  if (0 == (connection->daemon->options & MHD_TEST_ALLOW_SUSPEND_RESUME))
+    MHD_PANIC (_ ("Cannot resume connections without enabling " \
+                  "MHD_ALLOW_SUSPEND_RESUME!\n"));
+#ifdef MHD_HANDLER_THREADS_SUPPORT
+  if (MHD_handler_threads_resume_ (connection))
+    return; /* Resumed when the handler thread returns */
+#endif /* MHD_HANDLER_THREADS_SUPPORT */
+  internal_resume_connection_ (connection);
+}
+
+
+/**
+ * Internal version of ::MHD_resume_connection().
+ *
+ * @remark Can be called from any thread.
+ *
+ * @param connection the connection to resume
+ */
+void
+internal_resume_connection_ (struct MHD_Connection *connection)
 {
   struct MHD_Daemon *daemon = connection->daemon;
 #if defined(MHD_USE_THREADS)
   mhd_assert (NULL == daemon->worker_pool);
 #endif /* MHD_USE_THREADS */
 
-  if (0 == (daemon->options & MHD_TEST_ALLOW_SUSPEND_RESUME))
-    MHD_PANIC (_ ("Cannot resume connections without enabling " \
-                  "MHD_ALLOW_SUSPEND_RESUME!\n"));
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
   MHD_mutex_lock_chk_ (&daemon->cleanup_connection_mutex);
 #endif
-  connection->resuming = true;
-  daemon->resuming = true;
+  mark_connection_resuming (connection);
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
   MHD_mutex_unlock_chk_ (&daemon->cleanup_connection_mutex);
 #endif
@@ -3392,6 +3953,102 @@ MHD_resume_connection (struct MHD_Connection *connection)
 }
 
 
+_MHD_EXTERN void
+MHD_content_reader_ready (struct MHD_Connection *connection)
+{
+  struct MHD_Daemon *daemon = connection->daemon;
+  struct MHD_itc_ *signal_itc;
+
+  signal_itc = NULL;
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_lock_chk_ (&daemon->cleanup_connection_mutex);
+#endif
+  if (! connection->crc_ready)
+  {
+    connection->crc_ready = true;
+    if (MHD_D_IS_USING_THREAD_PER_CONN_ (daemon))
+    {
+      /* The connection's thread checks the flag before waiting */
+      if (MHD_ITC_IS_VALID_ (connection->crc_itc))
+        signal_itc = &connection->crc_itc;
+    }
+    else
+    {
+      connection->next_crc_ready = daemon->crc_ready_head;
+      daemon->crc_ready_head = connection;
+      /* The daemon is already signalled if the queue is not empty */
+      if (! daemon->have_crc_ready)
+        signal_itc = &daemon->itc;
+      daemon->have_crc_ready = true;
+    }
+  }
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_unlock_chk_ (&daemon->cleanup_connection_mutex);
+#endif
+  if ( (NULL != signal_itc) &&
+       (MHD_ITC_IS_VALID_ (*signal_itc)) &&
+       (! MHD_itc_activate_ (*signal_itc, "d")) )
+  {
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("Failed to signal the data of the content reader via " \
+                 "inter-thread communication channel.\n"));
+#endif
+  }
+}
+
+
+/**
+ * Process the connections signalled by #MHD_content_reader_ready().
+ * The connections waiting for the data of the content reader are
+ * marked for processing, the content reader is called again.
+ * @remark To be called only from thread that process
+ * daemon's select()/poll()/etc.
+ *
+ * @param daemon daemon context
+ */
+static void
+process_crc_ready_connections (struct MHD_Daemon *daemon)
+{
+  struct MHD_Connection *pos;
+
+  mhd_assert (! MHD_D_IS_USING_THREAD_PER_CONN_ (daemon));
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  mhd_assert (NULL == daemon->worker_pool);
+  mhd_assert ( (! MHD_D_IS_USING_THREADS_ (daemon)) || \
+               MHD_thread_handle_ID_is_current_thread_ (daemon->tid) );
+  MHD_mutex_lock_chk_ (&daemon->cleanup_connection_mutex);
+#endif
+  daemon->have_crc_ready = false;
+  while (NULL != (pos = daemon->crc_ready_head))
+  {
+    daemon->crc_ready_head = pos->next_crc_ready;
+    pos->next_crc_ready = NULL;
+    pos->crc_ready = false;
+    if (! pos->rp.crc_waiting)
+      continue; /* Signalled before the data has been requested */
+    pos->rp.crc_waiting = false;
+    if ( (pos->suspended) ||
+         (MHD_EVENT_LOOP_INFO_WAIT != pos->event_loop_info) )
+      continue; /* The event loop info is updated when processed */
+    pos->event_loop_info = MHD_EVENT_LOOP_INFO_PROCESS;
+#ifdef EPOLL_SUPPORT
+    if ( (MHD_D_IS_USING_EPOLL_ (daemon)) &&
+         (0 == (pos->epoll_state & MHD_EPOLL_STATE_IN_EREADY_EDLL)) )
+    {
+      EDLL_insert (daemon->eready_head,
+                   daemon->eready_tail,
+                   pos);
+      pos->epoll_state |= MHD_EPOLL_STATE_IN_EREADY_EDLL;
+    }
+#endif /* EPOLL_SUPPORT */
+  }
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_unlock_chk_ (&daemon->cleanup_connection_mutex);
+#endif
+}
+
+
 #ifdef UPGRADE_SUPPORT
 /**
  * Mark upgraded connection as closed by application.
@@ -3413,8 +4070,7 @@ MHD_upgraded_connection_mark_app_closed_ (struct MHD_Connection *connection)
 
   MHD_mutex_lock_chk_ (&daemon->cleanup_connection_mutex);
   connection->urh->was_closed = true;
-  connection->resuming = true;
-  daemon->resuming = true;
+  mark_connection_resuming (connection);
   MHD_mutex_unlock_chk_ (&daemon->cleanup_connection_mutex);
   if ( (MHD_ITC_IS_VALID_ (daemon->itc)) &&
        (! MHD_itc_activate_ (daemon->itc, "r")) )
@@ -3431,7 +4087,7 @@ MHD_upgraded_connection_mark_app_closed_ (struct MHD_Connection *connection)
 #endif /* UPGRADE_SUPPORT */
 
 /**
- * Run through the suspended connections and move any that are no
+ * Run through the resuming connections and move any that are no
  * longer suspended back to the active state.
  * @remark To be called only from thread that process
  * daemon's select()/poll()/etc.
@@ -3460,9 +4116,10 @@ resume_suspended_connections (struct MHD_Daemon *daemon)
 
   if (daemon->resuming)
   {
-    prev = daemon->suspended_connections_tail;
+    prev = daemon->resuming_tail;
     /* During shutdown check for resuming is forced. */
-    mhd_assert ((NULL != prev) || (daemon->shutdown) || \
+    mhd_assert ((NULL != daemon->suspended_connections_tail) || \
+                (daemon->shutdown) || \
                 (0 != (daemon->options & MHD_ALLOW_UPGRADE)));
   }
 
@@ -3475,15 +4132,14 @@ resume_suspended_connections (struct MHD_Daemon *daemon)
 #else  /* ! UPGRADE_SUPPORT */
     static const void *const urh = NULL;
 #endif /* ! UPGRADE_SUPPORT */
-    prev = pos->prev;
-    if ( (! pos->resuming)
+    prev = pos->prevR;
+    mhd_assert (pos->resuming);
 #ifdef UPGRADE_SUPPORT
-         || ( (NULL != urh) &&
-              ( (! urh->was_closed) ||
-                (! urh->clean_ready) ) )
-#endif /* UPGRADE_SUPPORT */
-         )
+    if ( (NULL != urh) &&
+         ( (! urh->was_closed) ||
+           (! urh->clean_ready) ) )
       continue;
+#endif /* UPGRADE_SUPPORT */
     ret = MHD_YES;
     mhd_assert (pos->suspended);
     DLL_remove (daemon->suspended_connections_head,
@@ -3550,6 +4206,9 @@ resume_suspended_connections (struct MHD_Daemon *daemon)
       daemon->data_already_pending = true;
     }
 #endif /* UPGRADE_SUPPORT */
+    RDLL_remove (daemon->resuming_head,
+                 daemon->resuming_tail,
+                 pos);
     pos->resuming = false;
   }
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
@@ -3572,6 +4231,104 @@ resume_suspended_connections (struct MHD_Daemon *daemon)
 }
 
 
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+/**
+ * Select the worker daemon for the connection added by
+ * #MHD_add_connection() according to #MHD_OPTION_WORKER_DISTRIBUTION.
+ * The numbers of the connections of the workers are read without
+ * locking, they are used only as a hint.
+ *
+ * @param daemon the master daemon with the thread pool
+ * @param client_socket the socket of the new connection
+ * @return the worker daemon to use,
+ *         NULL if all workers are at their connection limit
+ */
+static struct MHD_Daemon *
+select_worker (struct MHD_Daemon *daemon,
+               MHD_socket client_socket)
+{
+  const unsigned int num = daemon->worker_pool_size;
+  struct MHD_Daemon *best;
+  unsigned int i;
+
+  mhd_assert (1 < num);
+  if (MHD_WD_SOCKET == daemon->worker_distribution)
+  {
+    /* Use the socket as the initial offset into the pool,
+       try to find a worker with capacity */
+    for (i = 0; i < num; ++i)
+    {
+      struct MHD_Daemon *const worker =
+        &daemon->worker_pool[(i + (unsigned int) client_socket) % num];
+      if (worker->connections < worker->connection_limit)
+        return worker;
+    }
+    return NULL;
+  }
+#ifdef SO_INCOMING_CPU
+  if (MHD_WD_INCOMING_CPU == daemon->worker_distribution)
+  {
+    int cpu;
+    socklen_t cpu_size = (socklen_t) sizeof (cpu);
+
+    if ( (0 == getsockopt (client_socket,
+                           SOL_SOCKET,
+                           SO_INCOMING_CPU,
+                           (void *) &cpu,
+                           &cpu_size)) &&
+         (0 <= cpu) )
+    {
+      best = NULL;
+#ifdef MHD_USE_THREAD_CPU_AFFINITY_
+      for (i = 0; i < num; ++i)
+      {
+        struct MHD_Daemon *const worker = &daemon->worker_pool[i];
+        if (worker->bind_to_cpu &&
+            (((unsigned int) cpu) == worker->bound_cpu))
+        {
+          best = worker;
+          break;
+        }
+      }
+#endif /* MHD_USE_THREAD_CPU_AFFINITY_ */
+      if (NULL == best)
+        best = &daemon->worker_pool[((unsigned int) cpu) % num];
+      if (best->connections < best->connection_limit)
+        return best;
+    }
+  }
+#endif /* SO_INCOMING_CPU */
+  if (MHD_WD_LEAST_CONNECTIONS != daemon->worker_distribution)
+  {
+    /* Two different workers picked by the hash of the socket */
+    const uint32_t hash = ((uint32_t) client_socket) * 2654435761U;
+    const unsigned int first = (unsigned int) (hash >> 16) % num;
+    const unsigned int second =
+      (first + 1 + (unsigned int) (hash & 0xFFFFU) % (num - 1)) % num;
+
+    best = &daemon->worker_pool[first];
+    if (daemon->worker_pool[second].connections < best->connections)
+      best = &daemon->worker_pool[second];
+    if (best->connections < best->connection_limit)
+      return best;
+  }
+  /* Find the worker with the least number of the connections */
+  best = NULL;
+  for (i = 0; i < num; ++i)
+  {
+    struct MHD_Daemon *const worker = &daemon->worker_pool[i];
+    if (worker->connections >= worker->connection_limit)
+      continue;
+    if ( (NULL == best) ||
+         (worker->connections < best->connections) )
+      best = worker;
+  }
+  return best;
+}
+
+
+#endif /* MHD_USE_POSIX_THREADS || MHD_USE_W32_THREADS */
+
 /**
  * Add another client connection to the set of connections managed by
  * MHD.  This API is usually not needed (since MHD will accept inbound
@@ -3748,25 +4505,17 @@ MHD_add_connection (struct MHD_Daemon *daemon,
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
   if (NULL != daemon->worker_pool)
   {
-    unsigned int i;
-    /* have a pool, try to find a pool with capacity; we use the
-       socket as the initial offset into the pool for load
-       balancing */
-    for (i = 0; i < daemon->worker_pool_size; ++i)
-    {
-      struct MHD_Daemon *const worker =
-        &daemon->worker_pool[(i + (unsigned int) client_socket)
-                             % daemon->worker_pool_size];
-      if (worker->connections < worker->connection_limit)
-        return internal_add_connection (worker,
-                                        client_socket,
-                                        &addrstorage,
-                                        addrlen,
-                                        true,
-                                        sk_nonbl,
-                                        sk_spipe_supprs,
-                                        _MHD_UNKNOWN);
-    }
+    struct MHD_Daemon *const worker = select_worker (daemon,
+                                                     client_socket);
+    if (NULL != worker)
+      return internal_add_connection (worker,
+                                      client_socket,
+                                      &addrstorage,
+                                      addrlen,
+                                      true,
+                                      sk_nonbl,
+                                      sk_spipe_supprs,
+                                      _MHD_UNKNOWN);
     /* all pools are at their connection limit, must refuse */
     MHD_socket_close_chk_ (client_socket);
 #if defined(ENFILE) && (ENFILE + 0 != 0)
@@ -4031,6 +4780,35 @@ MHD_accept_connection (struct MHD_Daemon *daemon)
 }
 
 
+/**
+ * Accept pending incoming connections after the listen socket has been
+ * reported as ready.
+ * Connections are accepted until no more connections are pending, the
+ * connection limit is reached or #MHD_OPTION_ACCEPT_BATCH_SIZE connections
+ * have been accepted.  Blocking listen socket is used only once.
+ * @remark To be called only from thread that process
+ * daemon's select()/poll()/etc.
+ *
+ * @param daemon handle with the listen socket
+ */
+static void
+MHD_accept_connections_batch_ (struct MHD_Daemon *daemon)
+{
+  const unsigned int batch_size =
+    daemon->listen_nonblk ? daemon->accept_batch_size : 1;
+  unsigned int num_accepted;
+
+  for (num_accepted = 0; num_accepted < batch_size; num_accepted++)
+  {
+    if (MHD_NO == MHD_accept_connection (daemon))
+      break;
+    if ( (daemon->connections >= daemon->connection_limit) ||
+         (daemon->at_limit) )
+      break;
+  }
+}
+
+
 /**
  * Free resources associated with all closed connections.
  * (destroy responses, free buffers, etc.).  All closed
@@ -4053,9 +4831,25 @@ MHD_cleanup_connections (struct MHD_Daemon *daemon)
 #endif
   while (NULL != (pos = daemon->cleanup_tail))
   {
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+    if (pos->thread_reused && ! pos->thread_joined)
+      break; /* The thread is finishing with the connection, it signals
+                the daemon when the connection is released */
+#endif
     DLL_remove (daemon->cleanup_head,
                 daemon->cleanup_tail,
                 pos);
+    if ( (pos->crc_ready) &&
+         (! MHD_D_IS_USING_THREAD_PER_CONN_ (daemon)) )
+    {
+      /* Remove from the queue of MHD_content_reader_ready() */
+      struct MHD_Connection **pp;
+
+      for (pp = &daemon->crc_ready_head; pos != *pp;
+           pp = &((*pp)->next_crc_ready))
+        mhd_assert (NULL != *pp);
+      *pp = pos->next_crc_ready;
+    }
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
     MHD_mutex_unlock_chk_ (&daemon->cleanup_connection_mutex);
     if (MHD_D_IS_USING_THREAD_PER_CONN_ (daemon) &&
@@ -4063,6 +4857,8 @@ MHD_cleanup_connections (struct MHD_Daemon *daemon)
         (! MHD_thread_handle_ID_join_thread_ (pos->tid)) )
       MHD_PANIC (_ ("Failed to join a thread.\n"));
 #endif
+    if (MHD_ITC_IS_VALID_ (pos->crc_itc))
+      MHD_itc_destroy_chk_ (pos->crc_itc);
 #ifdef UPGRADE_SUPPORT
     cleanup_upgraded_connection (pos);
 #endif /* UPGRADE_SUPPORT */
@@ -4132,6 +4928,7 @@ MHD_cleanup_connections (struct MHD_Daemon *daemon)
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
   MHD_mutex_unlock_chk_ (&daemon->cleanup_connection_mutex);
 #endif
+  MHD_conn_threads_cleanup_ (daemon);
 }
 
 
@@ -4248,6 +5045,7 @@ MHD_get_timeout64 (struct MHD_Daemon *daemon,
       || (NULL != daemon->cleanup_head)
       || daemon->resuming
       || daemon->have_new
+      || daemon->have_crc_ready
       || daemon->shutdown)
   {
     /* Some data or connection statuses already waiting to be processed. */
@@ -4260,6 +5058,9 @@ MHD_get_timeout64 (struct MHD_Daemon *daemon,
 #if defined(UPGRADE_SUPPORT) && defined(HTTPS_SUPPORT)
        || (NULL != daemon->eready_urh_head)
 #endif /* UPGRADE_SUPPORT && HTTPS_SUPPORT */
+#ifdef MHD_UPGRADE_TUNNEL_SUPPORT
+       || (NULL != daemon->eready_tunnel_head)
+#endif /* MHD_UPGRADE_TUNNEL_SUPPORT */
       ) )
   {
     /* Some connection(s) already have some data pending. */
@@ -4528,6 +5329,9 @@ internal_run_from_select (struct MHD_Daemon *daemon,
   if (daemon->have_new)
     new_connections_list_process_ (daemon);
 
+  if (daemon->have_crc_ready)
+    process_crc_ready_connections (daemon);
+
   /* select connection thread handling type */
   ds = daemon->listen_fd;
   if ( (MHD_INVALID_SOCKET != ds) &&
@@ -4541,20 +5345,24 @@ internal_run_from_select (struct MHD_Daemon *daemon,
       need_to_accept = daemon->listen_nonblk;  /* Try to accept if non-blocking */
 
     if (need_to_accept)
-      (void) MHD_accept_connection (daemon);
+      MHD_accept_connections_batch_ (daemon);
   }
 
   if (! MHD_D_IS_USING_THREAD_PER_CONN_ (daemon))
   {
     /* do not have a thread per connection, process all connections now */
     struct MHD_Connection *pos;
-    for (pos = daemon->connections_tail; NULL != pos; pos = pos->prev)
+    struct MHD_Connection *prev;
+    for (pos = daemon->connections_tail; NULL != pos; pos = prev)
     {
       MHD_socket cs;
       bool r_ready;
       bool w_ready;
       bool has_err;
 
+      /* Get the previous connection here as the connection can be moved
+       * to the cleanup list when closed. */
+      prev = pos->prev;
       cs = pos->socket_fd;
       if (MHD_INVALID_SOCKET == cs)
         continue;
@@ -5062,6 +5870,7 @@ MHD_poll_all (struct MHD_Daemon *daemon,
         p[poll_server + i].events |= POLLOUT | MHD_POLL_EVENTS_ERR_DISC;
         break;
       case MHD_EVENT_LOOP_INFO_PROCESS:
+      case MHD_EVENT_LOOP_INFO_WAIT:
         p[poll_server + i].events |=  MHD_POLL_EVENTS_ERR_DISC;
         break;
       case MHD_EVENT_LOOP_INFO_CLEANUP:
@@ -5119,10 +5928,13 @@ MHD_poll_all (struct MHD_Daemon *daemon,
     if (daemon->have_new)
       new_connections_list_process_ (daemon);
 
+    if (daemon->have_crc_ready)
+      process_crc_ready_connections (daemon);
+
     /* handle 'listen' FD */
     if ( (-1 != poll_listen) &&
          (0 != (p[poll_listen].revents & POLLIN)) )
-      (void) MHD_accept_connection (daemon);
+      MHD_accept_connections_batch_ (daemon);
 
     /* Reset. New value will be set when connections are processed. */
     daemon->data_already_pending = false;
@@ -5270,7 +6082,7 @@ MHD_poll_listen_socket (struct MHD_Daemon *daemon,
 
   if ( (0 <= poll_listen) &&
        (0 != (p[poll_listen].revents & POLLIN)) )
-    (void) MHD_accept_connection (daemon);
+    MHD_accept_connections_batch_ (daemon);
   return MHD_YES;
 }
 
@@ -5417,64 +6229,166 @@ run_epoll_for_upgrade (struct MHD_Daemon *daemon)
         ueh->celi |= MHD_EPOLL_STATE_WRITE_READY;
       }
       if (0 != (events[i].events & EPOLLHUP))
-      {
+      {
+        ueh->celi |= MHD_EPOLL_STATE_READ_READY | MHD_EPOLL_STATE_WRITE_READY;
+      }
+
+      if ( (0 == (ueh->celi & MHD_EPOLL_STATE_ERROR)) &&
+           (0 != (events[i].events & (EPOLLERR | EPOLLPRI))) )
+      {
+        /* Process new error state only one time and avoid continuously
+         * marking this connection as 'ready'. */
+        ueh->celi |= MHD_EPOLL_STATE_ERROR;
+        new_err_state = true;
+      }
+      if (! urh->in_eready_list)
+      {
+        if (new_err_state ||
+            is_urh_ready (urh))
+        {
+          EDLL_insert (daemon->eready_urh_head,
+                       daemon->eready_urh_tail,
+                       urh);
+          urh->in_eready_list = true;
+        }
+      }
+    }
+  }
+  prev = daemon->eready_urh_tail;
+  while (NULL != (pos = prev))
+  {
+    prev = pos->prevE;
+    process_urh (pos);
+    if (! is_urh_ready (pos))
+    {
+      EDLL_remove (daemon->eready_urh_head,
+                   daemon->eready_urh_tail,
+                   pos);
+      pos->in_eready_list = false;
+    }
+    /* Finished forwarding? */
+    if ( (0 == pos->in_buffer_size) &&
+         (0 == pos->out_buffer_size) &&
+         (0 == pos->in_buffer_used) &&
+         (0 == pos->out_buffer_used) )
+    {
+      MHD_connection_finish_forward_ (pos->connection);
+      pos->clean_ready = true;
+      /* If 'pos->was_closed' already was set to true, connection
+       * will be moved immediately to cleanup list. Otherwise
+       * connection will stay in suspended list until 'pos' will
+       * be marked with 'was_closed' by application. */
+      MHD_resume_connection (pos->connection);
+    }
+  }
+
+  return MHD_YES;
+}
+
+
+#endif /* HTTPS_SUPPORT && UPGRADE_SUPPORT */
+
+
+#ifdef MHD_UPGRADE_TUNNEL_SUPPORT
+/**
+ * Do epoll()-based processing for plain-text upgraded connections
+ * forwarded by the kernel (see #MHD_UPGRADE_ACTION_TUNNEL).
+ * The separate epoll() FD is used for the same reason as for
+ * #run_epoll_for_upgrade().
+ * @remark To be called only from thread that process
+ * daemon's select()/poll()/etc.
+ *
+ * @param daemon the daemon to process tunnels for
+ * @return #MHD_NO on serious errors, #MHD_YES on success
+ */
+static enum MHD_Result
+run_epoll_for_tunnels (struct MHD_Daemon *daemon)
+{
+  struct epoll_event events[MAX_EVENTS];
+  int num_events;
+  struct MHD_UpgradeTunnel *pos;
+  struct MHD_UpgradeTunnel *prev;
+
+#ifdef MHD_USE_THREADS
+  mhd_assert ( (! MHD_D_IS_USING_THREADS_ (daemon)) || \
+               MHD_thread_handle_ID_is_current_thread_ (daemon->tid) );
+#endif /* MHD_USE_THREADS */
+
+  num_events = MAX_EVENTS;
+  while (MAX_EVENTS == num_events)
+  {
+    unsigned int i;
+    /* update event masks */
+    num_events = epoll_wait (daemon->epoll_tunnel_fd,
+                             events,
+                             MAX_EVENTS,
+                             0);
+    if (-1 == num_events)
+    {
+      const int err = MHD_socket_get_error_ ();
+
+      if (MHD_SCKT_ERR_IS_EINTR_ (err))
+        return MHD_YES;
+#ifdef HAVE_MESSAGES
+      MHD_DLOG (daemon,
+                _ ("Call to epoll_wait failed: %s\n"),
+                MHD_socket_strerr_ (err));
+#endif
+      return MHD_NO;
+    }
+    for (i = 0; i < (unsigned int) num_events; i++)
+    {
+      struct UpgradeEpollHandle *const ueh = events[i].data.ptr;
+      struct MHD_UpgradeTunnel *const tun = ueh->urh->tunnel;
+
+      mhd_assert (NULL != tun);
+      if (0 != (events[i].events & (EPOLLIN | EPOLLRDHUP)))
+        ueh->celi |= MHD_EPOLL_STATE_READ_READY;
+      if (0 != (events[i].events & EPOLLOUT))
+        ueh->celi |= MHD_EPOLL_STATE_WRITE_READY;
+      if (0 != (events[i].events & EPOLLHUP))
         ueh->celi |= MHD_EPOLL_STATE_READ_READY | MHD_EPOLL_STATE_WRITE_READY;
-      }
-
-      if ( (0 == (ueh->celi & MHD_EPOLL_STATE_ERROR)) &&
-           (0 != (events[i].events & (EPOLLERR | EPOLLPRI))) )
-      {
-        /* Process new error state only one time and avoid continuously
-         * marking this connection as 'ready'. */
+      if (0 != (events[i].events & (EPOLLERR | EPOLLPRI)))
         ueh->celi |= MHD_EPOLL_STATE_ERROR;
-        new_err_state = true;
-      }
-      if (! urh->in_eready_list)
+      if (! tun->in_eready_list)
       {
-        if (new_err_state ||
-            is_urh_ready (urh))
-        {
-          EDLL_insert (daemon->eready_urh_head,
-                       daemon->eready_urh_tail,
-                       urh);
-          urh->in_eready_list = true;
-        }
+        EDLL_insert (daemon->eready_tunnel_head,
+                     daemon->eready_tunnel_tail,
+                     tun);
+        tun->in_eready_list = true;
       }
     }
   }
-  prev = daemon->eready_urh_tail;
+  prev = daemon->eready_tunnel_tail;
   while (NULL != (pos = prev))
   {
     prev = pos->prevE;
-    process_urh (pos);
-    if (! is_urh_ready (pos))
+    MHD_upgrade_tunnel_process_ (pos);
+    if (MHD_upgrade_tunnel_is_finished_ (pos))
     {
-      EDLL_remove (daemon->eready_urh_head,
-                   daemon->eready_urh_tail,
-                   pos);
-      pos->in_eready_list = false;
+      struct MHD_Connection *const connection = pos->client.urh->connection;
+
+      /* 'pos' is removed from the EDLL and freed here */
+      MHD_upgrade_tunnel_close_ (connection->urh);
+      /* Finish the connection as if application used
+       * MHD_UPGRADE_ACTION_CLOSE. */
+      if (! connection->urh->was_closed)
+        MHD_upgraded_connection_mark_app_closed_ (connection);
+      continue;
     }
-    /* Finished forwarding? */
-    if ( (0 == pos->in_buffer_size) &&
-         (0 == pos->out_buffer_size) &&
-         (0 == pos->in_buffer_used) &&
-         (0 == pos->out_buffer_used) )
+    if (! MHD_upgrade_tunnel_is_ready_ (pos))
     {
-      MHD_connection_finish_forward_ (pos->connection);
-      pos->clean_ready = true;
-      /* If 'pos->was_closed' already was set to true, connection
-       * will be moved immediately to cleanup list. Otherwise
-       * connection will stay in suspended list until 'pos' will
-       * be marked with 'was_closed' by application. */
-      MHD_resume_connection (pos->connection);
+      EDLL_remove (daemon->eready_tunnel_head,
+                   daemon->eready_tunnel_tail,
+                   pos);
+      pos->in_eready_list = false;
     }
   }
-
   return MHD_YES;
 }
 
 
-#endif /* HTTPS_SUPPORT && UPGRADE_SUPPORT */
+#endif /* MHD_UPGRADE_TUNNEL_SUPPORT */
 
 
 /**
@@ -5499,6 +6413,10 @@ MHD_epoll (struct MHD_Daemon *daemon,
 #if defined(HTTPS_SUPPORT) && defined(UPGRADE_SUPPORT)
   static const char *const upgrade_marker = "upgrade_ptr";
 #endif /* HTTPS_SUPPORT && UPGRADE_SUPPORT */
+#ifdef MHD_UPGRADE_TUNNEL_SUPPORT
+  static const char *const tunnel_marker = "tunnel_ptr";
+  bool run_tunnels = false;
+#endif /* MHD_UPGRADE_TUNNEL_SUPPORT */
   struct MHD_Connection *pos;
   struct MHD_Connection *prev;
   struct epoll_event events[MAX_EVENTS];
@@ -5579,6 +6497,27 @@ MHD_epoll (struct MHD_Daemon *daemon,
     daemon->upgrade_fd_in_epoll = true;
   }
 #endif /* HTTPS_SUPPORT && UPGRADE_SUPPORT */
+#ifdef MHD_UPGRADE_TUNNEL_SUPPORT
+  if ( (! daemon->tunnel_fd_in_epoll) &&
+       (-1 != daemon->epoll_tunnel_fd) )
+  {
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP;
+    event.data.ptr = _MHD_DROP_CONST (tunnel_marker);
+    if (0 != epoll_ctl (daemon->epoll_fd,
+                        EPOLL_CTL_ADD,
+                        daemon->epoll_tunnel_fd,
+                        &event))
+    {
+#ifdef HAVE_MESSAGES
+      MHD_DLOG (daemon,
+                _ ("Call to epoll_ctl failed: %s\n"),
+                MHD_socket_last_strerr_ ());
+#endif
+      return MHD_NO;
+    }
+    daemon->tunnel_fd_in_epoll = true;
+  }
+#endif /* MHD_UPGRADE_TUNNEL_SUPPORT */
   if ( (daemon->listen_socket_in_epoll) &&
        ( (daemon->connections == daemon->connection_limit) ||
          (daemon->at_limit) ||
@@ -5645,6 +6584,15 @@ MHD_epoll (struct MHD_Daemon *daemon,
         continue;
       }
 #endif /* HTTPS_SUPPORT && UPGRADE_SUPPORT */
+#ifdef MHD_UPGRADE_TUNNEL_SUPPORT
+      if (tunnel_marker == events[i].data.ptr)
+      {
+        /* activity on a tunnelled connection, processed
+           in a separate epoll() */
+        run_tunnels = true;
+        continue;
+      }
+#endif /* MHD_UPGRADE_TUNNEL_SUPPORT */
       if (epoll_itc_marker == events[i].data.ptr)
       {
         /* It's OK to clear ITC here as all external
@@ -5711,20 +6659,13 @@ MHD_epoll (struct MHD_Daemon *daemon,
   if (daemon->have_new)
     new_connections_list_process_ (daemon);
 
-  if (need_to_accept)
-  {
-    unsigned int series_length = 0;
+  if (daemon->have_crc_ready)
+    process_crc_ready_connections (daemon);
 
-    /* Run 'accept' until it fails or daemon at limit of connections.
-     * Do not accept more then 10 connections at once. The rest will
-     * be accepted on next turn (level trigger is used for listen
-     * socket). */
-    while ( (MHD_NO != MHD_accept_connection (daemon)) &&
-            (series_length < 10) &&
-            (daemon->connections < daemon->connection_limit) &&
-            (! daemon->at_limit) )
-      series_length++;
-  }
+  /* The rest of pending connections (if any) will be accepted on next
+   * turn (level trigger is used for listen socket). */
+  if (need_to_accept)
+    MHD_accept_connections_batch_ (daemon);
 
   /* Handle timed-out connections; we need to do this here
      as the epoll mechanism won't call the 'MHD_connection_handle_idle()' on everything,
@@ -5757,6 +6698,10 @@ MHD_epoll (struct MHD_Daemon *daemon,
   if (run_upgraded || (NULL != daemon->eready_urh_head))
     run_epoll_for_upgrade (daemon);
 #endif /* HTTPS_SUPPORT && UPGRADE_SUPPORT */
+#ifdef MHD_UPGRADE_TUNNEL_SUPPORT
+  if (run_tunnels || (NULL != daemon->eready_tunnel_head))
+    run_epoll_for_tunnels (daemon);
+#endif /* MHD_UPGRADE_TUNNEL_SUPPORT */
 
   /* process events for connections */
   prev = daemon->eready_tail;
@@ -5775,6 +6720,7 @@ MHD_epoll (struct MHD_Daemon *daemon,
             (0 == (pos->epoll_state & MHD_EPOLL_STATE_READ_READY)) ) ||
            ((MHD_EVENT_LOOP_INFO_WRITE == pos->event_loop_info) &&
             (0 == (pos->epoll_state & MHD_EPOLL_STATE_WRITE_READY)) ) ||
+           (MHD_EVENT_LOOP_INFO_WAIT == pos->event_loop_info) ||
            (MHD_EVENT_LOOP_INFO_CLEANUP == pos->event_loop_info) )
       {
         EDLL_remove (daemon->eready_head,
@@ -5996,6 +6942,21 @@ MHD_polling_thread (void *cls)
 #endif /* HAVE_PTHREAD_SIGMASK */
 
   MHD_thread_handle_ID_set_current_thread_ID_ (&(daemon->tid));
+#ifdef MHD_USE_THREAD_CPU_AFFINITY_
+  /* Bind before any memory is used by this thread, so the memory
+   * pools of the connections are allocated on the node of the CPU. */
+  if (daemon->bind_to_cpu &&
+      ! MHD_thread_bind_to_cpu_ (daemon->bound_cpu))
+  {
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("Failed to bind the daemon thread to CPU %u: %s\n"),
+              daemon->bound_cpu,
+              MHD_strerror_ (errno));
+#endif /* HAVE_MESSAGES */
+    (void) 0; /* Mute possible compiler warning */
+  }
+#endif /* MHD_USE_THREAD_CPU_AFFINITY_ */
 #ifdef HAVE_PTHREAD_SIGMASK
   if ((0 == sigemptyset (&s_mask)) &&
       (0 == sigaddset (&s_mask, SIGPIPE)))
@@ -6026,6 +6987,7 @@ MHD_polling_thread (void *cls)
     else
 #endif
     MHD_select (daemon, -1);
+    MHD_handler_threads_dispatch_ (daemon);
     MHD_cleanup_connections (daemon);
   }
 
@@ -6711,6 +7673,156 @@ parse_options_va (struct MHD_Daemon *daemon,
       daemon->per_ip_connection_limit = va_arg (ap,
                                                 unsigned int);
       break;
+    case MHD_OPTION_PER_IP_RATE_LIMIT:
+      daemon->per_ip_rate_limit = va_arg (ap,
+                                          unsigned int);
+      break;
+    case MHD_OPTION_PER_IP_RATE_BURST:
+      daemon->per_ip_rate_burst = va_arg (ap,
+                                          unsigned int);
+      break;
+    case MHD_OPTION_PER_IP_RATE_PREFIX_IPV4:
+      daemon->per_ip_rate_prefix4 = va_arg (ap,
+                                            unsigned int);
+      if (32 < daemon->per_ip_rate_prefix4)
+        daemon->per_ip_rate_prefix4 = 32;
+      break;
+    case MHD_OPTION_PER_IP_RATE_PREFIX_IPV6:
+      daemon->per_ip_rate_prefix6 = va_arg (ap,
+                                            unsigned int);
+      if (128 < daemon->per_ip_rate_prefix6)
+        daemon->per_ip_rate_prefix6 = 128;
+      break;
+    case MHD_OPTION_PER_IP_RATE_DROP:
+      daemon->per_ip_rate_drop = (0 != va_arg (ap,
+                                               int));
+      break;
+    case MHD_OPTION_RESPONSE_CACHE_SIZE:
+      daemon->response_cache_size = va_arg (ap,
+                                            size_t);
+      break;
+    case MHD_OPTION_FILE_IO_THREADS:
+#ifdef MHD_FILE_IO_SUPPORT
+      daemon->file_io_threads = va_arg (ap,
+                                        unsigned int);
+      break;
+#else  /* ! MHD_FILE_IO_SUPPORT */
+      if (0 != va_arg (ap,
+                       unsigned int))
+      {
+#ifdef HAVE_MESSAGES
+        MHD_DLOG (daemon,
+                  _ ("MHD_OPTION_FILE_IO_THREADS is used, but MHD is "
+                     "compiled without support for I/O threads.\n"));
+#endif /* HAVE_MESSAGES */
+        return MHD_NO;
+      }
+      break;
+#endif /* ! MHD_FILE_IO_SUPPORT */
+    case MHD_OPTION_CONNECTION_THREADS_IDLE_MAX:
+#ifdef MHD_CONN_THREADS_SUPPORT
+      daemon->conn_threads_idle_max = va_arg (ap,
+                                              unsigned int);
+      break;
+#else  /* ! MHD_CONN_THREADS_SUPPORT */
+      if (0 != va_arg (ap,
+                       unsigned int))
+      {
+#ifdef HAVE_MESSAGES
+        MHD_DLOG (daemon,
+                  _ ("MHD_OPTION_CONNECTION_THREADS_IDLE_MAX is used, but "
+                     "MHD is compiled without support for the reuse of "
+                     "the connection threads.\n"));
+#endif /* HAVE_MESSAGES */
+        return MHD_NO;
+      }
+      break;
+#endif /* ! MHD_CONN_THREADS_SUPPORT */
+    case MHD_OPTION_CONNECTION_THREADS_IDLE_TIMEOUT:
+      daemon->conn_threads_idle_timeout = va_arg (ap,
+                                                  unsigned int);
+      break;
+    case MHD_OPTION_HANDLER_THREADS:
+#ifdef MHD_HANDLER_THREADS_SUPPORT
+      daemon->handler_threads = va_arg (ap,
+                                        unsigned int);
+      break;
+#else  /* ! MHD_HANDLER_THREADS_SUPPORT */
+      if (0 != va_arg (ap,
+                       unsigned int))
+      {
+#ifdef HAVE_MESSAGES
+        MHD_DLOG (daemon,
+                  _ ("MHD_OPTION_HANDLER_THREADS is used, but MHD is "
+                     "compiled without support for handler threads.\n"));
+#endif /* HAVE_MESSAGES */
+        return MHD_NO;
+      }
+      break;
+#endif /* ! MHD_HANDLER_THREADS_SUPPORT */
+    case MHD_OPTION_HANDLER_QUEUE_SIZE:
+      daemon->handler_queue_size = va_arg (ap,
+                                           unsigned int);
+      break;
+    case MHD_OPTION_ACCEPT_BATCH_SIZE:
+      daemon->accept_batch_size = va_arg (ap,
+                                          unsigned int);
+      if (0 == daemon->accept_batch_size)
+        daemon->accept_batch_size = 1;
+      break;
+    case MHD_OPTION_COALESCE_CHUNKED_UPLOAD:
+      daemon->coalesce_chunked_upload = (0 != va_arg (ap,
+                                                      int));
+      break;
+    case MHD_OPTION_DECOMPRESS_REQUEST_BODY:
+#ifdef BODY_DECODING_SUPPORT
+      daemon->body_decoding_limit = va_arg (ap,
+                                            size_t);
+      break;
+#else  /* ! BODY_DECODING_SUPPORT */
+      if (0 != va_arg (ap,
+                       size_t))
+      {
+#ifdef HAVE_MESSAGES
+        MHD_DLOG (daemon,
+                  _ ("MHD_OPTION_DECOMPRESS_REQUEST_BODY is used, but "
+                     "MHD is compiled without request body decoding "
+                     "support.\n"));
+#endif /* HAVE_MESSAGES */
+        return MHD_NO;
+      }
+      break;
+#endif /* ! BODY_DECODING_SUPPORT */
+    case MHD_OPTION_RESPONSE_COMPRESSION_LEVEL:
+#ifdef RESPONSE_COMPRESSION_SUPPORT
+      daemon->compression_level = va_arg (ap,
+                                          int);
+      if ((0 > daemon->compression_level) ||
+          (9 < daemon->compression_level))
+      {
+#ifdef HAVE_MESSAGES
+        MHD_DLOG (daemon,
+                  _ ("Wrong compression level %d is specified by "
+                     "MHD_OPTION_RESPONSE_COMPRESSION_LEVEL.\n"),
+                  daemon->compression_level);
+#endif /* HAVE_MESSAGES */
+        return MHD_NO;
+      }
+      break;
+#else  /* ! RESPONSE_COMPRESSION_SUPPORT */
+      if (0 != va_arg (ap,
+                       int))
+      {
+#ifdef HAVE_MESSAGES
+        MHD_DLOG (daemon,
+                  _ ("MHD_OPTION_RESPONSE_COMPRESSION_LEVEL is used, but "
+                     "MHD is compiled without response compression "
+                     "support.\n"));
+#endif /* HAVE_MESSAGES */
+        return MHD_NO;
+      }
+      break;
+#endif /* ! RESPONSE_COMPRESSION_SUPPORT */
     case MHD_OPTION_SOCK_ADDR_LEN:
       params->server_addr_len = va_arg (ap,
                                         socklen_t);
@@ -6790,6 +7902,68 @@ parse_options_va (struct MHD_Daemon *daemon,
         }
       }
       break;
+    case MHD_OPTION_WORKER_DISTRIBUTION:
+      daemon->worker_distribution =
+        (enum MHD_WorkerDistribution) va_arg (ap,
+                                              unsigned int);
+      if ( (MHD_WD_SOCKET != daemon->worker_distribution) &&
+           (MHD_WD_LEAST_CONNECTIONS != daemon->worker_distribution) &&
+           (MHD_WD_TWO_CHOICES != daemon->worker_distribution) &&
+           (MHD_WD_INCOMING_CPU != daemon->worker_distribution) )
+      {
+#ifdef HAVE_MESSAGES
+        MHD_DLOG (daemon,
+                  _ ("Invalid value (%u) specified for " \
+                     "MHD_OPTION_WORKER_DISTRIBUTION.\n"),
+                  (unsigned int) daemon->worker_distribution);
+#endif
+        return MHD_NO;
+      }
+      break;
+    case MHD_OPTION_THREAD_CPU_AFFINITY:
+      daemon->num_thread_cpus = va_arg (ap,
+                                        unsigned int);
+      daemon->thread_cpus = va_arg (ap,
+                                    const unsigned int *);
+      if ( (0 == daemon->num_thread_cpus) ||
+           (NULL == daemon->thread_cpus) )
+      {
+#ifdef HAVE_MESSAGES
+        MHD_DLOG (daemon,
+                  _ ("Empty list of CPUs is specified for " \
+                     "MHD_OPTION_THREAD_CPU_AFFINITY.\n"));
+#endif
+        return MHD_NO;
+      }
+#ifndef MHD_USE_THREAD_CPU_AFFINITY_
+#ifdef HAVE_MESSAGES
+      MHD_DLOG (daemon,
+                _ ("MHD_OPTION_THREAD_CPU_AFFINITY option is specified, " \
+                   "but binding of threads to CPUs is not supported " \
+                   "on this platform.\n"));
+#endif
+      return MHD_NO;
+#else  /* MHD_USE_THREAD_CPU_AFFINITY_ */
+      if (! MHD_D_IS_USING_THREADS_ (daemon))
+      {
+#ifdef HAVE_MESSAGES
+        MHD_DLOG (daemon,
+                  _ ("MHD_OPTION_THREAD_CPU_AFFINITY option is specified but "
+                     "MHD_USE_INTERNAL_POLLING_THREAD flag is not specified.\n"));
+#endif
+        return MHD_NO;
+      }
+      if (MHD_D_IS_USING_THREAD_PER_CONN_ (daemon))
+      {
+#ifdef HAVE_MESSAGES
+        MHD_DLOG (daemon,
+                  _ ("Both MHD_OPTION_THREAD_CPU_AFFINITY option and "
+                     "MHD_USE_THREAD_PER_CONNECTION flag are specified.\n"));
+#endif
+        return MHD_NO;
+      }
+      break;
+#endif /* MHD_USE_THREAD_CPU_AFFINITY_ */
 #endif
 #ifdef HTTPS_SUPPORT
     case MHD_OPTION_HTTPS_MEM_KEY:
@@ -7137,6 +8311,8 @@ parse_options_va (struct MHD_Daemon *daemon,
         case MHD_OPTION_CONNECTION_MEMORY_LIMIT:
         case MHD_OPTION_CONNECTION_MEMORY_INCREMENT:
         case MHD_OPTION_THREAD_STACK_SIZE:
+        case MHD_OPTION_DECOMPRESS_REQUEST_BODY:
+        case MHD_OPTION_RESPONSE_CACHE_SIZE:
           if (MHD_NO == parse_options (daemon,
                                        params,
                                        opt,
@@ -7149,7 +8325,18 @@ parse_options_va (struct MHD_Daemon *daemon,
         case MHD_OPTION_CONNECTION_LIMIT:
         case MHD_OPTION_CONNECTION_TIMEOUT:
         case MHD_OPTION_PER_IP_CONNECTION_LIMIT:
+        case MHD_OPTION_PER_IP_RATE_LIMIT:
+        case MHD_OPTION_PER_IP_RATE_BURST:
+        case MHD_OPTION_PER_IP_RATE_PREFIX_IPV4:
+        case MHD_OPTION_PER_IP_RATE_PREFIX_IPV6:
+        case MHD_OPTION_ACCEPT_BATCH_SIZE:
+        case MHD_OPTION_FILE_IO_THREADS:
+        case MHD_OPTION_CONNECTION_THREADS_IDLE_MAX:
+        case MHD_OPTION_CONNECTION_THREADS_IDLE_TIMEOUT:
+        case MHD_OPTION_HANDLER_THREADS:
+        case MHD_OPTION_HANDLER_QUEUE_SIZE:
         case MHD_OPTION_THREAD_POOL_SIZE:
+        case MHD_OPTION_WORKER_DISTRIBUTION:
         case MHD_OPTION_TCP_FASTOPEN_QUEUE_SIZE:
         case MHD_OPTION_LISTENING_ADDRESS_REUSE:
         case MHD_OPTION_LISTEN_BACKLOG_SIZE:
@@ -7189,6 +8376,9 @@ parse_options_va (struct MHD_Daemon *daemon,
         case MHD_OPTION_SIGPIPE_HANDLED_BY_APP:
         case MHD_OPTION_TLS_NO_ALPN:
         case MHD_OPTION_APP_FD_SETSIZE:
+        case MHD_OPTION_PER_IP_RATE_DROP:
+        case MHD_OPTION_COALESCE_CHUNKED_UPLOAD:
+        case MHD_OPTION_RESPONSE_COMPRESSION_LEVEL:
           if (MHD_NO == parse_options (daemon,
                                        params,
                                        opt,
@@ -7250,6 +8440,16 @@ parse_options_va (struct MHD_Daemon *daemon,
                                        MHD_OPTION_END))
             return MHD_NO;
           break;
+        /* options taking unsigned int-number followed by pointer */
+        case MHD_OPTION_THREAD_CPU_AFFINITY:
+          if (MHD_NO == parse_options (daemon,
+                                       params,
+                                       opt,
+                                       (unsigned int) oa[i].value,
+                                       oa[i].ptr_value,
+                                       MHD_OPTION_END))
+            return MHD_NO;
+          break;
         /* options taking socklen_t-number followed by pointer */
         case MHD_OPTION_SOCK_ADDR_LEN:
           if (MHD_NO == parse_options (daemon,
@@ -7440,6 +8640,15 @@ setup_epoll_to_listen (struct MHD_Daemon *daemon)
       return MHD_NO;
   }
 #endif /* HTTPS_SUPPORT && UPGRADE_SUPPORT */
+#ifdef MHD_UPGRADE_TUNNEL_SUPPORT
+  if ( (0 != (MHD_ALLOW_UPGRADE & daemon->options)) &&
+       (0 == (MHD_USE_TLS & daemon->options)) )
+  {
+    daemon->epoll_tunnel_fd = setup_epoll_fd (daemon);
+    if (-1 == daemon->epoll_tunnel_fd)
+      return MHD_NO;
+  }
+#endif /* MHD_UPGRADE_TUNNEL_SUPPORT */
   if ( (MHD_INVALID_SOCKET != (ls = daemon->listen_fd)) &&
        (! daemon->was_quiesced) )
   {
@@ -7788,6 +8997,9 @@ MHD_start_daemon_va (unsigned int flags,
 #if defined(HTTPS_SUPPORT) && defined(UPGRADE_SUPPORT)
   daemon->epoll_upgrade_fd = -1;
 #endif /* HTTPS_SUPPORT && UPGRADE_SUPPORT */
+#ifdef MHD_UPGRADE_TUNNEL_SUPPORT
+  daemon->epoll_tunnel_fd = -1;
+#endif /* MHD_UPGRADE_TUNNEL_SUPPORT */
 #endif
   /* try to open listen socket */
 #ifdef HTTPS_SUPPORT
@@ -7811,6 +9023,10 @@ MHD_start_daemon_va (unsigned int flags,
   daemon->pool_increment = MHD_BUF_INC_SIZE;
   daemon->unescape_callback = &unescape_wrapper;
   daemon->connection_timeout_ms = 0;       /* no timeout */
+  daemon->per_ip_rate_prefix4 = 32;
+  daemon->per_ip_rate_prefix6 = 128;
+  daemon->accept_batch_size = 10;
+  daemon->conn_threads_idle_timeout = 10;
   MHD_itc_set_invalid_ (daemon->itc);
 #ifdef MHD_USE_THREADS
   MHD_thread_handle_ID_set_invalid_ (&daemon->tid);
@@ -7918,6 +9134,59 @@ MHD_start_daemon_va (unsigned int flags,
           || (NULL != daemon->notify_connection)) )
     *pflags |= MHD_USE_ITC; /* requires ITC */
 
+  if (0 != daemon->file_io_threads)
+  {
+    if ( (! MHD_D_IS_USING_THREADS_ (daemon)) ||
+         MHD_D_IS_USING_THREAD_PER_CONN_ (daemon) )
+    {
+#ifdef HAVE_MESSAGES
+      MHD_DLOG (daemon,
+                _ ("Warning: MHD_OPTION_FILE_IO_THREADS is ignored, it "
+                   "is used only with MHD_USE_INTERNAL_POLLING_THREAD "
+                   "without MHD_USE_THREAD_PER_CONNECTION.\n"));
+#endif /* HAVE_MESSAGES */
+      daemon->file_io_threads = 0;
+    }
+    else
+      *pflags |= MHD_ALLOW_SUSPEND_RESUME; /* The connections are suspended
+                                              while the file is read */
+  }
+
+  if (0 != daemon->conn_threads_idle_max)
+  {
+    if (! MHD_D_IS_USING_THREAD_PER_CONN_ (daemon))
+    {
+#ifdef HAVE_MESSAGES
+      MHD_DLOG (daemon,
+                _ ("Warning: MHD_OPTION_CONNECTION_THREADS_IDLE_MAX is "
+                   "ignored, it is used only with "
+                   "MHD_USE_THREAD_PER_CONNECTION.\n"));
+#endif /* HAVE_MESSAGES */
+      daemon->conn_threads_idle_max = 0;
+    }
+    else
+      *pflags |= MHD_USE_ITC; /* The released connections are signalled
+                                 by the reused threads */
+  }
+
+  if (0 != daemon->handler_threads)
+  {
+    if ( (! MHD_D_IS_USING_THREADS_ (daemon)) ||
+         MHD_D_IS_USING_THREAD_PER_CONN_ (daemon) )
+    {
+#ifdef HAVE_MESSAGES
+      MHD_DLOG (daemon,
+                _ ("Warning: MHD_OPTION_HANDLER_THREADS is ignored, it "
+                   "is used only with MHD_USE_INTERNAL_POLLING_THREAD "
+                   "without MHD_USE_THREAD_PER_CONNECTION.\n"));
+#endif /* HAVE_MESSAGES */
+      daemon->handler_threads = 0;
+    }
+    else
+      *pflags |= MHD_ALLOW_SUSPEND_RESUME; /* The connections are suspended
+                                              while the handler is called */
+  }
+
 #ifdef _DEBUG
 #ifdef HAVE_MESSAGES
   MHD_DLOG (daemon,
@@ -8683,8 +9952,7 @@ MHD_start_daemon_va (unsigned int flags,
   }
 #endif /* EPOLL_SUPPORT */
 
-#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
-  if (! MHD_mutex_init_ (&daemon->per_ip_connection_mutex))
+  if (! MHD_ip_count_init (daemon))
   {
 #ifdef HAVE_MESSAGES
     MHD_DLOG (daemon,
@@ -8694,7 +9962,6 @@ MHD_start_daemon_va (unsigned int flags,
       MHD_socket_close_chk_ (listen_fd);
     goto free_and_fail;
   }
-#endif
 
 #ifdef HTTPS_SUPPORT
   /* initialize HTTPS daemon certificate aspects & send / recv functions */
@@ -8707,9 +9974,7 @@ MHD_start_daemon_va (unsigned int flags,
 #endif
     if (MHD_INVALID_SOCKET != listen_fd)
       MHD_socket_close_chk_ (listen_fd);
-#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
-    MHD_mutex_destroy_chk_ (&daemon->per_ip_connection_mutex);
-#endif
+    MHD_ip_count_deinit (daemon);
     goto free_and_fail;
   }
 #endif /* HTTPS_SUPPORT */
@@ -8737,7 +10002,7 @@ MHD_start_daemon_va (unsigned int flags,
         MHD_DLOG (daemon,
                   _ ("Failed to initialise internal lists mutex.\n"));
 #endif
-        MHD_mutex_destroy_chk_ (&daemon->per_ip_connection_mutex);
+        MHD_ip_count_deinit (daemon);
         if (MHD_INVALID_SOCKET != listen_fd)
           MHD_socket_close_chk_ (listen_fd);
         goto free_and_fail;
@@ -8748,12 +10013,17 @@ MHD_start_daemon_va (unsigned int flags,
         MHD_DLOG (daemon,
                   _ ("Failed to initialise mutex.\n"));
 #endif
-        MHD_mutex_destroy_chk_ (&daemon->per_ip_connection_mutex);
+        MHD_ip_count_deinit (daemon);
         MHD_mutex_destroy_chk_ (&daemon->cleanup_connection_mutex);
         if (MHD_INVALID_SOCKET != listen_fd)
           MHD_socket_close_chk_ (listen_fd);
         goto free_and_fail;
       }
+      if (0 != daemon->num_thread_cpus)
+      {
+        daemon->bind_to_cpu = true;
+        daemon->bound_cpu = daemon->thread_cpus[0];
+      }
       if (! MHD_create_named_thread_ (&daemon->tid,
                                       MHD_D_IS_USING_THREAD_PER_CONN_ (daemon) ?
                                       "MHD-listen" : "MHD-single",
@@ -8775,7 +10045,7 @@ MHD_start_daemon_va (unsigned int flags,
                   MHD_strerror_ (errno));
 #endif /* HAVE_MESSAGES */
         MHD_mutex_destroy_chk_ (&daemon->new_connections_mutex);
-        MHD_mutex_destroy_chk_ (&daemon->per_ip_connection_mutex);
+        MHD_ip_count_deinit (daemon);
         MHD_mutex_destroy_chk_ (&daemon->cleanup_connection_mutex);
         if (MHD_INVALID_SOCKET != listen_fd)
           MHD_socket_close_chk_ (listen_fd);
@@ -8814,6 +10084,13 @@ MHD_start_daemon_va (unsigned int flags,
         d->master = daemon;
         d->worker_pool_size = 0;
         d->worker_pool = NULL;
+        if (0 != daemon->num_thread_cpus)
+        {
+          d->bind_to_cpu = true;
+          d->bound_cpu = daemon->thread_cpus[i % daemon->num_thread_cpus];
+        }
+        d->thread_cpus = NULL;
+        d->num_thread_cpus = 0;
         if (! MHD_mutex_init_ (&d->cleanup_connection_mutex))
         {
 #ifdef HAVE_MESSAGES
@@ -8888,8 +10165,8 @@ MHD_start_daemon_va (unsigned int flags,
 #endif
         /* Some members must be used only in master daemon */
 #if defined(MHD_USE_THREADS)
-        memset (&d->per_ip_connection_mutex, 0x7F,
-                sizeof(d->per_ip_connection_mutex));
+        memset (&d->per_ip_count, 0x7F,
+                sizeof(d->per_ip_count));
 #endif /* MHD_USE_THREADS */
 #ifdef DAUTH_SUPPORT
         d->nnc = NULL;
@@ -8940,7 +10217,7 @@ MHD_start_daemon_va (unsigned int flags,
       MHD_DLOG (daemon,
                 _ ("Failed to initialise internal lists mutex.\n"));
 #endif
-      MHD_mutex_destroy_chk_ (&daemon->per_ip_connection_mutex);
+      MHD_ip_count_deinit (daemon);
       if (MHD_INVALID_SOCKET != listen_fd)
         MHD_socket_close_chk_ (listen_fd);
       goto free_and_fail;
@@ -8952,7 +10229,7 @@ MHD_start_daemon_va (unsigned int flags,
                 _ ("Failed to initialise mutex.\n"));
 #endif
       MHD_mutex_destroy_chk_ (&daemon->cleanup_connection_mutex);
-      MHD_mutex_destroy_chk_ (&daemon->per_ip_connection_mutex);
+      MHD_ip_count_deinit (daemon);
       if (MHD_INVALID_SOCKET != listen_fd)
         MHD_socket_close_chk_ (listen_fd);
       goto free_and_fail;
@@ -8964,6 +10241,10 @@ MHD_start_daemon_va (unsigned int flags,
      so we additionally NULL it here to not deref a dangling pointer. */
   daemon->https_key_password = NULL;
 #endif /* HTTPS_SUPPORT */
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  /* The array of the CPUs is not used after the start of the threads */
+  daemon->thread_cpus = NULL;
+#endif /* MHD_USE_POSIX_THREADS || MHD_USE_W32_THREADS */
 
   return daemon;
 
@@ -8978,7 +10259,7 @@ thread_failed:
     if (MHD_INVALID_SOCKET != listen_fd)
       MHD_socket_close_chk_ (listen_fd);
     listen_fd = MHD_INVALID_SOCKET;
-    MHD_mutex_destroy_chk_ (&daemon->per_ip_connection_mutex);
+    MHD_ip_count_deinit (daemon);
     if (NULL != daemon->worker_pool)
       free (daemon->worker_pool);
     goto free_and_fail;
@@ -9008,12 +10289,27 @@ free_and_fail:
     daemon->upgrade_fd_in_epoll = false;
   }
 #endif /* HTTPS_SUPPORT && UPGRADE_SUPPORT */
+#ifdef MHD_UPGRADE_TUNNEL_SUPPORT
+  if (daemon->tunnel_fd_in_epoll)
+  {
+    if (0 != epoll_ctl (daemon->epoll_fd,
+                        EPOLL_CTL_DEL,
+                        daemon->epoll_tunnel_fd,
+                        NULL))
+      MHD_PANIC (_ ("Failed to remove FD from epoll set.\n"));
+    daemon->tunnel_fd_in_epoll = false;
+  }
+#endif /* MHD_UPGRADE_TUNNEL_SUPPORT */
   if (-1 != daemon->epoll_fd)
     close (daemon->epoll_fd);
 #if defined(HTTPS_SUPPORT) && defined(UPGRADE_SUPPORT)
   if (-1 != daemon->epoll_upgrade_fd)
     close (daemon->epoll_upgrade_fd);
 #endif /* HTTPS_SUPPORT && UPGRADE_SUPPORT */
+#ifdef MHD_UPGRADE_TUNNEL_SUPPORT
+  if (-1 != daemon->epoll_tunnel_fd)
+    close (daemon->epoll_tunnel_fd);
+#endif /* MHD_UPGRADE_TUNNEL_SUPPORT */
 #endif /* EPOLL_SUPPORT */
 #ifdef DAUTH_SUPPORT
   free (daemon->digest_auth_random_copy);
@@ -9151,10 +10447,12 @@ close_all_connections (struct MHD_Daemon *daemon)
          * may still processing "upgrade" (exiting). */
         if (! used_thr_p_c)
           MHD_connection_finish_forward_ (susp);
+#ifdef MHD_UPGRADE_TUNNEL_SUPPORT
+        MHD_upgrade_tunnel_close_ (susp->urh);
+#endif /* MHD_UPGRADE_TUNNEL_SUPPORT */
         /* Do not use MHD_resume_connection() as mutex is
          * already locked. */
-        susp->resuming = true;
-        daemon->resuming = true;
+        mark_connection_resuming (susp);
       }
       susp = susp->prev;
     }
@@ -9177,7 +10475,8 @@ close_all_connections (struct MHD_Daemon *daemon)
       /* Any connection found here is "upgraded" connection, normal suspended
        * connections are already removed from this list. */
       mhd_assert (NULL != pos->urh);
-      if (! pos->thread_joined)
+      if ( (! pos->thread_joined) &&
+           (! pos->thread_reused) )
       {
         /* While "cleanup" list is not manipulated by "upgraded"
          * connection, "cleanup" mutex is required for call of
@@ -9197,6 +10496,14 @@ close_all_connections (struct MHD_Daemon *daemon)
   {
     shutdown (pos->socket_fd,
               SHUT_RDWR);
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+    /* Wake up the thread waiting for the data of the content reader */
+    if (MHD_D_IS_USING_THREAD_PER_CONN_ (daemon) &&
+        (MHD_ITC_IS_VALID_ (pos->crc_itc)) &&
+        (! MHD_itc_activate_ (pos->crc_itc, "e")) )
+      MHD_PANIC (_ ("Failed to signal shutdown via inter-thread " \
+                    "communication channel.\n"));
+#endif
 #ifdef MHD_WINSOCK_SOCKETS
     if (MHD_D_IS_USING_THREAD_PER_CONN_ (daemon) &&
         (MHD_ITC_IS_VALID_ (daemon->itc)) &&
@@ -9207,6 +10514,16 @@ close_all_connections (struct MHD_Daemon *daemon)
   }
 
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+#ifdef MHD_CONN_THREADS_SUPPORT
+  if (NULL != daemon->conn_threads)
+  {
+    /* The reused threads release the connections when they are stopped,
+       the "cleanup" mutex is required for the release. */
+    MHD_mutex_unlock_chk_ (&daemon->cleanup_connection_mutex);
+    MHD_conn_threads_stop_ (daemon);
+    MHD_mutex_lock_chk_ (&daemon->cleanup_connection_mutex);
+  }
+#endif /* MHD_CONN_THREADS_SUPPORT */
   /* now, collect per-connection threads */
   if (used_thr_p_c)
   {
@@ -9255,6 +10572,9 @@ close_all_connections (struct MHD_Daemon *daemon)
     close_connection (pos);
   }
   MHD_cleanup_connections (daemon);
+#ifdef RESPONSE_COMPRESSION_SUPPORT
+  MHD_resp_compress_pool_free_ (daemon);
+#endif /* RESPONSE_COMPRESSION_SUPPORT */
 }
 
 
@@ -9288,6 +10608,13 @@ MHD_stop_daemon (struct MHD_Daemon *daemon)
   mhd_assert ( (NULL == daemon->master) || (daemon->shutdown) );
 
   daemon->shutdown = true;
+  if (NULL == daemon->master)
+  {
+    MHD_file_io_stop_ (daemon); /* Resume the connections waiting for
+                                   the I/O threads */
+    MHD_handler_threads_stop_ (daemon); /* Resume the connections waiting
+                                           for the handler threads */
+  }
   if (daemon->was_quiesced)
     fd = MHD_INVALID_SOCKET; /* Do not use FD if daemon was quiesced */
   else
@@ -9331,6 +10658,9 @@ MHD_stop_daemon (struct MHD_Daemon *daemon)
 #if defined(HTTPS_SUPPORT) && defined(UPGRADE_SUPPORT)
     mhd_assert (-1 == daemon->epoll_upgrade_fd);
 #endif /* HTTPS_SUPPORT && UPGRADE_SUPPORT */
+#ifdef MHD_UPGRADE_TUNNEL_SUPPORT
+    mhd_assert (-1 == daemon->epoll_tunnel_fd);
+#endif /* MHD_UPGRADE_TUNNEL_SUPPORT */
 #endif /* EPOLL_SUPPORT */
   }
   else
@@ -9394,6 +10724,11 @@ MHD_stop_daemon (struct MHD_Daemon *daemon)
         (-1 != daemon->epoll_upgrade_fd) )
       MHD_socket_close_chk_ (daemon->epoll_upgrade_fd);
 #endif /* HTTPS_SUPPORT && UPGRADE_SUPPORT */
+#ifdef MHD_UPGRADE_TUNNEL_SUPPORT
+    if (MHD_D_IS_USING_EPOLL_ (daemon) &&
+        (-1 != daemon->epoll_tunnel_fd) )
+      MHD_socket_close_chk_ (daemon->epoll_tunnel_fd);
+#endif /* MHD_UPGRADE_TUNNEL_SUPPORT */
 #endif /* EPOLL_SUPPORT */
 
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
@@ -9433,9 +10768,7 @@ MHD_stop_daemon (struct MHD_Daemon *daemon)
     MHD_mutex_destroy_chk_ (&daemon->nnc_lock);
 #endif
 #endif
-#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
-    MHD_mutex_destroy_chk_ (&daemon->per_ip_connection_mutex);
-#endif
+    MHD_ip_count_deinit (daemon);
     free (daemon);
   }
 }
@@ -9509,6 +10842,35 @@ MHD_get_daemon_info (struct MHD_Daemon *daemon,
   case MHD_DAEMON_INFO_BIND_PORT:
     daemon->daemon_info_dummy_port.port = daemon->port;
     return &daemon->daemon_info_dummy_port;
+  case MHD_DAEMON_INFO_RESPONSE_CACHE_HITS:
+  case MHD_DAEMON_INFO_RESPONSE_CACHE_MISSES:
+    MHD_response_cache_get_stats_ (daemon,
+                                   &daemon->daemon_info_dummy_cache_hits.
+                                   num_requests,
+                                   &daemon->daemon_info_dummy_cache_misses.
+                                   num_requests);
+    if (MHD_DAEMON_INFO_RESPONSE_CACHE_HITS == info_type)
+      return &daemon->daemon_info_dummy_cache_hits;
+    return &daemon->daemon_info_dummy_cache_misses;
+  case MHD_DAEMON_INFO_WORKER_CONNECTIONS:
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+    if (NULL != daemon->worker_pool)
+    {
+      va_list ap;
+      unsigned int idx;
+
+      va_start (ap, info_type);
+      idx = va_arg (ap, unsigned int);
+      va_end (ap);
+      if (idx >= daemon->worker_pool_size)
+        return NULL;
+      /* FIXME: next line is thread-safe only if read is atomic. */
+      daemon->daemon_info_dummy_worker_connections.num_connections
+        = daemon->worker_pool[idx].connections;
+      return &daemon->daemon_info_dummy_worker_connections;
+    }
+#endif
+    return NULL;
   default:
     return NULL;
   }
@@ -9784,6 +11146,48 @@ MHD_is_feature_supported (enum MHD_FEATURE feature)
 #else  /* ! HAS_FD_SETSIZE_OVERRIDABLE */
     return MHD_NO;
 #endif /* ! HAS_FD_SETSIZE_OVERRIDABLE */
+  case MHD_FEATURE_UPGRADE_TUNNEL:
+#ifdef MHD_UPGRADE_TUNNEL_SUPPORT
+    return MHD_YES;
+#else  /* ! MHD_UPGRADE_TUNNEL_SUPPORT */
+    return MHD_NO;
+#endif /* ! MHD_UPGRADE_TUNNEL_SUPPORT */
+  case MHD_FEATURE_BODY_DECODING:
+#ifdef BODY_DECODING_SUPPORT
+    return MHD_YES;
+#else  /* ! BODY_DECODING_SUPPORT */
+    return MHD_NO;
+#endif /* ! BODY_DECODING_SUPPORT */
+  case MHD_FEATURE_RESPONSE_COMPRESSION:
+#ifdef RESPONSE_COMPRESSION_SUPPORT
+    return MHD_YES;
+#else  /* ! RESPONSE_COMPRESSION_SUPPORT */
+    return MHD_NO;
+#endif /* ! RESPONSE_COMPRESSION_SUPPORT */
+  case MHD_FEATURE_FILE_IO_THREADS:
+#ifdef MHD_FILE_IO_SUPPORT
+    return MHD_YES;
+#else  /* ! MHD_FILE_IO_SUPPORT */
+    return MHD_NO;
+#endif /* ! MHD_FILE_IO_SUPPORT */
+  case MHD_FEATURE_THREAD_CPU_AFFINITY:
+#ifdef MHD_USE_THREAD_CPU_AFFINITY_
+    return MHD_YES;
+#else  /* ! MHD_USE_THREAD_CPU_AFFINITY_ */
+    return MHD_NO;
+#endif /* ! MHD_USE_THREAD_CPU_AFFINITY_ */
+  case MHD_FEATURE_CONNECTION_THREADS_REUSE:
+#ifdef MHD_CONN_THREADS_SUPPORT
+    return MHD_YES;
+#else  /* ! MHD_CONN_THREADS_SUPPORT */
+    return MHD_NO;
+#endif /* ! MHD_CONN_THREADS_SUPPORT */
+  case MHD_FEATURE_HANDLER_THREADS:
+#ifdef MHD_HANDLER_THREADS_SUPPORT
+    return MHD_YES;
+#else  /* ! MHD_HANDLER_THREADS_SUPPORT */
+    return MHD_NO;
+#endif /* ! MHD_HANDLER_THREADS_SUPPORT */
 
   default:
     break;
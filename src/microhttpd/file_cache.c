@@ -0,0 +1,521 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     This library is free software; you can redistribute it and/or
+     modify it under the terms of the GNU Lesser General Public
+     License as published by the Free Software Foundation; either
+     version 2.1 of the License, or (at your option) any later version.
+
+     This library is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     Lesser General Public License for more details.
+
+     You should have received a copy of the GNU Lesser General Public
+     License along with this library; if not, write to the Free Software
+     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+/**
+ * @file microhttpd/file_cache.c
+ * @brief  The cache of the file-based responses
+ *
+ * The entries are found by the hash of the file name and kept in
+ * the list ordered by the last use.  The files are opened and checked
+ * without holding the lock of the cache.  The file is checked again
+ * after the configured time, the entry is replaced if the file has been
+ * changed (other modification time, size or inode).
+ */
+
+#include "internal.h"
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif /* HAVE_SYS_STAT_H */
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif /* HAVE_FCNTL_H */
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+#if defined(_WIN32)
+#include <io.h> /* for open(), close() */
+#endif /* _WIN32 */
+#include "response.h"
+#include "mhd_mono_clock.h"
+#ifdef MHD_USE_THREADS
+#include "mhd_locks.h"
+#endif /* MHD_USE_THREADS */
+#include "mhd_compat.h"
+#include "mhd_assert.h"
+
+#ifndef S_ISREG
+#define S_ISREG(x) (S_IFREG == ((x) & S_IFMT))
+#endif /* S_ISREG */
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif /* ! O_BINARY */
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif /* ! O_CLOEXEC */
+
+/**
+ * The maximum number of the hash buckets
+ */
+#define MHD_FILE_CACHE_MAX_BUCKETS (64 * 1024)
+
+
+/**
+ * The identity of the file
+ */
+struct MHD_FileId_
+{
+  /**
+   * The device of the file
+   */
+  uint64_t dev;
+
+  /**
+   * The inode of the file
+   */
+  uint64_t ino;
+
+  /**
+   * The modification time of the file
+   */
+  int64_t mtime;
+
+  /**
+   * The size of the file
+   */
+  uint64_t size;
+};
+
+
+/**
+ * The entry of the file cache
+ */
+struct MHD_FileCacheEntry_
+{
+  /**
+   * The previous entry in the list ordered by the last use
+   */
+  struct MHD_FileCacheEntry_ *prev;
+
+  /**
+   * The next entry in the list ordered by the last use
+   */
+  struct MHD_FileCacheEntry_ *next;
+
+  /**
+   * The next entry in the same hash bucket
+   */
+  struct MHD_FileCacheEntry_ *next_in_bucket;
+
+  /**
+   * The name of the file, zero-terminated
+   */
+  char *filename;
+
+  /**
+   * The length of the @a filename
+   */
+  size_t filename_len;
+
+  /**
+   * The hash of the @a filename
+   */
+  uint32_t hash;
+
+  /**
+   * The identity of the cached file
+   */
+  struct MHD_FileId_ id;
+
+  /**
+   * The response with the content of the file, one reference is held by
+   * the cache
+   */
+  struct MHD_Response *response;
+
+  /**
+   * The time (in milliseconds) when the file has been checked last time
+   */
+  uint64_t checked;
+};
+
+
+/**
+ * The cache of the file-based responses
+ */
+struct MHD_FileCache
+{
+#ifdef MHD_USE_THREADS
+  /**
+   * The lock for all members
+   */
+  MHD_mutex_ lock;
+#endif /* MHD_USE_THREADS */
+
+  /**
+   * The most recently used entry
+   */
+  struct MHD_FileCacheEntry_ *head;
+
+  /**
+   * The least recently used entry
+   */
+  struct MHD_FileCacheEntry_ *tail;
+
+  /**
+   * The hash buckets
+   */
+  struct MHD_FileCacheEntry_ **buckets;
+
+  /**
+   * The number of the @a buckets, the power of two
+   */
+  size_t num_buckets;
+
+  /**
+   * The number of the entries
+   */
+  unsigned int num_entries;
+
+  /**
+   * The maximum number of the entries
+   */
+  unsigned int max_entries;
+
+  /**
+   * The total size of the cached files
+   */
+  uint64_t total_size;
+
+  /**
+   * The maximum total size of the cached files
+   */
+  uint64_t max_size;
+
+  /**
+   * The time (in milliseconds) after which the cached file is checked
+   */
+  uint64_t ttl_ms;
+
+  /**
+   * The flags for the new responses
+   */
+  enum MHD_ResponseFlags flags;
+};
+
+
+/**
+ * Calculate the hash of the file name (FNV-1a).
+ *
+ * @param filename the name of the file
+ * @param len the length of the @a filename
+ * @return the hash value
+ */
+static uint32_t
+filename_hash (const char *filename,
+               size_t len)
+{
+  uint32_t h;
+  size_t i;
+
+  h = 2166136261U;
+  for (i = 0; i < len; ++i)
+  {
+    h ^= (uint8_t) filename[i];
+    h *= 16777619U;
+  }
+  return h;
+}
+
+
+/**
+ * Find the entry for the file.
+ *
+ * The cache must be locked.
+ *
+ * @param cache the cache to use
+ * @param filename the name of the file
+ * @param len the length of the @a filename
+ * @param hash the hash of the @a filename
+ * @return the found entry, NULL if not found
+ */
+static struct MHD_FileCacheEntry_ *
+find_entry (struct MHD_FileCache *cache,
+            const char *filename,
+            size_t len,
+            uint32_t hash)
+{
+  struct MHD_FileCacheEntry_ *e;
+
+  for (e = cache->buckets[hash & (cache->num_buckets - 1)];
+       NULL != e;
+       e = e->next_in_bucket)
+  {
+    if ( (hash == e->hash) &&
+         (len == e->filename_len) &&
+         (0 == memcmp (filename, e->filename, len)) )
+      return e;
+  }
+  return NULL;
+}
+
+
+/**
+ * Remove the entry from the cache and destroy it.
+ *
+ * The cache must be locked.
+ *
+ * @param cache the cache to use
+ * @param e the entry to remove
+ */
+static void
+remove_entry (struct MHD_FileCache *cache,
+              struct MHD_FileCacheEntry_ *e)
+{
+  struct MHD_FileCacheEntry_ **pos;
+
+  for (pos = &cache->buckets[e->hash & (cache->num_buckets - 1)];
+       e != *pos;
+       pos = &(*pos)->next_in_bucket)
+    mhd_assert (NULL != *pos);
+  *pos = e->next_in_bucket;
+  DLL_remove (cache->head, cache->tail, e);
+  mhd_assert (0 != cache->num_entries);
+  mhd_assert (cache->total_size >= e->id.size);
+  cache->num_entries--;
+  cache->total_size -= e->id.size;
+  MHD_destroy_response (e->response);
+  free (e->filename);
+  free (e);
+}
+
+
+/**
+ * Use the entry: move it to the head of the list and get the response.
+ *
+ * The cache must be locked.
+ *
+ * @param cache the cache to use
+ * @param e the entry to use
+ * @return the response with the reference counted for the caller
+ */
+static struct MHD_Response *
+use_entry (struct MHD_FileCache *cache,
+           struct MHD_FileCacheEntry_ *e)
+{
+  if (cache->head != e)
+  {
+    DLL_remove (cache->head, cache->tail, e);
+    DLL_insert (cache->head, cache->tail, e);
+  }
+  MHD_increment_response_rc (e->response);
+  return e->response;
+}
+
+
+_MHD_EXTERN struct MHD_FileCache *
+MHD_file_cache_create (unsigned int max_entries,
+                       uint64_t max_size,
+                       unsigned int ttl,
+                       enum MHD_ResponseFlags flags)
+{
+  struct MHD_FileCache *cache;
+  size_t num_buckets;
+
+  if (0 == max_entries)
+    return NULL;
+  num_buckets = 16;
+  while ( (num_buckets < max_entries) &&
+          (num_buckets < MHD_FILE_CACHE_MAX_BUCKETS) )
+    num_buckets *= 2;
+
+  cache = (struct MHD_FileCache *) MHD_calloc_ (1, sizeof (*cache));
+  if (NULL == cache)
+    return NULL;
+  cache->buckets = (struct MHD_FileCacheEntry_ **)
+                   MHD_calloc_ (num_buckets, sizeof (cache->buckets[0]));
+  if (NULL == cache->buckets)
+  {
+    free (cache);
+    return NULL;
+  }
+#ifdef MHD_USE_THREADS
+  if (! MHD_mutex_init_ (&cache->lock))
+  {
+    free (cache->buckets);
+    free (cache);
+    return NULL;
+  }
+#endif /* MHD_USE_THREADS */
+  cache->num_buckets = num_buckets;
+  cache->max_entries = max_entries;
+  cache->max_size = max_size;
+  cache->ttl_ms = ((uint64_t) ttl) * 1000;
+  cache->flags = flags;
+  return cache;
+}
+
+
+_MHD_EXTERN struct MHD_Response *
+MHD_file_cache_get_response (struct MHD_FileCache *cache,
+                             const char *filename)
+{
+  const uint64_t now = MHD_monotonic_msec_counter ();
+  size_t len;
+  uint32_t hash;
+  struct MHD_FileCacheEntry_ *e;
+  struct MHD_Response *response;
+  struct MHD_FileId_ id;
+  struct stat st;
+  int fd;
+
+  if ( (NULL == cache) ||
+       (NULL == filename) )
+    return NULL;
+  len = strlen (filename);
+  hash = filename_hash (filename, len);
+
+#ifdef MHD_USE_THREADS
+  MHD_mutex_lock_chk_ (&cache->lock);
+#endif /* MHD_USE_THREADS */
+  e = find_entry (cache, filename, len, hash);
+  if ( (NULL != e) &&
+       (now - e->checked < cache->ttl_ms) )
+  {
+    response = use_entry (cache, e);
+#ifdef MHD_USE_THREADS
+    MHD_mutex_unlock_chk_ (&cache->lock);
+#endif /* MHD_USE_THREADS */
+    return response;
+  }
+#ifdef MHD_USE_THREADS
+  MHD_mutex_unlock_chk_ (&cache->lock);
+#endif /* MHD_USE_THREADS */
+
+  /* Not cached or the cached entry must be checked.
+     Open and check the file without holding the lock. */
+  fd = open (filename, O_RDONLY | O_BINARY | O_CLOEXEC);
+  if (-1 == fd)
+    return NULL;
+  if ( (0 != fstat (fd, &st)) ||
+       (! S_ISREG (st.st_mode)) ||
+       (0 > st.st_size) )
+  {
+    (void) close (fd);
+    return NULL;
+  }
+  id.dev = (uint64_t) st.st_dev;
+  id.ino = (uint64_t) st.st_ino;
+  id.mtime = (int64_t) st.st_mtime;
+  id.size = (uint64_t) st.st_size;
+
+#ifdef MHD_USE_THREADS
+  MHD_mutex_lock_chk_ (&cache->lock);
+#endif /* MHD_USE_THREADS */
+  e = find_entry (cache, filename, len, hash);
+  if ( (NULL != e) &&
+       (e->id.dev == id.dev) &&
+       (e->id.ino == id.ino) &&
+       (e->id.mtime == id.mtime) &&
+       (e->id.size == id.size) )
+  { /* The file has not been changed */
+    e->checked = now;
+    response = use_entry (cache, e);
+#ifdef MHD_USE_THREADS
+    MHD_mutex_unlock_chk_ (&cache->lock);
+#endif /* MHD_USE_THREADS */
+    (void) close (fd);
+    return response;
+  }
+  if (NULL != e)
+    remove_entry (cache, e); /* The file has been changed */
+#ifdef MHD_USE_THREADS
+  MHD_mutex_unlock_chk_ (&cache->lock);
+#endif /* MHD_USE_THREADS */
+
+  response = MHD_create_response_from_fd64 (id.size, fd);
+  if (NULL == response)
+  {
+    (void) close (fd);
+    return NULL;
+  }
+  if (MHD_YES != MHD_set_response_options (response,
+                                           cache->flags,
+                                           MHD_RO_VALIDATORS_FROM_FD,
+                                           MHD_RO_END))
+  {
+    MHD_destroy_response (response);
+    return NULL;
+  }
+  if (id.size > cache->max_size)
+    return response; /* Too large to be cached */
+
+  e = (struct MHD_FileCacheEntry_ *) MHD_calloc_ (1, sizeof (*e));
+  if (NULL == e)
+    return response; /* Not cached */
+  e->filename = (char *) malloc (len + 1);
+  if (NULL == e->filename)
+  {
+    free (e);
+    return response; /* Not cached */
+  }
+  memcpy (e->filename, filename, len + 1);
+  e->filename_len = len;
+  e->hash = hash;
+  e->id = id;
+  e->response = response;
+  e->checked = now;
+  MHD_increment_response_rc (response); /* The reference for the cache */
+
+#ifdef MHD_USE_THREADS
+  MHD_mutex_lock_chk_ (&cache->lock);
+#endif /* MHD_USE_THREADS */
+  if (1)
+  {
+    struct MHD_FileCacheEntry_ *const old =
+      find_entry (cache, filename, len, hash);
+
+    if (NULL != old)
+      remove_entry (cache, old); /* Added by another thread */
+  }
+  while ( (NULL != cache->tail) &&
+          ((cache->num_entries >= cache->max_entries) ||
+           (cache->max_size - cache->total_size < id.size)) )
+    remove_entry (cache, cache->tail);
+  e->next_in_bucket = cache->buckets[hash & (cache->num_buckets - 1)];
+  cache->buckets[hash & (cache->num_buckets - 1)] = e;
+  DLL_insert (cache->head, cache->tail, e);
+  cache->num_entries++;
+  cache->total_size += id.size;
+#ifdef MHD_USE_THREADS
+  MHD_mutex_unlock_chk_ (&cache->lock);
+#endif /* MHD_USE_THREADS */
+
+  return response;
+}
+
+
+_MHD_EXTERN void
+MHD_file_cache_destroy (struct MHD_FileCache *cache)
+{
+  if (NULL == cache)
+    return;
+  while (NULL != cache->head)
+    remove_entry (cache, cache->head);
+#ifdef MHD_USE_THREADS
+  MHD_mutex_destroy_chk_ (&cache->lock);
+#endif /* MHD_USE_THREADS */
+  free (cache->buckets);
+  free (cache);
+}
+
+
+/* end of file_cache.c */
@@ -0,0 +1,491 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     This library is free software; you can redistribute it and/or
+     modify it under the terms of the GNU Lesser General Public
+     License as published by the Free Software Foundation; either
+     version 2.1 of the License, or (at your option) any later version.
+
+     This library is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     Lesser General Public License for more details.
+
+     You should have received a copy of the GNU Lesser General Public
+     License along with this library; if not, write to the Free Software
+     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+/**
+ * @file microhttpd/file_io.c
+ * @brief  The threads reading the files of the responses to the page cache
+ *
+ * Before the polling thread reads or sends the next window of the file,
+ * the first and the last bytes of the window are probed by non-blocking
+ * read.  If the data is not in the page cache, the connection is
+ * suspended and queued to the I/O threads.  The I/O
+ * thread reads the window (the data is discarded, only the page cache is
+ * filled), advises the kernel to prefetch the following window and
+ * resumes the connection.  The polling thread then reads or sends the
+ * window without blocking on the disk.
+ *
+ * Without the non-blocking read (preadv2() with RWF_NOWAIT) the page cache
+ * cannot be probed, and the I/O threads are not started: every window
+ * would cost the suspend and the resume of the connection.  The files are
+ * read in the polling thread in this case.
+ */
+
+#include "file_io.h"
+
+#ifdef MHD_FILE_IO_SUPPORT
+
+#include "mhd_itc.h"
+#include "mhd_compat.h"
+#include "mhd_assert.h"
+#include "mhd_locks.h"
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif /* HAVE_SYS_UIO_H */
+#include <fcntl.h>
+
+
+/**
+ * The size of the part of the file checked and read at once
+ */
+#define MHD_FILE_IO_WINDOW (256 * 1024)
+
+/**
+ * The size of the buffer of the I/O thread
+ */
+#define MHD_FILE_IO_BUF_SIZE (64 * 1024)
+
+#if defined(HAVE_PREADV2) && defined(RWF_NOWAIT)
+/**
+ * Defined if the data of the file can be checked for presence in the page
+ * cache
+ */
+#define MHD_FILE_IO_CAN_PROBE_ 1
+#endif /* HAVE_PREADV2 && RWF_NOWAIT */
+
+
+/**
+ * The I/O thread
+ */
+struct MHD_FileIOThread
+{
+  /**
+   * The pool of the thread
+   */
+  struct MHD_FileIOPool *pool;
+
+  /**
+   * The handle of the thread
+   */
+  MHD_thread_handle_ID_ tid;
+
+  /**
+   * The buffer for the data read from the files, the data is not used
+   */
+  char buf[MHD_FILE_IO_BUF_SIZE];
+};
+
+
+/**
+ * The pool of the I/O threads
+ */
+struct MHD_FileIOPool
+{
+  /**
+   * The first connection in the queue
+   */
+  struct MHD_Connection *head;
+
+  /**
+   * The last connection in the queue
+   */
+  struct MHD_Connection *tail;
+
+  /**
+   * The threads
+   */
+  struct MHD_FileIOThread *threads;
+
+  /**
+   * The number of the started threads
+   */
+  unsigned int num_threads;
+
+  /**
+   * Set to true when the threads must exit
+   */
+  bool shutdown;
+
+  /**
+   * The channel to wake up the threads
+   */
+  struct MHD_itc_ itc;
+
+  /**
+   * The lock for the queue and @e shutdown
+   */
+  MHD_mutex_ lock;
+};
+
+
+/**
+ * Check whether the data of the file is in the page cache.
+ *
+ * @param fd the FD of the file
+ * @param offset the offset of the data in the file
+ * @param size the size of the data, must be non-zero
+ * @return true if the first and the last bytes of the data are in
+ *         the page cache, false otherwise or if cannot be checked
+ */
+static bool
+is_resident (int fd,
+             uint64_t offset,
+             size_t size)
+{
+#ifdef MHD_FILE_IO_CAN_PROBE_
+  char b;
+  struct iovec iov;
+
+  mhd_assert (0 != size);
+  if ( (offset + size > (uint64_t) INT64_MAX) ||
+       ( (sizeof(off_t) < sizeof (uint64_t)) &&
+         (offset + size > (uint64_t) INT32_MAX) ) )
+    return false;
+  iov.iov_base = &b;
+  iov.iov_len = 1;
+  if (1 != preadv2 (fd, &iov, 1, (off_t) offset, RWF_NOWAIT))
+    return false;
+  if ( (1 < size) &&
+       (1 != preadv2 (fd, &iov, 1, (off_t) (offset + size - 1), RWF_NOWAIT)) )
+    return false;
+  return true;
+#else  /* ! MHD_FILE_IO_CAN_PROBE_ */
+  (void) fd; (void) offset; (void) size; /* Unused. Silent compiler warning. */
+  return false;
+#endif /* ! MHD_FILE_IO_CAN_PROBE_ */
+}
+
+
+/**
+ * Read the data of the file to the page cache.
+ *
+ * @param t the I/O thread
+ * @param fd the FD of the file
+ * @param offset the offset of the data in the file
+ * @param size the size of the data
+ */
+static void
+read_to_page_cache (struct MHD_FileIOThread *t,
+                    int fd,
+                    uint64_t offset,
+                    size_t size)
+{
+  size_t done;
+
+  if (offset + size > (uint64_t) INT64_MAX)
+    return; /* The file reader will report the error */
+#ifdef HAVE_POSIX_FADVISE
+  /* Prefetch the following window in the background */
+  if ( (sizeof(off_t) >= sizeof (uint64_t)) ||
+       (offset + size + MHD_FILE_IO_WINDOW <= (uint64_t) INT32_MAX) )
+    (void) posix_fadvise (fd,
+                          (off_t) (offset + size),
+                          (off_t) MHD_FILE_IO_WINDOW,
+                          POSIX_FADV_WILLNEED);
+#endif /* HAVE_POSIX_FADVISE */
+  done = 0;
+  while (done < size)
+  {
+    const size_t chunk = MHD_MIN (size - done, sizeof(t->buf));
+    ssize_t res;
+
+#if defined(HAVE_PREAD64)
+    res = pread64 (fd, t->buf, chunk, (off64_t) (offset + done));
+#else  /* ! HAVE_PREAD64 */
+    if ( (sizeof(off_t) < sizeof (uint64_t)) &&
+         (offset + size > (uint64_t) INT32_MAX) )
+      return;
+    res = pread (fd, t->buf, chunk, (off_t) (offset + done));
+#endif /* ! HAVE_PREAD64 */
+    if (0 > res)
+    {
+      if (EINTR == errno)
+        continue;
+      return; /* The file reader will report the error */
+    }
+    if (0 == res)
+      return; /* The file is truncated */
+    done += (size_t) res;
+  }
+}
+
+
+/**
+ * The main function of the I/O thread.
+ *
+ * @param cls the I/O thread
+ * @return always zero
+ */
+static MHD_THRD_RTRN_TYPE_ MHD_THRD_CALL_SPEC_
+file_io_thread (void *cls)
+{
+  struct MHD_FileIOThread *const t = (struct MHD_FileIOThread *) cls;
+  struct MHD_FileIOPool *const pool = t->pool;
+
+  while (1)
+  {
+    struct MHD_Connection *c;
+    bool more;
+    bool shutdown;
+    struct pollfd p;
+
+    MHD_mutex_lock_chk_ (&pool->lock);
+    shutdown = pool->shutdown;
+    c = shutdown ? NULL : pool->head;
+    if (NULL != c)
+    {
+      pool->head = c->next_file_io;
+      if (NULL == pool->head)
+        pool->tail = NULL;
+    }
+    more = (NULL != pool->head);
+    MHD_mutex_unlock_chk_ (&pool->lock);
+
+    if (shutdown)
+    {
+      /* The pending connections are resumed by MHD_file_io_stop_().
+         Wake up the next thread. */
+      (void) MHD_itc_activate_ (pool->itc, "s");
+      break;
+    }
+    if (NULL != c)
+    {
+      struct MHD_Response *const response = c->rp.response;
+
+      if (more)
+        (void) MHD_itc_activate_ (pool->itc, "q"); /* Let the other threads
+                                                      take the next one */
+      read_to_page_cache (t,
+                          response->fd,
+                          response->fd_off + c->rp.rsp_write_position,
+                          c->rp.file_io_size);
+      c->rp.file_ready_pos = c->rp.rsp_write_position + c->rp.file_io_size;
+      /* The connection must not be used after resuming */
+      internal_resume_connection_ (c);
+      continue;
+    }
+    p.fd = MHD_itc_r_fd_ (pool->itc);
+    p.events = POLLIN;
+    p.revents = 0;
+    if (0 < poll (&p, 1, -1))
+      MHD_itc_clear_ (pool->itc);
+  }
+  return (MHD_THRD_RTRN_TYPE_) 0;
+}
+
+
+bool
+MHD_file_io_init_ (struct MHD_Daemon *daemon)
+{
+  struct MHD_FileIOPool *pool;
+  unsigned int i;
+
+  mhd_assert (NULL == daemon->master);
+  daemon->file_io = NULL;
+#ifndef MHD_FILE_IO_CAN_PROBE_
+  if (0 != daemon->file_io_threads)
+  {
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("The page cache cannot be probed on this platform, " \
+                 "the files are read without the I/O threads.\n"));
+#endif /* HAVE_MESSAGES */
+    daemon->file_io_threads = 0;
+  }
+#endif /* ! MHD_FILE_IO_CAN_PROBE_ */
+  if (0 == daemon->file_io_threads)
+    return true;
+
+  pool = (struct MHD_FileIOPool *) MHD_calloc_ (1, sizeof(*pool));
+  if (NULL == pool)
+    return false;
+  pool->threads = (struct MHD_FileIOThread *)
+                  MHD_calloc_ (daemon->file_io_threads,
+                               sizeof(struct MHD_FileIOThread));
+  if (NULL == pool->threads)
+  {
+    free (pool);
+    return false;
+  }
+  if (! MHD_mutex_init_ (&pool->lock))
+  {
+    free (pool->threads);
+    free (pool);
+    return false;
+  }
+  if (! MHD_itc_init_ (pool->itc))
+  {
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("Failed to create inter-thread communication channel " \
+                 "for I/O threads: %s\n"),
+              MHD_itc_last_strerror_ ());
+#endif /* HAVE_MESSAGES */
+    MHD_mutex_destroy_chk_ (&pool->lock);
+    free (pool->threads);
+    free (pool);
+    return false;
+  }
+  daemon->file_io = pool;
+  for (i = 0; i < daemon->file_io_threads; i++)
+  {
+    struct MHD_FileIOThread *const t = pool->threads + i;
+
+    t->pool = pool;
+    if (! MHD_create_named_thread_ (&t->tid,
+                                    "MHD-file-io",
+                                    daemon->thread_stack_size,
+                                    &file_io_thread,
+                                    t))
+    {
+#ifdef HAVE_MESSAGES
+      MHD_DLOG (daemon,
+                _ ("Failed to create I/O thread: %s\n"),
+                MHD_strerror_ (errno));
+#endif /* HAVE_MESSAGES */
+      MHD_file_io_deinit_ (daemon);
+      return false;
+    }
+    pool->num_threads++;
+  }
+  return true;
+}
+
+
+void
+MHD_file_io_stop_ (struct MHD_Daemon *daemon)
+{
+  struct MHD_FileIOPool *const pool = daemon->file_io;
+  struct MHD_Connection *c;
+  unsigned int i;
+
+  mhd_assert (NULL == daemon->master);
+  if (NULL == pool)
+    return;
+  MHD_mutex_lock_chk_ (&pool->lock);
+  if (pool->shutdown)
+  {
+    MHD_mutex_unlock_chk_ (&pool->lock);
+    return;
+  }
+  pool->shutdown = true;
+  MHD_mutex_unlock_chk_ (&pool->lock);
+  if (! MHD_itc_activate_ (pool->itc, "e"))
+    MHD_PANIC (_ ("Failed to signal shutdown via inter-thread " \
+                  "communication channel.\n"));
+  for (i = 0; i < pool->num_threads; i++)
+  {
+    if (! MHD_thread_handle_ID_join_thread_ (pool->threads[i].tid))
+      MHD_PANIC (_ ("Failed to join a thread.\n"));
+  }
+  pool->num_threads = 0;
+
+  /* No connections are added after setting 'shutdown' */
+  while (NULL != (c = pool->head))
+  {
+    pool->head = c->next_file_io;
+    c->rp.file_ready_pos = c->rp.rsp_write_position + c->rp.file_io_size;
+    internal_resume_connection_ (c);
+  }
+  pool->tail = NULL;
+}
+
+
+void
+MHD_file_io_deinit_ (struct MHD_Daemon *daemon)
+{
+  struct MHD_FileIOPool *const pool = daemon->file_io;
+
+  mhd_assert (NULL == daemon->master);
+  if (NULL == pool)
+    return;
+  MHD_file_io_stop_ (daemon);
+  mhd_assert (NULL == pool->head);
+  MHD_itc_destroy_chk_ (pool->itc);
+  MHD_mutex_destroy_chk_ (&pool->lock);
+  free (pool->threads);
+  free (pool);
+  daemon->file_io = NULL;
+}
+
+
+bool
+MHD_file_io_is_ready_ (struct MHD_Connection *c)
+{
+  struct MHD_FileIOPool *const pool = MHD_get_master (c->daemon)->file_io;
+  struct MHD_Response *const response = c->rp.response;
+  const uint64_t pos = c->rp.rsp_write_position;
+  size_t size;
+
+  mhd_assert (-1 != response->fd);
+  mhd_assert (! response->is_pipe);
+  if (NULL == pool)
+    return true;
+  if (pos < c->rp.file_ready_pos)
+    return true;
+  if (pos >= response->total_size)
+    return true;
+  if (response->total_size - pos > MHD_FILE_IO_WINDOW)
+    size = MHD_FILE_IO_WINDOW;
+  else
+    size = (size_t) (response->total_size - pos);
+  if (is_resident (response->fd,
+                   response->fd_off + pos,
+                   size))
+  {
+    c->rp.file_ready_pos = pos + size;
+    return true;
+  }
+
+  MHD_mutex_lock_chk_ (&pool->lock);
+  if (pool->shutdown)
+  {
+    MHD_mutex_unlock_chk_ (&pool->lock);
+    return true; /* Read in the polling thread */
+  }
+  internal_suspend_connection_ (c);
+  if (! c->suspended)
+  {
+    /* The application has resumed the connection, but resuming has not
+       been processed yet */
+    MHD_mutex_unlock_chk_ (&pool->lock);
+    return true;
+  }
+  c->rp.file_io_size = size;
+  c->next_file_io = NULL;
+  if (NULL == pool->tail)
+    pool->head = c;
+  else
+    pool->tail->next_file_io = c;
+  pool->tail = c;
+  MHD_mutex_unlock_chk_ (&pool->lock);
+  if (! MHD_itc_activate_ (pool->itc, "f"))
+  {
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (c->daemon,
+              _ ("Failed to signal I/O thread via inter-thread " \
+                 "communication channel.\n"));
+#endif /* HAVE_MESSAGES */
+  }
+  return false;
+}
+
+#endif /* MHD_FILE_IO_SUPPORT */
+
+/* end of file_io.c */
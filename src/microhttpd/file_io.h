@@ -0,0 +1,94 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     This library is free software; you can redistribute it and/or
+     modify it under the terms of the GNU Lesser General Public
+     License as published by the Free Software Foundation; either
+     version 2.1 of the License, or (at your option) any later version.
+
+     This library is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     Lesser General Public License for more details.
+
+     You should have received a copy of the GNU Lesser General Public
+     License along with this library; if not, write to the Free Software
+     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+/**
+ * @file microhttpd/file_io.h
+ * @brief  The threads reading the files of the responses to the page cache
+ */
+
+#ifndef MHD_FILE_IO_H
+#define MHD_FILE_IO_H 1
+
+#include "internal.h"
+
+#ifdef MHD_FILE_IO_SUPPORT
+
+/**
+ * Start the I/O threads, if they are enabled for the @a daemon.
+ *
+ * @param daemon the master daemon
+ * @return true on success (or if the I/O threads are not used),
+ *         false if failed to allocate the memory or to start the threads
+ */
+bool
+MHD_file_io_init_ (struct MHD_Daemon *daemon);
+
+
+/**
+ * Stop the I/O threads and resume the connections waiting for them.
+ * The connections are resumed without reading the data, the I/O
+ * threads are not used after this call.
+ * Can be called several times.
+ *
+ * @param daemon the master daemon
+ */
+void
+MHD_file_io_stop_ (struct MHD_Daemon *daemon);
+
+
+/**
+ * Stop the I/O threads (if not stopped yet) and free the resources.
+ * Must be called when the polling threads are not running.
+ *
+ * @param daemon the master daemon
+ */
+void
+MHD_file_io_deinit_ (struct MHD_Daemon *daemon);
+
+
+/**
+ * Check whether the next part of the file of the response can be read
+ * without blocking.
+ * If the data is not in the page cache, the connection is suspended and
+ * the data is read by the I/O thread, the connection is resumed when
+ * the data is ready.
+ *
+ * Must be called only for the responses created from the file (not
+ * from the pipe) before reading or sending the file data at the current
+ * write position.
+ *
+ * @param c the connection to use
+ * @return true if the data can be used now,
+ *         false if the connection has been suspended
+ */
+bool
+MHD_file_io_is_ready_ (struct MHD_Connection *c);
+
+#else  /* ! MHD_FILE_IO_SUPPORT */
+
+#define MHD_file_io_init_(d) (((void) (d)), ! 0)
+
+#define MHD_file_io_stop_(d) ((void) (d))
+
+#define MHD_file_io_deinit_(d) ((void) (d))
+
+#endif /* ! MHD_FILE_IO_SUPPORT */
+
+#endif /* ! MHD_FILE_IO_H */
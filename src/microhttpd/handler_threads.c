@@ -0,0 +1,494 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     This library is free software; you can redistribute it and/or
+     modify it under the terms of the GNU Lesser General Public
+     License as published by the Free Software Foundation; either
+     version 2.1 of the License, or (at your option) any later version.
+
+     This library is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     Lesser General Public License for more details.
+
+     You should have received a copy of the GNU Lesser General Public
+     License along with this library; if not, write to the Free Software
+     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+/**
+ * @file microhttpd/handler_threads.c
+ * @brief  The threads calling the access handler callback
+ *
+ * When the polling thread has to call the access handler callback
+ * without the request body data (the first call for the request and
+ * the final call after the request body), the connection is suspended
+ * and queued to the handler threads instead.  The connections are
+ * passed to the handler threads when the polling thread has finished
+ * processing of all connections in the current turn, so the handler
+ * never runs while the polling thread still uses the connection.
+ * The handler thread calls the callback, records the result and
+ * resumes the connection.  The polling thread then continues
+ * processing of the connection with the result of the call, so
+ * the polling thread is never blocked by the application.
+ * The size of the queue is limited.  When the queue is full, the
+ * callback is called by the polling thread, which stops the processing
+ * of the other connections (and accepting of the new connections) of
+ * this thread until the handler returns.
+ */
+
+#include "handler_threads.h"
+
+#ifdef MHD_HANDLER_THREADS_SUPPORT
+
+#include "mhd_itc.h"
+#include "mhd_compat.h"
+#include "mhd_assert.h"
+#include "mhd_locks.h"
+#include "mhd_limits.h"
+
+
+/**
+ * The default maximum number of the queued calls per handler thread
+ */
+#define MHD_HANDLER_QUEUE_PER_THREAD 16
+
+
+/**
+ * The pool of the handler threads
+ */
+struct MHD_HandlerPool
+{
+  /**
+   * The first connection in the queue
+   */
+  struct MHD_Connection *head;
+
+  /**
+   * The last connection in the queue
+   */
+  struct MHD_Connection *tail;
+
+  /**
+   * The number of the connections in the queue, including
+   * the connections not yet passed to the queue by the polling threads
+   */
+  unsigned int queue_len;
+
+  /**
+   * The maximum number of the connections in the queue
+   */
+  unsigned int queue_max;
+
+  /**
+   * The handles of the threads
+   */
+  MHD_thread_handle_ID_ *threads;
+
+  /**
+   * The number of the started threads
+   */
+  unsigned int num_threads;
+
+  /**
+   * Set to true when the threads must exit
+   */
+  bool shutdown;
+
+  /**
+   * The channel to wake up the threads
+   */
+  struct MHD_itc_ itc;
+
+  /**
+   * The lock for the queue and @e shutdown
+   */
+  MHD_mutex_ lock;
+};
+
+
+/**
+ * Resume the connection without calling the access handler callback,
+ * the connection is closed when resumed.
+ *
+ * @param c the connection to resume
+ */
+static void
+resume_not_called (struct MHD_Connection *c)
+{
+  /* The flags are read by the polling thread after resuming */
+  c->handler_done = true;
+  c->handler_failed = true;
+  internal_resume_connection_ (c);
+}
+
+
+/**
+ * Call the access handler callback for the connection and resume
+ * the connection.
+ *
+ * @param c the connection to use
+ */
+static void
+call_handler (struct MHD_Connection *c)
+{
+  struct MHD_Daemon *const daemon = c->daemon;
+  size_t processed;
+  enum MHD_Result ret;
+  bool keep_suspended;
+
+  MHD_mutex_lock_chk_ (&daemon->cleanup_connection_mutex);
+  c->handler_running = true;
+  MHD_mutex_unlock_chk_ (&daemon->cleanup_connection_mutex);
+
+  processed = 0;
+  /* Like when called by MHD_connection_handle_idle(), the connection
+     must be processed by the polling thread only */
+  c->in_idle = true;
+  c->in_access_handler = true;
+  ret = daemon->default_handler (daemon->default_handler_cls,
+                                 c,
+                                 c->rq.url,
+                                 c->rq.method,
+                                 c->rq.version,
+                                 NULL,
+                                 &processed,
+                                 &c->rq.client_context);
+  c->in_access_handler = false;
+  c->in_idle = false;
+
+  MHD_mutex_lock_chk_ (&daemon->cleanup_connection_mutex);
+  c->handler_running = false;
+  /* The application may keep the connection suspended, like when the
+     handler is called by the polling thread */
+  keep_suspended = c->handler_suspend && (MHD_NO != ret);
+  c->handler_suspend = false;
+  if (! keep_suspended)
+  {
+    c->handler_done = true;
+    c->handler_failed = (MHD_NO == ret);
+  }
+  MHD_mutex_unlock_chk_ (&daemon->cleanup_connection_mutex);
+  /* The connection must not be used after resuming */
+  if (! keep_suspended)
+    internal_resume_connection_ (c);
+}
+
+
+/**
+ * The main function of the handler thread.
+ *
+ * @param cls the pool of the threads
+ * @return always zero
+ */
+static MHD_THRD_RTRN_TYPE_ MHD_THRD_CALL_SPEC_
+handler_thread (void *cls)
+{
+  struct MHD_HandlerPool *const pool = (struct MHD_HandlerPool *) cls;
+
+  while (1)
+  {
+    struct MHD_Connection *c;
+    bool more;
+    bool shutdown;
+    struct pollfd p;
+
+    MHD_mutex_lock_chk_ (&pool->lock);
+    shutdown = pool->shutdown;
+    c = shutdown ? NULL : pool->head;
+    if (NULL != c)
+    {
+      pool->head = c->next_handler;
+      if (NULL == pool->head)
+        pool->tail = NULL;
+      pool->queue_len--;
+    }
+    more = (NULL != pool->head);
+    MHD_mutex_unlock_chk_ (&pool->lock);
+
+    if (shutdown)
+    {
+      /* The pending connections are resumed by
+         MHD_handler_threads_stop_().  Wake up the next thread. */
+      (void) MHD_itc_activate_ (pool->itc, "s");
+      break;
+    }
+    if (NULL != c)
+    {
+      if (more)
+        (void) MHD_itc_activate_ (pool->itc, "q"); /* Let the other threads
+                                                      take the next one */
+      call_handler (c);
+      continue;
+    }
+    p.fd = MHD_itc_r_fd_ (pool->itc);
+    p.events = POLLIN;
+    p.revents = 0;
+    if (0 < poll (&p, 1, -1))
+      MHD_itc_clear_ (pool->itc);
+  }
+  return (MHD_THRD_RTRN_TYPE_) 0;
+}
+
+
+bool
+MHD_handler_threads_init_ (struct MHD_Daemon *daemon)
+{
+  struct MHD_HandlerPool *pool;
+  unsigned int i;
+
+  mhd_assert (NULL == daemon->master);
+  daemon->handler_pool = NULL;
+  if (0 == daemon->handler_threads)
+    return true;
+
+  pool = (struct MHD_HandlerPool *) MHD_calloc_ (1, sizeof(*pool));
+  if (NULL == pool)
+    return false;
+  pool->threads = (MHD_thread_handle_ID_ *)
+                  MHD_calloc_ (daemon->handler_threads,
+                               sizeof(MHD_thread_handle_ID_));
+  if (NULL == pool->threads)
+  {
+    free (pool);
+    return false;
+  }
+  if (0 != daemon->handler_queue_size)
+    pool->queue_max = daemon->handler_queue_size;
+  else if (UINT_MAX / MHD_HANDLER_QUEUE_PER_THREAD < daemon->handler_threads)
+    pool->queue_max = UINT_MAX;
+  else
+    pool->queue_max = daemon->handler_threads * MHD_HANDLER_QUEUE_PER_THREAD;
+  if (! MHD_mutex_init_ (&pool->lock))
+  {
+    free (pool->threads);
+    free (pool);
+    return false;
+  }
+  if (! MHD_itc_init_ (pool->itc))
+  {
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("Failed to create inter-thread communication channel " \
+                 "for handler threads: %s\n"),
+              MHD_itc_last_strerror_ ());
+#endif /* HAVE_MESSAGES */
+    MHD_mutex_destroy_chk_ (&pool->lock);
+    free (pool->threads);
+    free (pool);
+    return false;
+  }
+  daemon->handler_pool = pool;
+  for (i = 0; i < daemon->handler_threads; i++)
+  {
+    if (! MHD_create_named_thread_ (pool->threads + i,
+                                    "MHD-handler",
+                                    daemon->thread_stack_size,
+                                    &handler_thread,
+                                    pool))
+    {
+#ifdef HAVE_MESSAGES
+      MHD_DLOG (daemon,
+                _ ("Failed to create handler thread: %s\n"),
+                MHD_strerror_ (errno));
+#endif /* HAVE_MESSAGES */
+      MHD_handler_threads_deinit_ (daemon);
+      return false;
+    }
+    pool->num_threads++;
+  }
+  return true;
+}
+
+
+void
+MHD_handler_threads_stop_ (struct MHD_Daemon *daemon)
+{
+  struct MHD_HandlerPool *const pool = daemon->handler_pool;
+  struct MHD_Connection *c;
+  unsigned int i;
+
+  mhd_assert (NULL == daemon->master);
+  if (NULL == pool)
+    return;
+  MHD_mutex_lock_chk_ (&pool->lock);
+  if (pool->shutdown)
+  {
+    MHD_mutex_unlock_chk_ (&pool->lock);
+    return;
+  }
+  pool->shutdown = true;
+  MHD_mutex_unlock_chk_ (&pool->lock);
+  if (! MHD_itc_activate_ (pool->itc, "e"))
+    MHD_PANIC (_ ("Failed to signal shutdown via inter-thread " \
+                  "communication channel.\n"));
+  for (i = 0; i < pool->num_threads; i++)
+  {
+    if (! MHD_thread_handle_ID_join_thread_ (pool->threads[i]))
+      MHD_PANIC (_ ("Failed to join a thread.\n"));
+  }
+  pool->num_threads = 0;
+
+  /* No connections are added after setting 'shutdown' */
+  while (NULL != (c = pool->head))
+  {
+    pool->head = c->next_handler;
+    resume_not_called (c);
+  }
+  pool->tail = NULL;
+  pool->queue_len = 0;
+}
+
+
+void
+MHD_handler_threads_deinit_ (struct MHD_Daemon *daemon)
+{
+  struct MHD_HandlerPool *const pool = daemon->handler_pool;
+
+  mhd_assert (NULL == daemon->master);
+  if (NULL == pool)
+    return;
+  MHD_handler_threads_stop_ (daemon);
+  mhd_assert (NULL == pool->head);
+  MHD_itc_destroy_chk_ (pool->itc);
+  MHD_mutex_destroy_chk_ (&pool->lock);
+  free (pool->threads);
+  free (pool);
+  daemon->handler_pool = NULL;
+}
+
+
+bool
+MHD_handler_threads_queue_ (struct MHD_Connection *c)
+{
+  struct MHD_HandlerPool *const pool =
+    MHD_get_master (c->daemon)->handler_pool;
+
+  mhd_assert (! c->handler_done);
+  if (NULL == pool)
+    return false;
+  MHD_mutex_lock_chk_ (&pool->lock);
+  if ( (pool->shutdown) ||
+       (pool->queue_len >= pool->queue_max) )
+  {
+    /* Call in the polling thread */
+    MHD_mutex_unlock_chk_ (&pool->lock);
+    return false;
+  }
+  internal_suspend_connection_ (c);
+  if (! c->suspended)
+  {
+    /* The application has resumed the connection, but resuming has not
+       been processed yet */
+    MHD_mutex_unlock_chk_ (&pool->lock);
+    return false;
+  }
+  pool->queue_len++;
+  MHD_mutex_unlock_chk_ (&pool->lock);
+  /* Passed to the handler threads by MHD_handler_threads_dispatch_() */
+  c->next_handler = NULL;
+  if (NULL == c->daemon->handler_pending_tail)
+    c->daemon->handler_pending_head = c;
+  else
+    c->daemon->handler_pending_tail->next_handler = c;
+  c->daemon->handler_pending_tail = c;
+  return true;
+}
+
+
+void
+MHD_handler_threads_dispatch_ (struct MHD_Daemon *daemon)
+{
+  struct MHD_HandlerPool *const pool = MHD_get_master (daemon)->handler_pool;
+  struct MHD_Connection *c;
+
+  c = daemon->handler_pending_head;
+  if (NULL == c)
+    return;
+  MHD_mutex_lock_chk_ (&pool->lock);
+  if (! pool->shutdown)
+  {
+    if (NULL == pool->tail)
+      pool->head = c;
+    else
+      pool->tail->next_handler = c;
+    pool->tail = daemon->handler_pending_tail;
+    c = NULL;
+  }
+  MHD_mutex_unlock_chk_ (&pool->lock);
+  daemon->handler_pending_head = NULL;
+  daemon->handler_pending_tail = NULL;
+  if (NULL == c)
+  {
+    if (! MHD_itc_activate_ (pool->itc, "h"))
+    {
+#ifdef HAVE_MESSAGES
+      MHD_DLOG (daemon,
+                _ ("Failed to signal handler thread via inter-thread " \
+                   "communication channel.\n"));
+#endif /* HAVE_MESSAGES */
+    }
+    return;
+  }
+  /* The handler threads have been stopped */
+  while (NULL != c)
+  {
+    struct MHD_Connection *const next = c->next_handler;
+
+    resume_not_called (c);
+    c = next;
+  }
+}
+
+
+bool
+MHD_handler_threads_finish_ (struct MHD_Connection *c,
+                             bool *failed)
+{
+  /* The flags are set by the handler thread before resuming of
+     the connection */
+  if (! c->handler_done)
+    return false;
+  *failed = c->handler_failed;
+  c->handler_done = false;
+  c->handler_failed = false;
+  return true;
+}
+
+
+bool
+MHD_handler_threads_suspend_ (struct MHD_Connection *c)
+{
+  bool running;
+
+  if (NULL == MHD_get_master (c->daemon)->handler_pool)
+    return false;
+  MHD_mutex_lock_chk_ (&c->daemon->cleanup_connection_mutex);
+  running = c->handler_running;
+  if (running)
+    c->handler_suspend = true;
+  MHD_mutex_unlock_chk_ (&c->daemon->cleanup_connection_mutex);
+  return running;
+}
+
+
+bool
+MHD_handler_threads_resume_ (struct MHD_Connection *c)
+{
+  bool running;
+
+  if (NULL == MHD_get_master (c->daemon)->handler_pool)
+    return false;
+  MHD_mutex_lock_chk_ (&c->daemon->cleanup_connection_mutex);
+  running = c->handler_running;
+  if (running)
+    c->handler_suspend = false;
+  MHD_mutex_unlock_chk_ (&c->daemon->cleanup_connection_mutex);
+  return running;
+}
+
+#endif /* MHD_HANDLER_THREADS_SUPPORT */
+
+/* end of handler_threads.c */
@@ -0,0 +1,155 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     This library is free software; you can redistribute it and/or
+     modify it under the terms of the GNU Lesser General Public
+     License as published by the Free Software Foundation; either
+     version 2.1 of the License, or (at your option) any later version.
+
+     This library is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     Lesser General Public License for more details.
+
+     You should have received a copy of the GNU Lesser General Public
+     License along with this library; if not, write to the Free Software
+     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+/**
+ * @file microhttpd/handler_threads.h
+ * @brief  The threads calling the access handler callback
+ */
+
+#ifndef MHD_HANDLER_THREADS_H
+#define MHD_HANDLER_THREADS_H 1
+
+#include "internal.h"
+
+#ifdef MHD_HANDLER_THREADS_SUPPORT
+
+/**
+ * Start the handler threads, if they are enabled for the @a daemon.
+ *
+ * @param daemon the master daemon
+ * @return true on success (or if the handler threads are not used),
+ *         false if failed to allocate the memory or to start the threads
+ */
+bool
+MHD_handler_threads_init_ (struct MHD_Daemon *daemon);
+
+
+/**
+ * Stop the handler threads and resume the connections waiting for them.
+ * The handlers being called are completed, the connections still
+ * waiting in the queue are resumed without calling the handler and
+ * closed.  The handler threads are not used after this call.
+ * Can be called several times.
+ *
+ * @param daemon the master daemon
+ */
+void
+MHD_handler_threads_stop_ (struct MHD_Daemon *daemon);
+
+
+/**
+ * Stop the handler threads (if not stopped yet) and free the resources.
+ * Must be called when the polling threads are not running.
+ *
+ * @param daemon the master daemon
+ */
+void
+MHD_handler_threads_deinit_ (struct MHD_Daemon *daemon);
+
+
+/**
+ * Queue the call of the access handler callback (without the request
+ * body data) to the handler threads.
+ * The connection is suspended until the handler returns.  The result
+ * of the call is processed by #MHD_handler_threads_finish_() when the
+ * connection is resumed.
+ * The connection is passed to the handler threads by
+ * #MHD_handler_threads_dispatch_().
+ * @remark To be called only from thread that process
+ * daemon's select()/poll()/etc.
+ *
+ * @param c the connection to use
+ * @return true if the call has been queued and the connection has been
+ *         suspended,
+ *         false if the handler must be called by the current thread
+ *         (the handler threads are not used or the queue is full)
+ */
+bool
+MHD_handler_threads_queue_ (struct MHD_Connection *c);
+
+
+/**
+ * Pass the connections queued by #MHD_handler_threads_queue_() to
+ * the handler threads.
+ * @remark To be called only from thread that process
+ * daemon's select()/poll()/etc., when the connections are not
+ * processed anymore in the current turn.
+ *
+ * @param daemon the daemon to use
+ */
+void
+MHD_handler_threads_dispatch_ (struct MHD_Daemon *daemon);
+
+
+/**
+ * Check whether the access handler callback has been called by
+ * the handler thread for the current state of the connection.
+ * @remark To be called only from thread that process
+ * daemon's select()/poll()/etc.
+ *
+ * @param c the connection to use
+ * @param[out] failed set to true if the handler has returned #MHD_NO
+ * @return true if the handler has been called, the result is consumed,
+ *         false if the handler must be called
+ */
+bool
+MHD_handler_threads_finish_ (struct MHD_Connection *c,
+                             bool *failed);
+
+
+/**
+ * Process the call of #MHD_suspend_connection() made by the access
+ * handler callback called by the handler thread.
+ * The connection is already suspended, it is kept suspended when
+ * the handler returns.
+ *
+ * @param c the connection to suspend
+ * @return true if the connection is processed by the handler thread,
+ *         false otherwise
+ */
+bool
+MHD_handler_threads_suspend_ (struct MHD_Connection *c);
+
+
+/**
+ * Process the call of #MHD_resume_connection() made while the access
+ * handler callback is called by the handler thread.
+ * The connection is resumed when the handler returns.
+ *
+ * @param c the connection to resume
+ * @return true if the connection is processed by the handler thread,
+ *         false otherwise
+ */
+bool
+MHD_handler_threads_resume_ (struct MHD_Connection *c);
+
+#else  /* ! MHD_HANDLER_THREADS_SUPPORT */
+
+#define MHD_handler_threads_init_(d) (((void) (d)), ! 0)
+
+#define MHD_handler_threads_stop_(d) ((void) (d))
+
+#define MHD_handler_threads_deinit_(d) ((void) (d))
+
+#define MHD_handler_threads_dispatch_(d) ((void) (d))
+
+#endif /* ! MHD_HANDLER_THREADS_SUPPORT */
+
+#endif /* ! MHD_HANDLER_THREADS_H */
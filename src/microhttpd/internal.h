@@ -238,7 +238,13 @@ enum MHD_ConnectionEventLoopInfo
   /**
    * We are finished and are awaiting cleanup.
    */
-  MHD_EVENT_LOOP_INFO_CLEANUP = 1 << 3
+  MHD_EVENT_LOOP_INFO_CLEANUP = 1 << 3,
+
+  /**
+   * We are waiting for the application to signal that the data is ready
+   * by #MHD_content_reader_ready().
+   */
+  MHD_EVENT_LOOP_INFO_WAIT = 1 << 4
 } _MHD_FIXED_ENUM;
 
 
@@ -466,6 +472,66 @@ struct MHD_iovec_track_
   size_t sent;
 };
 
+#ifdef RESPONSE_COMPRESSION_SUPPORT
+/**
+ * The content coding used for the reply body
+ */
+enum MHD_RespEncoding_
+{
+  MHD_RESP_ENC_IDENTITY = 0, /**< The reply body is sent as is */
+  MHD_RESP_ENC_GZIP = 1,     /**< The reply body is compressed with "gzip" */
+  MHD_RESP_ENC_DEFLATE = 2   /**< The reply body is compressed with "deflate" */
+};
+
+/**
+ * The size of the table of pooled compressors, indexed by
+ * #MHD_RespEncoding_ values
+ */
+#define MHD_RESP_ENC_TABLE_SIZE 3
+
+/**
+ * The compressor of the reply body, defined in response_compress.c
+ */
+struct MHD_RespCompressor;
+#endif /* RESPONSE_COMPRESSION_SUPPORT */
+
+/**
+ * The variant of the response body with some content coding
+ */
+struct MHD_ResponseVariant
+{
+  /**
+   * The next variant in the list
+   */
+  struct MHD_ResponseVariant *next;
+
+  /**
+   * The name of the content coding, zero-terminated
+   */
+  char *encoding;
+
+  /**
+   * The length of the @a encoding
+   */
+  size_t encoding_len;
+
+  /**
+   * The encoded body
+   */
+  const char *data;
+
+  /**
+   * The size of the @a data
+   */
+  size_t size;
+
+  /**
+   * The response with this variant of the body, created on the first use.
+   * Protected by the @e mutex of the base response.
+   */
+  struct MHD_Response *resp;
+};
+
 /**
  * Representation of a response.
  */
@@ -591,6 +657,76 @@ struct MHD_Response
    * Number of elements in data_iov.
    */
   unsigned int data_iovcnt;
+
+  /**
+   * The list of the variants of the body with content codings added
+   * by the application
+   */
+  struct MHD_ResponseVariant *first_variant;
+
+  /**
+   * The response this response has been derived from (the encoded variant
+   * or the range of the body), NULL for the responses created by
+   * the application.
+   * The reference to the base response is released when this response
+   * is destroyed.
+   */
+  struct MHD_Response *base;
+
+  /**
+   * Set to true if this response is the encoded variant kept by
+   * the @e base response.  Such response has no own reference counter,
+   * the reference counter of the @e base response is used instead.
+   */
+  bool is_cached_variant;
+
+  /**
+   * The modification time of the body (seconds since the epoch),
+   * valid only if @a has_last_modified is set
+   */
+  uint64_t last_modified;
+
+  /**
+   * Set to true if @a last_modified is set
+   */
+  bool has_last_modified;
+
+  /**
+   * Set to true if the conditional requests are answered automatically
+   * (the validators have been set by MHD_set_response_options())
+   */
+  bool auto_cond;
+
+  /**
+   * The time (in seconds) the response is kept in the response cache of
+   * the daemon, zero if the response is not cached
+   */
+  unsigned int cache_ttl;
+
+#ifdef RESPONSE_COMPRESSION_SUPPORT
+  /**
+   * The body compressed by MHD, indexed by #MHD_RespEncoding_ values.
+   * Protected by the @e mutex.
+   */
+  char *compressed[MHD_RESP_ENC_TABLE_SIZE];
+
+  /**
+   * The sizes of the @a compressed data
+   */
+  size_t compressed_size[MHD_RESP_ENC_TABLE_SIZE];
+
+  /**
+   * Set to true if the body has been tried to compress with the coding.
+   * Protected by the @e mutex.
+   */
+  bool compress_tried[MHD_RESP_ENC_TABLE_SIZE];
+
+  /**
+   * The responses with the @a compressed bodies, created on the first use.
+   * Protected by the @e mutex.
+   */
+  struct MHD_Response *compressed_resp[MHD_RESP_ENC_TABLE_SIZE];
+#endif /* RESPONSE_COMPRESSION_SUPPORT */
 };
 
 
@@ -1061,6 +1197,23 @@ union MHD_StartOrSize
   size_t size;
 };
 
+
+#if defined(HAVE_SPLICE) && ! defined(MHD_WINSOCK_SOCKETS)
+/**
+ * The request body could be moved by the kernel from the socket
+ * to the application-provided FD.
+ */
+#define MHD_UPLOAD_SPLICE_SUPPORT 1
+#endif /* HAVE_SPLICE && ! MHD_WINSOCK_SOCKETS */
+
+#ifdef BODY_DECODING_SUPPORT
+/**
+ * The decoder of the compressed request body, defined in body_decoder.c
+ */
+struct MHD_BodyDecoder;
+#endif /* BODY_DECODING_SUPPORT */
+
+
 /**
  * Request-specific values.
  *
@@ -1166,6 +1319,19 @@ struct MHD_Request
    */
   uint64_t current_chunk_offset;
 
+  /**
+   * The size of the de-chunked payload data at the start of the read
+   * buffer, which has not been processed by the application yet.
+   * Used only with #MHD_OPTION_COALESCE_CHUNKED_UPLOAD.
+   */
+  size_t dechunked_size;
+
+  /**
+   * Set to true when the termination chunk has been received, but
+   * some de-chunked data has not been processed by the application yet.
+   */
+  bool dechunked_final;
+
   /**
    * Indicate that some of the upload payload data (from the currently
    * processed chunk for chunked uploads) have been processed by the
@@ -1198,6 +1364,72 @@ struct MHD_Request
    */
   bool client_aware;
 
+  /**
+   * Set to true if the request body is written to the @a upload_fd
+   * instead of giving it to the access handler callback.
+   */
+  bool upload_to_fd;
+
+  /**
+   * Set to true if the response cache has been checked for the request
+   */
+  bool resp_cache_checked;
+
+  /**
+   * Set to true if the request is answered by the response from
+   * the response cache
+   */
+  bool resp_cache_reply;
+
+  /**
+   * The application-provided FD to write the request body to.
+   * Valid only if @a upload_to_fd is set.  Not closed by MHD.
+   */
+  int upload_fd;
+
+#ifdef MHD_UPLOAD_SPLICE_SUPPORT
+  /**
+   * Set to true if the request body could be moved to the @a upload_fd
+   * by splice()
+   */
+  bool upload_splice;
+
+  /**
+   * Set to true if @a upload_pipe_r and @a upload_pipe_w are valid
+   */
+  bool upload_pipe_open;
+
+  /**
+   * The read end of the pipe used for splice()
+   */
+  int upload_pipe_r;
+
+  /**
+   * The write end of the pipe used for splice()
+   */
+  int upload_pipe_w;
+
+  /**
+   * The size of the pipe used for splice()
+   */
+  size_t upload_pipe_size;
+#endif /* MHD_UPLOAD_SPLICE_SUPPORT */
+
+  /**
+   * Set to true if the read buffer is provided by the application
+   * (by #MHD_CONNECTION_OPTION_UPLOAD_BUFFER) and is not allocated
+   * in the connection's memory pool.
+   */
+  bool upload_buf_ext;
+
+#ifdef BODY_DECODING_SUPPORT
+  /**
+   * The decoder of the compressed request body.
+   * NULL if the request body is not decoded.
+   */
+  struct MHD_BodyDecoder *decoder;
+#endif /* BODY_DECODING_SUPPORT */
+
 #ifdef BAUTH_SUPPORT
   /**
    * Basic Authorization parameters.
@@ -1253,6 +1485,9 @@ struct MHD_Reply_Properties
   bool use_reply_body_headers; /**< Use reply body-specific headers */
   bool send_reply_body; /**< Send reply body (can be zero-sized) */
   bool chunked; /**< Use chunked encoding for reply */
+#ifdef RESPONSE_COMPRESSION_SUPPORT
+  enum MHD_RespEncoding_ encoding; /**< The content coding of the reply body */
+#endif /* RESPONSE_COMPRESSION_SUPPORT */
 };
 
 #if defined(_MHD_HAVE_SENDFILE)
@@ -1263,6 +1498,32 @@ enum MHD_resp_sender_
 };
 #endif /* _MHD_HAVE_SENDFILE */
 
+#if defined(MHD_USE_THREADS) && defined(HAVE_POLL) && \
+  (defined(HAVE_PREAD64) || defined(HAVE_PREAD)) && \
+  (! defined(_WIN32) || defined(__CYGWIN__))
+/**
+ * The data of the file-based responses can be read to the page cache by
+ * the separate I/O threads.
+ */
+#define MHD_FILE_IO_SUPPORT 1
+#endif /* MHD_USE_THREADS && HAVE_POLL && (HAVE_PREAD64 || HAVE_PREAD) */
+
+#if defined(MHD_USE_THREADS) && defined(HAVE_POLL)
+/**
+ * The threads of the closed connections can be reused for the new
+ * connections in thread-per-connection mode.
+ */
+#define MHD_CONN_THREADS_SUPPORT 1
+#endif /* MHD_USE_THREADS && HAVE_POLL */
+
+#if defined(MHD_USE_THREADS) && defined(HAVE_POLL)
+/**
+ * The access handler callback can be called by the separate handler
+ * threads.
+ */
+#define MHD_HANDLER_THREADS_SUPPORT 1
+#endif /* MHD_USE_THREADS && HAVE_POLL */
+
 /**
  * Reply-specific values.
  *
@@ -1306,6 +1567,27 @@ struct MHD_Reply
   enum MHD_resp_sender_ resp_sender;
 #endif /* _MHD_HAVE_SENDFILE */
 
+#ifdef MHD_FILE_IO_SUPPORT
+  /**
+   * The position in the response content up to which the data of
+   * the file is known to be in the page cache.
+   */
+  uint64_t file_ready_pos;
+
+  /**
+   * The size of the data requested to be read to the page cache by
+   * the I/O thread, starting at @e rsp_write_position.
+   */
+  size_t file_io_size;
+#endif /* MHD_FILE_IO_SUPPORT */
+
+  /**
+   * Set to 'true' when the content reader has returned
+   * #MHD_CONTENT_READER_PENDING, reset when the connection has been
+   * signalled by #MHD_content_reader_ready().
+   */
+  bool crc_waiting;
+
   /**
    * Reply-specific properties
    */
@@ -1354,6 +1636,18 @@ struct MHD_Connection
    */
   struct MHD_Connection *prevX;
 
+  /**
+   * Next pointer for the RDLL listing the resuming connections.
+   * Protected by the daemon's @e cleanup_connection_mutex.
+   */
+  struct MHD_Connection *nextR;
+
+  /**
+   * Previous pointer for the RDLL listing the resuming connections.
+   * Protected by the daemon's @e cleanup_connection_mutex.
+   */
+  struct MHD_Connection *prevR;
+
   /**
    * Reference to the MHD_Daemon struct.
    */
@@ -1369,6 +1663,56 @@ struct MHD_Connection
    */
   struct MHD_Reply rp;
 
+#ifdef MHD_FILE_IO_SUPPORT
+  /**
+   * The next connection in the queue of the I/O threads.
+   */
+  struct MHD_Connection *next_file_io;
+#endif /* MHD_FILE_IO_SUPPORT */
+
+#ifdef MHD_HANDLER_THREADS_SUPPORT
+  /**
+   * The next connection in the queue of the handler threads.
+   */
+  struct MHD_Connection *next_handler;
+
+  /**
+   * Set to true when the access handler callback has been called by
+   * the handler thread, reset when the result is processed.
+   */
+  bool handler_done;
+
+  /**
+   * Set to true if the access handler callback called by the handler
+   * thread has returned #MHD_NO.
+   */
+  bool handler_failed;
+
+  /**
+   * Set to true while the access handler callback is called by
+   * the handler thread.
+   * Protected by the "cleanup" mutex of the daemon.
+   */
+  bool handler_running;
+
+  /**
+   * Set to true if the connection has been suspended by the application
+   * in the access handler callback called by the handler thread.
+   * Protected by the "cleanup" mutex of the daemon.
+   */
+  bool handler_suspend;
+#endif /* MHD_HANDLER_THREADS_SUPPORT */
+
+#ifdef RESPONSE_COMPRESSION_SUPPORT
+  /**
+   * The compressor used for the reply body.
+   * With #MHD_USE_THREAD_PER_CONNECTION the compressor is kept for the
+   * next replies, otherwise it is returned to the daemon's pool when
+   * the reply is finished.
+   */
+  struct MHD_RespCompressor *compressor;
+#endif /* RESPONSE_COMPRESSION_SUPPORT */
+
   /**
    * The memory pool is created whenever we first read from the TCP
    * stream and destroyed at the end of each request (and re-created
@@ -1537,8 +1881,16 @@ struct MHD_Connection
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
   /**
    * Set to `true` if the thread has been joined.
+   * If @e thread_reused is set, the thread is not joined, this is set
+   * by the thread when it does not use the connection anymore.
    */
   bool thread_joined;
+
+  /**
+   * Set to `true` if the connection is processed by the thread from
+   * the pool of the connection threads.
+   */
+  bool thread_reused;
 #endif
 
   /**
@@ -1617,9 +1969,33 @@ struct MHD_Connection
 
   /**
    * Is the connection wanting to resume?
+   * Set only when the connection is in the daemon's RDLL of the resuming
+   * connections.
    */
   volatile bool resuming;
 
+  /**
+   * Set by #MHD_content_reader_ready(), the data of the content reader
+   * is ready.
+   * Protected by the daemon's @e cleanup_connection_mutex.
+   */
+  bool crc_ready;
+
+  /**
+   * The next connection in the daemon's queue of the connections
+   * signalled by #MHD_content_reader_ready().
+   * Protected by the daemon's @e cleanup_connection_mutex.
+   */
+  struct MHD_Connection *next_crc_ready;
+
+  /**
+   * The ITC to wake up the thread of the connection waiting for
+   * #MHD_content_reader_ready(), created when the connection waits for
+   * the first time.  Used only in thread-per-connection mode.
+   * Protected by the daemon's @e cleanup_connection_mutex.
+   */
+  struct MHD_itc_ crc_itc;
+
   /**
    * Special member to be returned by #MHD_get_connection_info()
    */
@@ -1627,6 +2003,14 @@ struct MHD_Connection
 };
 
 
+#if defined(UPGRADE_SUPPORT) && defined(EPOLL_SUPPORT) && defined(HAVE_SPLICE)
+/**
+ * Plain-text "upgraded" connections can be forwarded by the kernel
+ * to the application-provided FD.
+ */
+#define MHD_UPGRADE_TUNNEL_SUPPORT 1
+#endif /* UPGRADE_SUPPORT && EPOLL_SUPPORT && HAVE_SPLICE */
+
 #ifdef UPGRADE_SUPPORT
 /**
  * Buffer we use for upgrade response handling in the unlikely
@@ -1678,6 +2062,109 @@ struct UpgradeEpollHandle
 };
 
 
+#ifdef MHD_UPGRADE_TUNNEL_SUPPORT
+/**
+ * One direction of the in-kernel forwarding of a "tunnelled" upgraded
+ * connection.  The data is spliced from the @e src socket to the pipe
+ * and from the pipe to the @e dst socket without copying to user space.
+ */
+struct MHD_UpgradeTunnelDir
+{
+  /**
+   * The handle of the socket to read the data from.
+   */
+  struct UpgradeEpollHandle *src;
+
+  /**
+   * The handle of the socket to write the data to.
+   */
+  struct UpgradeEpollHandle *dst;
+
+  /**
+   * The read end of the intermediate pipe.
+   */
+  int pipe_r;
+
+  /**
+   * The write end of the intermediate pipe.
+   */
+  int pipe_w;
+
+  /**
+   * The capacity of the pipe.
+   */
+  size_t pipe_size;
+
+  /**
+   * The number of bytes currently held in the pipe.
+   */
+  size_t in_pipe;
+
+  /**
+   * Set to true when the pipe cannot accept more data until some data
+   * is moved to @e dst.
+   */
+  bool pipe_full;
+
+  /**
+   * Set to true when no more data can be read from @e src (end of stream
+   * or error).
+   */
+  bool src_done;
+
+  /**
+   * Set to true when forwarding in this direction is finished and
+   * the @e dst was shut down for writing.
+   */
+  bool finished;
+};
+
+
+/**
+ * The state of the in-kernel forwarding between the client socket and
+ * the application-provided file descriptor.
+ * @see #MHD_UPGRADE_ACTION_TUNNEL
+ */
+struct MHD_UpgradeTunnel
+{
+  /**
+   * Next pointer for the EDLL listing tunnels that are epoll-ready.
+   */
+  struct MHD_UpgradeTunnel *nextE;
+
+  /**
+   * Previous pointer for the EDLL listing tunnels that are epoll-ready.
+   */
+  struct MHD_UpgradeTunnel *prevE;
+
+  /**
+   * Specifies whether the tunnel is already in EDLL list of ready tunnels.
+   */
+  bool in_eready_list;
+
+  /**
+   * The client (connection's) socket.
+   */
+  struct UpgradeEpollHandle client;
+
+  /**
+   * The application-provided target FD, owned by MHD.
+   */
+  struct UpgradeEpollHandle target;
+
+  /**
+   * Forwarding from the client to the target.
+   */
+  struct MHD_UpgradeTunnelDir to_target;
+
+  /**
+   * Forwarding from the target to the client.
+   */
+  struct MHD_UpgradeTunnelDir to_client;
+};
+#endif /* MHD_UPGRADE_TUNNEL_SUPPORT */
+
+
 /**
  * Handle given to the application to manage special
  * actions relating to MHD responses that "upgrade"
@@ -1723,14 +2210,16 @@ struct MHD_UpgradeResponseHandle
   /**
    * The buffer for receiving data from TLS to
    * be passed to the application.  Contains @e in_buffer_size
-   * bytes (unless @e in_buffer_size is zero). Do not free!
+   * bytes (unless @e in_buffer_size is zero). Do not free, unless
+   * @e in_buffer_malloced is set!
    */
   char *in_buffer;
 
   /**
    * The buffer for receiving data from the application to
    * be passed to TLS.  Contains @e out_buffer_size
-   * bytes (unless @e out_buffer_size is zero). Do not free!
+   * bytes (unless @e out_buffer_size is zero). Do not free, unless
+   * @e out_buffer_malloced is set!
    */
   char *out_buffer;
 
@@ -1783,8 +2272,41 @@ struct MHD_UpgradeResponseHandle
    */
   char e_buf[RESERVE_EBUF_SIZE];
 
+  /**
+   * Total number of bytes received from the remote TLS client and
+   * forwarded to the application.
+   */
+  uint64_t in_forwarded;
+
+  /**
+   * Total number of bytes received from the application and
+   * forwarded to the remote TLS client.
+   */
+  uint64_t out_forwarded;
+
+  /**
+   * Set to 'true' if @e in_buffer was enlarged and is allocated by
+   * malloc() instead of the connection's memory pool.
+   */
+  bool in_buffer_malloced;
+
+  /**
+   * Set to 'true' if @e out_buffer was enlarged and is allocated by
+   * malloc() instead of the connection's memory pool.
+   */
+  bool out_buffer_malloced;
+
 #endif /* HTTPS_SUPPORT */
 
+#ifdef MHD_UPGRADE_TUNNEL_SUPPORT
+  /**
+   * The in-kernel forwarding state if the application requested
+   * #MHD_UPGRADE_ACTION_TUNNEL, NULL otherwise.
+   * Used only by the thread that process daemon's epoll().
+   */
+  struct MHD_UpgradeTunnel *tunnel;
+#endif /* MHD_UPGRADE_TUNNEL_SUPPORT */
+
   /**
    * Set to true after the application finished with the socket
    * by #MHD_UPGRADE_ACTION_CLOSE.
@@ -1851,6 +2373,85 @@ typedef size_t
                     char *uri);
 
 
+/**
+ * The number of shards in the table of per-IP connection counts.
+ * Must be a power of two.
+ */
+#define MHD_IP_COUNT_SHARDS 16
+
+/**
+ * Connection count for single address, defined in daemon.c
+ */
+struct MHD_IPCount;
+
+/**
+ * The number of shards in the table of request rate buckets.
+ * Must be a power of two.
+ */
+#define MHD_RATE_SHARDS 16
+
+/**
+ * A shard of the table of request rate buckets, defined in mhd_ratelimit.c
+ */
+struct MHD_RateLimitShard;
+
+/**
+ * The number of shards in the response cache.
+ * Must be a power of two.
+ */
+#define MHD_RESP_CACHE_SHARDS 16
+
+/**
+ * A shard of the response cache, defined in response_cache.c
+ */
+struct MHD_RespCacheShard;
+
+/**
+ * The pool of the I/O threads, defined in file_io.c
+ */
+struct MHD_FileIOPool;
+
+/**
+ * The pool of the connection threads, defined in conn_threads.c
+ */
+struct MHD_ConnThreadPool;
+
+/**
+ * The pool of the handler threads, defined in handler_threads.c
+ */
+struct MHD_HandlerPool;
+
+/**
+ * A shard of the table of per-IP connection counts.
+ * Each shard is an open-addressing hash table with linear probing.
+ */
+struct MHD_IPCountShard
+{
+  /**
+   * The slots of the table, unused slots have zero count.
+   * NULL if not allocated yet.
+   */
+  struct MHD_IPCount *slots;
+
+  /**
+   * The number of the @e slots, zero or a power of two.
+   */
+  size_t size;
+
+  /**
+   * The number of used @e slots.
+   */
+  size_t used;
+
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  /**
+   * Mutex for the shard.
+   */
+  MHD_mutex_ lock;
+#endif
+};
+
+
 /**
  * State kept for each MHD daemon.  All connections are kept in two
  * doubly-linked lists.  The first one reflects the state of the
@@ -1909,6 +2510,18 @@ struct MHD_Daemon
    */
   struct MHD_Connection *suspended_connections_tail;
 
+  /**
+   * Head of the RDLL of the suspended connections that are resuming.
+   * Protected by @e cleanup_connection_mutex.
+   */
+  struct MHD_Connection *resuming_head;
+
+  /**
+   * Tail of the RDLL of the suspended connections that are resuming.
+   * Protected by @e cleanup_connection_mutex.
+   */
+  struct MHD_Connection *resuming_tail;
+
   /**
    * Head of doubly-linked list of connections to clean up.
    */
@@ -1919,6 +2532,13 @@ struct MHD_Daemon
    */
   struct MHD_Connection *cleanup_tail;
 
+  /**
+   * Head of the queue of the connections signalled by
+   * #MHD_content_reader_ready().
+   * Protected by @e cleanup_connection_mutex.
+   */
+  struct MHD_Connection *crc_ready_head;
+
   /**
    * _MHD_YES if the @e listen_fd socket is a UNIX domain socket.
    */
@@ -1974,6 +2594,30 @@ struct MHD_Daemon
    */
   struct MHD_UpgradeResponseHandle *eready_urh_tail;
 #endif /* UPGRADE_SUPPORT */
+
+#ifdef MHD_UPGRADE_TUNNEL_SUPPORT
+  /**
+   * File descriptor associated with the #run_epoll_for_tunnels() loop.
+   * Available only if #MHD_ALLOW_UPGRADE is set and TLS is not used.
+   */
+  int epoll_tunnel_fd;
+
+  /**
+   * true if @e epoll_tunnel_fd is in the 'epoll' set,
+   * false if not.
+   */
+  bool tunnel_fd_in_epoll;
+
+  /**
+   * Head of EDLL of tunnels ready for processing.
+   */
+  struct MHD_UpgradeTunnel *eready_tunnel_head;
+
+  /**
+   * Tail of EDLL of tunnels ready for processing.
+   */
+  struct MHD_UpgradeTunnel *eready_tunnel_tail;
+#endif /* MHD_UPGRADE_TUNNEL_SUPPORT */
 #endif /* EPOLL_SUPPORT */
 
   /**
@@ -2118,9 +2762,15 @@ struct MHD_Daemon
 #endif
 
   /**
-   * Table storing number of connections per IP
+   * Tables storing number of connections per IP, split into shards
+   * selected by the hash of the IP address.
    */
-  void *per_ip_connection_count;
+  struct MHD_IPCountShard per_ip_count[MHD_IP_COUNT_SHARDS];
+
+  /**
+   * The random value mixed into the hash of the IP addresses
+   */
+  uint32_t per_ip_count_salt;
 
   /**
    * Number of active parallel connections.
@@ -2152,14 +2802,38 @@ struct MHD_Daemon
   unsigned int worker_pool_size;
 
   /**
-   * The select thread handle (if we have internal select)
+   * The policy of the distribution of the connections added by
+   * #MHD_add_connection() between the worker daemons.
    */
-  MHD_thread_handle_ID_ tid;
+  enum MHD_WorkerDistribution worker_distribution;
+
+  /**
+   * The numbers of the CPUs to bind the internal threads to, set by
+   * #MHD_OPTION_THREAD_CPU_AFFINITY.
+   * Valid only during #MHD_start_daemon(), NULL if not set.
+   */
+  const unsigned int *thread_cpus;
+
+  /**
+   * The number of the elements in @a thread_cpus
+   */
+  unsigned int num_thread_cpus;
+
+  /**
+   * Set to 'true' if the internal thread of this daemon is bound to
+   * @a bound_cpu
+   */
+  bool bind_to_cpu;
 
   /**
-   * Mutex for per-IP connection counts.
+   * The CPU the internal thread is bound to
    */
-  MHD_mutex_ per_ip_connection_mutex;
+  unsigned int bound_cpu;
+
+  /**
+   * The select thread handle (if we have internal select)
+   */
+  MHD_thread_handle_ID_ tid;
 
   /**
    * Mutex for (modifying) access to the "cleanup", "normal_timeout" and
@@ -2229,6 +2903,12 @@ struct MHD_Daemon
    */
   volatile bool have_new;
 
+  /**
+   * Indicate that the connections in @e crc_ready_head queue need to be
+   * processed.
+   */
+  volatile bool have_crc_ready;
+
   /**
    * 'True' if some data is already waiting to be processed.
    * If set to 'true' - zero timeout for select()/poll*()
@@ -2245,6 +2925,12 @@ struct MHD_Daemon
    */
   unsigned int connection_limit;
 
+  /**
+   * The maximum number of connections accepted per single readiness
+   * event of the listen socket.
+   */
+  unsigned int accept_batch_size;
+
   /**
    * After how many milliseconds of inactivity should
    * this connection time out?
@@ -2258,12 +2944,158 @@ struct MHD_Daemon
    */
   unsigned int per_ip_connection_limit;
 
+  /**
+   * Maximum rate of requests per IP (or per network prefix) in requests
+   * per second, or 0 for unlimited.
+   */
+  unsigned int per_ip_rate_limit;
+
+  /**
+   * Maximum number of requests per IP (or per network prefix) allowed
+   * in a burst.
+   */
+  unsigned int per_ip_rate_burst;
+
+  /**
+   * The length of IPv4 network prefix used to group clients for
+   * the request rate limiting.
+   */
+  unsigned int per_ip_rate_prefix4;
+
+  /**
+   * The length of IPv6 network prefix used to group clients for
+   * the request rate limiting.
+   */
+  unsigned int per_ip_rate_prefix6;
+
+  /**
+   * The table of the request rate buckets, NULL if request rate is not
+   * limited.  Used only in master daemon.
+   */
+  struct MHD_RateLimitShard *per_ip_rate_table;
+
+  /**
+   * If set to 'true', connections of clients exceeding the request rate
+   * are closed instead of replying with "429 Too Many Requests".
+   */
+  bool per_ip_rate_drop;
+
+  /**
+   * The maximum memory used by the response cache, zero if the cache
+   * is disabled.
+   */
+  size_t response_cache_size;
+
+  /**
+   * The shards of the response cache, NULL if the cache is disabled.
+   * Used only in master daemon.
+   */
+  struct MHD_RespCacheShard *response_cache;
+
+  /**
+   * The number of the I/O threads for reading the files.
+   */
+  unsigned int file_io_threads;
+
+#ifdef MHD_FILE_IO_SUPPORT
+  /**
+   * The pool of the I/O threads, NULL if not used.
+   * Used only in master daemon.
+   */
+  struct MHD_FileIOPool *file_io;
+#endif /* MHD_FILE_IO_SUPPORT */
+
+  /**
+   * The maximum number of the idle connection threads kept for reuse,
+   * zero if the threads are not reused.
+   */
+  unsigned int conn_threads_idle_max;
+
+  /**
+   * The time (in seconds) after which the idle connection thread exits.
+   */
+  unsigned int conn_threads_idle_timeout;
+
+#ifdef MHD_CONN_THREADS_SUPPORT
+  /**
+   * The pool of the connection threads, NULL if not used.
+   * Used only in master daemon.
+   */
+  struct MHD_ConnThreadPool *conn_threads;
+#endif /* MHD_CONN_THREADS_SUPPORT */
+
+  /**
+   * The number of the threads calling the access handler callback,
+   * zero if the callback is called by the polling threads.
+   */
+  unsigned int handler_threads;
+
+  /**
+   * The maximum number of the calls waiting for the handler threads,
+   * zero for the default.
+   */
+  unsigned int handler_queue_size;
+
+#ifdef MHD_HANDLER_THREADS_SUPPORT
+  /**
+   * The pool of the handler threads, NULL if not used.
+   * Used only in master daemon.
+   */
+  struct MHD_HandlerPool *handler_pool;
+
+  /**
+   * The first connection waiting to be passed to the handler threads.
+   */
+  struct MHD_Connection *handler_pending_head;
+
+  /**
+   * The last connection waiting to be passed to the handler threads.
+   */
+  struct MHD_Connection *handler_pending_tail;
+#endif /* MHD_HANDLER_THREADS_SUPPORT */
+
   /**
    * The strictness level for parsing of incoming data.
    * @see #MHD_OPTION_CLIENT_DISCIPLINE_LVL
    */
   int client_discipline;
 
+  /**
+   * If set to true, the chunked request body is de-chunked in the read
+   * buffer and delivered to the application by larger portions.
+   * @see #MHD_OPTION_COALESCE_CHUNKED_UPLOAD
+   */
+  bool coalesce_chunked_upload;
+
+#ifdef RESPONSE_COMPRESSION_SUPPORT
+  /**
+   * The compression level used for the reply bodies.
+   * @see #MHD_OPTION_RESPONSE_COMPRESSION_LEVEL
+   */
+  int compression_level;
+
+  /**
+   * The idle compressors, the lists are indexed by #MHD_RespEncoding_.
+   * Used only by the thread of this daemon (or worker daemon), not used
+   * with #MHD_USE_THREAD_PER_CONNECTION.
+   */
+  struct MHD_RespCompressor *compressors[MHD_RESP_ENC_TABLE_SIZE];
+
+  /**
+   * The number of the idle compressors in each list of @a compressors
+   */
+  unsigned int compressors_num[MHD_RESP_ENC_TABLE_SIZE];
+#endif /* RESPONSE_COMPRESSION_SUPPORT */
+
+#ifdef BODY_DECODING_SUPPORT
+  /**
+   * The maximum size of the decoded request body, zero if decoding of
+   * the compressed request body is disabled.
+   * @see #MHD_OPTION_DECOMPRESS_REQUEST_BODY
+   */
+  size_t body_decoding_limit;
+#endif /* BODY_DECODING_SUPPORT */
+
 #ifdef HAS_FD_SETSIZE_OVERRIDABLE
   /**
    * The value of FD_SETSIZE used by the daemon.
@@ -2481,6 +3313,21 @@ struct MHD_Daemon
    */
   union MHD_DaemonInfo daemon_info_dummy_port;
 
+  /**
+   * The value to be returned by #MHD_get_daemon_info()
+   */
+  union MHD_DaemonInfo daemon_info_dummy_cache_hits;
+
+  /**
+   * The value to be returned by #MHD_get_daemon_info()
+   */
+  union MHD_DaemonInfo daemon_info_dummy_cache_misses;
+
+  /**
+   * The value to be returned by #MHD_get_daemon_info()
+   */
+  union MHD_DaemonInfo daemon_info_dummy_worker_connections;
+
 #if defined(_DEBUG) && defined(HAVE_ACCEPT4)
   /**
    * If set to 'true', accept() function will be used instead of accept4() even
@@ -2784,6 +3631,53 @@ struct MHD_RqDAuth
     (element)->prevE = NULL; } while (0)
 
 
+/**
+ * Insert an element at the head of a RDLL. Assumes that head, tail and
+ * element are structs with prevR and nextR fields.
+ *
+ * @param head pointer to the head of the RDLL
+ * @param tail pointer to the tail of the RDLL
+ * @param element element to insert
+ */
+#define RDLL_insert(head,tail,element) do { \
+    mhd_assert (NULL == (element)->nextR); \
+    mhd_assert (NULL == (element)->prevR); \
+    (element)->nextR = (head);     \
+    (element)->prevR = NULL;       \
+    if (NULL == (tail)) {          \
+      (tail) = element;            \
+    } else {                       \
+      (head)->prevR = element;     \
+    }                              \
+    (head) = (element); } while (0)
+
+
+/**
+ * Remove an element from a RDLL. Assumes
+ * that head, tail and element are structs
+ * with prevR and nextR fields.
+ *
+ * @param head pointer to the head of the RDLL
+ * @param tail pointer to the tail of the RDLL
+ * @param element element to remove
+ */
+#define RDLL_remove(head,tail,element) do { \
+    mhd_assert ( (NULL != (element)->nextR) || ((element) == (tail)));  \
+    mhd_assert ( (NULL != (element)->prevR) || ((element) == (head)));  \
+    if (NULL == (element)->prevR) {                                     \
+      (head) = (element)->nextR;                  \
+    } else {                                      \
+      (element)->prevR->nextR = (element)->nextR; \
+    }                                             \
+    if (NULL == (element)->nextR) {               \
+      (tail) = (element)->prevR;                  \
+    } else {                                      \
+      (element)->nextR->prevR = (element)->prevR; \
+    }                                             \
+    (element)->nextR = NULL;                      \
+    (element)->prevR = NULL; } while (0)
+
+
 /**
  * Convert all occurrences of '+' to ' '.
  *
@@ -2889,6 +3783,17 @@ void
 internal_suspend_connection_ (struct MHD_Connection *connection);
 
 
+/**
+ * Internal version of #MHD_resume_connection().
+ *
+ * @remark Can be called from any thread.
+ *
+ * @param connection the connection to resume
+ */
+void
+internal_resume_connection_ (struct MHD_Connection *connection);
+
+
 /**
  * Trace up to and return master daemon. If the supplied daemon
  * is a master, then return the daemon itself.
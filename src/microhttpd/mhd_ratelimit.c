@@ -0,0 +1,483 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     This library is free software; you can redistribute it and/or
+     modify it under the terms of the GNU Lesser General Public
+     License as published by the Free Software Foundation; either
+     version 2.1 of the License, or (at your option) any later version.
+
+     This library is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     Lesser General Public License for more details.
+
+     You should have received a copy of the GNU Lesser General Public
+     License along with this library; if not, write to the Free Software
+     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+/**
+ * @file microhttpd/mhd_ratelimit.c
+ * @brief  Per-IP (per network prefix) token-bucket request rate limiting
+ *
+ * The buckets are kept in the fixed-size set-associative table split into
+ * shards, each shard is protected by its own lock.  When a set is full,
+ * the least recently used bucket is replaced, the new client gets the full
+ * bucket.  A client cycling through IPv6 addresses to get the new full
+ * buckets is limited by the aggregate bucket of its /64 network.
+ */
+
+#include "mhd_ratelimit.h"
+#include "mhd_mono_clock.h"
+#include "mhd_compat.h"
+#include "mhd_assert.h"
+#ifdef MHD_USE_THREADS
+#include "mhd_locks.h"
+#endif /* MHD_USE_THREADS */
+
+
+/**
+ * The number of buckets in each set of the table
+ */
+#define MHD_RATE_SET_WAYS 4
+
+/**
+ * The number of sets in each shard, must be a power of two
+ */
+#define MHD_RATE_SHARD_SETS 64
+
+/**
+ * The length of the IPv6 network prefix of the aggregate buckets
+ */
+#define MHD_RATE_AGGR_PREFIX6 64
+
+/**
+ * The rate and the burst of the aggregate bucket, relative to the limits
+ * of the single client
+ */
+#define MHD_RATE_AGGR_FACTOR 16
+
+/**
+ * The number of tokens units per single request.
+ * Tokens are counted in fractions to avoid losing partial refills.
+ */
+#define MHD_RATE_TOKEN_UNIT 1000
+
+
+/**
+ * The key identifying the client (or the clients' network).
+ */
+struct MHD_RateKey
+{
+  /**
+   * Address family, AF_INET or AF_INET6.  Zero for unused buckets.
+   */
+  uint32_t family;
+
+  /**
+   * The length of the network prefix in bits
+   */
+  uint32_t prefix;
+
+  /**
+   * The address with host bits cleared by the network prefix
+   */
+  uint8_t addr[16];
+};
+
+
+/**
+ * The token bucket for a single client or network.
+ */
+struct MHD_RateBucket
+{
+  /**
+   * The key of the bucket
+   */
+  struct MHD_RateKey key;
+
+  /**
+   * The time of the last update of @e tokens, in milliseconds
+   */
+  uint64_t last_ms;
+
+  /**
+   * The number of available tokens, in #MHD_RATE_TOKEN_UNIT units
+   */
+  uint64_t tokens;
+};
+
+
+/**
+ * The shard of the table of buckets
+ */
+struct MHD_RateLimitShard
+{
+  /**
+   * The buckets, #MHD_RATE_SET_WAYS in each set
+   */
+  struct MHD_RateBucket buckets[MHD_RATE_SHARD_SETS * MHD_RATE_SET_WAYS];
+
+#ifdef MHD_USE_THREADS
+  /**
+   * The lock for the shard
+   */
+  MHD_mutex_ lock;
+#endif /* MHD_USE_THREADS */
+};
+
+
+/**
+ * Allocate and initialise the table of rate limiting buckets, if rate
+ * limiting is enabled for the @a daemon.
+ *
+ * @param daemon the master daemon
+ * @return true on success (or if rate limiting is not enabled),
+ *         false if memory allocation or mutex initialisation failed
+ */
+bool
+MHD_rate_limit_init_ (struct MHD_Daemon *daemon)
+{
+  struct MHD_RateLimitShard *table;
+#ifdef MHD_USE_THREADS
+  unsigned int i;
+#endif /* MHD_USE_THREADS */
+
+  mhd_assert (NULL == daemon->master);
+  daemon->per_ip_rate_table = NULL;
+  if (0 == daemon->per_ip_rate_limit)
+    return true;
+  if (0 == daemon->per_ip_rate_burst)
+    daemon->per_ip_rate_burst = daemon->per_ip_rate_limit;
+
+  table = (struct MHD_RateLimitShard *)
+          MHD_calloc_ (MHD_RATE_SHARDS, sizeof(struct MHD_RateLimitShard));
+  if (NULL == table)
+    return false;
+#ifdef MHD_USE_THREADS
+  for (i = 0; i < MHD_RATE_SHARDS; i++)
+  {
+    if (! MHD_mutex_init_ (&table[i].lock))
+    {
+      while (0 != i--)
+        MHD_mutex_destroy_chk_ (&table[i].lock);
+      free (table);
+      return false;
+    }
+  }
+#endif /* MHD_USE_THREADS */
+  daemon->per_ip_rate_table = table;
+  return true;
+}
+
+
+/**
+ * Deinitialise and free the table of rate limiting buckets.
+ *
+ * @param daemon the master daemon
+ */
+void
+MHD_rate_limit_deinit_ (struct MHD_Daemon *daemon)
+{
+#ifdef MHD_USE_THREADS
+  unsigned int i;
+#endif /* MHD_USE_THREADS */
+
+  mhd_assert (NULL == daemon->master);
+  if (NULL == daemon->per_ip_rate_table)
+    return;
+#ifdef MHD_USE_THREADS
+  for (i = 0; i < MHD_RATE_SHARDS; i++)
+    MHD_mutex_destroy_chk_ (&daemon->per_ip_rate_table[i].lock);
+#endif /* MHD_USE_THREADS */
+  free (daemon->per_ip_rate_table);
+  daemon->per_ip_rate_table = NULL;
+}
+
+
+/**
+ * Clear host bits in the address.
+ *
+ * @param[in,out] addr the address to process
+ * @param addr_size the size of the @a addr in bytes
+ * @param prefix the length of the network prefix in bits
+ */
+static void
+rate_key_apply_prefix (uint8_t *addr,
+                       size_t addr_size,
+                       unsigned int prefix)
+{
+  size_t i;
+
+  for (i = 0; i < addr_size; i++)
+  {
+    if (prefix >= 8)
+      prefix -= 8;
+    else
+    {
+      addr[i] &= (uint8_t) (0xFFU << (8 - prefix));
+      prefix = 0;
+    }
+  }
+}
+
+
+/**
+ * Build the bucket keys from the client address.
+ *
+ * @param daemon the master daemon
+ * @param addr the address of the client
+ * @param addrlen the size of the @a addr
+ * @param[out] key the key to build
+ * @param[out] aggr_key the key of the aggregate bucket to build,
+ *                      the family is zero if no aggregate bucket is used
+ * @return true if key was built,
+ *         false if address type is not limited
+ */
+static bool
+rate_key_from_addr (const struct MHD_Daemon *daemon,
+                    const struct sockaddr_storage *addr,
+                    socklen_t addrlen,
+                    struct MHD_RateKey *key,
+                    struct MHD_RateKey *aggr_key)
+{
+  memset (key, 0, sizeof(*key));
+  memset (aggr_key, 0, sizeof(*aggr_key));
+  if ( (AF_INET == addr->ss_family) &&
+       (sizeof (struct sockaddr_in) <= (size_t) addrlen) )
+  {
+    key->family = AF_INET;
+    key->prefix = daemon->per_ip_rate_prefix4;
+    memcpy (key->addr,
+            &((const struct sockaddr_in *) addr)->sin_addr,
+            sizeof(((const struct sockaddr_in *) NULL)->sin_addr));
+    rate_key_apply_prefix (key->addr,
+                           sizeof(((const struct sockaddr_in *) NULL)->sin_addr),
+                           daemon->per_ip_rate_prefix4);
+    return true;
+  }
+#ifdef HAVE_INET6
+  if ( (AF_INET6 == addr->ss_family) &&
+       (sizeof (struct sockaddr_in6) <= (size_t) addrlen) )
+  {
+    static const uint8_t v4mapped[12] =
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF };
+    const uint8_t *const a6 =
+      (const uint8_t *) &((const struct sockaddr_in6 *) addr)->sin6_addr;
+
+    if (0 == memcmp (a6, v4mapped, sizeof(v4mapped)))
+    {
+      /* IPv4-mapped address, limit as IPv4 client */
+      key->family = AF_INET;
+      key->prefix = daemon->per_ip_rate_prefix4;
+      memcpy (key->addr, a6 + sizeof(v4mapped), 4);
+      rate_key_apply_prefix (key->addr, 4,
+                             daemon->per_ip_rate_prefix4);
+      return true;
+    }
+    key->family = AF_INET6;
+    key->prefix = daemon->per_ip_rate_prefix6;
+    memcpy (key->addr, a6, 16);
+    rate_key_apply_prefix (key->addr, 16,
+                           daemon->per_ip_rate_prefix6);
+    if (MHD_RATE_AGGR_PREFIX6 < daemon->per_ip_rate_prefix6)
+    {
+      /* Limit the clients cycling through the addresses of the network */
+      aggr_key->family = AF_INET6;
+      aggr_key->prefix = MHD_RATE_AGGR_PREFIX6;
+      memcpy (aggr_key->addr, a6, 16);
+      rate_key_apply_prefix (aggr_key->addr, 16,
+                             MHD_RATE_AGGR_PREFIX6);
+    }
+    return true;
+  }
+#endif /* HAVE_INET6 */
+  return false;
+}
+
+
+/**
+ * Calculate the hash of the key (FNV-1a variant).
+ *
+ * @param daemon the master daemon
+ * @param key the key to hash
+ * @return the hash value
+ */
+static uint32_t
+rate_key_hash (const struct MHD_Daemon *daemon,
+               const struct MHD_RateKey *key)
+{
+  const uint8_t *const data = (const uint8_t *) key;
+  size_t i;
+  uint32_t hash;
+
+  hash = 2166136261U ^ daemon->per_ip_count_salt;
+  for (i = 0; i < sizeof(*key); i++)
+  {
+    hash ^= data[i];
+    hash *= 16777619U;
+  }
+  hash ^= hash >> 15;
+  hash *= 0x2c1b3c6dU;
+  hash ^= hash >> 12;
+  return hash;
+}
+
+
+/**
+ * Refill the bucket according to the time passed since the last update.
+ *
+ * @param b the bucket to refill
+ * @param rate the rate of the requests, in requests per second
+ * @param burst the size of the bucket, in requests
+ * @param now the current time in milliseconds
+ */
+static void
+rate_bucket_refill (struct MHD_RateBucket *b,
+                    uint64_t rate,
+                    uint64_t burst,
+                    uint64_t now)
+{
+  const uint64_t max_tokens = burst * MHD_RATE_TOKEN_UNIT;
+  uint64_t elapsed;
+
+  if (now <= b->last_ms)
+    return;
+  elapsed = now - b->last_ms;
+  b->last_ms = now;
+  /* The rate is in requests per second, the time is in milliseconds,
+   * the tokens are in 1/1000 of request */
+  if (elapsed >= (max_tokens / rate) + 1)
+    b->tokens = max_tokens;
+  else
+  {
+    b->tokens += elapsed * rate;
+    if (b->tokens > max_tokens)
+      b->tokens = max_tokens;
+  }
+}
+
+
+/**
+ * Check the bucket and take one token from it.
+ *
+ * @param daemon the master daemon
+ * @param key the key of the bucket
+ * @param rate the rate of the requests, in requests per second
+ * @param burst the size of the bucket, in requests
+ * @param now the current time in milliseconds
+ * @param consume if true, one token is taken and the missing bucket is
+ *                created
+ * @return true if request is allowed,
+ *         false if the bucket has no tokens left
+ */
+static bool
+rate_bucket_take (struct MHD_Daemon *daemon,
+                  const struct MHD_RateKey *key,
+                  uint64_t rate,
+                  uint64_t burst,
+                  uint64_t now,
+                  bool consume)
+{
+  struct MHD_RateLimitShard *shard;
+  struct MHD_RateBucket *set;
+  struct MHD_RateBucket *b;
+  uint32_t hash;
+  bool allowed;
+  unsigned int i;
+
+  hash = rate_key_hash (daemon, key);
+  shard = daemon->per_ip_rate_table
+          + ((hash >> 24) & (MHD_RATE_SHARDS - 1));
+  set = shard->buckets
+        + (size_t) (hash & (MHD_RATE_SHARD_SETS - 1)) * MHD_RATE_SET_WAYS;
+
+#ifdef MHD_USE_THREADS
+  MHD_mutex_lock_chk_ (&shard->lock);
+#endif /* MHD_USE_THREADS */
+  b = NULL;
+  for (i = 0; i < MHD_RATE_SET_WAYS; i++)
+  {
+    if (0 == memcmp (&set[i].key, key, sizeof(*key)))
+    {
+      b = set + i;
+      break;
+    }
+  }
+  if (NULL == b)
+  {
+    if (! consume)
+    {
+      /* Unknown clients have the full bucket */
+#ifdef MHD_USE_THREADS
+      MHD_mutex_unlock_chk_ (&shard->lock);
+#endif /* MHD_USE_THREADS */
+      return true;
+    }
+    /* Use the free or the least recently used bucket */
+    b = set;
+    for (i = 0; i < MHD_RATE_SET_WAYS; i++)
+    {
+      if (0 == set[i].key.family)
+      {
+        b = set + i;
+        break;
+      }
+      if (set[i].last_ms < b->last_ms)
+        b = set + i;
+    }
+    /* The new client gets the full bucket, the tokens of the replaced
+       client must not be inherited by an unrelated client */
+    b->key = *key;
+    b->last_ms = now;
+    b->tokens = burst * MHD_RATE_TOKEN_UNIT;
+  }
+  else
+    rate_bucket_refill (b, rate, burst, now);
+
+  allowed = (MHD_RATE_TOKEN_UNIT <= b->tokens);
+  if (allowed && consume)
+    b->tokens -= MHD_RATE_TOKEN_UNIT;
+#ifdef MHD_USE_THREADS
+  MHD_mutex_unlock_chk_ (&shard->lock);
+#endif /* MHD_USE_THREADS */
+  return allowed;
+}
+
+
+bool
+MHD_rate_limit_check_ (struct MHD_Daemon *daemon,
+                       const struct sockaddr_storage *addr,
+                       socklen_t addrlen,
+                       bool consume)
+{
+  struct MHD_RateKey key;
+  struct MHD_RateKey aggr_key;
+  uint64_t now;
+
+  daemon = MHD_get_master (daemon);
+  if (NULL == daemon->per_ip_rate_table)
+    return true;
+  if (! rate_key_from_addr (daemon, addr, addrlen, &key, &aggr_key))
+    return true; /* Allow unhandled address types through */
+
+  now = MHD_monotonic_msec_counter ();
+  if ( (0 != aggr_key.family) &&
+       (! rate_bucket_take (daemon,
+                            &aggr_key,
+                            ((uint64_t) daemon->per_ip_rate_limit)
+                            * MHD_RATE_AGGR_FACTOR,
+                            ((uint64_t) daemon->per_ip_rate_burst)
+                            * MHD_RATE_AGGR_FACTOR,
+                            now,
+                            consume)) )
+    return false;
+  return rate_bucket_take (daemon,
+                           &key,
+                           daemon->per_ip_rate_limit,
+                           daemon->per_ip_rate_burst,
+                           now,
+                           consume);
+}
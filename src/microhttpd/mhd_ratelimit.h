@@ -0,0 +1,76 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     This library is free software; you can redistribute it and/or
+     modify it under the terms of the GNU Lesser General Public
+     License as published by the Free Software Foundation; either
+     version 2.1 of the License, or (at your option) any later version.
+
+     This library is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     Lesser General Public License for more details.
+
+     You should have received a copy of the GNU Lesser General Public
+     License along with this library; if not, write to the Free Software
+     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+/**
+ * @file microhttpd/mhd_ratelimit.h
+ * @brief  Per-IP (per network prefix) token-bucket request rate limiting
+ */
+
+#ifndef MHD_RATELIMIT_H
+#define MHD_RATELIMIT_H 1
+
+#include "internal.h"
+
+/**
+ * Allocate and initialise the table of rate limiting buckets, if rate
+ * limiting is enabled for the @a daemon.
+ *
+ * @param daemon the master daemon
+ * @return true on success (or if rate limiting is not enabled),
+ *         false if memory allocation or mutex initialisation failed
+ */
+bool
+MHD_rate_limit_init_ (struct MHD_Daemon *daemon);
+
+
+/**
+ * Deinitialise and free the table of rate limiting buckets.
+ *
+ * @param daemon the master daemon
+ */
+void
+MHD_rate_limit_deinit_ (struct MHD_Daemon *daemon);
+
+
+/**
+ * Check whether the client is allowed to make a request.
+ *
+ * If @a consume is false, the bucket is only checked, the new buckets are
+ * not created (the client without a bucket is always allowed).
+ * If @a consume is true, one token is taken from the client's bucket.
+ *
+ * IPv6 clients are also checked by the aggregate bucket of their /64
+ * network.  Clients with addresses other than IPv4 and IPv6 are not
+ * limited.
+ *
+ * @param daemon the daemon (master or worker)
+ * @param addr the address of the client
+ * @param addrlen the size of the @a addr
+ * @param consume if true, one request is counted
+ * @return true if request is allowed,
+ *         false if client exceeded the rate limit
+ */
+bool
+MHD_rate_limit_check_ (struct MHD_Daemon *daemon,
+                       const struct sockaddr_storage *addr,
+                       socklen_t addrlen,
+                       bool consume);
+
+#endif /* ! MHD_RATELIMIT_H */
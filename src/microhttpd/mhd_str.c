@@ -29,6 +29,7 @@
 #include <stdbool.h>
 #endif /* HAVE_STDBOOL_H */
 #include <string.h>
+#include <time.h>
 
 #include "mhd_assert.h"
 #include "mhd_limits.h"
@@ -1179,6 +1180,91 @@ MHD_str_remove_tokens_caseless_ (char *str,
 }
 
 
+/**
+ * Get the weight ("q" parameter) of the list element.
+ *
+ * @param params the parameters of the element, starting after the token
+ * @param params_len the length of the @a params
+ * @return the weight in thousandths (0 - 1000)
+ */
+static unsigned int
+get_token_weight (const char *params,
+                  size_t params_len)
+{
+  size_t i;
+
+  for (i = 0; i < params_len; ++i)
+  {
+    unsigned int q;
+    unsigned int mult;
+
+    if ( ('q' != params[i]) && ('Q' != params[i]) )
+      continue;
+    if ( (0 == i) ||
+         ((';' != params[i - 1]) &&
+          (' ' != params[i - 1]) && ('\t' != params[i - 1])) )
+      continue;
+    if ( (i + 2 >= params_len) || ('=' != params[i + 1]) )
+      continue;
+    i += 2;
+    if ('0' != params[i])
+      return 1000; /* "1", "1.000" or broken value */
+    q = 0;
+    if ( (i + 1 < params_len) && ('.' == params[i + 1]) )
+    {
+      mult = 100;
+      for (i += 2; (i < params_len) && (0 != mult); ++i)
+      {
+        if ( ('0' > params[i]) || ('9' < params[i]) )
+          break;
+        q += (unsigned int) (params[i] - '0') * mult;
+        mult /= 10;
+      }
+    }
+    return q;
+  }
+  return 1000;
+}
+
+
+int
+MHD_str_get_token_weight_ (const char *str,
+                           size_t str_len,
+                           const char *const token,
+                           const size_t token_len)
+{
+  size_t pos;
+
+  pos = 0;
+  while (pos < str_len)
+  {
+    size_t elm_end;
+    size_t tkn_start;
+    size_t tkn_end;
+
+    elm_end = pos;
+    while ( (elm_end < str_len) && (',' != str[elm_end]) )
+      elm_end++;
+    tkn_start = pos;
+    while ( (tkn_start < elm_end) &&
+            ((' ' == str[tkn_start]) || ('\t' == str[tkn_start])) )
+      tkn_start++;
+    tkn_end = tkn_start;
+    while ( (tkn_end < elm_end) && (';' != str[tkn_end]) &&
+            (' ' != str[tkn_end]) && ('\t' != str[tkn_end]) )
+      tkn_end++;
+    if ( (token_len == tkn_end - tkn_start) &&
+         MHD_str_equal_caseless_bin_n_ (token,
+                                        str + tkn_start,
+                                        token_len) )
+      return (int) get_token_weight (str + tkn_end,
+                                     elm_end - tkn_end);
+    pos = elm_end + 1;
+  }
+  return -1;
+}
+
+
 #ifndef MHD_FAVOR_SMALL_CODE
 /* Use individual function for each case */
 
@@ -1672,6 +1758,320 @@ MHD_uint8_to_str_pad (uint8_t val,
 }
 
 
+/**
+ * The names of the days of the week, starting from Sunday
+ */
+static const char http_date_days[7][4] = {
+  "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"
+};
+
+/**
+ * The full names of the days of the week, starting from Sunday
+ */
+static const char http_date_days_l[7][10] = {
+  "Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday",
+  "Saturday"
+};
+
+/**
+ * The names of the months
+ */
+static const char http_date_months[12][4] = {
+  "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+  "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+
+size_t
+MHD_time_to_http_date_ (uint64_t secs,
+                        char *buf,
+                        size_t buf_size)
+{
+  const uint64_t days = secs / 86400;
+  const unsigned int day_secs = (unsigned int) (secs % 86400);
+  uint64_t doe; /* The day of the 400-years era */
+  uint64_t yoe; /* The year of the era */
+  uint64_t year;
+  unsigned int doy; /* The day of the year, starting from March 1 */
+  unsigned int mp;  /* The month, starting from March */
+  unsigned int month;
+  unsigned int mday;
+
+  if (MHD_HTTP_DATE_STR_LEN > buf_size)
+    return 0;
+  /* Convert the days to the civil date, the years start from March
+     to put the leap day at the end of the year */
+  doe = (days + 719468) % 146097;
+  yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  year = yoe + ((days + 719468) / 146097) * 400;
+  doy = (unsigned int) (doe - (365 * yoe + yoe / 4 - yoe / 100));
+  mp = (5 * doy + 2) / 153;
+  mday = doy - (153 * mp + 2) / 5 + 1;
+  month = (mp < 10) ? mp + 3 : mp - 9;
+  if (2 >= month)
+    year++;
+  if (9999 < year)
+    return 0;
+
+  memcpy (buf, http_date_days[(days + 4) % 7], 3); /* 1970-01-01 is Thursday */
+  buf[3] = ',';
+  buf[4] = ' ';
+  (void) MHD_uint8_to_str_pad ((uint8_t) mday, 2, buf + 5, 2);
+  buf[7] = ' ';
+  memcpy (buf + 8, http_date_months[month - 1], 3);
+  buf[11] = ' ';
+  (void) MHD_uint8_to_str_pad ((uint8_t) (year / 100), 2, buf + 12, 2);
+  (void) MHD_uint8_to_str_pad ((uint8_t) (year % 100), 2, buf + 14, 2);
+  buf[16] = ' ';
+  (void) MHD_uint8_to_str_pad ((uint8_t) (day_secs / 3600), 2, buf + 17, 2);
+  buf[19] = ':';
+  (void) MHD_uint8_to_str_pad ((uint8_t) ((day_secs / 60) % 60), 2,
+                               buf + 20, 2);
+  buf[22] = ':';
+  (void) MHD_uint8_to_str_pad ((uint8_t) (day_secs % 60), 2, buf + 23, 2);
+  memcpy (buf + 25, " GMT", 4);
+  return MHD_HTTP_DATE_STR_LEN;
+}
+
+
+/**
+ * Convert two decimal digits to the number.
+ *
+ * @param str the string with two digits
+ * @return the number, or -1 if the string has non-digit characters
+ */
+static int
+two_digits_to_int (const char *str)
+{
+  if (! isasciidigit (str[0]) || ! isasciidigit (str[1]))
+    return -1;
+  return (str[0] - '0') * 10 + (str[1] - '0');
+}
+
+
+/**
+ * Get the month by the name.
+ *
+ * @param str the three characters of the name of the month
+ * @return the month (1 for January), or -1 if the name is not valid
+ */
+static int
+http_date_month (const char *str)
+{
+  int i;
+
+  for (i = 0; i < 12; ++i)
+  {
+    if (MHD_str_equal_caseless_bin_n_ (http_date_months[i], str, 3))
+      return i + 1;
+  }
+  return -1;
+}
+
+
+/**
+ * Check whether the string starts with the short name of the day of
+ * the week.
+ *
+ * @param str the three characters of the name of the day
+ * @return true if the name is valid, false otherwise
+ */
+static bool
+http_date_is_day_name (const char *str)
+{
+  int i;
+
+  for (i = 0; i < 7; ++i)
+  {
+    if (MHD_str_equal_caseless_bin_n_ (http_date_days[i], str, 3))
+      return true;
+  }
+  return false;
+}
+
+
+/**
+ * Convert the date and the time of the day to the time.
+ *
+ * @param str_time the time of the day in "HH:MM:SS" format
+ * @param year the year
+ * @param month the month (1 for January), -1 if not valid
+ * @param mday the day of the month, -1 if not valid
+ * @param[out] secs set to the number of seconds since the epoch
+ * @return true on success,
+ *         false if the values are not valid or the date is earlier than
+ *         the epoch
+ */
+static bool
+http_date_to_secs (const char *str_time,
+                   int year,
+                   int month,
+                   int mday,
+                   uint64_t *secs)
+{
+  int hour;
+  int min;
+  int sec;
+  uint64_t y;
+  uint64_t yoe;
+  uint64_t doy;
+
+  if ( (':' != str_time[2]) || (':' != str_time[5]) )
+    return false;
+  hour = two_digits_to_int (str_time);
+  min = two_digits_to_int (str_time + 3);
+  sec = two_digits_to_int (str_time + 6);
+  if ( (0 > month) || (1 > mday) || (31 < mday) || (0 > hour) ||
+       (23 < hour) || (0 > min) || (59 < min) || (0 > sec) || (60 < sec) )
+    return false;
+  if (1970 > year)
+    return false;
+  /* Convert the civil date to the days, the years start from March */
+  y = (uint64_t) year;
+  if (2 >= month)
+    y--;
+  yoe = y % 400;
+  doy = (uint64_t) ((153 * (month + ((2 < month) ? -3 : 9)) + 2) / 5
+                    + mday - 1);
+  *secs = ((y / 400) * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy
+           - 719468) * 86400
+          + (uint64_t) (hour * 3600 + min * 60 + sec);
+  return true;
+}
+
+
+/**
+ * Convert the date in IMF-fixdate format
+ * ("Sun, 06 Nov 1994 08:49:37 GMT") to the time.
+ *
+ * @param str the string to convert, #MHD_HTTP_DATE_STR_LEN characters
+ * @param[out] secs set to the number of seconds since the epoch
+ * @return true on success, false otherwise
+ */
+static bool
+imf_fixdate_to_time (const char *str,
+                     uint64_t *secs)
+{
+  int century;
+  int year2;
+
+  if ( (! http_date_is_day_name (str)) ||
+       (',' != str[3]) || (' ' != str[4]) || (' ' != str[7]) ||
+       (' ' != str[11]) || (' ' != str[16]) ||
+       (! MHD_str_equal_caseless_bin_n_ (" GMT", str + 25, 4)) )
+    return false;
+  century = two_digits_to_int (str + 12);
+  year2 = two_digits_to_int (str + 14);
+  if ( (0 > century) || (0 > year2) )
+    return false;
+  return http_date_to_secs (str + 17, century * 100 + year2,
+                            http_date_month (str + 8),
+                            two_digits_to_int (str + 5), secs);
+}
+
+
+/**
+ * Convert the date in the obsolete rfc850-date format
+ * ("Sunday, 06-Nov-94 08:49:37 GMT") to the time.
+ *
+ * The two-digit year that appears to be more than 50 years in the future
+ * is interpreted as the most recent year in the past with the same last
+ * two digits (RFC 9110, Section 5.6.7).
+ *
+ * @param str the string to convert
+ * @param len the length of the @a str
+ * @param[out] secs set to the number of seconds since the epoch
+ * @return true on success, false otherwise
+ */
+static bool
+rfc850_date_to_time (const char *str,
+                     size_t len,
+                     uint64_t *secs)
+{
+  /* The length of the date after the name of the day:
+     ", 06-Nov-94 08:49:37 GMT" */
+  static const size_t date_len = 24;
+  size_t name_len;
+  const char *d;
+  int year2;
+  int year;
+  int cur_year;
+  int i;
+
+  if (date_len >= len)
+    return false;
+  name_len = len - date_len;
+  for (i = 0; i < 7; ++i)
+  {
+    if ( (name_len == strlen (http_date_days_l[i])) &&
+         MHD_str_equal_caseless_bin_n_ (http_date_days_l[i], str, name_len) )
+      break;
+  }
+  if (7 == i)
+    return false;
+  d = str + name_len;
+  if ( (',' != d[0]) || (' ' != d[1]) || ('-' != d[4]) || ('-' != d[8]) ||
+       (' ' != d[11]) ||
+       (! MHD_str_equal_caseless_bin_n_ (" GMT", d + 20, 4)) )
+    return false;
+  year2 = two_digits_to_int (d + 9);
+  if (0 > year2)
+    return false;
+  cur_year = 1970 + (int) (((uint64_t) time (NULL)) / 31556952);
+  year = (cur_year / 100) * 100 + year2;
+  if (cur_year + 50 < year)
+    year -= 100;
+  return http_date_to_secs (d + 12, year, http_date_month (d + 5),
+                            two_digits_to_int (d + 2), secs);
+}
+
+
+/**
+ * Convert the date in the obsolete asctime-date format
+ * ("Sun Nov  6 08:49:37 1994") to the time.
+ *
+ * @param str the string to convert, #MHD_HTTP_ASCTIME_DATE_LEN characters
+ * @param[out] secs set to the number of seconds since the epoch
+ * @return true on success, false otherwise
+ */
+static bool
+asctime_date_to_time (const char *str,
+                      uint64_t *secs)
+{
+  int mday;
+  int century;
+  int year2;
+
+  if ( (! http_date_is_day_name (str)) ||
+       (' ' != str[3]) || (' ' != str[7]) || (' ' != str[10]) ||
+       (' ' != str[19]) )
+    return false;
+  if ( (' ' == str[8]) && isasciidigit (str[9]) )
+    mday = str[9] - '0';
+  else
+    mday = two_digits_to_int (str + 8);
+  century = two_digits_to_int (str + 20);
+  year2 = two_digits_to_int (str + 22);
+  if ( (0 > century) || (0 > year2) )
+    return false;
+  return http_date_to_secs (str + 11, century * 100 + year2,
+                            http_date_month (str + 4), mday, secs);
+}
+
+
+bool
+MHD_http_date_to_time_ (const char *str,
+                        size_t len,
+                        uint64_t *secs)
+{
+  if (MHD_HTTP_DATE_STR_LEN == len)
+    return imf_fixdate_to_time (str, secs);
+  if (MHD_HTTP_ASCTIME_DATE_LEN == len)
+    return asctime_date_to_time (str, secs);
+  return rfc850_date_to_time (str, len, secs);
+}
+
+
 size_t
 MHD_bin_to_hex (const void *bin,
                 size_t size,
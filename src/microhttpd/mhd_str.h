@@ -222,6 +222,31 @@ MHD_str_remove_tokens_caseless_ (char *str,
                                  const size_t tokens_len);
 
 
+/**
+ * Get the weight of case-insensitive @a token in the list of tokens with
+ * optional weights, like the value of "Accept-Encoding" header.
+ *
+ * Tokens are delimited by comma and could be followed by parameters
+ * (separated by semicolon), the weight is specified by the "q" parameter.
+ * The "*" element is not handled specially, it could be checked by
+ * a separate call.
+ * The quoted strings and comments are not supported by this function.
+ *
+ * @param str the string to check, does not need to be zero-terminated
+ * @param str_len the length of the @a str
+ * @param token the token to find
+ * @param token_len the length of @a token, not including optional
+ *                  terminating null-character.
+ * @return the weight in thousandths (0 - 1000),
+ *         negative value if @a token is not in the list
+ */
+int
+MHD_str_get_token_weight_ (const char *str,
+                           size_t str_len,
+                           const char *const token,
+                           const size_t token_len);
+
+
 #ifndef MHD_FAVOR_SMALL_CODE
 /* Use individual function for each case to improve speed */
 
@@ -460,6 +485,52 @@ MHD_uint8_to_str_pad (uint8_t val,
                       size_t buf_size);
 
 
+/**
+ * The length of the HTTP date string in the preferred format
+ */
+#define MHD_HTTP_DATE_STR_LEN 29
+
+/**
+ * The length of the HTTP date in the obsolete asctime-date format
+ * ("Sun Nov  6 08:49:37 1994")
+ */
+#define MHD_HTTP_ASCTIME_DATE_LEN 24
+
+/**
+ * Convert the time to the HTTP date string in the preferred format
+ * (IMF-fixdate, RFC 9110, section 5.6.7), like
+ * "Sun, 06 Nov 1994 08:49:37 GMT".
+ * @note: result is NOT zero-terminated.
+ * @param secs the number of seconds since the epoch (1970-01-01 00:00:00 UTC)
+ * @param buf the buffer to result to
+ * @param buf_size size of the @a buffer
+ * @return #MHD_HTTP_DATE_STR_LEN on success,
+ *         zero if buffer is too small or the year is larger than 9999
+ */
+size_t
+MHD_time_to_http_date_ (uint64_t secs,
+                        char *buf,
+                        size_t buf_size);
+
+
+/**
+ * Convert the HTTP date string to the time.
+ * The preferred format (IMF-fixdate) and both obsolete formats
+ * (rfc850-date and asctime-date) are supported, see RFC 9110,
+ * section 5.6.7.
+ * @param str the string to convert, does not need to be zero-terminated
+ * @param len the length of the @a str
+ * @param[out] secs set to the number of seconds since the epoch
+ * @return true on success,
+ *         false if the string is not the valid date or the date is
+ *         earlier than the epoch
+ */
+bool
+MHD_http_date_to_time_ (const char *str,
+                        size_t len,
+                        uint64_t *secs);
+
+
 /**
  * Convert @a size bytes from input binary data to lower case
  * hexadecimal digits.
@@ -37,6 +37,12 @@
 #include <pthread_np.h>
 #endif /* HAVE_PTHREAD_NP_H */
 #endif /* MHD_USE_THREAD_NAME_ */
+#if defined(MHD_USE_THREAD_CPU_AFFINITY_) && defined(MHD_USE_POSIX_THREADS)
+#ifdef HAVE_PTHREAD_NP_H
+#include <pthread_np.h>
+#endif /* HAVE_PTHREAD_NP_H */
+#include <sched.h>
+#endif /* MHD_USE_THREAD_CPU_AFFINITY_ && MHD_USE_POSIX_THREADS */
 #include <errno.h>
 #include "mhd_assert.h"
 
@@ -416,3 +422,53 @@ MHD_create_named_thread_ (MHD_thread_handle_ID_ *handle_id,
 
 
 #endif /* MHD_USE_THREAD_NAME_ */
+
+
+#ifdef MHD_USE_THREAD_CPU_AFFINITY_
+/**
+ * Bind the current thread to the single CPU.
+ *
+ * @param cpu the number of the CPU
+ * @return non-zero on success; zero otherwise (with errno set)
+ */
+int
+MHD_thread_bind_to_cpu_ (unsigned int cpu)
+{
+#if defined(MHD_USE_POSIX_THREADS)
+  cpu_set_t cpu_set;
+  int res;
+
+  if (CPU_SETSIZE <= cpu)
+  {
+    errno = EINVAL;
+    return 0;
+  }
+  CPU_ZERO (&cpu_set);
+  CPU_SET (cpu, &cpu_set);
+  res = pthread_setaffinity_np (pthread_self (),
+                                sizeof (cpu_set),
+                                &cpu_set);
+  if (0 != res)
+  {
+    errno = res;
+    return 0;
+  }
+  return ! 0;
+#elif defined(MHD_USE_W32_THREADS)
+  if ((sizeof (DWORD_PTR) * 8) <= cpu)
+  {
+    errno = EINVAL;
+    return 0;
+  }
+  if (0 == SetThreadAffinityMask (GetCurrentThread (),
+                                  ((DWORD_PTR) 1) << cpu))
+  {
+    errno = EINVAL;
+    return 0;
+  }
+  return ! 0;
+#endif
+}
+
+
+#endif /* MHD_USE_THREAD_CPU_AFFINITY_ */
@@ -90,6 +90,14 @@
 #  endif
 #endif
 
+#if defined(MHD_USE_POSIX_THREADS)
+#  ifdef HAVE_PTHREAD_SETAFFINITY_NP
+#    define MHD_USE_THREAD_CPU_AFFINITY_ 1
+#  endif /* HAVE_PTHREAD_SETAFFINITY_NP */
+#elif defined(MHD_USE_W32_THREADS)
+#  define MHD_USE_THREAD_CPU_AFFINITY_ 1
+#endif
+
 /* ** Thread handle - used to control the thread ** */
 
 #if defined(MHD_USE_POSIX_THREADS)
@@ -563,4 +571,19 @@ MHD_create_named_thread_ (MHD_thread_handle_ID_ *handle_id,
 
 #endif /* MHD_USE_THREAD_NAME_ */
 
+#ifdef MHD_USE_THREAD_CPU_AFFINITY_
+/**
+ * Bind the current thread to the single CPU.
+ *
+ * The memory first used by the bound thread is normally allocated by
+ * the OS on the NUMA node of the CPU.
+ *
+ * @param cpu the number of the CPU
+ * @return non-zero on success; zero otherwise (with errno set)
+ */
+int
+MHD_thread_bind_to_cpu_ (unsigned int cpu);
+
+#endif /* MHD_USE_THREAD_CPU_AFFINITY_ */
+
 #endif /* ! MHD_THREADS_H */
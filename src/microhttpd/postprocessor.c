@@ -39,6 +39,51 @@
 #define XBUF_SIZE 512
 
 
+/**
+ * The start of the delimiter preceding each boundary in the multipart body,
+ * the boundary string follows it.
+ */
+static const char delim_start[] = "\r\n--";
+
+
+/**
+ * Prepare the shift table for Boyer-Moore-Horspool search of the
+ * delimiter ("\r\n--" followed by the boundary).
+ * For each byte value the table gives the distance from the last occurrence
+ * of this byte in the delimiter (excluding the last delimiter position) to
+ * the end of the delimiter.  The shifts are limited to 255, smaller shifts
+ * are always safe.
+ *
+ * @param[out] skip the table to fill, 256 elements
+ * @param boundary the boundary
+ * @param blen the length of the @a boundary
+ */
+static void
+boundary_skip_init (uint8_t *skip,
+                    const char *boundary,
+                    size_t blen)
+{
+  const size_t dlen = MHD_STATICSTR_LEN_ (delim_start) + blen;
+  const size_t max_shift = (dlen < 255) ? dlen : 255;
+  size_t i;
+
+  memset (skip,
+          (int) max_shift,
+          256);
+  for (i = 0; i < dlen - 1; i++)
+  {
+    const size_t shift = dlen - 1 - i;
+    const uint8_t c = (uint8_t)
+                      ((i < MHD_STATICSTR_LEN_ (delim_start)) ?
+                       delim_start[i] :
+                       boundary[i - MHD_STATICSTR_LEN_ (delim_start)]);
+
+    if (shift < max_shift)
+      skip[c] = (uint8_t) shift;
+  }
+}
+
+
 _MHD_EXTERN struct MHD_PostProcessor *
 MHD_create_post_processor (struct MHD_Connection *connection,
                            size_t buffer_size,
@@ -112,10 +157,79 @@ MHD_create_post_processor (struct MHD_Connection *connection,
   ret->blen = blen;
   ret->boundary = boundary;
   ret->skip_rn = RN_Inactive;
+  if (0 != blen)
+    boundary_skip_init (ret->bskip,
+                        boundary,
+                        blen);
   return ret;
 }
 
 
+/**
+ * Give a (possibly partial) value to the application callback, decoding
+ * the value in place in the data provided by the application.
+ * Used when there is no data left over from the previous round in
+ * 'pp->xbuf' and the data can be modified.  The possible incomplete escape
+ * sequence at the end of the value is preserved in 'pp->xbuf' for
+ * the future.
+ *
+ * @param[in,out] pp post processor to act upon
+ * @param value where in memory is the value
+ * @param value_len the length of the @a value
+ */
+static void
+process_value_in_place (struct MHD_PostProcessor *pp,
+                        char *value,
+                        size_t value_len)
+{
+  size_t i;
+
+  mhd_assert (0 == pp->xbuf_pos);
+  if ( (0 < value_len) &&
+       ('%' == value[value_len - 1]) )
+    pp->xbuf_pos = 1;
+  else if ( (1 < value_len) &&
+            ('%' == value[value_len - 2]) )
+    pp->xbuf_pos = 2;
+  if (0 != pp->xbuf_pos)
+  {
+    value_len -= pp->xbuf_pos;
+    memcpy (pp->xbuf,
+            value + value_len,
+            pp->xbuf_pos);
+  }
+  for (i = 0; i < value_len; i++)
+  {
+    if ('+' == value[i])
+      value[i] = ' ';
+  }
+  if (0 != value_len)
+    value_len = MHD_str_pct_decode_lenient_n_ (value,
+                                               value_len,
+                                               value,
+                                               value_len,
+                                               NULL);
+  if (pp->must_ikvi || (0 != value_len) )
+  {
+    pp->must_ikvi = false;
+    if (MHD_NO == pp->ikvi (pp->cls,
+                            MHD_POSTDATA_KIND,
+                            (const char *) &pp[1],      /* key */
+                            NULL,
+                            NULL,
+                            NULL,
+                            value,
+                            pp->value_offset,
+                            value_len))
+    {
+      pp->state = PP_Error;
+      return;
+    }
+  }
+  pp->value_offset += value_len;
+}
+
+
 /**
  * Give a (possibly partial) value to the application callback.  We have some
  * part of the value in the 'pp->xbuf', the rest is between @a value_start and
@@ -147,6 +261,16 @@ process_value (struct MHD_PostProcessor *pp,
   mhd_assert ( (NULL == value_start) || (NULL != value_end) );
   mhd_assert ( (NULL != value_start) || (NULL == value_end) );
   mhd_assert ( (NULL == last_escape) || (NULL != value_start) );
+  if ( (pp->in_place) &&
+       (0 == pp->xbuf_pos) &&
+       (NULL != value_start) )
+  {
+    /* The data is provided by MHD_post_process_in_place() */
+    process_value_in_place (pp,
+                            (char *) _MHD_DROP_CONST (value_start),
+                            (size_t) (value_end - value_start));
+    return;
+  }
   /* move remaining input from previous round into processing buffer */
   if (0 != pp->xbuf_pos)
     memcpy (xbuf,
@@ -799,6 +923,117 @@ process_multipart_headers (struct MHD_PostProcessor *pp,
 }
 
 
+/**
+ * Check whether the data is the beginning of the delimiter.
+ *
+ * @param data the data to check
+ * @param size the size of the @a data, less than the delimiter length
+ * @param boundary the boundary
+ * @param blen the length of the @a boundary
+ * @return true if @a data matches the beginning of the delimiter
+ */
+static bool
+is_delim_prefix (const char *data,
+                 size_t size,
+                 const char *boundary,
+                 size_t blen)
+{
+  mhd_assert (MHD_STATICSTR_LEN_ (delim_start) + blen > size);
+  (void) blen; /* Mute compiler warning */
+  if (MHD_STATICSTR_LEN_ (delim_start) >= size)
+    return (0 == memcmp (data,
+                         delim_start,
+                         size));
+  return (0 == memcmp (data,
+                       delim_start,
+                       MHD_STATICSTR_LEN_ (delim_start))) &&
+         (0 == memcmp (data + MHD_STATICSTR_LEN_ (delim_start),
+                       boundary,
+                       size - MHD_STATICSTR_LEN_ (delim_start)));
+}
+
+
+/**
+ * Find the delimiter ("\r\n--" followed by the boundary) in the data.
+ *
+ * The Boyer-Moore-Horspool algorithm is used, so typically only a small
+ * part of the bytes of the data is examined: the search advances by up to
+ * the delimiter length after each check.
+ * If the delimiter is not found, the position of the data which may be
+ * the beginning of the delimiter not fully received yet is returned.
+ *
+ * @param skip the shift table, see boundary_skip_init()
+ * @param data the data to search
+ * @param size the size of the @a data
+ * @param boundary the boundary
+ * @param blen the length of the @a boundary
+ * @param[out] found set to true if the delimiter was found
+ * @return the position of the delimiter if found,
+ *         the position of the possible beginning of the delimiter at
+ *         the end of the data or @a size if there is nothing like
+ *         the delimiter
+ */
+static size_t
+find_delimiter (const uint8_t *skip,
+                const char *data,
+                size_t size,
+                const char *boundary,
+                size_t blen,
+                bool *found)
+{
+  const uint8_t *const d = (const uint8_t *) data;
+  const size_t dlen = MHD_STATICSTR_LEN_ (delim_start) + blen;
+  const uint8_t last = (uint8_t) ((0 != blen) ? boundary[blen - 1] : '-');
+  size_t pos;
+
+  *found = false;
+  pos = 0;
+  if (size >= dlen)
+  {
+    const size_t last_pos = size - dlen;
+
+    while (pos <= last_pos)
+    {
+      const uint8_t c = d[pos + dlen - 1];
+
+      if ( (last == c) &&
+           ('\r' == data[pos]) &&
+           (0 == memcmp (data + pos,
+                         delim_start,
+                         MHD_STATICSTR_LEN_ (delim_start))) &&
+           (0 == memcmp (data + pos + MHD_STATICSTR_LEN_ (delim_start),
+                         boundary,
+                         blen)) )
+      {
+        *found = true;
+        return pos;
+      }
+      pos += skip[c];
+    }
+  }
+  /* The positions skipped by the search cannot be the beginning of
+     the delimiter, check the remaining positions for partial match */
+  while (pos < size)
+  {
+    const char *cr;
+
+    cr = memchr (data + pos,
+                 '\r',
+                 size - pos);
+    if (NULL == cr)
+      break;
+    pos = (size_t) (cr - data);
+    if (is_delim_prefix (cr,
+                         size - pos,
+                         boundary,
+                         blen))
+      return pos;
+    pos++;
+  }
+  return size;
+}
+
+
 /**
  * We have the value until we hit the given boundary;
  * process accordingly.
@@ -807,6 +1042,7 @@ process_multipart_headers (struct MHD_PostProcessor *pp,
  * @param ioffptr incremented based on the number of bytes processed
  * @param boundary the boundary to look for
  * @param blen strlen(boundary)
+ * @param skip the shift table for the @a boundary
  * @param next_state what state to go into after the
  *        boundary was found
  * @param next_dash_state state to go into if the next
@@ -820,71 +1056,39 @@ process_value_to_boundary (struct MHD_PostProcessor *pp,
                            size_t *ioffptr,
                            const char *boundary,
                            size_t blen,
+                           const uint8_t *skip,
                            enum PP_State next_state,
                            enum PP_State next_dash_state)
 {
   char *buf = (char *) &pp[1];
   size_t newline;
-  const char *r;
+  bool found;
 
   /* all data in buf until the boundary
      (\r\n--+boundary) is part of the value */
-  newline = 0;
-  while (1)
+  newline = find_delimiter (skip,
+                            buf,
+                            pp->buffer_pos,
+                            boundary,
+                            blen,
+                            &found);
+  if (found)
   {
-    while (newline + 4 < pp->buffer_pos)
-    {
-      r = memchr (&buf[newline],
-                  '\r',
-                  pp->buffer_pos - newline - 4);
-      if (NULL == r)
-      {
-        newline = pp->buffer_pos - 4;
-        break;
-      }
-      newline = (size_t) (r - buf);
-      if (0 == memcmp ("\r\n--",
-                       &buf[newline],
-                       4))
-        break;
-      newline++;
-    }
-    if (newline + blen + 4 <= pp->buffer_pos)
-    {
-      /* can check boundary */
-      if (0 != memcmp (&buf[newline + 4],
-                       boundary,
-                       blen))
-      {
-        /* no boundary, "\r\n--" is part of content, skip */
-        newline += 4;
-        continue;
-      }
-      else
-      {
-        /* boundary found, process until newline then
-           skip boundary and go back to init */
-        pp->skip_rn = RN_Dash;
-        pp->state = next_state;
-        pp->dash_state = next_dash_state;
-        (*ioffptr) += blen + 4;             /* skip boundary as well */
-        buf[newline] = '\0';
-        break;
-      }
-    }
-    else
-    {
-      /* cannot check for boundary, process content that
-         we have and check again later; except, if we have
-         no content, abort (out of memory) */
-      if ( (0 == newline) &&
-           (pp->buffer_pos == pp->buffer_size) )
-      {
-        pp->state = PP_Error;
-        return MHD_NO;
-      }
-      break;
-    }
+    /* boundary found, process until newline then
+       skip boundary and go back to init */
+    pp->skip_rn = RN_Dash;
+    pp->state = next_state;
+    pp->dash_state = next_dash_state;
+    (*ioffptr) += blen + 4;             /* skip boundary as well */
+    buf[newline] = '\0';
+  }
+  else if ( (0 == newline) &&
+            (pp->buffer_pos == pp->buffer_size) )
+  {
+    /* cannot check for boundary, and we have no content
+       to process, abort (out of memory) */
+    pp->state = PP_Error;
+    return MHD_NO;
   }
   /* newline is either at beginning of boundary or
      at least at the last character that we are sure
@@ -911,6 +1115,71 @@ process_value_to_boundary (struct MHD_PostProcessor *pp,
 }
 
 
+/**
+ * Give the value data directly from the application-provided data to
+ * the application callback, without copying it to the internal buffer.
+ * Used when the internal buffer is empty while processing the value.
+ *
+ * The tail of the value before the found delimiter is left for the
+ * processing by process_value_to_boundary() so the values fitting the
+ * internal buffer are still delivered in one piece and zero-terminated.
+ *
+ * @param pp post processor context
+ * @param data the data provided by the application
+ * @param size the size of the @a data
+ * @param[out] processed set to the number of bytes processed
+ * @return #MHD_YES if we can continue processing,
+ *         #MHD_NO on error
+ */
+static int
+process_value_direct (struct MHD_PostProcessor *pp,
+                      const char *data,
+                      size_t size,
+                      size_t *processed)
+{
+  const bool nested = (PP_Nested_ProcessValueToBoundary == pp->state);
+  const char *const boundary = nested ? pp->nested_boundary : pp->boundary;
+  const size_t blen = nested ? pp->nlen : pp->blen;
+  const size_t dlen = MHD_STATICSTR_LEN_ (delim_start) + blen;
+  size_t len;
+  bool found;
+
+  *processed = 0;
+  len = find_delimiter (nested ? pp->nskip : pp->bskip,
+                        data,
+                        size,
+                        boundary,
+                        blen,
+                        &found);
+  if (found)
+  {
+    const size_t keep = (pp->buffer_size > dlen) ?
+                        (pp->buffer_size - dlen) : len;
+
+    len = (len > keep) ? (len - keep) : 0;
+  }
+  if (0 == len)
+    return MHD_YES;
+  if (MHD_NO == pp->ikvi (pp->cls,
+                          MHD_POSTDATA_KIND,
+                          pp->content_name,
+                          pp->content_filename,
+                          pp->content_type,
+                          pp->content_transfer_encoding,
+                          data,
+                          pp->value_offset,
+                          len))
+  {
+    pp->state = PP_Error;
+    return MHD_NO;
+  }
+  pp->must_ikvi = false;
+  pp->value_offset += len;
+  *processed = len;
+  return MHD_YES;
+}
+
+
 /**
  *
  * @param pp post processor context
@@ -972,6 +1241,21 @@ post_process_multipart (struct MHD_PostProcessor *pp,
           ( (pp->buffer_pos > 0) &&
             (0 != state_changed) ) )
   {
+    if ( (0 == pp->buffer_pos) &&
+         (RN_Inactive == pp->skip_rn) &&
+         (poff < post_data_len) &&
+         ( (PP_ProcessValueToBoundary == pp->state) ||
+           (PP_Nested_ProcessValueToBoundary == pp->state) ) )
+    {
+      /* nothing is buffered, the bulk of the value can be passed
+         to the application without copying */
+      if (MHD_NO == process_value_direct (pp,
+                                          &post_data[poff],
+                                          post_data_len - poff,
+                                          &max))
+        return MHD_NO;
+      poff += max;
+    }
     /* first, move as much input data
        as possible to our internal buffer */
     max = pp->buffer_size - pp->buffer_pos;
@@ -1131,6 +1415,9 @@ post_process_multipart (struct MHD_PostProcessor *pp,
         free (pp->content_type);
         pp->content_type = NULL;
         pp->nlen = strlen (pp->nested_boundary);
+        boundary_skip_init (pp->nskip,
+                            pp->nested_boundary,
+                            pp->nlen);
         pp->state = PP_Nested_Init;
         state_changed = 1;
         break;
@@ -1144,6 +1431,7 @@ post_process_multipart (struct MHD_PostProcessor *pp,
                                                &ioff,
                                                pp->boundary,
                                                pp->blen,
+                                               pp->bskip,
                                                PP_PerformCleanup,
                                                PP_Done))
       {
@@ -1216,6 +1504,7 @@ post_process_multipart (struct MHD_PostProcessor *pp,
                                                &ioff,
                                                pp->nested_boundary,
                                                pp->nlen,
+                                               pp->nskip,
                                                PP_Nested_PerformCleanup,
                                                PP_NextBoundary))
       {
@@ -1291,6 +1580,26 @@ MHD_post_process (struct MHD_PostProcessor *pp,
 }
 
 
+_MHD_EXTERN enum MHD_Result
+MHD_post_process_in_place (struct MHD_PostProcessor *pp,
+                           char *post_data,
+                           size_t post_data_len)
+{
+  enum MHD_Result ret;
+
+  if (0 == post_data_len)
+    return MHD_YES;
+  if (NULL == pp)
+    return MHD_NO;
+  pp->in_place = true;
+  ret = MHD_post_process (pp,
+                          post_data,
+                          post_data_len);
+  pp->in_place = false;
+  return ret;
+}
+
+
 _MHD_EXTERN enum MHD_Result
 MHD_destroy_post_processor (struct MHD_PostProcessor *pp)
 {
@@ -216,6 +216,12 @@ struct MHD_PostProcessor
    */
   bool must_unescape_key;
 
+  /**
+   * Set while processing the data provided by
+   * #MHD_post_process_in_place(): the values may be decoded in place.
+   */
+  bool in_place;
+
   /**
    * State of the parser.
    */
@@ -241,6 +247,18 @@ struct MHD_PostProcessor
    */
   enum NE_State have;
 
+  /**
+   * Shift table for the search of the delimiter of the primary
+   * boundary, see boundary_skip_init().
+   */
+  uint8_t bskip[256];
+
+  /**
+   * Shift table for the search of the delimiter of the nested
+   * boundary.
+   */
+  uint8_t nskip[256];
+
 };
 
 #endif /* ! MHD_POSTPROCESSOR_H */
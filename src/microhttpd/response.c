@@ -31,6 +31,9 @@
 #ifdef HAVE_SYS_IOCTL_H
 #include <sys/ioctl.h>
 #endif /* HAVE_SYS_IOCTL_H */
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif /* HAVE_SYS_STAT_H */
 #if defined(_WIN32) && ! defined(__CYGWIN__)
 #include <windows.h>
 #endif /* _WIN32 && !__CYGWIN__ */
@@ -46,6 +49,8 @@
 #include "mhd_send.h"
 #include "mhd_compat.h"
 #include "mhd_assert.h"
+#include "upgrade_tunnel.h"
+#include "response_compress.h"
 
 
 #if defined(MHD_W32_MUTEX_)
@@ -1016,6 +1021,174 @@ MHD_create_response_from_callback (uint64_t size,
 }
 
 
+/**
+ * Check whether the string is the valid entity-tag.
+ *
+ * @param etag the entity-tag to check
+ * @param etag_len the length of the @a etag
+ * @return true if the @a etag is valid, false otherwise
+ */
+static bool
+is_valid_etag (const char *etag,
+               size_t etag_len)
+{
+  size_t i;
+
+  i = 0;
+  if ( (2 <= etag_len) &&
+       ('W' == etag[0]) &&
+       ('/' == etag[1]) )
+    i = 2; /* Weak entity-tag */
+  if ( (2 > etag_len - i) ||
+       ('"' != etag[i]) ||
+       ('"' != etag[etag_len - 1]) )
+    return false;
+  for (i++; i < etag_len - 1; i++)
+  {
+    const unsigned char c = (unsigned char) etag[i];
+    /* See RFC 9110, Section 8.8.3, 'etagc' */
+    if ( (0x21 != c) &&
+         ((0x23 > c) || (0x7E < c)) &&
+         (0x80 > c) )
+      return false;
+  }
+  return true;
+}
+
+
+/**
+ * Set the entity-tag of the response and enable the automatic processing
+ * of the conditional requests.
+ *
+ * @param response the response to modify
+ * @param etag the entity-tag with the quotes
+ * @return #MHD_YES on success, #MHD_NO on error
+ */
+static enum MHD_Result
+response_set_etag (struct MHD_Response *response,
+                   const char *etag)
+{
+  size_t etag_len;
+
+  if (NULL == etag)
+    return MHD_NO;
+  etag_len = strlen (etag);
+  if (! is_valid_etag (etag, etag_len))
+    return MHD_NO;
+  if (NULL != MHD_get_response_element_n_ (response, MHD_HEADER_KIND,
+                                           MHD_HTTP_HEADER_ETAG,
+                                           MHD_STATICSTR_LEN_ ( \
+                                             MHD_HTTP_HEADER_ETAG)))
+    return MHD_NO;
+  if (! MHD_add_response_entry_no_check_ (response, MHD_HEADER_KIND,
+                                          MHD_HTTP_HEADER_ETAG,
+                                          MHD_STATICSTR_LEN_ ( \
+                                            MHD_HTTP_HEADER_ETAG),
+                                          etag, etag_len))
+    return MHD_NO;
+  response->auto_cond = true;
+  return MHD_YES;
+}
+
+
+/**
+ * Set the modification time of the response and enable the automatic
+ * processing of the conditional requests.
+ *
+ * @param response the response to modify
+ * @param mtime the modification time, seconds since the epoch
+ * @return #MHD_YES on success, #MHD_NO on error
+ */
+static enum MHD_Result
+response_set_last_modified (struct MHD_Response *response,
+                            uint64_t mtime)
+{
+  char date[MHD_HTTP_DATE_STR_LEN + 1];
+
+  if (MHD_HTTP_DATE_STR_LEN !=
+      MHD_time_to_http_date_ (mtime, date, sizeof(date)))
+    return MHD_NO;
+  if (NULL != MHD_get_response_element_n_ (response, MHD_HEADER_KIND,
+                                           MHD_HTTP_HEADER_LAST_MODIFIED,
+                                           MHD_STATICSTR_LEN_ ( \
+                                             MHD_HTTP_HEADER_LAST_MODIFIED)))
+    return MHD_NO;
+  if (! MHD_add_response_entry_no_check_ (response, MHD_HEADER_KIND,
+                                          MHD_HTTP_HEADER_LAST_MODIFIED,
+                                          MHD_STATICSTR_LEN_ ( \
+                                            MHD_HTTP_HEADER_LAST_MODIFIED),
+                                          date, MHD_HTTP_DATE_STR_LEN))
+    return MHD_NO;
+  response->last_modified = mtime;
+  response->has_last_modified = true;
+  response->auto_cond = true;
+  return MHD_YES;
+}
+
+
+/**
+ * Set the entity-tag and the modification time of the response from
+ * the file of the response.
+ *
+ * @param response the response to modify
+ * @return #MHD_YES on success, #MHD_NO on error
+ */
+static enum MHD_Result
+response_set_validators_from_fd (struct MHD_Response *response)
+{
+#ifdef HAVE_SYS_STAT_H
+  struct stat st;
+  char etag[64];
+  size_t pos;
+  size_t len;
+
+  if ( (-1 == response->fd) ||
+       response->is_pipe )
+    return MHD_NO;
+  if ( (NULL != MHD_get_response_element_n_ (response, MHD_HEADER_KIND,
+                                             MHD_HTTP_HEADER_ETAG,
+                                             MHD_STATICSTR_LEN_ ( \
+                                               MHD_HTTP_HEADER_ETAG))) ||
+       (NULL != MHD_get_response_element_n_ (response, MHD_HEADER_KIND,
+                                             MHD_HTTP_HEADER_LAST_MODIFIED,
+                                             MHD_STATICSTR_LEN_ ( \
+                                               MHD_HTTP_HEADER_LAST_MODIFIED))) )
+    return MHD_NO;
+  if (0 != fstat (response->fd, &st))
+    return MHD_NO;
+  if ( (0 > st.st_mtime) ||
+       (0 > st.st_size) )
+    return MHD_NO;
+
+  /* The entity-tag is "<mtime>-<size>" */
+  pos = 0;
+  etag[pos++] = '"';
+  len = MHD_uint64_to_str ((uint64_t) st.st_mtime, etag + pos,
+                           sizeof(etag) - pos);
+  if (0 == len)
+    return MHD_NO;
+  pos += len;
+  etag[pos++] = '-';
+  len = MHD_uint64_to_str ((uint64_t) st.st_size, etag + pos,
+                           sizeof(etag) - pos);
+  if ( (0 == len) ||
+       (sizeof(etag) - 2 < pos + len) )
+    return MHD_NO;
+  pos += len;
+  etag[pos++] = '"';
+  etag[pos] = 0;
+
+  if (MHD_YES != response_set_last_modified (response,
+                                             (uint64_t) st.st_mtime))
+    return MHD_NO;
+  return response_set_etag (response, etag);
+#else  /* ! HAVE_SYS_STAT_H */
+  (void) response; /* Unused. Silence compiler warning. */
+  return MHD_NO;
+#endif /* ! HAVE_SYS_STAT_H */
+}
+
+
 /**
  * Set special flags and options for a response.
  *
@@ -1056,12 +1229,27 @@ MHD_set_response_options (struct MHD_Response *response,
   response->flags = flags;
 
   va_start (ap, flags);
-  while (MHD_RO_END != (ro = va_arg (ap, enum MHD_ResponseOptions)))
+  while ( (MHD_YES == ret) &&
+          (MHD_RO_END != (ro = va_arg (ap, enum MHD_ResponseOptions))) )
   {
     switch (ro)
     {
     case MHD_RO_END: /* Not possible */
       break;
+    case MHD_RO_ETAG:
+      ret = response_set_etag (response,
+                               va_arg (ap, const char *));
+      break;
+    case MHD_RO_LAST_MODIFIED:
+      ret = response_set_last_modified (response,
+                                        va_arg (ap, uint64_t));
+      break;
+    case MHD_RO_VALIDATORS_FROM_FD:
+      ret = response_set_validators_from_fd (response);
+      break;
+    case MHD_RO_CACHE_TTL:
+      response->cache_ttl = va_arg (ap, unsigned int);
+      break;
     default:
       ret = MHD_NO;
       break;
@@ -1909,6 +2097,22 @@ MHD_upgrade_action (struct MHD_UpgradeResponseHandle *urh,
     /* Unportable API. TODO: replace with portable action. */
     return MHD_connection_set_cork_state_ (connection,
                                            false) ? MHD_YES : MHD_NO;
+  case MHD_UPGRADE_ACTION_TUNNEL:
+#ifdef MHD_UPGRADE_TUNNEL_SUPPORT
+    if (1)
+    {
+      va_list ap;
+      int target_fd;
+
+      va_start (ap, action);
+      target_fd = va_arg (ap, int);
+      va_end (ap);
+      mhd_assert (MHD_CONNECTION_UPGRADE == connection->state);
+      return MHD_upgrade_tunnel_start_ (urh,
+                                        target_fd);
+    }
+#endif /* MHD_UPGRADE_TUNNEL_SUPPORT */
+    return MHD_NO;
   default:
     /* we don't understand this one */
     return MHD_NO;
@@ -2276,6 +2480,471 @@ MHD_create_response_for_upgrade (MHD_UpgradeHandler upgrade_handler,
 #endif /* UPGRADE_SUPPORT */
 
 
+/**
+ * Add the variant of the response body encoded with the content coding.
+ *
+ * The variant is used instead of the response body if the client accepts
+ * the content coding (as specified by the "Accept-Encoding" request header).
+ * If several variants (or the variants compressed by MHD, see
+ * #MHD_RF_COMPRESS) are acceptable, the variant with the highest weight
+ * is used, the variants added earlier are preferred for the equal
+ * weights.  The reply with the variant has the same headers as
+ * the response plus "Content-Encoding" header, the "ETag" header gets
+ * the name of the content coding as the suffix of the entity-tag (for
+ * example, "abc" becomes "abc-br"), so each variant has its own
+ * validator.  The "Vary" header with
+ * "Accept-Encoding" value is added automatically to all replies with
+ * the response, unless the response has "Vary" header.
+ *
+ * The variants are not used for the responses with "Content-Encoding"
+ * header, for the responses with #MHD_HTTP_PARTIAL_CONTENT and for
+ * the replies without the body.
+ *
+ * This function must be used before the response is queued for
+ * the first time.
+ *
+ * The buffer with the variant data is not copied, it must be valid until
+ * all replies with the response are completed (for example, until
+ * the daemon is stopped).
+ *
+ * @param response the response to add the variant to
+ * @param encoding the name of the content coding (like "br" or "zstd"),
+ *                 must not be "identity", must be unique for the response
+ * @param size the size of the encoded data
+ * @param buffer the encoded data
+ * @return #MHD_YES on success,
+ *         #MHD_NO on error (invalid parameters, duplicated coding or
+ *         out of memory)
+ * @note Available since #MHD_VERSION 0x01000102
+ * @ingroup response
+ */
+_MHD_EXTERN enum MHD_Result
+MHD_add_response_variant_static (struct MHD_Response *response,
+                                 const char *encoding,
+                                 size_t size,
+                                 const void *buffer)
+{
+  struct MHD_ResponseVariant *v;
+  struct MHD_ResponseVariant *last;
+  size_t enc_len;
+  size_t i;
+
+  if ( (NULL == response) || (NULL == encoding) )
+    return MHD_NO;
+  if ( (NULL == buffer) && (0 != size) )
+    return MHD_NO;
+  if (0 != (response->flags & MHD_RF_HEAD_ONLY_RESPONSE))
+    return MHD_NO;
+#ifdef UPGRADE_SUPPORT
+  if (NULL != response->upgrade_handler)
+    return MHD_NO;
+#endif /* UPGRADE_SUPPORT */
+  enc_len = strlen (encoding);
+  if (0 == enc_len)
+    return MHD_NO;
+  for (i = 0; i < enc_len; ++i)
+  {
+    const unsigned char chr = (unsigned char) encoding[i];
+
+    /* Only token characters are allowed */
+    if ( (' ' >= chr) || (127 <= chr) ||
+         (',' == chr) || (';' == chr) || ('"' == chr) || ('=' == chr) )
+      return MHD_NO;
+  }
+  if (MHD_str_equal_caseless_s_bin_n_ ("identity", encoding, enc_len))
+    return MHD_NO;
+  last = NULL;
+  for (v = response->first_variant; NULL != v; v = v->next)
+  {
+    if ( (enc_len == v->encoding_len) &&
+         MHD_str_equal_caseless_bin_n_ (encoding, v->encoding, enc_len) )
+      return MHD_NO;
+    last = v;
+  }
+  v = (struct MHD_ResponseVariant *) MHD_calloc_ (1, sizeof(*v));
+  if (NULL == v)
+    return MHD_NO;
+  v->encoding = (char *) malloc (enc_len + 1);
+  if (NULL == v->encoding)
+  {
+    free (v);
+    return MHD_NO;
+  }
+  memcpy (v->encoding, encoding, enc_len + 1);
+  v->encoding_len = enc_len;
+  v->data = (const char *) buffer;
+  v->size = size;
+  if (NULL == last)
+    response->first_variant = v;
+  else
+    last->next = v;
+  return MHD_YES;
+}
+
+
+/**
+ * Add the "ETag" header of the base response to the variant response.
+ *
+ * The entity-tag gets the name of the content coding as the suffix, so
+ * each variant has its own validator (RFC 9110, Section 8.8.3).
+ *
+ * @param r the variant response
+ * @param etag the "ETag" header of the base response
+ * @param encoding the name of the content coding
+ * @param encoding_len the length of the @a encoding
+ * @return true on success, false if no memory
+ */
+static bool
+add_variant_etag (struct MHD_Response *r,
+                  const struct MHD_HTTP_Res_Header *etag,
+                  const char *encoding,
+                  size_t encoding_len)
+{
+  char *value;
+  size_t pos;
+  bool ret;
+
+  if ( (2 > etag->value_size) ||
+       ('"' != etag->value[etag->value_size - 1]) )
+    return MHD_add_response_entry_no_check_ (r, etag->kind,
+                                             etag->header, etag->header_size,
+                                             etag->value, etag->value_size);
+  value = (char *) malloc (etag->value_size + 1 + encoding_len);
+  if (NULL == value)
+    return false;
+  pos = etag->value_size - 1;
+  memcpy (value, etag->value, pos);
+  value[pos++] = '-';
+  memcpy (value + pos, encoding, encoding_len);
+  pos += encoding_len;
+  value[pos++] = '"';
+  ret = MHD_add_response_entry_no_check_ (r, etag->kind,
+                                          etag->header, etag->header_size,
+                                          value, pos);
+  free (value);
+  return ret;
+}
+
+
+/**
+ * Create the response with the encoded variant of the body.
+ *
+ * The new response has all headers and flags of the base @a response,
+ * except the entity-tag, which is made unique for the content coding.
+ * The new response is kept by the base response and uses the reference
+ * counter of the base response, so the variant data is valid while
+ * the new response is used.
+ *
+ * @param response the base response
+ * @param encoding the name of the content coding
+ * @param encoding_len the length of the @a encoding
+ * @param data the encoded data
+ * @param size the size of the @a data
+ * @return the new response, NULL on error
+ */
+static struct MHD_Response *
+create_variant_response (struct MHD_Response *response,
+                         const char *encoding,
+                         size_t encoding_len,
+                         const char *data,
+                         size_t size)
+{
+  struct MHD_Response *r;
+  struct MHD_HTTP_Res_Header *pos;
+
+  r = MHD_create_response_from_buffer_with_free_callback_cls (size,
+                                                              data,
+                                                              NULL,
+                                                              NULL);
+  if (NULL == r)
+    return NULL;
+  r->flags = response->flags;
+  r->flags_auto = response->flags_auto;
+  r->auto_cond = response->auto_cond;
+  r->has_last_modified = response->has_last_modified;
+  r->last_modified = response->last_modified;
+  for (pos = response->first_header; NULL != pos; pos = pos->next)
+  {
+    bool res;
+
+    if ( (MHD_HEADER_KIND == pos->kind) &&
+         MHD_str_equal_caseless_s_bin_n_ (MHD_HTTP_HEADER_ETAG,
+                                          pos->header, pos->header_size) )
+      res = add_variant_etag (r, pos, encoding, encoding_len);
+    else
+      res = MHD_add_response_entry_no_check_ (r, pos->kind,
+                                              pos->header, pos->header_size,
+                                              pos->value, pos->value_size);
+    if (! res)
+    {
+      MHD_destroy_response (r);
+      return NULL;
+    }
+  }
+  if (! MHD_add_response_entry_no_check_ (r, MHD_HEADER_KIND,
+                                          MHD_HTTP_HEADER_CONTENT_ENCODING,
+                                          MHD_STATICSTR_LEN_ ( \
+                                            MHD_HTTP_HEADER_CONTENT_ENCODING),
+                                          encoding,
+                                          encoding_len))
+  {
+    MHD_destroy_response (r);
+    return NULL;
+  }
+  if ( (NULL == MHD_get_response_element_n_ (response, MHD_HEADER_KIND,
+                                             MHD_HTTP_HEADER_VARY,
+                                             MHD_STATICSTR_LEN_ ( \
+                                               MHD_HTTP_HEADER_VARY))) &&
+       (! MHD_add_response_entry_no_check_ (r, MHD_HEADER_KIND,
+                                            MHD_HTTP_HEADER_VARY,
+                                            MHD_STATICSTR_LEN_ ( \
+                                              MHD_HTTP_HEADER_VARY),
+                                            MHD_HTTP_HEADER_ACCEPT_ENCODING,
+                                            MHD_STATICSTR_LEN_ ( \
+                                              MHD_HTTP_HEADER_ACCEPT_ENCODING)))
+       )
+  {
+    MHD_destroy_response (r);
+    return NULL;
+  }
+  r->base = response;
+  r->is_cached_variant = true;
+  return r;
+}
+
+
+/**
+ * Get the response with the encoded variant of the body.
+ * The response is created on the first use and kept by the base response.
+ *
+ * @param response the base response
+ * @param[in,out] cached the pointer to the kept variant response
+ * @param encoding the name of the content coding
+ * @param encoding_len the length of the @a encoding
+ * @param data the encoded data
+ * @param size the size of the @a data
+ * @return the variant response with the counted reference,
+ *         NULL on error
+ */
+static struct MHD_Response *
+get_variant_response (struct MHD_Response *response,
+                      struct MHD_Response **cached,
+                      const char *encoding,
+                      size_t encoding_len,
+                      const char *data,
+                      size_t size)
+{
+  struct MHD_Response *r;
+
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_lock_chk_ (&response->mutex);
+#endif
+  if (NULL == *cached)
+    *cached = create_variant_response (response, encoding, encoding_len,
+                                       data, size);
+  r = *cached;
+  if (NULL != r)
+    (response->reference_count)++; /* The variant uses the base counter */
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_unlock_chk_ (&response->mutex);
+#endif
+  return r;
+}
+
+
+#ifdef RESPONSE_COMPRESSION_SUPPORT
+/**
+ * Get the body of the response compressed by MHD.
+ * The body is compressed on the first use and kept by the response.
+ *
+ * @param daemon the daemon to use
+ * @param response the response to use
+ * @param encoding the content coding to use
+ * @param[out] size set to the size of the compressed data
+ * @return the compressed data,
+ *         NULL if the data cannot be compressed
+ */
+static const char *
+get_compressed_body (struct MHD_Daemon *daemon,
+                     struct MHD_Response *response,
+                     enum MHD_RespEncoding_ encoding,
+                     size_t *size)
+{
+  const char *data;
+
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_lock_chk_ (&response->mutex);
+#endif
+  if (! response->compress_tried[encoding])
+  {
+    response->compressed[encoding] =
+      MHD_resp_compress_buffer_ (daemon,
+                                 encoding,
+                                 response->data,
+                                 response->data_size,
+                                 &response->compressed_size[encoding]);
+    response->compress_tried[encoding] = true;
+  }
+  data = response->compressed[encoding];
+  *size = response->compressed_size[encoding];
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+  MHD_mutex_unlock_chk_ (&response->mutex);
+#endif
+  return data;
+}
+
+
+#endif /* RESPONSE_COMPRESSION_SUPPORT */
+
+
+struct MHD_Response *
+MHD_response_select_variant_ (struct MHD_Connection *connection,
+                              struct MHD_Response *response,
+                              unsigned int status_code)
+{
+  const char *accept_enc;
+  size_t accept_enc_len;
+  struct MHD_ResponseVariant *v;
+  struct MHD_Response **cached;
+  const char *enc_name;
+  size_t enc_name_len;
+  const char *data;
+  size_t size;
+  unsigned int best_w;
+  int any_w;
+  bool can_compress;
+
+#ifdef RESPONSE_COMPRESSION_SUPPORT
+  can_compress = (0 != (response->flags & MHD_RF_COMPRESS)) &&
+                 (NULL == response->crc) &&
+                 (NULL == response->data_iov) &&
+                 (NULL != response->data);
+#else  /* ! RESPONSE_COMPRESSION_SUPPORT */
+  can_compress = false;
+#endif /* ! RESPONSE_COMPRESSION_SUPPORT */
+  if ( (NULL == response->first_variant) && (! can_compress) )
+    return NULL;
+  if ( (MHD_HTTP_OK > status_code) ||
+       (MHD_HTTP_NO_CONTENT == status_code) ||
+       (MHD_HTTP_PARTIAL_CONTENT == status_code) ||
+       (MHD_HTTP_NOT_MODIFIED == status_code) )
+    return NULL;
+  if ( (0 != (response->flags & MHD_RF_HEAD_ONLY_RESPONSE)) ||
+       (0 != (response->flags_auto & (MHD_RAF_HAS_CONTENT_LENGTH
+                                      | MHD_RAF_HAS_TRANS_ENC_CHUNKED))) )
+    return NULL;
+#ifdef UPGRADE_SUPPORT
+  if (NULL != response->upgrade_handler)
+    return NULL;
+#endif /* UPGRADE_SUPPORT */
+  if (NULL != MHD_get_response_element_n_ (response, MHD_HEADER_KIND,
+                                           MHD_HTTP_HEADER_CONTENT_ENCODING,
+                                           MHD_STATICSTR_LEN_ ( \
+                                             MHD_HTTP_HEADER_CONTENT_ENCODING)))
+    return NULL;
+  if (MHD_NO ==
+      MHD_lookup_connection_value_n (connection,
+                                     MHD_HEADER_KIND,
+                                     MHD_HTTP_HEADER_ACCEPT_ENCODING,
+                                     MHD_STATICSTR_LEN_ ( \
+                                       MHD_HTTP_HEADER_ACCEPT_ENCODING),
+                                     &accept_enc,
+                                     &accept_enc_len))
+    return NULL;
+
+  any_w = MHD_str_get_token_weight_ (accept_enc, accept_enc_len,
+                                     "*", MHD_STATICSTR_LEN_ ("*"));
+  cached = NULL;
+  enc_name = NULL;
+  enc_name_len = 0;
+  data = NULL;
+  size = 0;
+  best_w = 0;
+  for (v = response->first_variant; NULL != v; v = v->next)
+  {
+    int w;
+
+    w = MHD_str_get_token_weight_ (accept_enc, accept_enc_len,
+                                   v->encoding, v->encoding_len);
+    if (0 > w)
+      w = any_w;
+    if ((0 < w) && (best_w < (unsigned int) w))
+    {
+      best_w = (unsigned int) w;
+      cached = &v->resp;
+      enc_name = v->encoding;
+      enc_name_len = v->encoding_len;
+      data = v->data;
+      size = v->size;
+    }
+  }
+#ifdef RESPONSE_COMPRESSION_SUPPORT
+  if (can_compress)
+  {
+    static const enum MHD_RespEncoding_ encs[] =
+    { MHD_RESP_ENC_GZIP, MHD_RESP_ENC_DEFLATE };
+    size_t i;
+
+    for (i = 0; i < sizeof(encs) / sizeof(encs[0]); ++i)
+    {
+      const char *name;
+      size_t name_len;
+      const char *c_data;
+      size_t c_size;
+      unsigned int w;
+
+      w = MHD_resp_compress_enc_weight_ (accept_enc, accept_enc_len,
+                                         encs[i]);
+      if (best_w >= w)
+        continue;
+      name = MHD_resp_compress_enc_name_ (encs[i], &name_len);
+      for (v = response->first_variant; NULL != v; v = v->next)
+      {
+        if ( (name_len == v->encoding_len) &&
+             MHD_str_equal_caseless_bin_n_ (name, v->encoding, name_len) )
+          break;
+      }
+      if (NULL != v)
+        continue; /* The application has provided this variant */
+      c_data = get_compressed_body (connection->daemon, response, encs[i],
+                                    &c_size);
+      if (NULL == c_data)
+        continue;
+      best_w = w;
+      cached = &response->compressed_resp[encs[i]];
+      enc_name = name;
+      enc_name_len = name_len;
+      data = c_data;
+      size = c_size;
+    }
+  }
+#endif /* RESPONSE_COMPRESSION_SUPPORT */
+  if (NULL == enc_name)
+    return NULL;
+  return get_variant_response (response, cached, enc_name, enc_name_len,
+                               data, size);
+}
+
+
+/**
+ * Destroy the variant response kept by the base response.
+ * Used only when the base response is destroyed.
+ *
+ * @param variant the variant response to destroy, could be NULL
+ */
+static void
+destroy_cached_variant (struct MHD_Response *variant)
+{
+  if (NULL == variant)
+    return;
+  mhd_assert (variant->is_cached_variant);
+  mhd_assert (1 == variant->reference_count);
+  variant->is_cached_variant = false;
+  variant->base = NULL; /* The base response is being destroyed */
+  MHD_destroy_response (variant);
+}
+
+
 /**
  * Destroy a response object and associated resources.  Note that
  * libmicrohttpd may keep some of the resources around if the response
@@ -2289,9 +2958,16 @@ _MHD_EXTERN void
 MHD_destroy_response (struct MHD_Response *response)
 {
   struct MHD_HTTP_Res_Header *pos;
+  struct MHD_Response *base;
 
   if (NULL == response)
     return;
+  if (response->is_cached_variant)
+  {
+    /* The variant is kept by the base response */
+    MHD_destroy_response (response->base);
+    return;
+  }
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
   MHD_mutex_lock_chk_ (&response->mutex);
 #endif
@@ -2314,6 +2990,28 @@ MHD_destroy_response (struct MHD_Response *response)
     free (response->data_iov);
   }
 
+  while (NULL != response->first_variant)
+  {
+    struct MHD_ResponseVariant *const v = response->first_variant;
+
+    response->first_variant = v->next;
+    destroy_cached_variant (v->resp);
+    free (v->encoding);
+    free (v);
+  }
+#ifdef RESPONSE_COMPRESSION_SUPPORT
+  if (1)
+  {
+    unsigned int i;
+
+    for (i = 0; i < MHD_RESP_ENC_TABLE_SIZE; ++i)
+    {
+      destroy_cached_variant (response->compressed_resp[i]);
+      free (response->compressed[i]);
+    }
+  }
+#endif /* RESPONSE_COMPRESSION_SUPPORT */
+
   while (NULL != response->first_header)
   {
     pos = response->first_header;
@@ -2322,7 +3020,10 @@ MHD_destroy_response (struct MHD_Response *response)
     free (pos->value);
     free (pos);
   }
+  base = response->base;
   free (response);
+  if (NULL != base)
+    MHD_destroy_response (base);
 }
 
 
@@ -2334,6 +3035,8 @@ MHD_destroy_response (struct MHD_Response *response)
 void
 MHD_increment_response_rc (struct MHD_Response *response)
 {
+  if (response->is_cached_variant)
+    response = response->base; /* The variant uses the base counter */
 #if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
   MHD_mutex_lock_chk_ (&response->mutex);
 #endif
@@ -2344,4 +3047,133 @@ MHD_increment_response_rc (struct MHD_Response *response)
 }
 
 
+/**
+ * Check whether the list of entity-tags from the "If-None-Match" header
+ * matches the entity-tag of the response.
+ *
+ * The weak comparison is used, see RFC 9110, Section 13.1.2.
+ *
+ * @param list the value of the "If-None-Match" header
+ * @param list_len the length of the @a list
+ * @param etag the entity-tag of the response
+ * @param etag_len the length of the @a etag
+ * @return true if any entity-tag in the @a list matches the @a etag,
+ *         false otherwise
+ */
+static bool
+etag_list_matches (const char *list,
+                   size_t list_len,
+                   const char *etag,
+                   size_t etag_len)
+{
+  size_t i;
+
+  if ( (2 <= etag_len) &&
+       ('W' == etag[0]) &&
+       ('/' == etag[1]) )
+  {
+    etag += 2; /* The weakness is ignored */
+    etag_len -= 2;
+  }
+  i = 0;
+  while (i < list_len)
+  {
+    size_t tag_start;
+
+    if ( (' ' == list[i]) || ('\t' == list[i]) || (',' == list[i]) )
+    {
+      i++;
+      continue;
+    }
+    if ( (2 <= list_len - i) &&
+         ('W' == list[i]) &&
+         ('/' == list[i + 1]) )
+      i += 2;
+    if ( (i >= list_len) ||
+         ('"' != list[i]) )
+      return false; /* Broken list */
+    tag_start = i++;
+    while ( (i < list_len) &&
+            ('"' != list[i]) )
+      i++;
+    if (i >= list_len)
+      return false; /* Broken list */
+    i++;
+    if ( (etag_len == i - tag_start) &&
+         (0 == memcmp (list + tag_start, etag, etag_len)) )
+      return true;
+  }
+  return false;
+}
+
+
+bool
+MHD_response_is_not_modified_ (struct MHD_Connection *connection,
+                               struct MHD_Response *response,
+                               unsigned int status_code)
+{
+  const char *val;
+  size_t val_len;
+  uint64_t since;
+
+  if (! response->auto_cond)
+    return false;
+  if (MHD_HTTP_OK != status_code)
+    return false;
+  if ( (MHD_HTTP_MTHD_GET != connection->rq.http_mthd) &&
+       (MHD_HTTP_MTHD_HEAD != connection->rq.http_mthd) )
+    return false;
+
+  if (MHD_NO !=
+      MHD_lookup_connection_value_n (connection,
+                                     MHD_HEADER_KIND,
+                                     MHD_HTTP_HEADER_IF_NONE_MATCH,
+                                     MHD_STATICSTR_LEN_ ( \
+                                       MHD_HTTP_HEADER_IF_NONE_MATCH),
+                                     &val,
+                                     &val_len))
+  {
+    const struct MHD_HTTP_Res_Header *etag;
+
+    /* "If-Modified-Since" is ignored when "If-None-Match" is present,
+       see RFC 9110, Section 13.1.3 */
+    while ( (0 != val_len) &&
+            ((' ' == val[val_len - 1]) || ('\t' == val[val_len - 1])) )
+      val_len--;
+    while ( (0 != val_len) &&
+            ((' ' == val[0]) || ('\t' == val[0])) )
+    {
+      val++;
+      val_len--;
+    }
+    if ( (1 == val_len) &&
+         ('*' == val[0]) )
+      return true;
+    etag = MHD_get_response_element_n_ (response, MHD_HEADER_KIND,
+                                        MHD_HTTP_HEADER_ETAG,
+                                        MHD_STATICSTR_LEN_ ( \
+                                          MHD_HTTP_HEADER_ETAG));
+    if (NULL == etag)
+      return false;
+    return etag_list_matches (val, val_len,
+                              etag->value, etag->value_size);
+  }
+
+  if (! response->has_last_modified)
+    return false;
+  if (MHD_NO ==
+      MHD_lookup_connection_value_n (connection,
+                                     MHD_HEADER_KIND,
+                                     MHD_HTTP_HEADER_IF_MODIFIED_SINCE,
+                                     MHD_STATICSTR_LEN_ ( \
+                                       MHD_HTTP_HEADER_IF_MODIFIED_SINCE),
+                                     &val,
+                                     &val_len))
+    return false;
+  if (! MHD_http_date_to_time_ (val, val_len, &since))
+    return false; /* Invalid dates are ignored */
+  return response->last_modified <= since;
+}
+
+
 /* end of response.c */
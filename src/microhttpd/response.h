@@ -122,4 +122,45 @@ MHD_add_response_entry_no_alloc_ (struct MHD_Response *response,
                                   char *content,
                                   size_t content_len);
 
+
+/**
+ * Select the variant of the response body encoded with the content coding
+ * accepted by the client.
+ *
+ * The variants are added by the application or compressed by MHD (for
+ * the buffer-based responses with #MHD_RF_COMPRESS flag).
+ *
+ * @param connection the connection to use
+ * @param response the response to be queued
+ * @param status_code the HTTP status code of the reply
+ * @return the new response (with the reference counted for the caller)
+ *         with the selected variant of the body,
+ *         NULL if the @a response should be used as is
+ */
+struct MHD_Response *
+MHD_response_select_variant_ (struct MHD_Connection *connection,
+                              struct MHD_Response *response,
+                              unsigned int status_code);
+
+
+/**
+ * Check whether the client has the current version of the response body
+ * already.
+ *
+ * The "If-None-Match" and "If-Modified-Since" request headers are checked
+ * only for GET and HEAD requests answered with #MHD_HTTP_OK code by
+ * the response with the validators set by #MHD_RO_ETAG,
+ * #MHD_RO_LAST_MODIFIED or #MHD_RO_VALIDATORS_FROM_FD options.
+ *
+ * @param connection the connection to use
+ * @param response the response to be queued
+ * @param status_code the HTTP status code of the reply
+ * @return true if the reply should be sent with #MHD_HTTP_NOT_MODIFIED
+ *         code, false otherwise
+ */
+bool
+MHD_response_is_not_modified_ (struct MHD_Connection *connection,
+                               struct MHD_Response *response,
+                               unsigned int status_code);
+
 #endif
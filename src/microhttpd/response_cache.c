@@ -0,0 +1,852 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     This library is free software; you can redistribute it and/or
+     modify it under the terms of the GNU Lesser General Public
+     License as published by the Free Software Foundation; either
+     version 2.1 of the License, or (at your option) any later version.
+
+     This library is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     Lesser General Public License for more details.
+
+     You should have received a copy of the GNU Lesser General Public
+     License along with this library; if not, write to the Free Software
+     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+/**
+ * @file microhttpd/response_cache.c
+ * @brief  The cache of the responses in the daemon
+ *
+ * The key of the entry is the method, the "Host" header and the decoded
+ * URL with the query arguments of GET or HEAD request.  The values of
+ * the request headers listed in the "Vary" header of the response are
+ * stored with the entry and compared when the entry is found.  The requests
+ * with "Authorization" or "Cookie" header are answered from the cache (and
+ * their responses are cached) only if the "Vary" header of the response
+ * lists these headers.  The key is serialised as the list of
+ * the strings with the lengths, the request key is hashed and compared
+ * directly with the stored key, without building it in memory.
+ *
+ * The entries are kept in the shards selected by the hash of the key,
+ * each shard has its own lock, the hash table and the list ordered by
+ * the last use.  The memory limit is split equally between the shards.
+ */
+
+#include "response_cache.h"
+#include "response.h"
+#include "mhd_str.h"
+#include "mhd_mono_clock.h"
+#include "mhd_compat.h"
+#include "mhd_assert.h"
+#ifdef MHD_USE_THREADS
+#include "mhd_locks.h"
+#endif /* MHD_USE_THREADS */
+
+
+/**
+ * The number of hash buckets in each shard, must be a power of two
+ */
+#define MHD_RESP_CACHE_SHARD_BUCKETS 256
+
+
+/**
+ * The request headers with the credentials or the user state
+ */
+static const struct _MHD_cstr_w_len private_hdrs[] = {
+  _MHD_S_STR_W_LEN (MHD_HTTP_HEADER_AUTHORIZATION),
+  _MHD_S_STR_W_LEN (MHD_HTTP_HEADER_COOKIE)
+};
+
+
+/**
+ * The cached response
+ */
+struct MHD_RespCacheEntry
+{
+  /**
+   * The previous entry in the list ordered by the last use
+   */
+  struct MHD_RespCacheEntry *prev;
+
+  /**
+   * The next entry in the list ordered by the last use
+   */
+  struct MHD_RespCacheEntry *next;
+
+  /**
+   * The next entry in the same hash bucket
+   */
+  struct MHD_RespCacheEntry *next_in_bucket;
+
+  /**
+   * The hash of the @e key
+   */
+  uint32_t hash;
+
+  /**
+   * The cached response, one reference is held by the cache
+   */
+  struct MHD_Response *response;
+
+  /**
+   * The status code to use with the @e response
+   */
+  unsigned int status_code;
+
+  /**
+   * The time (monotonic seconds) when the entry expires
+   */
+  uint64_t expires;
+
+  /**
+   * The memory accounted for the entry
+   */
+  size_t mem_size;
+
+  /**
+   * The serialised key (method, host, URL and query arguments)
+   */
+  const char *key;
+
+  /**
+   * The length of the @e key
+   */
+  size_t key_len;
+
+  /**
+   * The serialised names and values of the request headers listed
+   * in "Vary" header of the response
+   */
+  const char *vary;
+
+  /**
+   * The length of the @e vary
+   */
+  size_t vary_len;
+};
+
+
+/**
+ * The shard of the response cache
+ */
+struct MHD_RespCacheShard
+{
+  /**
+   * The hash buckets
+   */
+  struct MHD_RespCacheEntry *buckets[MHD_RESP_CACHE_SHARD_BUCKETS];
+
+  /**
+   * The most recently used entry
+   */
+  struct MHD_RespCacheEntry *head;
+
+  /**
+   * The least recently used entry
+   */
+  struct MHD_RespCacheEntry *tail;
+
+  /**
+   * The memory used by the entries of the shard
+   */
+  size_t mem_used;
+
+  /**
+   * The number of requests answered from the shard
+   */
+  uint64_t hits;
+
+  /**
+   * The number of requests not found in the shard
+   */
+  uint64_t misses;
+
+#ifdef MHD_USE_THREADS
+  /**
+   * The lock for the shard
+   */
+  MHD_mutex_ lock;
+#endif /* MHD_USE_THREADS */
+};
+
+
+/**
+ * The state of the key processing: hashing, serialising and comparing
+ * with the serialised key.
+ */
+struct MHD_RespCacheKey
+{
+  /**
+   * The hash of the processed data
+   */
+  uint32_t hash;
+
+  /**
+   * The length of the processed data
+   */
+  size_t len;
+
+  /**
+   * The buffer to write the serialised data, NULL to skip writing
+   */
+  char *out;
+
+  /**
+   * The serialised key to compare with, NULL to skip comparing
+   */
+  const char *cmp;
+
+  /**
+   * The length of the @e cmp
+   */
+  size_t cmp_len;
+
+  /**
+   * Set to true if the processed data differs from the @e cmp
+   */
+  bool differs;
+};
+
+
+/**
+ * Initialise the key processing.
+ *
+ * @param daemon the master daemon
+ * @param[out] k the key processing state to initialise
+ * @param out the buffer to write the serialised data, can be NULL
+ * @param cmp the serialised key to compare with, can be NULL
+ * @param cmp_len the length of the @a cmp
+ */
+static void
+key_init (const struct MHD_Daemon *daemon,
+          struct MHD_RespCacheKey *k,
+          char *out,
+          const char *cmp,
+          size_t cmp_len)
+{
+  k->hash = 2166136261U ^ daemon->per_ip_count_salt;
+  k->len = 0;
+  k->out = out;
+  k->cmp = cmp;
+  k->cmp_len = cmp_len;
+  k->differs = false;
+}
+
+
+/**
+ * Process the raw data of the key.
+ *
+ * @param k the key processing state
+ * @param data the data to process
+ * @param size the size of the @a data
+ */
+static void
+key_add_raw (struct MHD_RespCacheKey *k,
+             const void *data,
+             size_t size)
+{
+  const uint8_t *const d = (const uint8_t *) data;
+  size_t i;
+
+  for (i = 0; i < size; i++)
+  {
+    k->hash ^= d[i];
+    k->hash *= 16777619U;
+  }
+  if (NULL != k->out)
+    memcpy (k->out + k->len, data, size);
+  if ( (NULL != k->cmp) &&
+       (! k->differs) )
+  {
+    if ( (k->cmp_len - k->len < size) ||
+         (0 != memcmp (k->cmp + k->len, data, size)) )
+      k->differs = true;
+  }
+  k->len += size;
+}
+
+
+/**
+ * Process the string of the key.
+ *
+ * @param k the key processing state
+ * @param str the string, can be NULL if @a present is false
+ * @param len the length of the @a str
+ * @param present false if the string is absent (like the value of
+ *                the query argument without '=')
+ */
+static void
+key_add (struct MHD_RespCacheKey *k,
+         const char *str,
+         size_t len,
+         bool present)
+{
+  const uint8_t marker = present ? 1 : 0;
+
+  key_add_raw (k, &marker, sizeof(marker));
+  if (! present)
+    return;
+  key_add_raw (k, &len, sizeof(len));
+  key_add_raw (k, str, len);
+}
+
+
+/**
+ * Process the key of the request: the method, the "Host" header, the URL
+ * and the query arguments.
+ *
+ * @param c the connection with the request
+ * @param k the key processing state
+ */
+static void
+key_add_request (struct MHD_Connection *c,
+                 struct MHD_RespCacheKey *k)
+{
+  const struct MHD_HTTP_Req_Header *h;
+  const char *host;
+  size_t host_len;
+  bool has_host;
+
+  host = NULL;
+  host_len = 0;
+  has_host = (MHD_NO !=
+              MHD_lookup_connection_value_n (c,
+                                             MHD_HEADER_KIND,
+                                             MHD_HTTP_HEADER_HOST,
+                                             MHD_STATICSTR_LEN_ ( \
+                                               MHD_HTTP_HEADER_HOST),
+                                             &host,
+                                             &host_len));
+  key_add (k, c->rq.method, strlen (c->rq.method), true);
+  key_add (k, host, host_len, has_host);
+  key_add (k, c->rq.url, c->rq.url_len, true);
+  for (h = c->rq.headers_received; NULL != h; h = h->next)
+  {
+    if (MHD_GET_ARGUMENT_KIND != h->kind)
+      continue;
+    key_add (k, h->header, h->header_size, true);
+    key_add (k, h->value, h->value_size, NULL != h->value);
+  }
+}
+
+
+/**
+ * Read the string from the serialised data.
+ *
+ * @param data the serialised data
+ * @param[in,out] pos the position in the @a data
+ * @param[out] str set to the string
+ * @param[out] len set to the length of the @a str
+ * @return true if the string is present, false otherwise
+ */
+static bool
+read_str (const char *data,
+          size_t *pos,
+          const char **str,
+          size_t *len)
+{
+  const bool present = (0 != data[*pos]);
+
+  (*pos)++;
+  *str = NULL;
+  *len = 0;
+  if (! present)
+    return false;
+  memcpy (len, data + *pos, sizeof(*len));
+  *pos += sizeof(*len);
+  *str = data + *pos;
+  *pos += *len;
+  return true;
+}
+
+
+/**
+ * Check whether the request headers listed in "Vary" have the same
+ * values as in the request answered by the cached response.
+ *
+ * @param c the connection with the request
+ * @param e the cache entry
+ * @return true if the values are the same, false otherwise
+ */
+static bool
+vary_matches (struct MHD_Connection *c,
+              const struct MHD_RespCacheEntry *e)
+{
+  size_t pos;
+
+  pos = 0;
+  while (pos < e->vary_len)
+  {
+    const char *name;
+    size_t name_len;
+    const char *val;
+    size_t val_len;
+    const char *rq_val;
+    size_t rq_val_len;
+    bool present;
+
+    (void) read_str (e->vary, &pos, &name, &name_len);
+    present = read_str (e->vary, &pos, &val, &val_len);
+    if (MHD_NO ==
+        MHD_lookup_connection_value_n (c,
+                                       MHD_HEADER_KIND,
+                                       name,
+                                       name_len,
+                                       &rq_val,
+                                       &rq_val_len))
+    {
+      if (present)
+        return false;
+    }
+    else if ( (! present) ||
+              (val_len != rq_val_len) ||
+              (0 != memcmp (val, rq_val, val_len)) )
+      return false;
+  }
+  mhd_assert (pos == e->vary_len);
+  return true;
+}
+
+
+/**
+ * Check whether the request headers with the credentials or the user
+ * state, if present in the request, are listed in the "Vary" data.
+ *
+ * @param c the connection with the request
+ * @param vary the serialised "Vary" data
+ * @param vary_len the length of the @a vary
+ * @return true if the cached response can be used for the request,
+ *         false otherwise
+ */
+static bool
+vary_has_private_hdrs (struct MHD_Connection *c,
+                       const char *vary,
+                       size_t vary_len)
+{
+  size_t i;
+
+  for (i = 0; i < sizeof(private_hdrs) / sizeof(private_hdrs[0]); ++i)
+  {
+    size_t pos;
+    bool listed;
+
+    if (MHD_NO ==
+        MHD_lookup_connection_value_n (c,
+                                       MHD_HEADER_KIND,
+                                       private_hdrs[i].str,
+                                       private_hdrs[i].len,
+                                       NULL,
+                                       NULL))
+      continue;
+    listed = false;
+    pos = 0;
+    while ( (pos < vary_len) && (! listed) )
+    {
+      const char *name;
+      size_t name_len;
+      const char *val;
+      size_t val_len;
+
+      (void) read_str (vary, &pos, &name, &name_len);
+      (void) read_str (vary, &pos, &val, &val_len);
+      listed = (private_hdrs[i].len == name_len) &&
+               MHD_str_equal_caseless_bin_n_ (private_hdrs[i].str,
+                                              name, name_len);
+    }
+    if (! listed)
+      return false;
+  }
+  return true;
+}
+
+
+/**
+ * Process the names and the request values of the headers listed in
+ * "Vary" headers of the response.
+ *
+ * @param c the connection with the request
+ * @param response the response
+ * @param k the key processing state
+ * @return true on success,
+ *         false if the response cannot be cached ("Vary: *")
+ */
+static bool
+vary_add (struct MHD_Connection *c,
+          struct MHD_Response *response,
+          struct MHD_RespCacheKey *k)
+{
+  const struct MHD_HTTP_Res_Header *h;
+
+  for (h = response->first_header; NULL != h; h = h->next)
+  {
+    size_t pos;
+
+    if ( (MHD_HEADER_KIND != h->kind) ||
+         (! MHD_str_equal_caseless_s_bin_n_ (MHD_HTTP_HEADER_VARY,
+                                             h->header,
+                                             h->header_size)) )
+      continue;
+    pos = 0;
+    while (pos < h->value_size)
+    {
+      size_t start;
+      size_t end;
+      const char *rq_val;
+      size_t rq_val_len;
+      bool found;
+
+      while ( (pos < h->value_size) &&
+              ((' ' == h->value[pos]) || ('\t' == h->value[pos]) ||
+               (',' == h->value[pos])) )
+        pos++;
+      start = pos;
+      while ( (pos < h->value_size) &&
+              (',' != h->value[pos]) )
+        pos++;
+      end = pos;
+      while ( (end > start) &&
+              ((' ' == h->value[end - 1]) || ('\t' == h->value[end - 1])) )
+        end--;
+      if (end == start)
+        continue;
+      if ( (1 == end - start) &&
+           ('*' == h->value[start]) )
+        return false;
+      found = (MHD_NO !=
+               MHD_lookup_connection_value_n (c,
+                                              MHD_HEADER_KIND,
+                                              h->value + start,
+                                              end - start,
+                                              &rq_val,
+                                              &rq_val_len));
+      key_add (k, h->value + start, end - start, true);
+      key_add (k, rq_val, rq_val_len, found);
+    }
+  }
+  return true;
+}
+
+
+/**
+ * Remove the entry from the shard and release it.
+ *
+ * The shard must be locked.
+ *
+ * @param shard the shard to use
+ * @param e the entry to remove
+ */
+static void
+entry_remove (struct MHD_RespCacheShard *shard,
+              struct MHD_RespCacheEntry *e)
+{
+  struct MHD_RespCacheEntry **pos;
+
+  for (pos = shard->buckets + (e->hash & (MHD_RESP_CACHE_SHARD_BUCKETS - 1));
+       e != *pos;
+       pos = &(*pos)->next_in_bucket)
+    mhd_assert (NULL != *pos);
+  *pos = e->next_in_bucket;
+  DLL_remove (shard->head, shard->tail, e);
+  mhd_assert (shard->mem_used >= e->mem_size);
+  shard->mem_used -= e->mem_size;
+  MHD_destroy_response (e->response);
+  free (e);
+}
+
+
+/**
+ * Find the entry with the key of the request.
+ *
+ * The shard must be locked.
+ *
+ * @param c the connection with the request
+ * @param shard the shard to use
+ * @param hash the hash of the key of the request
+ * @param key_len the length of the serialised key of the request
+ * @param vary_e if not NULL, the entry with the "Vary" data to match,
+ *               otherwise the request headers are matched
+ * @return the found entry, NULL if not found
+ */
+static struct MHD_RespCacheEntry *
+entry_find (struct MHD_Connection *c,
+            struct MHD_RespCacheShard *shard,
+            uint32_t hash,
+            size_t key_len,
+            const struct MHD_RespCacheEntry *vary_e)
+{
+  struct MHD_Daemon *const daemon = MHD_get_master (c->daemon);
+  struct MHD_RespCacheEntry *e;
+
+  for (e = shard->buckets[hash & (MHD_RESP_CACHE_SHARD_BUCKETS - 1)];
+       NULL != e;
+       e = e->next_in_bucket)
+  {
+    struct MHD_RespCacheKey k;
+
+    if ( (hash != e->hash) ||
+         (key_len != e->key_len) )
+      continue;
+    key_init (daemon, &k, NULL, e->key, e->key_len);
+    key_add_request (c, &k);
+    if (k.differs)
+      continue;
+    if (NULL == vary_e)
+    {
+      if (vary_matches (c, e) &&
+          vary_has_private_hdrs (c, e->vary, e->vary_len))
+        return e;
+    }
+    else if ( (vary_e->vary_len == e->vary_len) &&
+              (0 == memcmp (vary_e->vary, e->vary, e->vary_len)) )
+      return e;
+  }
+  return NULL;
+}
+
+
+bool
+MHD_response_cache_init_ (struct MHD_Daemon *daemon)
+{
+  struct MHD_RespCacheShard *shards;
+#ifdef MHD_USE_THREADS
+  unsigned int i;
+#endif /* MHD_USE_THREADS */
+
+  mhd_assert (NULL == daemon->master);
+  daemon->response_cache = NULL;
+  if (0 == daemon->response_cache_size)
+    return true;
+
+  shards = (struct MHD_RespCacheShard *)
+           MHD_calloc_ (MHD_RESP_CACHE_SHARDS,
+                        sizeof(struct MHD_RespCacheShard));
+  if (NULL == shards)
+    return false;
+#ifdef MHD_USE_THREADS
+  for (i = 0; i < MHD_RESP_CACHE_SHARDS; i++)
+  {
+    if (! MHD_mutex_init_ (&shards[i].lock))
+    {
+      while (0 != i--)
+        MHD_mutex_destroy_chk_ (&shards[i].lock);
+      free (shards);
+      return false;
+    }
+  }
+#endif /* MHD_USE_THREADS */
+  daemon->response_cache = shards;
+  return true;
+}
+
+
+void
+MHD_response_cache_deinit_ (struct MHD_Daemon *daemon)
+{
+  unsigned int i;
+
+  mhd_assert (NULL == daemon->master);
+  if (NULL == daemon->response_cache)
+    return;
+  for (i = 0; i < MHD_RESP_CACHE_SHARDS; i++)
+  {
+    struct MHD_RespCacheShard *const shard = daemon->response_cache + i;
+
+    while (NULL != shard->head)
+      entry_remove (shard, shard->head);
+#ifdef MHD_USE_THREADS
+    MHD_mutex_destroy_chk_ (&shard->lock);
+#endif /* MHD_USE_THREADS */
+  }
+  free (daemon->response_cache);
+  daemon->response_cache = NULL;
+}
+
+
+struct MHD_Response *
+MHD_response_cache_lookup_ (struct MHD_Connection *c,
+                            unsigned int *status_code)
+{
+  struct MHD_Daemon *const daemon = MHD_get_master (c->daemon);
+  struct MHD_RespCacheShard *shard;
+  struct MHD_RespCacheEntry *e;
+  struct MHD_RespCacheKey k;
+  struct MHD_Response *response;
+  uint64_t now;
+
+  if (NULL == daemon->response_cache)
+    return NULL;
+  if (c->rq.resp_cache_checked)
+    return NULL;
+  if ( (MHD_HTTP_MTHD_GET != c->rq.http_mthd) &&
+       (MHD_HTTP_MTHD_HEAD != c->rq.http_mthd) )
+    return NULL;
+  if ( (0 != c->rq.remaining_upload_size) ||
+       (c->rq.have_chunked_upload) )
+    return NULL;
+  c->rq.resp_cache_checked = true;
+
+  key_init (daemon, &k, NULL, NULL, 0);
+  key_add_request (c, &k);
+  shard = daemon->response_cache
+          + ((k.hash >> 24) & (MHD_RESP_CACHE_SHARDS - 1));
+  now = MHD_monotonic_sec_counter ();
+  response = NULL;
+
+#ifdef MHD_USE_THREADS
+  MHD_mutex_lock_chk_ (&shard->lock);
+#endif /* MHD_USE_THREADS */
+  e = entry_find (c, shard, k.hash, k.len, NULL);
+  if ( (NULL != e) &&
+       (now >= e->expires) )
+  {
+    entry_remove (shard, e);
+    e = NULL;
+  }
+  if (NULL != e)
+  {
+    if (shard->head != e)
+    {
+      DLL_remove (shard->head, shard->tail, e);
+      DLL_insert (shard->head, shard->tail, e);
+    }
+    MHD_increment_response_rc (e->response);
+    response = e->response;
+    *status_code = e->status_code;
+    shard->hits++;
+  }
+  else
+    shard->misses++;
+#ifdef MHD_USE_THREADS
+  MHD_mutex_unlock_chk_ (&shard->lock);
+#endif /* MHD_USE_THREADS */
+  return response;
+}
+
+
+void
+MHD_response_cache_store_ (struct MHD_Connection *c,
+                           struct MHD_Response *response,
+                           unsigned int status_code)
+{
+  struct MHD_Daemon *const daemon = MHD_get_master (c->daemon);
+  const size_t shard_limit = daemon->response_cache_size
+                             / MHD_RESP_CACHE_SHARDS;
+  struct MHD_RespCacheShard *shard;
+  struct MHD_RespCacheEntry *e;
+  struct MHD_RespCacheEntry *old;
+  struct MHD_RespCacheKey k;
+  struct MHD_RespCacheKey v;
+  size_t mem_size;
+  char *buf;
+
+  if ( (0 == response->cache_ttl) ||
+       (NULL == daemon->response_cache) ||
+       (! c->rq.resp_cache_checked) ||
+       (c->rq.resp_cache_reply) )
+    return;
+  if ( (MHD_HTTP_OK > status_code) ||
+       (0 != (response->flags & MHD_RF_HEAD_ONLY_RESPONSE)) ||
+       (response->is_pipe) )
+    return;
+#ifdef UPGRADE_SUPPORT
+  if (NULL != response->upgrade_handler)
+    return;
+#endif /* UPGRADE_SUPPORT */
+
+  /* Calculate the sizes */
+  key_init (daemon, &k, NULL, NULL, 0);
+  key_add_request (c, &k);
+  key_init (daemon, &v, NULL, NULL, 0);
+  if (! vary_add (c, response, &v))
+    return; /* "Vary: *" */
+  mem_size = sizeof(struct MHD_RespCacheEntry) + k.len + v.len;
+  if ( (NULL == response->crc) &&
+       (MHD_SIZE_UNKNOWN != response->total_size) )
+  {
+    if (shard_limit - mem_size < response->total_size)
+      return;
+    mem_size += (size_t) response->total_size;
+  }
+  if (mem_size > shard_limit)
+    return;
+
+  e = (struct MHD_RespCacheEntry *) MHD_calloc_ (1, mem_size);
+  if (NULL == e)
+    return;
+  buf = (char *) (e + 1);
+  key_init (daemon, &k, buf, NULL, 0);
+  key_add_request (c, &k);
+  key_init (daemon, &v, buf + k.len, NULL, 0);
+  (void) vary_add (c, response, &v);
+  if (! vary_has_private_hdrs (c, buf + k.len, v.len))
+  {
+    free (e);
+    return; /* The response may depend on the credentials or the cookies */
+  }
+  e->hash = k.hash;
+  e->key = buf;
+  e->key_len = k.len;
+  e->vary = buf + k.len;
+  e->vary_len = v.len;
+  e->response = response;
+  e->status_code = status_code;
+  e->expires = MHD_monotonic_sec_counter () + response->cache_ttl;
+  e->mem_size = mem_size;
+  MHD_increment_response_rc (response);
+
+  shard = daemon->response_cache
+          + ((e->hash >> 24) & (MHD_RESP_CACHE_SHARDS - 1));
+#ifdef MHD_USE_THREADS
+  MHD_mutex_lock_chk_ (&shard->lock);
+#endif /* MHD_USE_THREADS */
+  old = entry_find (c, shard, e->hash, e->key_len, e);
+  if (NULL != old)
+    entry_remove (shard, old);
+  while ( (NULL != shard->tail) &&
+          (shard_limit - shard->mem_used < mem_size) )
+    entry_remove (shard, shard->tail);
+  e->next_in_bucket =
+    shard->buckets[e->hash & (MHD_RESP_CACHE_SHARD_BUCKETS - 1)];
+  shard->buckets[e->hash & (MHD_RESP_CACHE_SHARD_BUCKETS - 1)] = e;
+  DLL_insert (shard->head, shard->tail, e);
+  shard->mem_used += mem_size;
+#ifdef MHD_USE_THREADS
+  MHD_mutex_unlock_chk_ (&shard->lock);
+#endif /* MHD_USE_THREADS */
+}
+
+
+void
+MHD_response_cache_get_stats_ (struct MHD_Daemon *daemon,
+                               uint64_t *hits,
+                               uint64_t *misses)
+{
+  unsigned int i;
+
+  daemon = MHD_get_master (daemon);
+  *hits = 0;
+  *misses = 0;
+  if (NULL == daemon->response_cache)
+    return;
+  for (i = 0; i < MHD_RESP_CACHE_SHARDS; i++)
+  {
+    struct MHD_RespCacheShard *const shard = daemon->response_cache + i;
+
+#ifdef MHD_USE_THREADS
+    MHD_mutex_lock_chk_ (&shard->lock);
+#endif /* MHD_USE_THREADS */
+    *hits += shard->hits;
+    *misses += shard->misses;
+#ifdef MHD_USE_THREADS
+    MHD_mutex_unlock_chk_ (&shard->lock);
+#endif /* MHD_USE_THREADS */
+  }
+}
+
+
+/* end of response_cache.c */
@@ -0,0 +1,95 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     This library is free software; you can redistribute it and/or
+     modify it under the terms of the GNU Lesser General Public
+     License as published by the Free Software Foundation; either
+     version 2.1 of the License, or (at your option) any later version.
+
+     This library is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     Lesser General Public License for more details.
+
+     You should have received a copy of the GNU Lesser General Public
+     License along with this library; if not, write to the Free Software
+     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+/**
+ * @file microhttpd/response_cache.h
+ * @brief  The cache of the responses in the daemon
+ */
+
+#ifndef MHD_RESPONSE_CACHE_H
+#define MHD_RESPONSE_CACHE_H 1
+
+#include "internal.h"
+
+
+/**
+ * Allocate and initialise the response cache, if the cache is enabled
+ * for the @a daemon.
+ *
+ * @param daemon the master daemon
+ * @return true on success (or if the cache is not enabled),
+ *         false if memory allocation or mutex initialisation failed
+ */
+bool
+MHD_response_cache_init_ (struct MHD_Daemon *daemon);
+
+
+/**
+ * Deinitialise the response cache, release the cached responses.
+ *
+ * @param daemon the master daemon
+ */
+void
+MHD_response_cache_deinit_ (struct MHD_Daemon *daemon);
+
+
+/**
+ * Find the cached response for the request.
+ *
+ * Only GET and HEAD requests without the body are checked, the request
+ * is checked only once.
+ *
+ * @param c the connection with the request
+ * @param[out] status_code the status code to use with the response
+ * @return the cached response with the reference counted for the caller,
+ *         NULL if not found
+ */
+struct MHD_Response *
+MHD_response_cache_lookup_ (struct MHD_Connection *c,
+                            unsigned int *status_code);
+
+
+/**
+ * Put the response to the cache, if the response has #MHD_RO_CACHE_TTL
+ * option and the request has been checked by MHD_response_cache_lookup_().
+ *
+ * @param c the connection with the request
+ * @param response the response queued by the application
+ * @param status_code the status code used with the @a response
+ */
+void
+MHD_response_cache_store_ (struct MHD_Connection *c,
+                           struct MHD_Response *response,
+                           unsigned int status_code);
+
+
+/**
+ * Get the statistics of the response cache.
+ *
+ * @param daemon the daemon (master or worker)
+ * @param[out] hits the number of requests answered from the cache
+ * @param[out] misses the number of checked requests not found in the cache
+ */
+void
+MHD_response_cache_get_stats_ (struct MHD_Daemon *daemon,
+                               uint64_t *hits,
+                               uint64_t *misses);
+
+#endif /* ! MHD_RESPONSE_CACHE_H */
@@ -0,0 +1,579 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     This library is free software; you can redistribute it and/or
+     modify it under the terms of the GNU Lesser General Public
+     License as published by the Free Software Foundation; either
+     version 2.1 of the License, or (at your option) any later version.
+
+     This library is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     Lesser General Public License for more details.
+
+     You should have received a copy of the GNU Lesser General Public
+     License along with this library; if not, write to the Free Software
+     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+/**
+ * @file microhttpd/response_compress.c
+ * @brief  On-the-fly compression of the reply body with "gzip" or "deflate"
+ *
+ * The compressed reply body is always sent with the chunked encoding.
+ * The data is compressed directly into the chunk space in the connection's
+ * write buffer, the buffer and iovec responses are compressed without
+ * intermediate copies.
+ *
+ * The compressor state is large (about 256 KiB), so the compressors are
+ * reused: every daemon (every worker daemon in the thread pool mode) keeps
+ * the list of idle compressors; with thread-per-connection mode the
+ * compressor is kept by the connection for the next replies.
+ */
+
+#include "response_compress.h"
+#include "response.h"
+#include "mhd_str.h"
+#include "mhd_compat.h"
+#include "mhd_assert.h"
+#include <zlib.h>
+
+
+/**
+ * The response bodies smaller than this size are never compressed
+ */
+#define MHD_RESP_COMPRESS_MIN_SIZE 256
+
+/**
+ * The maximum number of idle compressors of each type kept by the daemon
+ */
+#define MHD_RESP_COMPRESSORS_MAX_IDLE 8
+
+
+/**
+ * The compressor of the reply body
+ */
+struct MHD_RespCompressor
+{
+  /**
+   * The zlib stream
+   */
+  z_stream strm;
+
+  /**
+   * The next idle compressor in the daemon's list
+   */
+  struct MHD_RespCompressor *next;
+
+  /**
+   * The content coding produced by this compressor
+   */
+  enum MHD_RespEncoding_ encoding;
+
+  /**
+   * Set to true if some data has been given to the compressor since
+   * the last flush
+   */
+  bool unflushed;
+
+  /**
+   * Set to true if all response data has been given to the compressor
+   */
+  bool src_eof;
+
+  /**
+   * Set to true if the end of compressed stream has been produced
+   */
+  bool finished;
+};
+
+
+unsigned int
+MHD_resp_compress_enc_weight_ (const char *accept_enc,
+                               size_t accept_enc_len,
+                               enum MHD_RespEncoding_ encoding)
+{
+  int w;
+
+  switch (encoding)
+  {
+  case MHD_RESP_ENC_GZIP:
+    w = MHD_str_get_token_weight_ (accept_enc, accept_enc_len,
+                                   "gzip", MHD_STATICSTR_LEN_ ("gzip"));
+    if (0 > w)
+      w = MHD_str_get_token_weight_ (accept_enc, accept_enc_len,
+                                     "x-gzip", MHD_STATICSTR_LEN_ ("x-gzip"));
+    break;
+  case MHD_RESP_ENC_DEFLATE:
+    w = MHD_str_get_token_weight_ (accept_enc, accept_enc_len,
+                                   "deflate", MHD_STATICSTR_LEN_ ("deflate"));
+    break;
+  case MHD_RESP_ENC_IDENTITY:
+  default:
+    mhd_assert (0);
+    return 0;
+  }
+  if (0 > w)
+    w = MHD_str_get_token_weight_ (accept_enc, accept_enc_len,
+                                   "*", MHD_STATICSTR_LEN_ ("*"));
+  return (0 > w) ? 0 : (unsigned int) w;
+}
+
+
+/**
+ * Select the content coding accepted by the client.
+ *
+ * @param connection the connection to use
+ * @return the content coding to use
+ */
+static enum MHD_RespEncoding_
+select_accepted_encoding (struct MHD_Connection *connection)
+{
+  const char *value;
+  size_t value_len;
+  unsigned int q_gzip;
+  unsigned int q_deflate;
+
+  if (MHD_NO ==
+      MHD_lookup_connection_value_n (connection,
+                                     MHD_HEADER_KIND,
+                                     MHD_HTTP_HEADER_ACCEPT_ENCODING,
+                                     MHD_STATICSTR_LEN_ ( \
+                                       MHD_HTTP_HEADER_ACCEPT_ENCODING),
+                                     &value,
+                                     &value_len))
+    return MHD_RESP_ENC_IDENTITY;
+
+  q_gzip = MHD_resp_compress_enc_weight_ (value, value_len,
+                                          MHD_RESP_ENC_GZIP);
+  q_deflate = MHD_resp_compress_enc_weight_ (value, value_len,
+                                             MHD_RESP_ENC_DEFLATE);
+  if ( (0 != q_gzip) && (q_gzip >= q_deflate) )
+    return MHD_RESP_ENC_GZIP;
+  if (0 != q_deflate)
+    return MHD_RESP_ENC_DEFLATE;
+  return MHD_RESP_ENC_IDENTITY;
+}
+
+
+enum MHD_RespEncoding_
+MHD_resp_compress_select_ (struct MHD_Connection *connection)
+{
+  struct MHD_Connection *const c = connection; /**< a short alias */
+  struct MHD_Response *const r = c->rp.response; /**< a short alias */
+
+  mhd_assert (NULL != r);
+  if (0 == (r->flags & MHD_RF_COMPRESS))
+    return MHD_RESP_ENC_IDENTITY;
+  if ( (0 != (r->flags & (MHD_RF_HEAD_ONLY_RESPONSE
+                          | MHD_RF_HTTP_1_0_COMPATIBLE_STRICT
+                          | MHD_RF_HTTP_1_0_SERVER))) ||
+       (0 != (r->flags_auto & (MHD_RAF_HAS_CONTENT_LENGTH
+                               | MHD_RAF_HAS_TRANS_ENC_CHUNKED))) )
+    return MHD_RESP_ENC_IDENTITY;
+  /* The compressed body is sent with the chunked encoding only */
+  if (! MHD_IS_HTTP_VER_1_1_COMPAT (c->rq.http_ver))
+    return MHD_RESP_ENC_IDENTITY;
+  if ( (0 == r->total_size) ||
+       ((MHD_SIZE_UNKNOWN != r->total_size) &&
+        (MHD_RESP_COMPRESS_MIN_SIZE > r->total_size)) )
+    return MHD_RESP_ENC_IDENTITY;
+  if ( (NULL == r->crc) && (NULL == r->data_iov) )
+    return MHD_RESP_ENC_IDENTITY; /* Compressed once and cached, see
+                                     MHD_response_select_variant_() */
+#ifdef UPGRADE_SUPPORT
+  if (NULL != r->upgrade_handler)
+    return MHD_RESP_ENC_IDENTITY;
+#endif /* UPGRADE_SUPPORT */
+  if (NULL != MHD_get_response_element_n_ (r,
+                                           MHD_HEADER_KIND,
+                                           MHD_HTTP_HEADER_CONTENT_ENCODING,
+                                           MHD_STATICSTR_LEN_ ( \
+                                             MHD_HTTP_HEADER_CONTENT_ENCODING)))
+    return MHD_RESP_ENC_IDENTITY; /* Already encoded by the application */
+  return select_accepted_encoding (c);
+}
+
+
+const char *
+MHD_resp_compress_enc_name_ (enum MHD_RespEncoding_ encoding,
+                             size_t *name_len)
+{
+  switch (encoding)
+  {
+  case MHD_RESP_ENC_GZIP:
+    *name_len = MHD_STATICSTR_LEN_ ("gzip");
+    return "gzip";
+  case MHD_RESP_ENC_DEFLATE:
+    *name_len = MHD_STATICSTR_LEN_ ("deflate");
+    return "deflate";
+  case MHD_RESP_ENC_IDENTITY:
+  default:
+    break;
+  }
+  mhd_assert (0);
+  *name_len = MHD_STATICSTR_LEN_ ("identity");
+  return "identity";
+}
+
+
+char *
+MHD_resp_compress_buffer_ (struct MHD_Daemon *daemon,
+                           enum MHD_RespEncoding_ encoding,
+                           const char *data,
+                           size_t size,
+                           size_t *out_size)
+{
+  z_stream strm;
+  char *out;
+  uLong out_alloc;
+  int ret;
+
+  mhd_assert (MHD_RESP_ENC_IDENTITY != encoding);
+  if ( (MHD_RESP_COMPRESS_MIN_SIZE > size) ||
+       ((uInt) size != size) )
+    return NULL;
+  memset (&strm, 0, sizeof(strm));
+  if (Z_OK != deflateInit2 (&strm,
+                            (0 == daemon->compression_level) ?
+                            Z_DEFAULT_COMPRESSION :
+                            daemon->compression_level,
+                            Z_DEFLATED,
+                            (MHD_RESP_ENC_GZIP == encoding) ?
+                            (MAX_WBITS + 16) : MAX_WBITS,
+                            8,
+                            Z_DEFAULT_STRATEGY))
+    return NULL;
+  /* The compressed data larger than the original data is useless */
+  out_alloc = deflateBound (&strm, (uLong) size);
+  if (out_alloc >= size)
+    out_alloc = (uLong) size - 1;
+  out = (char *) malloc ((size_t) out_alloc);
+  if (NULL == out)
+  {
+    deflateEnd (&strm);
+    return NULL;
+  }
+  strm.next_in = (Bytef *) (void *) data;
+  strm.avail_in = (uInt) size;
+  strm.next_out = (Bytef *) (void *) out;
+  strm.avail_out = (uInt) out_alloc;
+  ret = deflate (&strm,
+                 Z_FINISH);
+  deflateEnd (&strm);
+  if (Z_STREAM_END != ret)
+  {
+    free (out);
+    return NULL;
+  }
+  *out_size = (size_t) (out_alloc - strm.avail_out);
+  return out;
+}
+
+
+/**
+ * Destroy the compressor.
+ *
+ * @param comp the compressor to destroy
+ */
+static void
+compressor_destroy (struct MHD_RespCompressor *comp)
+{
+  deflateEnd (&comp->strm);
+  free (comp);
+}
+
+
+/**
+ * Get the compressor for the current reply of the connection.
+ *
+ * @param connection the connection to use
+ * @return the compressor ready for the new stream, NULL on error
+ */
+static struct MHD_RespCompressor *
+compressor_acquire (struct MHD_Connection *connection)
+{
+  struct MHD_Daemon *const daemon = connection->daemon;
+  const enum MHD_RespEncoding_ enc = connection->rp.props.encoding;
+  struct MHD_RespCompressor *comp;
+
+  mhd_assert (MHD_RESP_ENC_IDENTITY != enc);
+  comp = connection->compressor;
+  if (NULL != comp)
+  {
+    /* Kept from the previous reply (thread-per-connection mode) */
+    if (enc == comp->encoding)
+      return comp;
+    compressor_destroy (comp);
+    connection->compressor = NULL;
+  }
+  if (NULL != daemon->compressors[enc])
+  {
+    comp = daemon->compressors[enc];
+    daemon->compressors[enc] = comp->next;
+    daemon->compressors_num[enc]--;
+    comp->next = NULL;
+    connection->compressor = comp;
+    return comp;
+  }
+  comp = (struct MHD_RespCompressor *) MHD_calloc_ (1, sizeof(*comp));
+  if (NULL == comp)
+    return NULL;
+  comp->encoding = enc;
+  comp->strm.zalloc = Z_NULL;
+  comp->strm.zfree = Z_NULL;
+  comp->strm.opaque = Z_NULL;
+  if (Z_OK != deflateInit2 (&comp->strm,
+                            (0 == daemon->compression_level) ?
+                            Z_DEFAULT_COMPRESSION :
+                            daemon->compression_level,
+                            Z_DEFLATED,
+                            (MHD_RESP_ENC_GZIP == enc) ?
+                            (MAX_WBITS + 16) : MAX_WBITS,
+                            8,
+                            Z_DEFAULT_STRATEGY))
+  {
+    free (comp);
+    return NULL;
+  }
+  connection->compressor = comp;
+  return comp;
+}
+
+
+/**
+ * Get the next portion of the response data at the current write position.
+ *
+ * @param connection the connection to use
+ * @param[out] src set to the pointer to the data
+ * @return the size of the data available at the @a src,
+ *         zero or #MHD_CONTENT_READER_PENDING if data is not ready yet,
+ *         #MHD_CONTENT_READER_END_OF_STREAM at the end of the response data,
+ *         #MHD_CONTENT_READER_END_WITH_ERROR on error
+ */
+static ssize_t
+get_response_data (struct MHD_Connection *connection,
+                   const char **src)
+{
+  struct MHD_Response *const r = connection->rp.response;
+  const uint64_t pos = connection->rp.rsp_write_position;
+  size_t size;
+  ssize_t ret;
+
+  if ( (MHD_SIZE_UNKNOWN != r->total_size) &&
+       (pos >= r->total_size) )
+    return MHD_CONTENT_READER_END_OF_STREAM;
+  if (NULL != r->data_iov)
+  {
+    uint64_t off = pos;
+    unsigned int i;
+
+    for (i = 0; i < r->data_iovcnt; ++i)
+    {
+      if (off < r->data_iov[i].iov_len)
+      {
+        size = (size_t) (r->data_iov[i].iov_len - off);
+        if (SSIZE_MAX < size)
+          size = SSIZE_MAX;
+        *src = ((const char *) r->data_iov[i].iov_base) + (size_t) off;
+        return (ssize_t) size;
+      }
+      off -= r->data_iov[i].iov_len;
+    }
+    return MHD_CONTENT_READER_END_OF_STREAM;
+  }
+  if ( (r->data_start <= pos) &&
+       (r->data_start + r->data_size > pos) )
+  {
+    const size_t offset = (size_t) (pos - r->data_start);
+
+    size = r->data_size - offset;
+    if (SSIZE_MAX < size)
+      size = SSIZE_MAX;
+    *src = r->data + offset;
+    return (ssize_t) size;
+  }
+  if (NULL == r->crc)
+    return MHD_CONTENT_READER_END_OF_STREAM;
+  /* Read the data to the response's buffer, like for non-compressed
+     replies */
+  size = r->data_buffer_size;
+  if ( (MHD_SIZE_UNKNOWN != r->total_size) &&
+       (r->total_size - pos < size) )
+    size = (size_t) (r->total_size - pos);
+  ret = r->crc (r->crc_cls,
+                pos,
+                (char *) r->data,
+                size);
+  if (0 > ret)
+    return ret;
+  if ((size_t) ret > size)
+    return MHD_CONTENT_READER_END_WITH_ERROR;
+  r->data_start = pos;
+  r->data_size = (size_t) ret;
+  *src = r->data;
+  return ret;
+}
+
+
+ssize_t
+MHD_resp_compress_fill_ (struct MHD_Connection *connection,
+                         char *buf,
+                         size_t size)
+{
+  struct MHD_RespCompressor *comp;
+  z_stream *strm;
+  bool pending;
+
+  mhd_assert (MHD_RESP_ENC_IDENTITY != connection->rp.props.encoding);
+  comp = connection->compressor;
+  if ( (NULL == comp) ||
+       (comp->encoding != connection->rp.props.encoding) )
+  {
+    comp = compressor_acquire (connection);
+    if (NULL == comp)
+      return MHD_CONTENT_READER_END_WITH_ERROR;
+  }
+  if (comp->finished)
+    return MHD_CONTENT_READER_END_OF_STREAM;
+  strm = &comp->strm;
+  pending = false;
+  if ((uInt) size != size)
+    size = (size_t) ((uInt) ~((uInt) 0));
+  strm->next_out = (Bytef *) (void *) buf;
+  strm->avail_out = (uInt) size;
+  while (0 != strm->avail_out)
+  {
+    const char *src = NULL;
+    size_t src_size = 0;
+    int flush = Z_NO_FLUSH;
+    uInt in_size;
+    int ret;
+
+    if (! comp->src_eof)
+    {
+      const ssize_t res = get_response_data (connection,
+                                             &src);
+      if (MHD_CONTENT_READER_END_WITH_ERROR == res)
+        return MHD_CONTENT_READER_END_WITH_ERROR;
+      if (MHD_CONTENT_READER_END_OF_STREAM == res)
+      {
+        comp->src_eof = true;
+        connection->rp.response->total_size =
+          connection->rp.rsp_write_position;
+      }
+      else if ( (0 == res) ||
+                (MHD_CONTENT_READER_PENDING == res) )
+      {
+        pending = (MHD_CONTENT_READER_PENDING == res);
+        /* No response data yet, give the already compressed data to
+           the client */
+        if (! comp->unflushed)
+          break;
+        flush = Z_SYNC_FLUSH;
+      }
+      else
+        src_size = (size_t) res;
+    }
+    if (comp->src_eof)
+      flush = Z_FINISH;
+
+    in_size = (uInt) src_size;
+    if (in_size != src_size)
+      in_size = (uInt) ~((uInt) 0);
+    strm->next_in = (Bytef *) (void *) src;
+    strm->avail_in = in_size;
+    ret = deflate (strm,
+                   flush);
+    if (Z_STREAM_ERROR == ret)
+      return MHD_CONTENT_READER_END_WITH_ERROR;
+    if (in_size != strm->avail_in)
+    {
+      connection->rp.rsp_write_position += in_size - strm->avail_in;
+      comp->unflushed = true;
+    }
+    strm->next_in = Z_NULL;
+    strm->avail_in = 0;
+    if (Z_STREAM_END == ret)
+    {
+      comp->finished = true;
+      break;
+    }
+    if (Z_SYNC_FLUSH == flush)
+    {
+      if (0 != strm->avail_out)
+        comp->unflushed = false; /* All pending data has been flushed */
+      break;
+    }
+    if (Z_BUF_ERROR == ret)
+      break; /* No progress possible */
+  }
+  if (size == strm->avail_out)
+  {
+    if (comp->finished)
+      return MHD_CONTENT_READER_END_OF_STREAM;
+    return pending ? MHD_CONTENT_READER_PENDING : 0;
+  }
+  return (ssize_t) (size - strm->avail_out);
+}
+
+
+bool
+MHD_resp_compress_is_finished_ (struct MHD_Connection *connection)
+{
+  return (NULL != connection->compressor) &&
+         (connection->compressor->finished);
+}
+
+
+void
+MHD_resp_compress_release_ (struct MHD_Connection *connection,
+                            bool closing)
+{
+  struct MHD_Daemon *const daemon = connection->daemon;
+  struct MHD_RespCompressor *const comp = connection->compressor;
+  enum MHD_RespEncoding_ enc;
+
+  if (NULL == comp)
+    return;
+  enc = comp->encoding;
+  if ( (Z_OK != deflateReset (&comp->strm)) ||
+       (MHD_D_IS_USING_THREAD_PER_CONN_ (daemon) && closing) ||
+       ((! MHD_D_IS_USING_THREAD_PER_CONN_ (daemon)) &&
+        (MHD_RESP_COMPRESSORS_MAX_IDLE <= daemon->compressors_num[enc])) )
+  {
+    compressor_destroy (comp);
+    connection->compressor = NULL;
+    return;
+  }
+  comp->unflushed = false;
+  comp->src_eof = false;
+  comp->finished = false;
+  if (MHD_D_IS_USING_THREAD_PER_CONN_ (daemon))
+    return; /* Keep the compressor for the next reply */
+  comp->next = daemon->compressors[enc];
+  daemon->compressors[enc] = comp;
+  daemon->compressors_num[enc]++;
+  connection->compressor = NULL;
+}
+
+
+void
+MHD_resp_compress_pool_free_ (struct MHD_Daemon *daemon)
+{
+  unsigned int i;
+
+  for (i = 0; i < MHD_RESP_ENC_TABLE_SIZE; ++i)
+  {
+    while (NULL != daemon->compressors[i])
+    {
+      struct MHD_RespCompressor *const comp = daemon->compressors[i];
+
+      daemon->compressors[i] = comp->next;
+      compressor_destroy (comp);
+    }
+    daemon->compressors_num[i] = 0;
+  }
+}
@@ -0,0 +1,153 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     This library is free software; you can redistribute it and/or
+     modify it under the terms of the GNU Lesser General Public
+     License as published by the Free Software Foundation; either
+     version 2.1 of the License, or (at your option) any later version.
+
+     This library is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     Lesser General Public License for more details.
+
+     You should have received a copy of the GNU Lesser General Public
+     License along with this library; if not, write to the Free Software
+     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+/**
+ * @file microhttpd/response_compress.h
+ * @brief  On-the-fly compression of the reply body
+ */
+
+#ifndef MHD_RESPONSE_COMPRESS_H
+#define MHD_RESPONSE_COMPRESS_H 1
+
+#include "internal.h"
+
+#ifdef RESPONSE_COMPRESSION_SUPPORT
+
+/**
+ * Select the content coding for the reply body.
+ *
+ * The reply body is compressed only if the response has
+ * #MHD_RF_COMPRESS flag, the response has no "Content-Encoding" and
+ * no "Content-Length" headers set by the application, the response body
+ * is not too small and the client accepts "gzip" or "deflate" coding.
+ * The buffer-based responses are never compressed on the fly, they are
+ * compressed once and the result is cached by the response.
+ *
+ * @param connection the connection to use, the response must be set
+ * @return the content coding to use
+ */
+enum MHD_RespEncoding_
+MHD_resp_compress_select_ (struct MHD_Connection *connection);
+
+
+/**
+ * Get the weight of the content coding in the "Accept-Encoding" header.
+ *
+ * @param accept_enc the value of the "Accept-Encoding" header
+ * @param accept_enc_len the length of the @a accept_enc
+ * @param encoding the content coding, must not be #MHD_RESP_ENC_IDENTITY
+ * @return the weight in thousandths (0 - 1000), zero if the coding is
+ *         not acceptable
+ */
+unsigned int
+MHD_resp_compress_enc_weight_ (const char *accept_enc,
+                               size_t accept_enc_len,
+                               enum MHD_RespEncoding_ encoding);
+
+
+/**
+ * Get the name of the content coding.
+ *
+ * @param encoding the content coding, must not be #MHD_RESP_ENC_IDENTITY
+ * @param[out] name_len set to the length of the name
+ * @return the name of the content coding
+ */
+const char *
+MHD_resp_compress_enc_name_ (enum MHD_RespEncoding_ encoding,
+                             size_t *name_len);
+
+
+/**
+ * Compress the whole buffer.
+ *
+ * @param daemon the daemon to use (for the compression settings)
+ * @param encoding the content coding, must not be #MHD_RESP_ENC_IDENTITY
+ * @param data the data to compress
+ * @param size the size of the @a data
+ * @param[out] out_size set to the size of the compressed data
+ * @return the malloc()'ed compressed data,
+ *         NULL if the data is too small, the compressed data is not
+ *         smaller than the original data or on error
+ */
+char *
+MHD_resp_compress_buffer_ (struct MHD_Daemon *daemon,
+                           enum MHD_RespEncoding_ encoding,
+                           const char *data,
+                           size_t size,
+                           size_t *out_size);
+
+
+/**
+ * Compress the next portion of the reply body.
+ *
+ * The response data is taken at the current write position of the reply,
+ * the position is advanced by the amount of the data consumed by
+ * the compressor.  Callback-based responses are read into the response's
+ * buffer, the response mutex must be held by the caller in this case.
+ *
+ * @param connection the connection to use
+ * @param[out] buf the buffer to put the compressed data to
+ * @param size the size of the @a buf
+ * @return the size of the compressed data put to the @a buf,
+ *         zero if response data is not ready yet,
+ *         #MHD_CONTENT_READER_PENDING if the application has not
+ *         provided the data yet,
+ *         #MHD_CONTENT_READER_END_OF_STREAM if the compressed stream is
+ *         finished,
+ *         #MHD_CONTENT_READER_END_WITH_ERROR on error
+ */
+ssize_t
+MHD_resp_compress_fill_ (struct MHD_Connection *connection,
+                         char *buf,
+                         size_t size);
+
+
+/**
+ * Check whether the compressed reply body is complete.
+ *
+ * @param connection the connection to use
+ * @return true if the end of the compressed stream has been produced
+ */
+bool
+MHD_resp_compress_is_finished_ (struct MHD_Connection *connection);
+
+
+/**
+ * Release the compressor of the connection.
+ *
+ * @param connection the connection to use
+ * @param closing set to true if the connection is being closed
+ */
+void
+MHD_resp_compress_release_ (struct MHD_Connection *connection,
+                            bool closing);
+
+
+/**
+ * Free all idle compressors kept by the daemon.
+ *
+ * @param daemon the daemon (or the worker daemon) to use
+ */
+void
+MHD_resp_compress_pool_free_ (struct MHD_Daemon *daemon);
+
+#endif /* RESPONSE_COMPRESSION_SUPPORT */
+
+#endif /* ! MHD_RESPONSE_COMPRESS_H */
@@ -0,0 +1,979 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     This library is free software; you can redistribute it and/or
+     modify it under the terms of the GNU Lesser General Public
+     License as published by the Free Software Foundation; either
+     version 2.1 of the License, or (at your option) any later version.
+
+     This library is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     Lesser General Public License for more details.
+
+     You should have received a copy of the GNU Lesser General Public
+     License along with this library; if not, write to the Free Software
+     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+/**
+ * @file microhttpd/response_range.c
+ * @brief  Automatic processing of the "Range" requests
+ *
+ * The partial reply is sent by the new response derived from the response
+ * queued by the application.  The ranges of the memory-based responses
+ * are sent as an array of buffers pointing to the data of the base
+ * response, the single range of the file-based response is sent as
+ * the file response with the adjusted offset (by sendfile() when
+ * possible), several ranges of the file-based response are read by
+ * the callback.
+ */
+
+#include "response_range.h"
+#include "response.h"
+#include "mhd_str.h"
+#include "mhd_mono_clock.h"
+#include "mhd_locks.h"
+#include "mhd_compat.h"
+#include "mhd_assert.h"
+
+
+/**
+ * The maximum number of the ranges in one request.
+ * The "Range" header with more ranges is ignored.
+ */
+#define MHD_RANGES_MAX_NUM 16
+
+/**
+ * The prefix of the boundary of the "multipart/byteranges" body
+ */
+#define MHD_RANGE_BOUNDARY_PREFIX "MHD-byteranges-"
+
+/**
+ * The length of the boundary of the "multipart/byteranges" body
+ */
+#define MHD_RANGE_BOUNDARY_LEN \
+  (MHD_STATICSTR_LEN_ (MHD_RANGE_BOUNDARY_PREFIX) + 16)
+
+/**
+ * The maximum number of the attempts to select the boundary not found in
+ * the data of the parts
+ */
+#define MHD_RANGE_BOUNDARY_TRIES 4
+
+/**
+ * The maximum length of the "Content-Range" value
+ * ("bytes " + 3 numbers + 2 separators)
+ */
+#define MHD_CONTENT_RANGE_MAX_LEN (6 + 3 * 20 + 2)
+
+
+/**
+ * The part of the reply body
+ */
+struct MHD_RangePart_
+{
+  /**
+   * The offset of the part in the body of the base response
+   */
+  uint64_t start;
+
+  /**
+   * The length of the part
+   */
+  uint64_t len;
+
+  /**
+   * The offset of the part headers in the @a hdrs buffer
+   * (for "multipart/byteranges" body only)
+   */
+  size_t hdr_off;
+
+  /**
+   * The length of the part headers
+   */
+  size_t hdr_len;
+};
+
+
+/**
+ * The set of the ranges requested by the client
+ */
+struct MHD_Ranges_
+{
+  /**
+   * The base response, used by the reader of the ranges of
+   * the file-based response
+   */
+  struct MHD_Response *src;
+
+  /**
+   * The malloc()'ed headers of the parts and the final boundary of
+   * "multipart/byteranges" body, NULL if the single range is sent
+   */
+  char *hdrs;
+
+  /**
+   * The offset of the final boundary in the @a hdrs buffer
+   */
+  size_t closing_off;
+
+  /**
+   * The length of the final boundary
+   */
+  size_t closing_len;
+
+  /**
+   * The number of the @a parts
+   */
+  unsigned int num;
+
+  /**
+   * The requested parts of the body
+   */
+  struct MHD_RangePart_ parts[MHD_RANGES_MAX_NUM];
+};
+
+
+/**
+ * The result of the "Range" header parsing
+ */
+enum MHD_RangeParseResult_
+{
+  /**
+   * The header must be ignored, the full body is sent
+   */
+  MHD_RANGE_PARSE_IGNORE = 0,
+
+  /**
+   * None of the ranges can be satisfied
+   */
+  MHD_RANGE_PARSE_UNSATISFIABLE,
+
+  /**
+   * At least one range can be satisfied
+   */
+  MHD_RANGE_PARSE_OK
+};
+
+
+bool
+MHD_response_is_rangeable_ (struct MHD_Response *response)
+{
+  if (0 == (response->flags & MHD_RF_ACCEPT_RANGES))
+    return false;
+  if (0 != (response->flags & MHD_RF_HEAD_ONLY_RESPONSE))
+    return false;
+  if (0 != (response->flags_auto & (MHD_RAF_HAS_CONTENT_LENGTH
+                                    | MHD_RAF_HAS_TRANS_ENC_CHUNKED)))
+    return false;
+  if (MHD_SIZE_UNKNOWN == response->total_size)
+    return false;
+#ifdef UPGRADE_SUPPORT
+  if (NULL != response->upgrade_handler)
+    return false;
+#endif /* UPGRADE_SUPPORT */
+  /* Only the file-based callback responses support random access */
+  if ( (NULL != response->crc) &&
+       ((-1 == response->fd) || response->is_pipe) )
+    return false;
+  if (NULL != MHD_get_response_element_n_ (response, MHD_HEADER_KIND,
+                                           MHD_HTTP_HEADER_CONTENT_RANGE,
+                                           MHD_STATICSTR_LEN_ ( \
+                                             MHD_HTTP_HEADER_CONTENT_RANGE)))
+    return false;
+  return true;
+}
+
+
+/**
+ * Parse the value of the "Range" header (RFC 9110, section 14.2).
+ *
+ * The unsatisfiable ranges are skipped, the satisfiable ranges are
+ * clamped to the size of the body.
+ *
+ * @param str the value of the header
+ * @param len the length of the @a str
+ * @param size the size of the body
+ * @param[out] rs the ranges to fill
+ * @return the result of the parsing
+ */
+static enum MHD_RangeParseResult_
+parse_ranges (const char *str,
+              size_t len,
+              uint64_t size,
+              struct MHD_Ranges_ *rs)
+{
+  uint64_t total;
+  size_t i;
+  bool has_spec;
+
+  if ( (MHD_STATICSTR_LEN_ ("bytes=") > len) ||
+       (! MHD_str_equal_caseless_bin_n_ ("bytes=", str,
+                                         MHD_STATICSTR_LEN_ ("bytes="))) )
+    return MHD_RANGE_PARSE_IGNORE; /* Unsupported range unit */
+  total = 0;
+  has_spec = false;
+  rs->num = 0;
+  i = MHD_STATICSTR_LEN_ ("bytes=");
+  while (i < len)
+  {
+    uint64_t first;
+    uint64_t last;
+    bool has_first;
+    bool has_last;
+    size_t num_len;
+
+    if ((',' == str[i]) || (' ' == str[i]) || ('\t' == str[i]))
+    {
+      i++; /* Empty list elements are allowed */
+      continue;
+    }
+    has_first = ('-' != str[i]);
+    if (has_first)
+    {
+      num_len = MHD_str_to_uint64_n_ (str + i, len - i, &first);
+      if (0 == num_len)
+        return MHD_RANGE_PARSE_IGNORE;
+      i += num_len;
+    }
+    if ((i >= len) || ('-' != str[i]))
+      return MHD_RANGE_PARSE_IGNORE;
+    i++;
+    has_last = (i < len) && ('0' <= str[i]) && ('9' >= str[i]);
+    if (has_last)
+    {
+      num_len = MHD_str_to_uint64_n_ (str + i, len - i, &last);
+      if (0 == num_len)
+        return MHD_RANGE_PARSE_IGNORE; /* Too large number */
+      i += num_len;
+    }
+    while ((i < len) && ((' ' == str[i]) || ('\t' == str[i])))
+      i++;
+    if ((i < len) && (',' != str[i]))
+      return MHD_RANGE_PARSE_IGNORE;
+    has_spec = true;
+
+    if (! has_first)
+    {
+      if (! has_last)
+        return MHD_RANGE_PARSE_IGNORE;
+      /* The suffix range: the last bytes of the body */
+      if ((0 == last) || (0 == size))
+        continue; /* Unsatisfiable range */
+      if (last > size)
+        last = size;
+      first = size - last;
+      last = size - 1;
+    }
+    else
+    {
+      if (has_last && (last < first))
+        return MHD_RANGE_PARSE_IGNORE; /* Invalid range */
+      if (first >= size)
+        continue; /* Unsatisfiable range */
+      if ((! has_last) || (last >= size))
+        last = size - 1;
+    }
+    if (MHD_RANGES_MAX_NUM == rs->num)
+      return MHD_RANGE_PARSE_IGNORE; /* Too many ranges */
+    rs->parts[rs->num].start = first;
+    rs->parts[rs->num].len = last - first + 1;
+    total += rs->parts[rs->num].len;
+    /* The overlapped ranges must not amplify the reply */
+    if (total > size)
+      return MHD_RANGE_PARSE_IGNORE;
+    rs->num++;
+  }
+  if (! has_spec)
+    return MHD_RANGE_PARSE_IGNORE;
+  return (0 == rs->num) ?
+         MHD_RANGE_PARSE_UNSATISFIABLE : MHD_RANGE_PARSE_OK;
+}
+
+
+/**
+ * Check the "If-Range" request header (RFC 9110, section 13.1.5).
+ *
+ * @param connection the connection to use
+ * @param response the response to use
+ * @return true if the "Range" header should be processed,
+ *         false if the full body must be sent
+ */
+static bool
+check_if_range (struct MHD_Connection *connection,
+                struct MHD_Response *response)
+{
+  const char *cond;
+  size_t cond_len;
+  const struct MHD_HTTP_Res_Header *hdr;
+
+  if (MHD_NO ==
+      MHD_lookup_connection_value_n (connection,
+                                     MHD_HEADER_KIND,
+                                     MHD_HTTP_HEADER_IF_RANGE,
+                                     MHD_STATICSTR_LEN_ ( \
+                                       MHD_HTTP_HEADER_IF_RANGE),
+                                     &cond,
+                                     &cond_len))
+    return true;
+  if ((0 != cond_len) && ('"' == cond[0]))
+    hdr = MHD_get_response_element_n_ (response, MHD_HEADER_KIND,
+                                       MHD_HTTP_HEADER_ETAG,
+                                       MHD_STATICSTR_LEN_ ( \
+                                         MHD_HTTP_HEADER_ETAG));
+  else if ((2 <= cond_len) && ('W' == cond[0]) && ('/' == cond[1]))
+    return false; /* The weak entity-tag never matches */
+  else
+    hdr = MHD_get_response_element_n_ (response, MHD_HEADER_KIND,
+                                       MHD_HTTP_HEADER_LAST_MODIFIED,
+                                       MHD_STATICSTR_LEN_ ( \
+                                         MHD_HTTP_HEADER_LAST_MODIFIED));
+  if (NULL == hdr)
+    return false;
+  return (hdr->value_size == cond_len) &&
+         (0 == memcmp (hdr->value, cond, cond_len));
+}
+
+
+/**
+ * Print the value of the "Content-Range" header for the range.
+ *
+ * @param start the first byte of the range
+ * @param len the length of the range
+ * @param size the size of the body
+ * @param[out] buf the buffer to print to, at least
+ *                 #MHD_CONTENT_RANGE_MAX_LEN bytes
+ * @return the length of the printed value
+ */
+static size_t
+print_content_range (uint64_t start,
+                     uint64_t len,
+                     uint64_t size,
+                     char *buf)
+{
+  size_t pos;
+
+  memcpy (buf, "bytes ", MHD_STATICSTR_LEN_ ("bytes "));
+  pos = MHD_STATICSTR_LEN_ ("bytes ");
+  pos += MHD_uint64_to_str (start, buf + pos,
+                            MHD_CONTENT_RANGE_MAX_LEN - pos);
+  buf[pos++] = '-';
+  pos += MHD_uint64_to_str (start + len - 1, buf + pos,
+                            MHD_CONTENT_RANGE_MAX_LEN - pos);
+  buf[pos++] = '/';
+  pos += MHD_uint64_to_str (size, buf + pos,
+                            MHD_CONTENT_RANGE_MAX_LEN - pos);
+  mhd_assert (MHD_CONTENT_RANGE_MAX_LEN >= pos);
+  return pos;
+}
+
+
+/**
+ * Build the headers of the parts of the "multipart/byteranges" body.
+ *
+ * @param response the base response
+ * @param rs the ranges to use
+ * @param boundary the boundary, #MHD_RANGE_BOUNDARY_LEN bytes
+ * @param[out] body_size set to the size of the multipart body
+ * @return true on success, false if out of memory
+ */
+static bool
+build_part_headers (struct MHD_Response *response,
+                    struct MHD_Ranges_ *rs,
+                    const char *boundary,
+                    uint64_t *body_size)
+{
+  const struct MHD_HTTP_Res_Header *ctype;
+  size_t ctype_len;
+  size_t buf_size;
+  size_t pos;
+  uint64_t total;
+  unsigned int i;
+
+  ctype = MHD_get_response_element_n_ (response, MHD_HEADER_KIND,
+                                       MHD_HTTP_HEADER_CONTENT_TYPE,
+                                       MHD_STATICSTR_LEN_ ( \
+                                         MHD_HTTP_HEADER_CONTENT_TYPE));
+  ctype_len = (NULL == ctype) ? 0 : ctype->value_size;
+  /* CRLF "--" boundary CRLF "Content-Type: " value CRLF
+     "Content-Range: " value CRLF CRLF */
+  buf_size = rs->num * (MHD_RANGE_BOUNDARY_LEN + ctype_len
+                        + MHD_CONTENT_RANGE_MAX_LEN + 48)
+             + MHD_RANGE_BOUNDARY_LEN + 8;
+  rs->hdrs = (char *) malloc (buf_size);
+  if (NULL == rs->hdrs)
+    return false;
+
+  pos = 0;
+  total = 0;
+  for (i = 0; i < rs->num; ++i)
+  {
+    struct MHD_RangePart_ *const p = rs->parts + i;
+
+    p->hdr_off = pos;
+    if (0 != i)
+    {
+      rs->hdrs[pos++] = '\r';
+      rs->hdrs[pos++] = '\n';
+    }
+    rs->hdrs[pos++] = '-';
+    rs->hdrs[pos++] = '-';
+    memcpy (rs->hdrs + pos, boundary, MHD_RANGE_BOUNDARY_LEN);
+    pos += MHD_RANGE_BOUNDARY_LEN;
+    rs->hdrs[pos++] = '\r';
+    rs->hdrs[pos++] = '\n';
+    if (NULL != ctype)
+    {
+      memcpy (rs->hdrs + pos, MHD_HTTP_HEADER_CONTENT_TYPE ": ",
+              MHD_STATICSTR_LEN_ (MHD_HTTP_HEADER_CONTENT_TYPE ": "));
+      pos += MHD_STATICSTR_LEN_ (MHD_HTTP_HEADER_CONTENT_TYPE ": ");
+      memcpy (rs->hdrs + pos, ctype->value, ctype_len);
+      pos += ctype_len;
+      rs->hdrs[pos++] = '\r';
+      rs->hdrs[pos++] = '\n';
+    }
+    memcpy (rs->hdrs + pos, MHD_HTTP_HEADER_CONTENT_RANGE ": ",
+            MHD_STATICSTR_LEN_ (MHD_HTTP_HEADER_CONTENT_RANGE ": "));
+    pos += MHD_STATICSTR_LEN_ (MHD_HTTP_HEADER_CONTENT_RANGE ": ");
+    pos += print_content_range (p->start, p->len, response->total_size,
+                                rs->hdrs + pos);
+    memcpy (rs->hdrs + pos, "\r\n\r\n", 4);
+    pos += 4;
+    p->hdr_len = pos - p->hdr_off;
+    total += p->hdr_len + p->len;
+  }
+  rs->closing_off = pos;
+  memcpy (rs->hdrs + pos, "\r\n--", 4);
+  pos += 4;
+  memcpy (rs->hdrs + pos, boundary, MHD_RANGE_BOUNDARY_LEN);
+  pos += MHD_RANGE_BOUNDARY_LEN;
+  memcpy (rs->hdrs + pos, "--\r\n", 4);
+  pos += 4;
+  rs->closing_len = pos - rs->closing_off;
+  mhd_assert (buf_size >= pos);
+  *body_size = total + rs->closing_len;
+  return true;
+}
+
+
+/**
+ * Put the buffers with the range of the memory-based response body to
+ * the array.
+ *
+ * @param response the memory-based response
+ * @param start the offset of the range
+ * @param len the length of the range
+ * @param[out] iov the array to fill
+ * @return the number of the elements put to the @a iov
+ */
+static unsigned int
+add_body_slices (const struct MHD_Response *response,
+                 uint64_t start,
+                 uint64_t len,
+                 struct MHD_IoVec *iov)
+{
+  unsigned int num;
+  unsigned int i;
+
+  if (NULL == response->data_iov)
+  {
+    iov[0].iov_base = response->data + (size_t) start;
+    iov[0].iov_len = (size_t) len;
+    return 1;
+  }
+  num = 0;
+  for (i = 0; (i < response->data_iovcnt) && (0 != len); ++i)
+  {
+    const size_t el_size = (size_t) response->data_iov[i].iov_len;
+    size_t chunk;
+
+    if (start >= el_size)
+    {
+      start -= el_size;
+      continue;
+    }
+    chunk = el_size - (size_t) start;
+    if (chunk > len)
+      chunk = (size_t) len;
+    iov[num].iov_base = (const char *) response->data_iov[i].iov_base
+                        + (size_t) start;
+    iov[num].iov_len = chunk;
+    num++;
+    len -= chunk;
+    start = 0;
+  }
+  return num;
+}
+
+
+/**
+ * Check whether the ranges of the memory-based response body contain
+ * the boundary.
+ *
+ * @param response the memory-based response
+ * @param rs the ranges to check
+ * @param boundary the boundary, #MHD_RANGE_BOUNDARY_LEN bytes
+ * @return true if the boundary is found or the data cannot be checked,
+ *         false otherwise
+ */
+static bool
+ranges_have_boundary (const struct MHD_Response *response,
+                      const struct MHD_Ranges_ *rs,
+                      const char *boundary)
+{
+  struct MHD_IoVec *iov;
+  unsigned int max_slices;
+  unsigned int i;
+  bool found;
+
+  max_slices = (NULL == response->data_iov) ? 1 : response->data_iovcnt;
+  iov = (struct MHD_IoVec *) malloc (sizeof(struct MHD_IoVec) * max_slices);
+  if (NULL == iov)
+    return true;
+  found = false;
+  for (i = 0; (i < rs->num) && ! found; ++i)
+  {
+    const struct MHD_RangePart_ *const p = rs->parts + i;
+    unsigned int num;
+    unsigned int j;
+    size_t matched;
+
+    num = add_body_slices (response, p->start, p->len, iov);
+    matched = 0;
+    for (j = 0; (j < num) && ! found; ++j)
+    {
+      const char *const data = (const char *) iov[j].iov_base;
+      const size_t len = iov[j].iov_len;
+      size_t k;
+
+      k = 0;
+      while (k < len)
+      {
+        if (0 == matched)
+        {
+          const char *const m = (const char *) memchr (data + k, boundary[0],
+                                                       len - k);
+          if (NULL == m)
+            break;
+          k = (size_t) (m - data) + 1;
+          matched = 1;
+        }
+        else if (boundary[matched] == data[k])
+        {
+          k++;
+          if (MHD_RANGE_BOUNDARY_LEN == ++matched)
+          {
+            found = true;
+            break;
+          }
+        }
+        else
+          matched = 0; /* The first character of the boundary is not
+                          repeated in the boundary, re-check this byte */
+      }
+    }
+  }
+  free (iov);
+  return found;
+}
+
+
+/**
+ * Select the boundary of the "multipart/byteranges" body.
+ *
+ * The boundary is not random and could be guessed, it only must not be
+ * found in the data of the parts (RFC 2046, Section 5.1.1).  The data of
+ * the memory-based bodies is checked and other boundary is tried in case
+ * of the collision.  The data of other bodies is not known in advance,
+ * the collision is just unlikely.
+ *
+ * @param response the base response
+ * @param rs the ranges to use
+ * @param[out] boundary the buffer for the boundary, at least
+ *                      #MHD_RANGE_BOUNDARY_LEN bytes
+ * @return true on success, false if no boundary could be used
+ */
+static bool
+select_boundary (const struct MHD_Response *response,
+                 const struct MHD_Ranges_ *rs,
+                 char *boundary)
+{
+  uint64_t rnd;
+  unsigned int i;
+
+  /* The hexadecimal digits never match the first character of
+     the prefix, the check of the data relies on it */
+  mhd_assert ('M' == MHD_RANGE_BOUNDARY_PREFIX[0]);
+  rnd = MHD_monotonic_msec_counter ()
+        ^ (((uint64_t) (uintptr_t) rs) * 0x9E3779B97F4A7C15ULL);
+  memcpy (boundary, MHD_RANGE_BOUNDARY_PREFIX,
+          MHD_STATICSTR_LEN_ (MHD_RANGE_BOUNDARY_PREFIX));
+  for (i = 0; i < MHD_RANGE_BOUNDARY_TRIES; ++i)
+  {
+    MHD_bin_to_hex (&rnd, sizeof(rnd),
+                    boundary + MHD_STATICSTR_LEN_ (MHD_RANGE_BOUNDARY_PREFIX));
+    if ( (NULL != response->crc) ||
+         ! ranges_have_boundary (response, rs, boundary) )
+      return true;
+    rnd = rnd * 6364136223846793005ULL + 1442695040888963407ULL;
+  }
+  return false;
+}
+
+
+/**
+ * Create the response with the ranges of the memory-based response.
+ * The data is not copied.
+ *
+ * @param response the memory-based response
+ * @param rs the ranges to use, freed by this function
+ * @return the new response, NULL on error
+ */
+static struct MHD_Response *
+create_memory_ranges (struct MHD_Response *response,
+                      struct MHD_Ranges_ *rs)
+{
+  struct MHD_Response *r;
+  struct MHD_IoVec *iov;
+  unsigned int max_slices;
+  unsigned int num;
+  unsigned int i;
+
+  max_slices = (NULL == response->data_iov) ? 1 : response->data_iovcnt;
+  iov = (struct MHD_IoVec *) malloc (sizeof(struct MHD_IoVec)
+                                     * (rs->num * (max_slices + 1) + 1));
+  if (NULL == iov)
+  {
+    free (rs->hdrs);
+    free (rs);
+    return NULL;
+  }
+  num = 0;
+  for (i = 0; i < rs->num; ++i)
+  {
+    const struct MHD_RangePart_ *const p = rs->parts + i;
+
+    if (NULL != rs->hdrs)
+    {
+      iov[num].iov_base = rs->hdrs + p->hdr_off;
+      iov[num].iov_len = p->hdr_len;
+      num++;
+    }
+    num += add_body_slices (response, p->start, p->len, iov + num);
+  }
+  if (NULL != rs->hdrs)
+  {
+    iov[num].iov_base = rs->hdrs + rs->closing_off;
+    iov[num].iov_len = rs->closing_len;
+    num++;
+  }
+  /* The headers of the parts are freed together with the new response */
+  r = MHD_create_response_from_iovec (iov, num,
+                                      (NULL != rs->hdrs) ? &free : NULL,
+                                      rs->hdrs);
+  free (iov);
+  if (NULL == r)
+    free (rs->hdrs);
+  free (rs);
+  return r;
+}
+
+
+/**
+ * Read the "multipart/byteranges" body with the ranges of
+ * the file-based response.
+ *
+ * @param cls the ranges
+ * @param pos the position in the multipart body
+ * @param buf the buffer to fill
+ * @param max the size of the @a buf
+ * @return the number of bytes put to the @a buf,
+ *         #MHD_CONTENT_READER_END_OF_STREAM or
+ *         #MHD_CONTENT_READER_END_WITH_ERROR
+ */
+static ssize_t
+range_reader (void *cls,
+              uint64_t pos,
+              char *buf,
+              size_t max)
+{
+  struct MHD_Ranges_ *const rs = (struct MHD_Ranges_ *) cls;
+  struct MHD_Response *const src = rs->src;
+  unsigned int i;
+
+  for (i = 0; i < rs->num; ++i)
+  {
+    const struct MHD_RangePart_ *const p = rs->parts + i;
+
+    if (pos < p->hdr_len)
+    {
+      if (max > p->hdr_len - (size_t) pos)
+        max = p->hdr_len - (size_t) pos;
+      memcpy (buf, rs->hdrs + p->hdr_off + (size_t) pos, max);
+      return (ssize_t) max;
+    }
+    pos -= p->hdr_len;
+    if (pos < p->len)
+    {
+      ssize_t ret;
+
+      if (max > p->len - pos)
+        max = (size_t) (p->len - pos);
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+      MHD_mutex_lock_chk_ (&src->mutex);
+#endif
+      ret = src->crc (src->crc_cls, p->start + pos, buf, max);
+#if defined(MHD_USE_POSIX_THREADS) || defined(MHD_USE_W32_THREADS)
+      MHD_mutex_unlock_chk_ (&src->mutex);
+#endif
+      if (MHD_CONTENT_READER_END_OF_STREAM == ret)
+        return MHD_CONTENT_READER_END_WITH_ERROR; /* The file is truncated */
+      return ret;
+    }
+    pos -= p->len;
+  }
+  if (pos >= rs->closing_len)
+    return MHD_CONTENT_READER_END_OF_STREAM;
+  if (max > rs->closing_len - (size_t) pos)
+    max = rs->closing_len - (size_t) pos;
+  memcpy (buf, rs->hdrs + rs->closing_off + (size_t) pos, max);
+  return (ssize_t) max;
+}
+
+
+/**
+ * Free the ranges used by #range_reader().
+ *
+ * @param cls the ranges
+ */
+static void
+range_reader_free (void *cls)
+{
+  struct MHD_Ranges_ *const rs = (struct MHD_Ranges_ *) cls;
+
+  free (rs->hdrs);
+  free (rs);
+}
+
+
+/**
+ * Create the response with the partial content of the base response.
+ *
+ * @param response the base response
+ * @param rs the ranges to use, freed by this function
+ * @return the new response, NULL on error
+ */
+static struct MHD_Response *
+create_partial_response (struct MHD_Response *response,
+                         struct MHD_Ranges_ *rs)
+{
+  struct MHD_Response *r;
+  const struct MHD_HTTP_Res_Header *pos;
+  char boundary[MHD_RANGE_BOUNDARY_LEN];
+  char crange[MHD_CONTENT_RANGE_MAX_LEN];
+  size_t crange_len;
+  uint64_t body_size;
+  const bool multipart = (1 < rs->num);
+
+  mhd_assert (0 != rs->num);
+  crange_len = 0;
+  if (multipart)
+  {
+    if ( (! select_boundary (response, rs, boundary)) ||
+         (! build_part_headers (response, rs, boundary, &body_size)) )
+    {
+      free (rs);
+      return NULL;
+    }
+  }
+  else
+    crange_len = print_content_range (rs->parts[0].start, rs->parts[0].len,
+                                      response->total_size, crange);
+
+  if (NULL == response->crc)
+    r = create_memory_ranges (response, rs);
+  else if (! multipart)
+  {
+    r = MHD_create_response_from_fd_at_offset64 (rs->parts[0].len,
+                                                 response->fd,
+                                                 response->fd_off
+                                                 + rs->parts[0].start);
+    if (NULL != r)
+      r->crfc = NULL; /* The FD is owned by the base response */
+    free (rs);
+  }
+  else
+  {
+    rs->src = response;
+    r = MHD_create_response_from_callback (body_size,
+                                           response->data_buffer_size,
+                                           &range_reader,
+                                           rs,
+                                           &range_reader_free);
+    if (NULL == r)
+      range_reader_free (rs);
+  }
+  if (NULL == r)
+    return NULL;
+
+  r->flags = response->flags;
+  r->flags_auto = response->flags_auto;
+  for (pos = response->first_header; NULL != pos; pos = pos->next)
+  {
+    if (multipart &&
+        (MHD_HEADER_KIND == pos->kind) &&
+        (MHD_STATICSTR_LEN_ (MHD_HTTP_HEADER_CONTENT_TYPE) ==
+         pos->header_size) &&
+        MHD_str_equal_caseless_bin_n_ (MHD_HTTP_HEADER_CONTENT_TYPE,
+                                       pos->header, pos->header_size))
+      continue; /* Replaced with the multipart type */
+    if (! MHD_add_response_entry_no_check_ (r, pos->kind,
+                                            pos->header, pos->header_size,
+                                            pos->value, pos->value_size))
+    {
+      MHD_destroy_response (r);
+      return NULL;
+    }
+  }
+  if (multipart)
+  {
+    char ctype[MHD_STATICSTR_LEN_ ("multipart/byteranges; boundary=")
+               + MHD_RANGE_BOUNDARY_LEN];
+
+    memcpy (ctype, "multipart/byteranges; boundary=",
+            MHD_STATICSTR_LEN_ ("multipart/byteranges; boundary="));
+    memcpy (ctype + MHD_STATICSTR_LEN_ ("multipart/byteranges; boundary="),
+            boundary, MHD_RANGE_BOUNDARY_LEN);
+    if (! MHD_add_response_entry_no_check_ (r, MHD_HEADER_KIND,
+                                            MHD_HTTP_HEADER_CONTENT_TYPE,
+                                            MHD_STATICSTR_LEN_ ( \
+                                              MHD_HTTP_HEADER_CONTENT_TYPE),
+                                            ctype, sizeof(ctype)))
+    {
+      MHD_destroy_response (r);
+      return NULL;
+    }
+  }
+  else if (! MHD_add_response_entry_no_check_ (r, MHD_HEADER_KIND,
+                                               MHD_HTTP_HEADER_CONTENT_RANGE,
+                                               MHD_STATICSTR_LEN_ ( \
+                                                 MHD_HTTP_HEADER_CONTENT_RANGE),
+                                               crange, crange_len))
+  {
+    MHD_destroy_response (r);
+    return NULL;
+  }
+  /* The reply still depends on the client's "Accept-Encoding" */
+  if ( (NULL != response->first_variant) &&
+       (NULL == MHD_get_response_element_n_ (response, MHD_HEADER_KIND,
+                                             MHD_HTTP_HEADER_VARY,
+                                             MHD_STATICSTR_LEN_ ( \
+                                               MHD_HTTP_HEADER_VARY))) &&
+       (! MHD_add_response_entry_no_check_ (r, MHD_HEADER_KIND,
+                                            MHD_HTTP_HEADER_VARY,
+                                            MHD_STATICSTR_LEN_ ( \
+                                              MHD_HTTP_HEADER_VARY),
+                                            MHD_HTTP_HEADER_ACCEPT_ENCODING,
+                                            MHD_STATICSTR_LEN_ ( \
+                                              MHD_HTTP_HEADER_ACCEPT_ENCODING)))
+       )
+  {
+    MHD_destroy_response (r);
+    return NULL;
+  }
+  MHD_increment_response_rc (response);
+  r->base = response;
+  return r;
+}
+
+
+/**
+ * Create the "Range Not Satisfiable" reply.
+ *
+ * @param response the base response
+ * @return the new response, NULL on error
+ */
+static struct MHD_Response *
+create_unsatisfiable_response (struct MHD_Response *response)
+{
+  struct MHD_Response *r;
+  char crange[MHD_CONTENT_RANGE_MAX_LEN];
+  size_t len;
+
+  r = MHD_create_response_empty (MHD_RF_NONE);
+  if (NULL == r)
+    return NULL;
+  r->flags = response->flags;
+  memcpy (crange, "bytes */", MHD_STATICSTR_LEN_ ("bytes */"));
+  len = MHD_STATICSTR_LEN_ ("bytes */");
+  len += MHD_uint64_to_str (response->total_size, crange + len,
+                            sizeof(crange) - len);
+  if (! MHD_add_response_entry_no_check_ (r, MHD_HEADER_KIND,
+                                          MHD_HTTP_HEADER_CONTENT_RANGE,
+                                          MHD_STATICSTR_LEN_ ( \
+                                            MHD_HTTP_HEADER_CONTENT_RANGE),
+                                          crange, len))
+  {
+    MHD_destroy_response (r);
+    return NULL;
+  }
+  return r;
+}
+
+
+struct MHD_Response *
+MHD_response_select_range_ (struct MHD_Connection *connection,
+                            struct MHD_Response *response,
+                            unsigned int *status_code)
+{
+  struct MHD_Ranges_ *rs;
+  struct MHD_Response *r;
+  const char *range;
+  size_t range_len;
+
+  if (0 == (response->flags & MHD_RF_ACCEPT_RANGES))
+    return NULL;
+  /* Range requests are defined only for GET method */
+  if ( (MHD_HTTP_OK != *status_code) ||
+       (MHD_HTTP_MTHD_GET != connection->rq.http_mthd) )
+    return NULL;
+  if (MHD_NO ==
+      MHD_lookup_connection_value_n (connection,
+                                     MHD_HEADER_KIND,
+                                     MHD_HTTP_HEADER_RANGE,
+                                     MHD_STATICSTR_LEN_ ( \
+                                       MHD_HTTP_HEADER_RANGE),
+                                     &range,
+                                     &range_len))
+    return NULL;
+  if (! MHD_response_is_rangeable_ (response))
+    return NULL;
+  if (! check_if_range (connection, response))
+    return NULL;
+
+  rs = (struct MHD_Ranges_ *) MHD_calloc_ (1, sizeof(*rs));
+  if (NULL == rs)
+    return NULL; /* Send the full body */
+  switch (parse_ranges (range, range_len, response->total_size, rs))
+  {
+  case MHD_RANGE_PARSE_OK:
+    r = create_partial_response (response, rs);
+    if (NULL != r)
+      *status_code = MHD_HTTP_PARTIAL_CONTENT;
+    return r;
+  case MHD_RANGE_PARSE_UNSATISFIABLE:
+    free (rs);
+    r = create_unsatisfiable_response (response);
+    if (NULL != r)
+      *status_code = MHD_HTTP_RANGE_NOT_SATISFIABLE;
+    return r;
+  case MHD_RANGE_PARSE_IGNORE:
+  default:
+    break;
+  }
+  free (rs);
+  return NULL;
+}
@@ -0,0 +1,65 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     This library is free software; you can redistribute it and/or
+     modify it under the terms of the GNU Lesser General Public
+     License as published by the Free Software Foundation; either
+     version 2.1 of the License, or (at your option) any later version.
+
+     This library is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     Lesser General Public License for more details.
+
+     You should have received a copy of the GNU Lesser General Public
+     License along with this library; if not, write to the Free Software
+     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+/**
+ * @file microhttpd/response_range.h
+ * @brief  Automatic processing of the "Range" requests
+ */
+
+#ifndef MHD_RESPONSE_RANGE_H
+#define MHD_RESPONSE_RANGE_H 1
+
+#include "internal.h"
+
+
+/**
+ * Check whether the parts of the response body can be sent
+ * automatically.
+ *
+ * @param response the response to check
+ * @return true if the response has #MHD_RF_ACCEPT_RANGES flag and
+ *         the body of the response can be sent partially,
+ *         false otherwise
+ */
+bool
+MHD_response_is_rangeable_ (struct MHD_Response *response);
+
+
+/**
+ * Select the parts of the response body requested by the client.
+ *
+ * The "Range" request header is processed only for GET requests answered
+ * with #MHD_HTTP_OK code by the response with #MHD_RF_ACCEPT_RANGES flag.
+ *
+ * @param connection the connection to use
+ * @param response the response queued by the application
+ * @param[in,out] status_code the status code of the reply, updated if
+ *                            the new response is returned
+ * @return the new response (the partial content or the "Range Not
+ *         Satisfiable" reply) with the reference counted for
+ *         the connection,
+ *         NULL if the @a response should be used as is
+ */
+struct MHD_Response *
+MHD_response_select_range_ (struct MHD_Connection *connection,
+                            struct MHD_Response *response,
+                            unsigned int *status_code);
+
+#endif /* ! MHD_RESPONSE_RANGE_H */
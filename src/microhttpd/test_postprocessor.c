@@ -121,6 +121,13 @@ static struct expResult exp_results[] = {
 };
 
 
+/**
+ * If non-zero, the url-encoded data is processed by
+ * MHD_post_process_in_place()
+ */
+static int use_in_place;
+
+
 static int
 mismatch (const char *a, const char *b)
 {
@@ -230,7 +237,11 @@ test_urlencoding_case (unsigned int want_start,
   size_t step;
   unsigned int errors = 0;
   const size_t size = strlen (url_data);
+  char *data_copy;
 
+  data_copy = malloc (size + 1);
+  if (NULL == data_copy)
+    exit (99);
   for (step = 1; size >= step; ++step)
   {
     struct MHD_Connection connection;
@@ -258,12 +269,21 @@ test_urlencoding_case (unsigned int want_start,
                "Line: %u\n", (unsigned int) __LINE__);
       exit (50);
     }
+    memcpy (data_copy, url_data, size + 1);
     for (i = 0; size > i; i += step)
     {
       size_t left = size - i;
-      if (MHD_YES != MHD_post_process (pp,
-                                       &url_data[i],
-                                       (left > step) ? step : left))
+      enum MHD_Result res;
+
+      if (use_in_place)
+        res = MHD_post_process_in_place (pp,
+                                         &data_copy[i],
+                                         (left > step) ? step : left);
+      else
+        res = MHD_post_process (pp,
+                                &url_data[i],
+                                (left > step) ? step : left);
+      if (MHD_YES != res)
       {
         fprintf (stderr, "Failed to process the data.\n"
                  "i: %u. step: %u.\n"
@@ -286,6 +306,7 @@ test_urlencoding_case (unsigned int want_start,
       errors++;
     }
   }
+  free (data_copy);
   return errors;
 }
 
@@ -828,6 +849,9 @@ main (int argc, char *const *argv)
   errorCount += test_multipart_splits ();
   errorCount += test_multipart_garbage ();
   errorCount += test_urlencoding ();
+  use_in_place = ! 0;
+  errorCount += test_urlencoding ();
+  use_in_place = 0;
   errorCount += test_multipart ();
   errorCount += test_nested_multipart ();
   errorCount += test_empty_key ();
@@ -29,6 +29,8 @@
 #include "internal.h"
 #include "mhd_compat.h"
 
+#include <time.h>
+
 #ifndef WINDOWS
 #include <unistd.h>
 #endif
@@ -59,6 +61,35 @@ value_checker (void *cls,
 }
 
 
+static enum MHD_Result
+value_checker_in_place (void *cls,
+                        enum MHD_ValueKind kind,
+                        const char *key,
+                        const char *filename,
+                        const char *content_type,
+                        const char *transfer_encoding,
+                        const char *data, uint64_t off, size_t size)
+{
+  size_t *calls = (size_t *) cls;
+  size_t i;
+  (void) kind; (void) filename; (void) content_type; /* Unused. Silent compiler warning. */
+  (void) transfer_encoding; (void) off;              /* Unused. Silent compiler warning. */
+
+  if ( (0 != strcmp ("key", key)) ||
+       (calls[1] != off) )
+    return MHD_NO;
+  for (i = 0; i < size; i++)
+  {
+    if ( (' ' != data[i]) &&
+         ('A' != data[i]) )
+      return MHD_NO;
+  }
+  calls[0]++;
+  calls[1] += size;
+  return MHD_YES;
+}
+
+
 static unsigned int
 test_simple_large (void)
 {
@@ -108,6 +139,289 @@ test_simple_large (void)
 }
 
 
+/**
+ * The boundary used for multipart tests
+ */
+#define MP_BOUNDARY "----------------------------d7a4b1c9e5f30826"
+
+/**
+ * The size of the file uploaded in multipart tests
+ */
+#define MP_FILE_SIZE (16 * 1024 * 1024)
+
+/**
+ * The state of the multipart value checker
+ */
+struct MpCheck
+{
+  /**
+   * The expected content of the file
+   */
+  const char *file;
+
+  /**
+   * The number of bytes received
+   */
+  size_t received;
+
+  /**
+   * Set to non-zero if wrong data was received
+   */
+  int error;
+};
+
+
+static enum MHD_Result
+mp_value_checker (void *cls,
+                  enum MHD_ValueKind kind,
+                  const char *key,
+                  const char *filename,
+                  const char *content_type,
+                  const char *transfer_encoding,
+                  const char *data, uint64_t off, size_t size)
+{
+  struct MpCheck *chk = (struct MpCheck *) cls;
+  (void) kind; (void) filename; (void) content_type; /* Unused. Silent compiler warning. */
+  (void) transfer_encoding;                          /* Unused. Silent compiler warning. */
+
+  if ( (NULL == key) ||
+       (0 != strcmp ("file", key)) ||
+       (off != chk->received) ||
+       (off + size > MP_FILE_SIZE) ||
+       (0 != memcmp (chk->file + off, data, size)) )
+  {
+    chk->error = 1;
+    return MHD_NO;
+  }
+  chk->received += size;
+  return MHD_YES;
+}
+
+
+/**
+ * Process the multipart body containing the large file.
+ *
+ * @param body the body to process
+ * @param body_size the size of the @a body
+ * @param file the expected content of the file
+ * @param chunk_size the size of the chunks passed to the post processor,
+ *                   zero for random sizes
+ * @return zero on success
+ */
+static unsigned int
+mp_process (const char *body,
+            size_t body_size,
+            const char *file,
+            size_t chunk_size)
+{
+  struct MHD_Connection connection;
+  struct MHD_HTTP_Req_Header header;
+  struct MHD_PostProcessor *pp;
+  struct MpCheck chk;
+  size_t i;
+  size_t delta;
+
+  memset (&connection, 0, sizeof (struct MHD_Connection));
+  memset (&header, 0, sizeof (struct MHD_HTTP_Req_Header));
+  connection.rq.headers_received = &header;
+  header.header = MHD_HTTP_HEADER_CONTENT_TYPE;
+  header.value = MHD_HTTP_POST_ENCODING_MULTIPART_FORMDATA \
+                 "; boundary=" MP_BOUNDARY;
+  header.header_size = strlen (header.header);
+  header.value_size = strlen (header.value);
+  header.kind = MHD_HEADER_KIND;
+  chk.file = file;
+  chk.received = 0;
+  chk.error = 0;
+  pp = MHD_create_post_processor (&connection, 1024, &mp_value_checker, &chk);
+  if (NULL == pp)
+    return 2;
+  i = 0;
+  while (i < body_size)
+  {
+    if (0 != chunk_size)
+      delta = chunk_size;
+    else
+      delta = 1 + ((size_t) MHD_random_ ()) % 100000;
+    if (delta > body_size - i)
+      delta = body_size - i;
+    if (MHD_YES !=
+        MHD_post_process (pp,
+                          &body[i],
+                          delta))
+    {
+      fprintf (stderr,
+               "MHD_post_process() failed at offset %lu!\n",
+               (unsigned long) i);
+      MHD_destroy_post_processor (pp);
+      return 4;
+    }
+    i += delta;
+  }
+  MHD_destroy_post_processor (pp);
+  if (chk.error || (MP_FILE_SIZE != chk.received))
+  {
+    fprintf (stderr,
+             "Wrong file data received: %lu bytes of %lu.\n",
+             (unsigned long) chk.received,
+             (unsigned long) MP_FILE_SIZE);
+    return 8;
+  }
+  return 0;
+}
+
+
+/**
+ * Test the multipart processing of the large file.  The file contains
+ * the strings partially matching the delimiter.  The throughput is
+ * printed.
+ */
+static unsigned int
+test_multipart_large (void)
+{
+  static const char head[] =
+    "--" MP_BOUNDARY "\r\n"
+    "Content-Disposition: form-data; name=\"file\"; filename=\"f.bin\"\r\n"
+    "Content-Type: application/octet-stream\r\n"
+    "\r\n";
+  static const char tail[] = "\r\n--" MP_BOUNDARY "--\r\n";
+  static const char trap[] = "\r\n--" MP_BOUNDARY;
+  char *body;
+  char *file;
+  size_t body_size;
+  size_t i;
+  uint32_t rnd;
+  unsigned int ret;
+  clock_t start;
+  double secs;
+
+  body_size = MHD_STATICSTR_LEN_ (head) + MP_FILE_SIZE
+              + MHD_STATICSTR_LEN_ (tail);
+  body = malloc (body_size);
+  if (NULL == body)
+    return 0; /* Not enough memory, skip the test */
+  file = body + MHD_STATICSTR_LEN_ (head);
+  memcpy (body, head, MHD_STATICSTR_LEN_ (head));
+  memcpy (file + MP_FILE_SIZE, tail, MHD_STATICSTR_LEN_ (tail));
+  rnd = 12345;
+  for (i = 0; i < MP_FILE_SIZE; i++)
+  {
+    rnd = rnd * 1103515245U + 12345U;
+    file[i] = (char) (rnd >> 24);
+  }
+  /* Put the delimiter truncated by various length */
+  for (i = 0; i + 4096 < MP_FILE_SIZE; i += 4096)
+  {
+    const size_t len = 1 + (i / 4096) % (MHD_STATICSTR_LEN_ (trap) - 1);
+
+    memcpy (file + i + (i / 4096) % 1024, trap, len);
+  }
+
+  ret = mp_process (body, body_size, file, 0);
+  if (0 == ret)
+  {
+    start = clock ();
+    ret = mp_process (body, body_size, file, 64 * 1024);
+    secs = ((double) (clock () - start)) / CLOCKS_PER_SEC;
+    if ((0 == ret) && (0 < secs))
+      fprintf (stderr,
+               "Multipart processing throughput: %.1f MiB/s\n",
+               ((double) body_size) / secs / 1024 / 1024);
+  }
+  free (body);
+  return ret;
+}
+
+
+/**
+ * Test the large url-encoded value processed by
+ * MHD_post_process_in_place(): each chunk of data must be given to
+ * the iterator in one call.
+ */
+static unsigned int
+test_simple_large_in_place (void)
+{
+  struct MHD_Connection connection;
+  struct MHD_HTTP_Req_Header header;
+  struct MHD_PostProcessor *pp;
+  size_t i;
+  size_t delta;
+  size_t size;
+  size_t num_chunks;
+  size_t value_size;
+  char data[102400];
+  size_t calls[2]; /* number of calls, size of the value */
+
+  /* "key=" followed by 'A', '+' and "%41" */
+  memcpy (data, "key=", 4);
+  value_size = 0;
+  for (i = 4; i < sizeof (data) - 1; i++, value_size++)
+  {
+    if ( (0 == i % 7) &&
+         (i + 3 < sizeof (data) - 1) )
+    {
+      memcpy (data + i, "%41", 3);
+      i += 2;
+    }
+    else if (0 == i % 5)
+      data[i] = '+';
+    else
+      data[i] = 'A';
+  }
+  data[sizeof (data) - 1] = '\0';
+  memset (&connection, 0, sizeof (struct MHD_Connection));
+  memset (&header, 0, sizeof (struct MHD_HTTP_Req_Header));
+  connection.rq.headers_received = &header;
+  header.header = MHD_HTTP_HEADER_CONTENT_TYPE;
+  header.value = MHD_HTTP_POST_ENCODING_FORM_URLENCODED;
+  header.header_size = strlen (header.header);
+  header.value_size = strlen (header.value);
+  header.kind = MHD_HEADER_KIND;
+  calls[0] = 0;
+  calls[1] = 0;
+  pp = MHD_create_post_processor (&connection, 1024,
+                                  &value_checker_in_place, calls);
+  i = 0;
+  num_chunks = 0;
+  size = strlen (data);
+  while (i < size)
+  {
+    delta = 1 + ((size_t) MHD_random_ ()) % (size - i);
+    if (MHD_YES !=
+        MHD_post_process_in_place (pp,
+                                   &data[i],
+                                   delta))
+    {
+      fprintf (stderr,
+               "MHD_post_process_in_place() failed!\n");
+      MHD_destroy_post_processor (pp);
+      return 1;
+    }
+    num_chunks++;
+    i += delta;
+  }
+  MHD_destroy_post_processor (pp);
+  if (value_size != calls[1])
+  {
+    fprintf (stderr,
+             "Wrong value size: %lu instead of %lu\n",
+             (unsigned long) calls[1],
+             (unsigned long) value_size);
+    return 1;
+  }
+  /* A chunk may be split by an escape sequence only once */
+  if (calls[0] > 2 * num_chunks)
+  {
+    fprintf (stderr,
+             "Too many iterator calls: %lu for %lu chunks\n",
+             (unsigned long) calls[0],
+             (unsigned long) num_chunks);
+    return 1;
+  }
+  return 0;
+}
+
+
 int
 main (int argc, char *const *argv)
 {
@@ -115,6 +429,8 @@ main (int argc, char *const *argv)
   (void) argc; (void) argv;  /* Unused. Silent compiler warning. */
 
   errorCount += test_simple_large ();
+  errorCount += test_simple_large_in_place ();
+  errorCount += test_multipart_large ();
   if (errorCount != 0)
     fprintf (stderr, "Error (code: %u)\n", errorCount);
   return errorCount != 0;       /* 0 == pass */
@@ -0,0 +1,224 @@
+/*
+  This file is part of libmicrohttpd
+  Copyright (C) 2026 libmicrohttpd developers
+
+  This test tool is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License as
+  published by the Free Software Foundation; either version 2, or
+  (at your option) any later version.
+
+  This test tool is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * @file microhttpd/test_str_http_date.c
+ * @brief  Unit tests for HTTP date strings <-> time conversion
+ */
+
+#include "mhd_options.h"
+#include <string.h>
+#include <stdio.h>
+#include "mhd_str.h"
+
+#ifndef MHD_STATICSTR_LEN_
+/**
+ * Determine length of static string / macro strings at compile time.
+ */
+#define MHD_STATICSTR_LEN_(macro) (sizeof(macro) / sizeof(char) - 1)
+#endif /* ! MHD_STATICSTR_LEN_ */
+
+
+/**
+ * The time and the matching HTTP date string
+ */
+struct date_check
+{
+  uint64_t secs;
+  const char *str;
+};
+
+static const struct date_check dates[] = {
+  {0, "Thu, 01 Jan 1970 00:00:00 GMT"},
+  {59, "Thu, 01 Jan 1970 00:00:59 GMT"},
+  {86399, "Thu, 01 Jan 1970 23:59:59 GMT"},
+  {784111777, "Sun, 06 Nov 1994 08:49:37 GMT"},
+  {951782400, "Tue, 29 Feb 2000 00:00:00 GMT"},
+  {951868800, "Wed, 01 Mar 2000 00:00:00 GMT"},
+  {1709210096, "Thu, 29 Feb 2024 12:34:56 GMT"},
+  {4102444799, "Thu, 31 Dec 2099 23:59:59 GMT"},
+  {4102444800, "Fri, 01 Jan 2100 00:00:00 GMT"},
+  {253402300799, "Fri, 31 Dec 9999 23:59:59 GMT"}
+};
+
+
+static int
+check_conversion (void)
+{
+  int errcount = 0;
+  size_t i;
+
+  for (i = 0; i < sizeof(dates) / sizeof(dates[0]); ++i)
+  {
+    char buf[MHD_HTTP_DATE_STR_LEN + 1];
+    uint64_t secs;
+
+    memset (buf, '#', sizeof(buf));
+    if ( (MHD_HTTP_DATE_STR_LEN !=
+          MHD_time_to_http_date_ (dates[i].secs, buf, sizeof(buf))) ||
+         (0 != memcmp (buf, dates[i].str, MHD_HTTP_DATE_STR_LEN)) ||
+         ('#' != buf[MHD_HTTP_DATE_STR_LEN]) )
+    {
+      fprintf (stderr,
+               "MHD_time_to_http_date_() FAILED for %lu: got \"%.*s\", "
+               "expected \"%s\"\n",
+               (unsigned long) dates[i].secs, (int) MHD_HTTP_DATE_STR_LEN,
+               buf, dates[i].str);
+      errcount++;
+    }
+    if ( (! MHD_http_date_to_time_ (dates[i].str, strlen (dates[i].str),
+                                    &secs)) ||
+         (dates[i].secs != secs) )
+    {
+      fprintf (stderr,
+               "MHD_http_date_to_time_() FAILED for \"%s\": got %lu, "
+               "expected %lu\n",
+               dates[i].str, (unsigned long) secs,
+               (unsigned long) dates[i].secs);
+      errcount++;
+    }
+  }
+  return errcount;
+}
+
+
+/**
+ * The dates in the obsolete formats
+ */
+static const struct date_check obsolete_dates[] = {
+  {784111777, "Sunday, 06-Nov-94 08:49:37 GMT"},
+  {784111777, "Sun Nov  6 08:49:37 1994"},
+  {784111777, "Sun Nov 06 08:49:37 1994"},
+  {951782400, "Tuesday, 29-Feb-00 00:00:00 GMT"},
+  {951782400, "Tue Feb 29 00:00:00 2000"},
+  {1709210096, "Thursday, 29-Feb-24 12:34:56 GMT"},
+  {1709210096, "Thu Feb 29 12:34:56 2024"},
+  {0, "Thu Jan  1 00:00:00 1970"}
+};
+
+
+static int
+check_obsolete_dates (void)
+{
+  int errcount = 0;
+  size_t i;
+
+  for (i = 0; i < sizeof(obsolete_dates) / sizeof(obsolete_dates[0]); ++i)
+  {
+    uint64_t secs;
+
+    if ( (! MHD_http_date_to_time_ (obsolete_dates[i].str,
+                                    strlen (obsolete_dates[i].str),
+                                    &secs)) ||
+         (obsolete_dates[i].secs != secs) )
+    {
+      fprintf (stderr,
+               "MHD_http_date_to_time_() FAILED for \"%s\": got %lu, "
+               "expected %lu\n",
+               obsolete_dates[i].str, (unsigned long) secs,
+               (unsigned long) obsolete_dates[i].secs);
+      errcount++;
+    }
+  }
+  return errcount;
+}
+
+
+static const char *const bad_dates[] = {
+  "",
+  "Sun, 06 Nov 1994 08:49:37",
+  "Sun, 06 Nov 1994 08:49:37 UTC",
+  "Sunday, 06-Nov-1994 08:49:37 GMT",
+  "Sun, 06-Nov-94 08:49:37 GMT",
+  "Sundey, 06-Nov-94 08:49:37 GMT",
+  "Sunday, 06 Nov 94 08:49:37 GMT",
+  "Sunday, 06-Xyz-94 08:49:37 GMT",
+  "Sunday, 06-Nov-94 08:49:37 UTC",
+  "Sunday, 06-Nov-9x 08:49:37 GMT",
+  "Sun Nov 6 08:49:37 1994",
+  "Sun Nov  6 08:49:37 94",
+  "Sun Nov  0 08:49:37 1994",
+  "Sun Xyz  6 08:49:37 1994",
+  "Xyz Nov  6 08:49:37 1994",
+  "Sun Nov  6 08-49-37 1994",
+  "Wed Dec 31 23:59:59 1969",
+  "Xyz, 06 Nov 1994 08:49:37 GMT",
+  "Sun, 06 Xyz 1994 08:49:37 GMT",
+  "Sun, 00 Nov 1994 08:49:37 GMT",
+  "Sun, 32 Nov 1994 08:49:37 GMT",
+  "Sun, 06 Nov 1994 24:49:37 GMT",
+  "Sun, 06 Nov 1994 08:60:37 GMT",
+  "Sun, 06 Nov 1994 08:49:61 GMT",
+  "Sun, 06 Nov 19a4 08:49:37 GMT",
+  "Sun,  6 Nov 1994 08:49:37 GMT",
+  "Wed, 31 Dec 1969 23:59:59 GMT"
+};
+
+
+static int
+check_bad_dates (void)
+{
+  int errcount = 0;
+  size_t i;
+
+  for (i = 0; i < sizeof(bad_dates) / sizeof(bad_dates[0]); ++i)
+  {
+    uint64_t secs;
+
+    if (MHD_http_date_to_time_ (bad_dates[i], strlen (bad_dates[i]), &secs))
+    {
+      fprintf (stderr,
+               "MHD_http_date_to_time_() FAILED: \"%s\" is accepted\n",
+               bad_dates[i]);
+      errcount++;
+    }
+  }
+  if (1)
+  {
+    char buf[MHD_HTTP_DATE_STR_LEN];
+
+    if (0 != MHD_time_to_http_date_ (0, buf, sizeof(buf) - 1))
+    {
+      fprintf (stderr,
+               "MHD_time_to_http_date_() FAILED: small buffer is used\n");
+      errcount++;
+    }
+    if (0 != MHD_time_to_http_date_ (253402300800ULL, buf, sizeof(buf)))
+    {
+      fprintf (stderr,
+               "MHD_time_to_http_date_() FAILED: year 10000 is printed\n");
+      errcount++;
+    }
+  }
+  return errcount;
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  int errcount = 0;
+  (void) argc; (void) argv; /* Unused. Silent compiler warning. */
+  errcount += check_conversion ();
+  errcount += check_obsolete_dates ();
+  errcount += check_bad_dates ();
+  if (0 == errcount)
+    printf ("All tests were passed without errors.\n");
+  return errcount == 0 ? 0 : 1;
+}
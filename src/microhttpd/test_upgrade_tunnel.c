@@ -0,0 +1,392 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     libmicrohttpd is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 3, or (at your
+     option) any later version.
+
+     libmicrohttpd is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with libmicrohttpd; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+/**
+ * @file test_upgrade_tunnel.c
+ * @brief  Testcase for in-kernel forwarding of upgraded connections
+ *         by #MHD_UPGRADE_ACTION_TUNNEL
+ */
+
+#include "mhd_options.h"
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "platform.h"
+#include "microhttpd.h"
+
+#ifndef MHD_STATICSTR_LEN_
+/**
+ * Determine length of static string / macro strings at compile time.
+ */
+#define MHD_STATICSTR_LEN_(macro) (sizeof(macro) / sizeof(char) - 1)
+#endif /* ! MHD_STATICSTR_LEN_ */
+
+/**
+ * The size of the bulk data block sent in each direction
+ */
+#define BULK_SIZE (256 * 1024)
+
+/**
+ * The socket used by the "application" as the other end of the tunnel
+ */
+static volatile int app_sock = -1;
+
+/**
+ * Set to non-zero when the upgrade handler failed
+ */
+static volatile int upgrade_failed = 0;
+
+/**
+ * Set to non-zero when MHD closed the client connection
+ */
+static volatile int conn_closed = 0;
+
+
+_MHD_NORETURN static void
+externalErrorExitDesc_ (const char *errDesc, const char *funcName, int lineNum)
+{
+  fflush (stdout);
+  fprintf (stderr, "System or external library call failed");
+  if ((NULL != errDesc) && (0 != errDesc[0]))
+    fprintf (stderr, ": %s", errDesc);
+  if ((NULL != funcName) && (0 != funcName[0]))
+    fprintf (stderr, " in %s", funcName);
+  if (0 < lineNum)
+    fprintf (stderr, " at line %d", lineNum);
+  fprintf (stderr, ".\nLast errno value: %d (%s)\n", (int) errno,
+           strerror (errno));
+  fflush (stderr);
+  exit (99);
+}
+
+
+#define externalErrorExitDesc(errDesc) \
+  externalErrorExitDesc_(errDesc, MHD_FUNC_, __LINE__)
+
+
+_MHD_NORETURN static void
+testErrorLogDesc_ (const char *errDesc, const char *funcName, int lineNum)
+{
+  fflush (stdout);
+  fprintf (stderr, "Test failed: %s", errDesc);
+  if ((NULL != funcName) && (0 != funcName[0]))
+    fprintf (stderr, " in %s", funcName);
+  if (0 < lineNum)
+    fprintf (stderr, " at line %d", lineNum);
+  fprintf (stderr, ".\n");
+  fflush (stderr);
+  exit (1);
+}
+
+
+#define testErrorLogDesc(errDesc) \
+  testErrorLogDesc_(errDesc, MHD_FUNC_, __LINE__)
+
+
+static void
+notify_connection_cb (void *cls,
+                      struct MHD_Connection *connection,
+                      void **socket_context,
+                      enum MHD_ConnectionNotificationCode toe)
+{
+  (void) cls; (void) connection; (void) socket_context; /* Unused. */
+  if (MHD_CONNECTION_NOTIFY_CLOSED == toe)
+    conn_closed = 1;
+}
+
+
+static void
+upgrade_cb (void *cls,
+            struct MHD_Connection *connection,
+            void *req_cls,
+            const char *extra_in,
+            size_t extra_in_size,
+            MHD_socket sock,
+            struct MHD_UpgradeResponseHandle *urh)
+{
+  int sp[2];
+  (void) cls; (void) connection; (void) req_cls; (void) sock; /* Unused. */
+
+  if (0 != extra_in_size)
+  {
+    (void) extra_in;
+    upgrade_failed = 1;
+    MHD_upgrade_action (urh, MHD_UPGRADE_ACTION_CLOSE);
+    return;
+  }
+  if (0 != socketpair (AF_UNIX, SOCK_STREAM, 0, sp))
+  {
+    upgrade_failed = 1;
+    MHD_upgrade_action (urh, MHD_UPGRADE_ACTION_CLOSE);
+    return;
+  }
+  if (MHD_YES != MHD_upgrade_action (urh, MHD_UPGRADE_ACTION_TUNNEL, sp[1]))
+  {
+    upgrade_failed = 1;
+    close (sp[0]);
+    close (sp[1]);
+    MHD_upgrade_action (urh, MHD_UPGRADE_ACTION_CLOSE);
+    return;
+  }
+  app_sock = sp[0];
+}
+
+
+static enum MHD_Result
+ahc_upgrade (void *cls,
+             struct MHD_Connection *connection,
+             const char *url,
+             const char *method,
+             const char *version,
+             const char *upload_data,
+             size_t *upload_data_size,
+             void **req_cls)
+{
+  struct MHD_Response *resp;
+  enum MHD_Result ret;
+  (void) cls; (void) url; (void) method;                  /* Unused. */
+  (void) version; (void) upload_data; (void) upload_data_size; /* Unused. */
+
+  if (NULL == *req_cls)
+  {
+    *req_cls = (void *) &app_sock;
+    return MHD_YES;
+  }
+  resp = MHD_create_response_for_upgrade (&upgrade_cb,
+                                          NULL);
+  if (NULL == resp)
+    externalErrorExitDesc ("MHD_create_response_for_upgrade() failed");
+  if (MHD_YES != MHD_add_response_header (resp,
+                                          MHD_HTTP_HEADER_UPGRADE,
+                                          "Hello World Protocol"))
+    externalErrorExitDesc ("MHD_add_response_header() failed");
+  ret = MHD_queue_response (connection,
+                            MHD_HTTP_SWITCHING_PROTOCOLS,
+                            resp);
+  MHD_destroy_response (resp);
+  return ret;
+}
+
+
+static void
+set_timeouts (int fd)
+{
+  struct timeval tv;
+
+  tv.tv_sec = 5;
+  tv.tv_usec = 0;
+  if ( (0 != setsockopt (fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv))) ||
+       (0 != setsockopt (fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv))) )
+    externalErrorExitDesc ("setsockopt() failed");
+}
+
+
+static void
+send_all (int fd, const char *buf, size_t len)
+{
+  size_t off;
+
+  for (off = 0; off < len;)
+  {
+    ssize_t res;
+
+    res = send (fd, buf + off, len - off, MSG_NOSIGNAL);
+    if (0 >= res)
+      externalErrorExitDesc ("send() failed");
+    off += (size_t) res;
+  }
+}
+
+
+static void
+recv_all (int fd, char *buf, size_t len)
+{
+  size_t off;
+
+  for (off = 0; off < len;)
+  {
+    ssize_t res;
+
+    res = recv (fd, buf + off, len - off, 0);
+    if (0 > res)
+      externalErrorExitDesc ("recv() failed");
+    if (0 == res)
+      testErrorLogDesc ("Unexpected EOF");
+    off += (size_t) res;
+  }
+}
+
+
+static void
+recv_eof (int fd)
+{
+  char c;
+  ssize_t res;
+
+  res = recv (fd, &c, 1, 0);
+  if (0 > res)
+    externalErrorExitDesc ("recv() failed");
+  if (0 != res)
+    testErrorLogDesc ("Extra data received instead of EOF");
+}
+
+
+static void
+recv_hdr (int fd)
+{
+  static const char term[] = "\r\n\r\n";
+  size_t matched = 0;
+
+  while (MHD_STATICSTR_LEN_ (term) > matched)
+  {
+    char c;
+    ssize_t res;
+
+    res = recv (fd, &c, 1, 0);
+    if (0 > res)
+      externalErrorExitDesc ("recv() failed");
+    if (0 == res)
+      testErrorLogDesc ("Unexpected EOF while receiving the reply header");
+    if (term[matched] == c)
+      matched++;
+    else
+      matched = ('\r' == c) ? 1 : 0;
+  }
+}
+
+
+/**
+ * Send the @a len bytes from @a src_fd and receive them on @a dst_fd.
+ * Data is sent in blocks to avoid deadlocks on full buffers.
+ */
+static void
+transfer_check (int src_fd, int dst_fd, size_t len)
+{
+  static char out[BULK_SIZE];
+  static char in[BULK_SIZE];
+  const size_t block = 4096;
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    out[i] = (char) ('a' + ((i * 7 + len) % 26));
+  for (i = 0; i < len; i += block)
+  {
+    const size_t sz = (len - i) < block ? (len - i) : block;
+
+    send_all (src_fd, out + i, sz);
+    recv_all (dst_fd, in + i, sz);
+  }
+  if (0 != memcmp (out, in, len))
+    testErrorLogDesc ("Forwarded data is corrupted");
+}
+
+
+int
+main (int argc,
+      char *const *argv)
+{
+  static const char req[] =
+    "GET / HTTP/1.1\r\n"
+    "Host: localhost\r\n"
+    "Connection: Upgrade\r\n"
+    "Upgrade: Hello World Protocol\r\n\r\n";
+  struct MHD_Daemon *d;
+  const union MHD_DaemonInfo *dinfo;
+  struct sockaddr_in sa;
+  int client;
+  int i;
+  (void) argc; (void) argv; /* Unused. Silent compiler warning. */
+
+  if (MHD_YES != MHD_is_feature_supported (MHD_FEATURE_UPGRADE_TUNNEL))
+    return 77;
+  if (MHD_YES != MHD_is_feature_supported (MHD_FEATURE_EPOLL))
+    return 77;
+  if (SIG_ERR == signal (SIGPIPE, SIG_IGN))
+    externalErrorExitDesc ("signal() failed");
+
+  d = MHD_start_daemon (MHD_USE_INTERNAL_POLLING_THREAD | MHD_USE_EPOLL
+                        | MHD_ALLOW_UPGRADE | MHD_USE_ERROR_LOG,
+                        0,
+                        NULL, NULL,
+                        &ahc_upgrade, NULL,
+                        MHD_OPTION_NOTIFY_CONNECTION,
+                        &notify_connection_cb, NULL,
+                        MHD_OPTION_SIGPIPE_HANDLED_BY_APP, 1,
+                        MHD_OPTION_END);
+  if (NULL == d)
+    testErrorLogDesc ("MHD_start_daemon() failed");
+  dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_BIND_PORT);
+  if ((NULL == dinfo) || (0 == dinfo->port))
+    testErrorLogDesc ("MHD_get_daemon_info() failed");
+
+  client = socket (AF_INET, SOCK_STREAM, 0);
+  if (0 > client)
+    externalErrorExitDesc ("socket() failed");
+  set_timeouts (client);
+  memset (&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_port = htons (dinfo->port);
+  sa.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  if (0 != connect (client, (struct sockaddr *) &sa, sizeof(sa)))
+    externalErrorExitDesc ("connect() failed");
+
+  send_all (client, req, MHD_STATICSTR_LEN_ (req));
+  recv_hdr (client);
+  for (i = 0; (i < 5000) && (0 > app_sock) && ! upgrade_failed; i++)
+    usleep (1000);
+  if (upgrade_failed)
+    testErrorLogDesc ("MHD_UPGRADE_ACTION_TUNNEL failed");
+  if (0 > app_sock)
+    testErrorLogDesc ("Upgrade handler has not been called");
+  set_timeouts (app_sock);
+
+  transfer_check (client, app_sock, 5);
+  transfer_check (app_sock, client, 7);
+  transfer_check (client, app_sock, BULK_SIZE);
+  transfer_check (app_sock, client, BULK_SIZE);
+
+  /* Half-close must be forwarded in each direction separately */
+  if (0 != shutdown (client, SHUT_WR))
+    externalErrorExitDesc ("shutdown() failed");
+  recv_eof (app_sock);
+  transfer_check (app_sock, client, 11);
+  if (0 != shutdown (app_sock, SHUT_WR))
+    externalErrorExitDesc ("shutdown() failed");
+  recv_eof (client);
+
+  for (i = 0; (i < 5000) && ! conn_closed; i++)
+    usleep (1000);
+  if (! conn_closed)
+    testErrorLogDesc ("The connection has not been closed after the tunnel " \
+                      "has been finished");
+  close (client);
+  close (app_sock);
+  MHD_stop_daemon (d);
+  return 0;
+}
@@ -0,0 +1,451 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     This library is free software; you can redistribute it and/or
+     modify it under the terms of the GNU Lesser General Public
+     License as published by the Free Software Foundation; either
+     version 2.1 of the License, or (at your option) any later version.
+
+     This library is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     Lesser General Public License for more details.
+
+     You should have received a copy of the GNU Lesser General Public
+     License along with this library; if not, write to the Free Software
+     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+/**
+ * @file microhttpd/upgrade_tunnel.c
+ * @brief  In-kernel forwarding of plain-text "upgraded" connections
+ *
+ * Each direction of the tunnel uses its own pipe: the data is spliced
+ * from the source socket to the pipe and then from the pipe to
+ * the destination socket, so the payload never reaches user space.
+ * The sockets are watched by the separate per-daemon epoll FD
+ * (the same way as TLS upgraded connections) in edge-triggered mode.
+ */
+
+#include "upgrade_tunnel.h"
+
+#ifdef MHD_UPGRADE_TUNNEL_SUPPORT
+
+#include <fcntl.h>
+#include "mhd_sockets.h"
+#include "mhd_compat.h"
+#include "mhd_assert.h"
+
+/**
+ * The size of the pipe used if the real size cannot be detected.
+ */
+#define MHD_TUNNEL_PIPE_SIZE_DEF (4096)
+
+/**
+ * The maximum number of fill/drain rounds for one direction of one
+ * tunnel per single call of #MHD_upgrade_tunnel_process_().
+ * Limits the time spent for a busy tunnel so other connections are
+ * not starved; the tunnel stays in the "ready" list if more data
+ * can be forwarded.
+ */
+#define MHD_TUNNEL_MAX_ROUNDS (16)
+
+
+/**
+ * Initialise one direction of the tunnel: create the pipe.
+ *
+ * @param d the direction to initialise
+ * @param src the source handle
+ * @param dst the destination handle
+ * @return true on success, false otherwise
+ */
+static bool
+tunnel_dir_init (struct MHD_UpgradeTunnelDir *d,
+                 struct UpgradeEpollHandle *src,
+                 struct UpgradeEpollHandle *dst)
+{
+  int fds[2];
+#ifdef F_GETPIPE_SZ
+  int psize;
+#endif /* F_GETPIPE_SZ */
+
+#ifdef HAVE_PIPE2_FUNC
+  if (0 != pipe2 (fds, O_CLOEXEC | O_NONBLOCK))
+    return false;
+#else  /* ! HAVE_PIPE2_FUNC */
+  if (0 != pipe (fds))
+    return false;
+  if ( (! MHD_socket_nonblocking_ (fds[0])) ||
+       (! MHD_socket_nonblocking_ (fds[1])) )
+  {
+    MHD_fd_close_chk_ (fds[0]);
+    MHD_fd_close_chk_ (fds[1]);
+    return false;
+  }
+  (void) MHD_socket_noninheritable_ (fds[0]);
+  (void) MHD_socket_noninheritable_ (fds[1]);
+#endif /* ! HAVE_PIPE2_FUNC */
+  d->src = src;
+  d->dst = dst;
+  d->pipe_r = fds[0];
+  d->pipe_w = fds[1];
+  d->pipe_size = MHD_TUNNEL_PIPE_SIZE_DEF;
+#ifdef F_GETPIPE_SZ
+  psize = fcntl (d->pipe_w, F_GETPIPE_SZ);
+  if (0 < psize)
+    d->pipe_size = (size_t) psize;
+#endif /* F_GETPIPE_SZ */
+  d->in_pipe = 0;
+  d->pipe_full = false;
+  d->src_done = false;
+  d->finished = false;
+  return true;
+}
+
+
+/**
+ * Release the pipe of one direction of the tunnel.
+ *
+ * @param d the direction to clean
+ */
+static void
+tunnel_dir_deinit (struct MHD_UpgradeTunnelDir *d)
+{
+  if (0 <= d->pipe_r)
+    MHD_fd_close_chk_ (d->pipe_r);
+  if (0 <= d->pipe_w)
+    MHD_fd_close_chk_ (d->pipe_w);
+  d->pipe_r = -1;
+  d->pipe_w = -1;
+}
+
+
+enum MHD_Result
+MHD_upgrade_tunnel_start_ (struct MHD_UpgradeResponseHandle *urh,
+                           int target_fd)
+{
+  struct MHD_Connection *const connection = urh->connection;
+  struct MHD_Daemon *const daemon = connection->daemon;
+  struct MHD_UpgradeTunnel *tun;
+  struct epoll_event event;
+
+  if (0 > target_fd)
+    return MHD_NO;
+  if ( (urh->was_closed) ||
+       (NULL != urh->tunnel) )
+    return MHD_NO;
+  if (-1 == daemon->epoll_tunnel_fd)
+  {
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("The \"tunnel\" action is supported only for " \
+                 "non-TLS connections in epoll mode.\n"));
+#endif /* HAVE_MESSAGES */
+    return MHD_NO;
+  }
+  if (! daemon->sigpipe_blocked)
+  {
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("The \"tunnel\" action cannot be used as " \
+                 "SIGPIPE is not blocked.\n"));
+#endif /* HAVE_MESSAGES */
+    return MHD_NO;
+  }
+  if (! MHD_socket_nonblocking_ (target_fd))
+  {
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("Failed to set non-blocking mode on the tunnel FD: %s\n"),
+              MHD_socket_last_strerr_ ());
+#endif /* HAVE_MESSAGES */
+    return MHD_NO;
+  }
+  tun = MHD_calloc_ (1, sizeof (struct MHD_UpgradeTunnel));
+  if (NULL == tun)
+    return MHD_NO;
+  tun->client.urh = urh;
+  tun->client.socket = connection->socket_fd;
+  tun->client.celi = MHD_EPOLL_STATE_UNREADY;
+  tun->target.urh = urh;
+  tun->target.socket = target_fd;
+  tun->target.celi = MHD_EPOLL_STATE_UNREADY;
+  tun->to_target.pipe_r = -1;
+  tun->to_target.pipe_w = -1;
+  tun->to_client.pipe_r = -1;
+  tun->to_client.pipe_w = -1;
+  if ( (! tunnel_dir_init (&tun->to_target,
+                           &tun->client,
+                           &tun->target)) ||
+       (! tunnel_dir_init (&tun->to_client,
+                           &tun->target,
+                           &tun->client)) )
+  {
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("Failed to create pipes for the tunnel: %s\n"),
+              MHD_socket_last_strerr_ ());
+#endif /* HAVE_MESSAGES */
+    tunnel_dir_deinit (&tun->to_target);
+    tunnel_dir_deinit (&tun->to_client);
+    free (tun);
+    return MHD_NO;
+  }
+  /* The tunnel must be visible before the first event is reported. */
+  urh->tunnel = tun;
+
+  event.events = EPOLLIN | EPOLLOUT | EPOLLPRI | EPOLLRDHUP | EPOLLET;
+  event.data.ptr = &tun->client;
+  if (0 != epoll_ctl (daemon->epoll_tunnel_fd,
+                      EPOLL_CTL_ADD,
+                      tun->client.socket,
+                      &event))
+  {
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("Call to epoll_ctl failed: %s\n"),
+              MHD_socket_last_strerr_ ());
+#endif /* HAVE_MESSAGES */
+    urh->tunnel = NULL;
+    tunnel_dir_deinit (&tun->to_target);
+    tunnel_dir_deinit (&tun->to_client);
+    free (tun);
+    return MHD_NO;
+  }
+  event.events = EPOLLIN | EPOLLOUT | EPOLLPRI | EPOLLRDHUP | EPOLLET;
+  event.data.ptr = &tun->target;
+  if (0 != epoll_ctl (daemon->epoll_tunnel_fd,
+                      EPOLL_CTL_ADD,
+                      tun->target.socket,
+                      &event))
+  {
+#ifdef HAVE_MESSAGES
+    MHD_DLOG (daemon,
+              _ ("Call to epoll_ctl failed: %s\n"),
+              MHD_socket_last_strerr_ ());
+#endif /* HAVE_MESSAGES */
+    if (0 != epoll_ctl (daemon->epoll_tunnel_fd,
+                        EPOLL_CTL_DEL,
+                        tun->client.socket,
+                        NULL))
+      MHD_PANIC (_ ("Error cleaning up while handling epoll error.\n"));
+    urh->tunnel = NULL;
+    tunnel_dir_deinit (&tun->to_target);
+    tunnel_dir_deinit (&tun->to_client);
+    free (tun);
+    return MHD_NO;
+  }
+  return MHD_YES;
+}
+
+
+/**
+ * Check whether one direction of the tunnel can make progress.
+ *
+ * @param d the direction to check
+ * @return true if processing is needed, false otherwise
+ */
+static bool
+tunnel_dir_is_ready (const struct MHD_UpgradeTunnelDir *d)
+{
+  if (d->finished)
+    return false;
+  if ( (! d->src_done) &&
+       (! d->pipe_full) &&
+       (0 != ((MHD_EPOLL_STATE_READ_READY | MHD_EPOLL_STATE_ERROR)
+              & d->src->celi)) )
+    return true;
+  if ( (0 != d->in_pipe) &&
+       (0 != (MHD_EPOLL_STATE_WRITE_READY & d->dst->celi)) )
+    return true;
+  if ( (d->src_done) &&
+       (0 == d->in_pipe) )
+    return true; /* Not finished yet */
+  return false;
+}
+
+
+/**
+ * Forward data in one direction of the tunnel.
+ *
+ * @param d the direction to process
+ */
+static void
+tunnel_dir_process (struct MHD_UpgradeTunnelDir *d)
+{
+  unsigned int rounds;
+
+  for (rounds = 0; rounds < MHD_TUNNEL_MAX_ROUNDS; ++rounds)
+  {
+    bool progress = false;
+    ssize_t res;
+
+    if (d->finished)
+      return;
+
+    /* Fill the pipe from the source socket */
+    if ( (! d->src_done) &&
+         (! d->pipe_full) &&
+         (0 != ((MHD_EPOLL_STATE_READ_READY | MHD_EPOLL_STATE_ERROR)
+                & d->src->celi)) )
+    {
+      mhd_assert (d->pipe_size > d->in_pipe);
+      res = splice (d->src->socket, NULL,
+                    d->pipe_w, NULL,
+                    d->pipe_size - d->in_pipe,
+                    SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+      if (0 < res)
+      {
+        d->in_pipe += (size_t) res;
+        if (d->pipe_size <= d->in_pipe)
+          d->pipe_full = true;
+        progress = true;
+      }
+      else if (0 == res)
+        d->src_done = true; /* End of stream */
+      else
+      {
+        const int err = errno;
+        if (EAGAIN == err)
+        {
+          /* The pipe capacity is counted in pages, not in bytes, so
+           * the pipe may be full while holding less data than its size.
+           * Only an empty pipe guarantees that the socket is drained. */
+          if (0 == d->in_pipe)
+          {
+            d->src->celi &= ~((enum MHD_EpollState) MHD_EPOLL_STATE_READ_READY);
+            if (0 != (MHD_EPOLL_STATE_ERROR & d->src->celi))
+              d->src_done = true;
+          }
+          else
+            d->pipe_full = true;
+        }
+        else if (EINTR != err)
+          d->src_done = true; /* Unrecoverable error */
+      }
+    }
+
+    /* Drain the pipe to the destination socket */
+    if ( (0 != d->in_pipe) &&
+         (0 != (MHD_EPOLL_STATE_WRITE_READY & d->dst->celi)) )
+    {
+      res = splice (d->pipe_r, NULL,
+                    d->dst->socket, NULL,
+                    d->in_pipe,
+                    SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+      if (0 < res)
+      {
+        mhd_assert (d->in_pipe >= (size_t) res);
+        d->in_pipe -= (size_t) res;
+        d->pipe_full = false;
+        progress = true;
+      }
+      else if (0 > res)
+      {
+        const int err = errno;
+        if (EAGAIN == err)
+          d->dst->celi &= ~((enum MHD_EpollState) MHD_EPOLL_STATE_WRITE_READY);
+        else if (EINTR != err)
+        {
+          /* The destination is gone, the data cannot be delivered.
+           * The data left in the pipe will be discarded when the pipe
+           * is closed. */
+          d->src_done = true;
+          d->finished = true;
+          return;
+        }
+      }
+    }
+
+    if ( (d->src_done) &&
+         (0 == d->in_pipe) )
+    {
+      /* Reflect the end of stream to the other side */
+      (void) shutdown (d->dst->socket,
+                       SHUT_WR);
+      d->finished = true;
+      return;
+    }
+    if (! progress)
+      return;
+  }
+}
+
+
+void
+MHD_upgrade_tunnel_process_ (struct MHD_UpgradeTunnel *tun)
+{
+  struct MHD_Connection *const connection = tun->client.urh->connection;
+  struct MHD_Daemon *const daemon = connection->daemon;
+
+#ifdef MHD_USE_THREADS
+  mhd_assert ( (! MHD_D_IS_USING_THREADS_ (daemon)) || \
+               MHD_thread_handle_ID_is_current_thread_ (daemon->tid) );
+#endif /* MHD_USE_THREADS */
+
+  if (daemon->shutdown)
+  {
+    /* Forwarding is stopped, the tunnel will be closed by the caller */
+    tun->to_target.finished = true;
+    tun->to_client.finished = true;
+    return;
+  }
+  /* Read from both sides before any sending, see the comment in
+   * process_urh() about W32 and Darwin. */
+  tunnel_dir_process (&tun->to_target);
+  tunnel_dir_process (&tun->to_client);
+}
+
+
+bool
+MHD_upgrade_tunnel_is_ready_ (const struct MHD_UpgradeTunnel *tun)
+{
+  return tunnel_dir_is_ready (&tun->to_target) ||
+         tunnel_dir_is_ready (&tun->to_client);
+}
+
+
+bool
+MHD_upgrade_tunnel_is_finished_ (const struct MHD_UpgradeTunnel *tun)
+{
+  return tun->to_target.finished && tun->to_client.finished;
+}
+
+
+void
+MHD_upgrade_tunnel_close_ (struct MHD_UpgradeResponseHandle *urh)
+{
+  struct MHD_UpgradeTunnel *const tun = urh->tunnel;
+  struct MHD_Daemon *daemon;
+
+  if (NULL == tun)
+    return;
+  daemon = urh->connection->daemon;
+  if (0 != epoll_ctl (daemon->epoll_tunnel_fd,
+                      EPOLL_CTL_DEL,
+                      tun->client.socket,
+                      NULL))
+    MHD_PANIC (_ ("Failed to remove FD from epoll set.\n"));
+  if (0 != epoll_ctl (daemon->epoll_tunnel_fd,
+                      EPOLL_CTL_DEL,
+                      tun->target.socket,
+                      NULL))
+    MHD_PANIC (_ ("Failed to remove FD from epoll set.\n"));
+  if (tun->in_eready_list)
+  {
+    EDLL_remove (daemon->eready_tunnel_head,
+                 daemon->eready_tunnel_tail,
+                 tun);
+    tun->in_eready_list = false;
+  }
+  tunnel_dir_deinit (&tun->to_target);
+  tunnel_dir_deinit (&tun->to_client);
+  MHD_fd_close_chk_ (tun->target.socket);
+  urh->tunnel = NULL;
+  free (tun);
+}
+
+
+#endif /* MHD_UPGRADE_TUNNEL_SUPPORT */
@@ -0,0 +1,99 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     This library is free software; you can redistribute it and/or
+     modify it under the terms of the GNU Lesser General Public
+     License as published by the Free Software Foundation; either
+     version 2.1 of the License, or (at your option) any later version.
+
+     This library is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     Lesser General Public License for more details.
+
+     You should have received a copy of the GNU Lesser General Public
+     License along with this library; if not, write to the Free Software
+     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+/**
+ * @file microhttpd/upgrade_tunnel.h
+ * @brief  In-kernel forwarding of plain-text "upgraded" connections
+ */
+
+#ifndef MHD_UPGRADE_TUNNEL_H
+#define MHD_UPGRADE_TUNNEL_H 1
+
+#include "internal.h"
+
+#ifdef MHD_UPGRADE_TUNNEL_SUPPORT
+
+/**
+ * Start forwarding of the data between the client socket of
+ * the upgraded connection and the application-provided @a target_fd.
+ * On success MHD takes ownership of the @a target_fd.
+ * @remark Could be called from any thread.
+ *
+ * @param urh the upgrade handle of the connection
+ * @param target_fd the file descriptor to forward the data to and from
+ * @return #MHD_YES on success,
+ *         #MHD_NO if tunnel cannot be used (the @a target_fd is not
+ *         closed in this case)
+ */
+enum MHD_Result
+MHD_upgrade_tunnel_start_ (struct MHD_UpgradeResponseHandle *urh,
+                           int target_fd);
+
+
+/**
+ * Move data through the tunnel based on the readiness state stored in
+ * the @a tun handles.
+ * @remark To be called only from thread that process
+ * daemon's epoll().
+ *
+ * @param tun the tunnel to process
+ */
+void
+MHD_upgrade_tunnel_process_ (struct MHD_UpgradeTunnel *tun);
+
+
+/**
+ * Check whether any data can be moved through the tunnel without waiting
+ * for new events.
+ *
+ * @param tun the tunnel to check
+ * @return true if the tunnel should be processed again,
+ *         false otherwise
+ */
+bool
+MHD_upgrade_tunnel_is_ready_ (const struct MHD_UpgradeTunnel *tun);
+
+
+/**
+ * Check whether forwarding is finished in both directions.
+ *
+ * @param tun the tunnel to check
+ * @return true if nothing more can be forwarded,
+ *         false otherwise
+ */
+bool
+MHD_upgrade_tunnel_is_finished_ (const struct MHD_UpgradeTunnel *tun);
+
+
+/**
+ * Stop forwarding, release the pipes and close the application-provided
+ * FD.  Any data not yet forwarded is discarded.
+ * Does nothing if tunnel is not used for the @a urh.
+ * @remark To be called only from thread that process
+ * daemon's epoll().
+ *
+ * @param urh the upgrade handle of the connection
+ */
+void
+MHD_upgrade_tunnel_close_ (struct MHD_UpgradeResponseHandle *urh);
+
+#endif /* MHD_UPGRADE_TUNNEL_SUPPORT */
+
+#endif /* ! MHD_UPGRADE_TUNNEL_H */
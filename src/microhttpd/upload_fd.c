@@ -0,0 +1,353 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     This library is free software; you can redistribute it and/or
+     modify it under the terms of the GNU Lesser General Public
+     License as published by the Free Software Foundation; either
+     version 2.1 of the License, or (at your option) any later version.
+
+     This library is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     Lesser General Public License for more details.
+
+     You should have received a copy of the GNU Lesser General Public
+     License along with this library; if not, write to the Free Software
+     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+/**
+ * @file microhttpd/upload_fd.c
+ * @brief  Writing of the request body directly to the application's FD
+ *
+ * When the body is not chunked, the connection is not encrypted and the
+ * target is a regular file, the data is moved by splice() from the socket
+ * to the pipe and from the pipe to the file, so the body never crosses
+ * the user space.  In all other cases the data is written from the read
+ * buffer by write() without calling the access handler callback.
+ */
+
+#include "upload_fd.h"
+#include "connection.h"
+#include "mhd_limits.h"
+#include "mhd_sockets.h"
+#include "mhd_assert.h"
+#if defined(_WIN32) && ! defined(__CYGWIN__)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN 1
+#endif /* !WIN32_LEAN_AND_MEAN */
+#include <windows.h>
+#include <io.h> /* for _get_osfhandle() */
+#endif /* _WIN32 && !__CYGWIN__ */
+#ifdef MHD_UPLOAD_SPLICE_SUPPORT
+#include <fcntl.h>
+#include <sys/stat.h>
+
+/**
+ * The minimal size of the remaining body to use splice().
+ * For smaller bodies the pipe setup costs more than the copying.
+ */
+#define MHD_UPLOAD_SPLICE_MIN_SIZE (64 * 1024)
+
+/**
+ * The size of the pipe to request.  The kernel may limit it.
+ */
+#define MHD_UPLOAD_SPLICE_PIPE_SIZE (256 * 1024)
+
+/**
+ * The size of the pipe used if the real size cannot be detected.
+ */
+#define MHD_UPLOAD_SPLICE_PIPE_SIZE_DEF (4096)
+
+/**
+ * The maximum number of socket->pipe->file rounds per single call of
+ * #MHD_upload_fd_splice_().  Limits the time spent for a single busy
+ * connection so other connections are not starved.
+ */
+#define MHD_UPLOAD_SPLICE_MAX_ROUNDS (16)
+
+
+/**
+ * Check whether splice() could be used to write to the @a fd.
+ * splice() is usable only for regular files not opened in "append" mode.
+ *
+ * @param fd the FD to check
+ * @return true if splice() could be used, false otherwise
+ */
+static bool
+upload_fd_is_spliceable (int fd)
+{
+  struct stat st;
+  int flags;
+
+  if (0 != fstat (fd, &st))
+    return false;
+  if (! S_ISREG (st.st_mode))
+    return false;
+  flags = fcntl (fd, F_GETFL);
+  if (-1 == flags)
+    return false;
+  return (0 == (flags & O_APPEND));
+}
+
+
+/**
+ * Create the pipe used for splice().
+ *
+ * @param c the connection to use
+ * @return true on success, false otherwise
+ */
+static bool
+upload_pipe_open (struct MHD_Connection *c)
+{
+  int fds[2];
+#ifdef F_GETPIPE_SZ
+  int psize;
+#endif /* F_GETPIPE_SZ */
+
+  mhd_assert (! c->rq.upload_pipe_open);
+#ifdef HAVE_PIPE2_FUNC
+  if (0 != pipe2 (fds, O_CLOEXEC | O_NONBLOCK))
+    return false;
+#else  /* ! HAVE_PIPE2_FUNC */
+  if (0 != pipe (fds))
+    return false;
+  if ( (! MHD_socket_nonblocking_ (fds[0])) ||
+       (! MHD_socket_nonblocking_ (fds[1])) )
+  {
+    MHD_fd_close_chk_ (fds[0]);
+    MHD_fd_close_chk_ (fds[1]);
+    return false;
+  }
+  (void) MHD_socket_noninheritable_ (fds[0]);
+  (void) MHD_socket_noninheritable_ (fds[1]);
+#endif /* ! HAVE_PIPE2_FUNC */
+  c->rq.upload_pipe_r = fds[0];
+  c->rq.upload_pipe_w = fds[1];
+  c->rq.upload_pipe_size = MHD_UPLOAD_SPLICE_PIPE_SIZE_DEF;
+#ifdef F_SETPIPE_SZ
+  (void) fcntl (fds[1], F_SETPIPE_SZ, MHD_UPLOAD_SPLICE_PIPE_SIZE);
+#endif /* F_SETPIPE_SZ */
+#ifdef F_GETPIPE_SZ
+  psize = fcntl (fds[1], F_GETPIPE_SZ);
+  if (0 < psize)
+    c->rq.upload_pipe_size = (size_t) psize;
+#endif /* F_GETPIPE_SZ */
+  c->rq.upload_pipe_open = true;
+  return true;
+}
+
+
+enum MHD_UploadSpliceResult
+MHD_upload_fd_splice_ (struct MHD_Connection *connection)
+{
+  struct MHD_Connection *const c = connection; /**< a short alias */
+  unsigned int max_rounds;
+  unsigned int i;
+
+  mhd_assert (c->rq.upload_to_fd);
+  mhd_assert (0 == c->read_buffer_offset);
+  mhd_assert (! c->rq.have_chunked_upload);
+  mhd_assert (MHD_SIZE_UNKNOWN != c->rq.remaining_upload_size);
+
+  if (! c->rq.upload_splice)
+    return MHD_UPLOAD_SPLICE_FALLBACK;
+  if (0 == c->rq.remaining_upload_size)
+    return MHD_UPLOAD_SPLICE_FALLBACK;
+  if (! c->rq.upload_pipe_open)
+  {
+    if (! upload_pipe_open (c))
+    {
+      c->rq.upload_splice = false;
+      return MHD_UPLOAD_SPLICE_FALLBACK;
+    }
+  }
+  /* Blocking socket could be read only once per "ready" event */
+  max_rounds = c->sk_nonblck ? MHD_UPLOAD_SPLICE_MAX_ROUNDS : 1;
+
+  for (i = 0; i < max_rounds; i++)
+  {
+    size_t want;
+    size_t in_pipe;
+    ssize_t res;
+
+    want = c->rq.upload_pipe_size;
+    if (c->rq.remaining_upload_size < (uint64_t) want)
+      want = (size_t) c->rq.remaining_upload_size;
+    res = splice (c->socket_fd, NULL,
+                  c->rq.upload_pipe_w, NULL,
+                  want,
+                  SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (0 >= res)
+    {
+      if (0 > res)
+      {
+        const int err = errno;
+
+        if ((EAGAIN == err) || (EWOULDBLOCK == err))
+        {
+#ifdef EPOLL_SUPPORT
+          /* Got EAGAIN --- no longer read-ready */
+          c->epoll_state &=
+            ~((enum MHD_EpollState) MHD_EPOLL_STATE_READ_READY);
+#endif /* EPOLL_SUPPORT */
+          return MHD_UPLOAD_SPLICE_OK;
+        }
+        if ((EINVAL == err) || (ENOSYS == err))
+          c->rq.upload_splice = false; /* Not supported for this socket */
+      }
+      /* Let recv() detect the closure or the error of the socket */
+      return MHD_UPLOAD_SPLICE_FALLBACK;
+    }
+    c->rq.remaining_upload_size -= (uint64_t) res;
+    MHD_update_last_activity_ (c);
+
+    in_pipe = (size_t) res;
+    while (0 != in_pipe)
+    {
+      ssize_t wr;
+
+      wr = splice (c->rq.upload_pipe_r, NULL,
+                   c->rq.upload_fd, NULL,
+                   in_pipe,
+                   SPLICE_F_MOVE);
+      if (0 >= wr)
+      {
+        if ((0 > wr) && (EINTR == errno))
+          continue;
+        return MHD_UPLOAD_SPLICE_WRITE_ERROR;
+      }
+      in_pipe -= (size_t) wr;
+    }
+
+    if (0 == c->rq.remaining_upload_size)
+    {
+      MHD_upload_fd_cleanup_ (c);
+      /* The whole body has been received, keep the state consistent with
+         the counter of the remaining data */
+      c->state = MHD_CONNECTION_BODY_RECEIVED;
+      break;
+    }
+    if ((size_t) res < want)
+    {
+#ifdef EPOLL_SUPPORT
+      /* The socket has been drained */
+      c->epoll_state &=
+        ~((enum MHD_EpollState) MHD_EPOLL_STATE_READ_READY);
+#endif /* EPOLL_SUPPORT */
+      break;
+    }
+  }
+  return MHD_UPLOAD_SPLICE_OK;
+}
+
+
+#endif /* MHD_UPLOAD_SPLICE_SUPPORT */
+
+
+void
+MHD_upload_fd_cleanup_ (struct MHD_Connection *connection)
+{
+#ifdef MHD_UPLOAD_SPLICE_SUPPORT
+  if (! connection->rq.upload_pipe_open)
+    return;
+  MHD_fd_close_chk_ (connection->rq.upload_pipe_r);
+  MHD_fd_close_chk_ (connection->rq.upload_pipe_w);
+  connection->rq.upload_pipe_open = false;
+#else  /* ! MHD_UPLOAD_SPLICE_SUPPORT */
+  (void) connection; /* Mute compiler warning */
+#endif /* ! MHD_UPLOAD_SPLICE_SUPPORT */
+}
+
+
+bool
+MHD_upload_fd_write_ (struct MHD_Connection *connection,
+                      const char *data,
+                      size_t size)
+{
+#if ! defined(_WIN32) || defined(__CYGWIN__)
+  while (0 != size)
+  {
+    ssize_t res;
+    size_t to_write;
+
+    to_write = (size > SSIZE_MAX) ? SSIZE_MAX : size;
+    res = write (connection->rq.upload_fd,
+                 data,
+                 to_write);
+    if (0 > res)
+    {
+      if (EINTR == errno)
+        continue;
+      return false;
+    }
+    if (0 == res)
+      return false;
+    data += (size_t) res;
+    size -= (size_t) res;
+  }
+  return true;
+#else  /* _WIN32 && !__CYGWIN__ */
+  const HANDLE fh = (HANDLE) (uintptr_t) _get_osfhandle (
+    connection->rq.upload_fd);
+
+  if (INVALID_HANDLE_VALUE == fh)
+    return false; /* Value of 'upload_fd' is not valid. */
+  while (0 != size)
+  {
+    DWORD to_write = (size > INT32_MAX) ? INT32_MAX : (DWORD) size;
+    DWORD written;
+
+    if (! WriteFile (fh, (const void *) data, to_write, &written, NULL))
+      return false;
+    if (0 == written)
+      return false;
+    data += (size_t) written;
+    size -= (size_t) written;
+  }
+  return true;
+#endif /* _WIN32 && !__CYGWIN__ */
+}
+
+
+_MHD_EXTERN enum MHD_Result
+MHD_set_connection_upload_fd (struct MHD_Connection *connection,
+                              int fd)
+{
+  struct MHD_Connection *const c = connection; /**< a short alias */
+
+  if (0 > fd)
+    return MHD_NO;
+  if (! c->in_access_handler)
+    return MHD_NO;
+  if ( (MHD_CONNECTION_HEADERS_PROCESSED != c->state) &&
+       (MHD_CONNECTION_BODY_RECEIVING != c->state) )
+    return MHD_NO;
+  if (NULL != c->rp.response)
+    return MHD_NO;
+  if (c->rq.upload_to_fd)
+    return MHD_NO; /* Already set */
+
+  c->rq.upload_fd = fd;
+  c->rq.upload_to_fd = true;
+#ifdef MHD_UPLOAD_SPLICE_SUPPORT
+  c->rq.upload_splice = false;
+#ifdef HTTPS_SUPPORT
+  if (MHD_TLS_CONN_NO_TLS != c->tls_state)
+    return MHD_YES;
+#endif /* HTTPS_SUPPORT */
+#ifdef BODY_DECODING_SUPPORT
+  if (NULL != c->rq.decoder)
+    return MHD_YES; /* The decoded data is written */
+#endif /* BODY_DECODING_SUPPORT */
+  if (c->rq.have_chunked_upload ||
+      (MHD_SIZE_UNKNOWN == c->rq.remaining_upload_size) ||
+      (MHD_UPLOAD_SPLICE_MIN_SIZE > c->rq.remaining_upload_size))
+    return MHD_YES;
+  c->rq.upload_splice = upload_fd_is_spliceable (fd);
+#endif /* MHD_UPLOAD_SPLICE_SUPPORT */
+  return MHD_YES;
+}
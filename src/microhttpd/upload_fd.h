@@ -0,0 +1,99 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     This library is free software; you can redistribute it and/or
+     modify it under the terms of the GNU Lesser General Public
+     License as published by the Free Software Foundation; either
+     version 2.1 of the License, or (at your option) any later version.
+
+     This library is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     Lesser General Public License for more details.
+
+     You should have received a copy of the GNU Lesser General Public
+     License along with this library; if not, write to the Free Software
+     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+
+/**
+ * @file microhttpd/upload_fd.h
+ * @brief  Writing of the request body directly to the application's FD
+ */
+
+#ifndef MHD_UPLOAD_FD_H
+#define MHD_UPLOAD_FD_H 1
+
+#include "internal.h"
+
+
+/**
+ * Write the request body data to the upload FD of the connection.
+ * All data is written, the short writes are retried.
+ *
+ * @param connection the connection to use
+ * @param data the data to write
+ * @param size the size of the @a data
+ * @return true if all data has been written,
+ *         false on write error
+ */
+bool
+MHD_upload_fd_write_ (struct MHD_Connection *connection,
+                      const char *data,
+                      size_t size);
+
+
+/**
+ * Release the resources used for the upload FD, if any.
+ * The upload FD itself is not closed.
+ *
+ * @param connection the connection to use
+ */
+void
+MHD_upload_fd_cleanup_ (struct MHD_Connection *connection);
+
+
+#ifdef MHD_UPLOAD_SPLICE_SUPPORT
+
+/**
+ * The result of #MHD_upload_fd_splice_()
+ */
+enum MHD_UploadSpliceResult
+{
+  /**
+   * The data has been moved (or no data is available yet)
+   */
+  MHD_UPLOAD_SPLICE_OK = 0,
+
+  /**
+   * splice() cannot be used now, the data must be received
+   * in the usual way
+   */
+  MHD_UPLOAD_SPLICE_FALLBACK = 1,
+
+  /**
+   * Failed to write the data to the upload FD
+   */
+  MHD_UPLOAD_SPLICE_WRITE_ERROR = 2
+};
+
+
+/**
+ * Move the request body from the connection socket to the upload FD
+ * by splice() through the pipe, without copying data to the user space.
+ * Must be called only when the read buffer is empty.
+ *
+ * @param connection the connection to use
+ * @return #MHD_UPLOAD_SPLICE_OK if data was moved or socket has no data,
+ *         #MHD_UPLOAD_SPLICE_FALLBACK if data must be received by recv(),
+ *         #MHD_UPLOAD_SPLICE_WRITE_ERROR if writing to the FD failed
+ */
+enum MHD_UploadSpliceResult
+MHD_upload_fd_splice_ (struct MHD_Connection *connection);
+
+#endif /* MHD_UPLOAD_SPLICE_SUPPORT */
+
+#endif /* ! MHD_UPLOAD_FD_H */
@@ -0,0 +1,228 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     libmicrohttpd is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 2, or (at your
+     option) any later version.
+
+     libmicrohttpd is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with libmicrohttpd; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+
+/**
+ * @file test_accept_batch.c
+ * @brief  Testcase for accepting of several pending connections per
+ *         wakeup of the listen socket (MHD_OPTION_ACCEPT_BATCH_SIZE)
+ */
+
+#include "MHD_config.h"
+#include "platform.h"
+#include <microhttpd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#ifndef WINDOWS
+#include <unistd.h>
+#endif
+#include "mhd_sockets.h" /* only macros used */
+
+/**
+ * The number of the connections accepted per wakeup
+ */
+#define BATCH_SIZE 4
+
+/**
+ * The limit of the number of the connections
+ */
+#define CONN_LIMIT 10
+
+/**
+ * The maximum number of the client connections
+ */
+#define MAX_CLIENTS (CONN_LIMIT + 2)
+
+
+static enum MHD_Result
+ahc_echo (void *cls,
+          struct MHD_Connection *connection,
+          const char *url,
+          const char *method,
+          const char *version,
+          const char *upload_data, size_t *upload_data_size,
+          void **req_cls)
+{
+  (void) cls; (void) connection; (void) url; (void) method;
+  (void) version; (void) upload_data; (void) upload_data_size;
+  (void) req_cls; /* Unused. Silent compiler warning. */
+  return MHD_NO;  /* No requests are sent */
+}
+
+
+/**
+ * Get the number of the connections of the daemon.
+ *
+ * @param d the daemon
+ * @return the number of the connections, -1 on error
+ */
+static int
+num_connections (struct MHD_Daemon *d)
+{
+  const union MHD_DaemonInfo *dinfo;
+
+  dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_CURRENT_CONNECTIONS);
+  if (NULL == dinfo)
+    return -1;
+  return (int) dinfo->num_connections;
+}
+
+
+/**
+ * Connect the new clients to the daemon.
+ *
+ * @param sa the address of the daemon
+ * @param clients the array of the client sockets
+ * @param[in,out] num_clients the number of the connected clients
+ * @param num the number of the clients to connect
+ * @return zero on success, non-zero on error
+ */
+static int
+connect_clients (const struct sockaddr_in *sa,
+                 MHD_socket *clients,
+                 unsigned int *num_clients,
+                 unsigned int num)
+{
+  unsigned int i;
+
+  for (i = 0; i < num; i++)
+  {
+    MHD_socket s;
+
+    s = socket (AF_INET, SOCK_STREAM, 0);
+    if (MHD_INVALID_SOCKET == s)
+      return 1;
+    clients[(*num_clients)++] = s;
+    if (0 != connect (s, (const struct sockaddr *) sa, sizeof(*sa)))
+      return 1;
+  }
+  return 0;
+}
+
+
+/**
+ * Run the daemon once and check the number of the connections.
+ *
+ * @param d the daemon
+ * @param expected the expected number of the connections
+ * @param descr the description of the check
+ * @return zero on success, non-zero on error
+ */
+static unsigned int
+run_and_check (struct MHD_Daemon *d, int expected, const char *descr)
+{
+  int num;
+
+  if (MHD_YES != MHD_run (d))
+  {
+    fprintf (stderr, "MHD_run() failed.\n");
+    return 1;
+  }
+  num = num_connections (d);
+  if (expected != num)
+  {
+    fprintf (stderr, "%s: %d connections instead of %d.\n",
+             descr, num, expected);
+    return 1;
+  }
+  return 0;
+}
+
+
+static unsigned int
+testAcceptBatch (unsigned int flags)
+{
+  struct MHD_Daemon *d;
+  const union MHD_DaemonInfo *dinfo;
+  MHD_socket clients[MAX_CLIENTS];
+  unsigned int num_clients;
+  struct sockaddr_in sa;
+  unsigned int errorCount = 0;
+  unsigned int i;
+
+  d = MHD_start_daemon (flags | MHD_USE_ERROR_LOG,
+                        0,
+                        NULL, NULL, &ahc_echo, NULL,
+                        MHD_OPTION_ACCEPT_BATCH_SIZE, (unsigned int) BATCH_SIZE,
+                        MHD_OPTION_CONNECTION_LIMIT, (unsigned int) CONN_LIMIT,
+                        MHD_OPTION_CONNECTION_TIMEOUT, 0u,
+                        MHD_OPTION_END);
+  if (NULL == d)
+    return 2;
+  dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_BIND_PORT);
+  if ((NULL == dinfo) || (0 == dinfo->port) )
+  {
+    MHD_stop_daemon (d);
+    return 4;
+  }
+  memset (&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  sa.sin_port = htons (dinfo->port);
+
+  num_clients = 0;
+  /* The partial batch, accepting stops when no more connections are
+     pending (EAGAIN) */
+  if (0 != connect_clients (&sa, clients, &num_clients, BATCH_SIZE - 1))
+    errorCount |= 8;
+  else
+    errorCount |= run_and_check (d, BATCH_SIZE - 1, "Partial batch") << 4;
+  /* More pending connections than the batch size, the rest is accepted
+     on the next wakeup */
+  if ((0 == errorCount) &&
+      (0 != connect_clients (&sa, clients, &num_clients, BATCH_SIZE + 2)))
+    errorCount |= 8;
+  if (0 == errorCount)
+    errorCount |= run_and_check (d, 2 * BATCH_SIZE - 1, "Full batch") << 5;
+  if (0 == errorCount)
+    errorCount |= run_and_check (d, 2 * BATCH_SIZE + 1, "Next batch") << 6;
+  /* The connection limit is reached inside the batch */
+  if ((0 == errorCount) &&
+      (0 != connect_clients (&sa, clients, &num_clients,
+                             MAX_CLIENTS - num_clients)))
+    errorCount |= 8;
+  if (0 == errorCount)
+    errorCount |= run_and_check (d, CONN_LIMIT, "Limit in batch") << 7;
+  if (0 == errorCount)
+    errorCount |= run_and_check (d, CONN_LIMIT, "Over limit") << 8;
+
+  MHD_stop_daemon (d);
+  for (i = 0; i < num_clients; i++)
+    MHD_socket_close_chk_ (clients[i]);
+  return errorCount;
+}
+
+
+int
+main (int argc, char *const *argv)
+{
+  unsigned int errorCount = 0;
+  (void) argc; (void) argv; /* Unused. Silent compiler warning. */
+
+  if (MHD_NO == MHD_is_feature_supported (MHD_FEATURE_AUTODETECT_BIND_PORT))
+    return 77;
+  errorCount += testAcceptBatch (0);
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_EPOLL))
+    errorCount += testAcceptBatch (MHD_USE_EPOLL);
+  if (errorCount != 0)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  return (0 == errorCount) ? 0 : 1;       /* 0 == pass */
+}
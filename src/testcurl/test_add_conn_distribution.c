@@ -0,0 +1,243 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     libmicrohttpd is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 2, or (at your
+     option) any later version.
+
+     libmicrohttpd is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with libmicrohttpd; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+
+/**
+ * @file test_add_conn_distribution.c
+ * @brief  Testcase for the distribution of the connections added by
+ *         MHD_add_connection() between the threads of the pool
+ *         (MHD_OPTION_WORKER_DISTRIBUTION)
+ */
+
+#include "MHD_config.h"
+#include "platform.h"
+#include <microhttpd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#ifndef WINDOWS
+#include <unistd.h>
+#endif
+#include "mhd_sockets.h" /* only macros used */
+
+/**
+ * The size of the thread pool
+ */
+#define POOL_SIZE 4
+
+/**
+ * The number of the connections added to each thread
+ */
+#define CONN_PER_WORKER 3
+
+#define NUM_CONN (POOL_SIZE * CONN_PER_WORKER)
+
+
+static enum MHD_Result
+ahc_echo (void *cls,
+          struct MHD_Connection *connection,
+          const char *url,
+          const char *method,
+          const char *version,
+          const char *upload_data, size_t *upload_data_size,
+          void **req_cls)
+{
+  (void) cls; (void) connection; (void) url; (void) method;
+  (void) version; (void) upload_data; (void) upload_data_size;
+  (void) req_cls; /* Unused. Silent compiler warning. */
+  return MHD_NO;  /* No requests are sent */
+}
+
+
+/**
+ * Get the number of the connections of the worker thread.
+ *
+ * @param d the daemon
+ * @param idx the index of the worker thread
+ * @return the number of the connections, -1 on error
+ */
+static int
+worker_connections (struct MHD_Daemon *d, unsigned int idx)
+{
+  const union MHD_DaemonInfo *dinfo;
+
+  dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_WORKER_CONNECTIONS, idx);
+  if (NULL == dinfo)
+    return -1;
+  return (int) dinfo->num_connections;
+}
+
+
+/**
+ * Wait until the added connections are processed by the worker threads.
+ *
+ * @param d the daemon
+ * @param num the expected total number of the connections
+ * @return zero on success, non-zero if not processed in time
+ */
+static int
+wait_connections (struct MHD_Daemon *d, unsigned int num)
+{
+  int i;
+
+  for (i = 0; i < 500; i++)
+  {
+    unsigned int total = 0;
+    unsigned int w;
+
+    for (w = 0; w < POOL_SIZE; w++)
+      total += (unsigned int) worker_connections (d, w);
+    if (num == total)
+      return 0;
+    (void) usleep (10000);
+  }
+  return 1;
+}
+
+
+static unsigned int
+testDistribution (unsigned int policy)
+{
+  struct MHD_Daemon *d;
+  MHD_socket lstn;
+  MHD_socket clients[NUM_CONN];
+  struct sockaddr_in sa;
+  socklen_t sa_len;
+  unsigned int errorCount = 0;
+  unsigned int i;
+
+  for (i = 0; i < NUM_CONN; i++)
+    clients[i] = MHD_INVALID_SOCKET;
+  lstn = socket (AF_INET, SOCK_STREAM, 0);
+  if (MHD_INVALID_SOCKET == lstn)
+    return 1;
+  memset (&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  sa.sin_port = 0;
+  sa_len = (socklen_t) sizeof(sa);
+  if ( (0 != bind (lstn, (struct sockaddr *) &sa, sa_len)) ||
+       (0 != listen (lstn, NUM_CONN)) ||
+       (0 != getsockname (lstn, (struct sockaddr *) &sa, &sa_len)) )
+  {
+    MHD_socket_close_chk_ (lstn);
+    return 2;
+  }
+
+  d = MHD_start_daemon (MHD_USE_INTERNAL_POLLING_THREAD | MHD_USE_ITC
+                        | MHD_USE_NO_LISTEN_SOCKET | MHD_USE_ERROR_LOG,
+                        0,
+                        NULL, NULL, &ahc_echo, NULL,
+                        MHD_OPTION_THREAD_POOL_SIZE, (unsigned int) POOL_SIZE,
+                        MHD_OPTION_WORKER_DISTRIBUTION, policy,
+                        MHD_OPTION_CONNECTION_TIMEOUT, 0u,
+                        MHD_OPTION_END);
+  if (NULL == d)
+  {
+    MHD_socket_close_chk_ (lstn);
+    return 4;
+  }
+  if (NULL != MHD_get_daemon_info (d, MHD_DAEMON_INFO_WORKER_CONNECTIONS,
+                                   (unsigned int) POOL_SIZE))
+  {
+    fprintf (stderr, "Information returned for non-existing thread.\n");
+    errorCount |= 8;
+  }
+
+  for (i = 0; (i < NUM_CONN) && (0 == errorCount); i++)
+  {
+    struct sockaddr_in acc_sa;
+    socklen_t acc_sa_len = (socklen_t) sizeof(acc_sa);
+    MHD_socket accepted;
+
+    clients[i] = socket (AF_INET, SOCK_STREAM, 0);
+    if ( (MHD_INVALID_SOCKET == clients[i]) ||
+         (0 != connect (clients[i], (struct sockaddr *) &sa, sa_len)) )
+    {
+      fprintf (stderr, "Failed to connect to the test socket.\n");
+      errorCount |= 16;
+      break;
+    }
+    accepted = accept (lstn, (struct sockaddr *) &acc_sa, &acc_sa_len);
+    if (MHD_INVALID_SOCKET == accepted)
+    {
+      fprintf (stderr, "Failed to accept the test connection.\n");
+      errorCount |= 16;
+      break;
+    }
+    if (MHD_YES != MHD_add_connection (d, accepted,
+                                       (struct sockaddr *) &acc_sa,
+                                       acc_sa_len))
+    {
+      fprintf (stderr, "MHD_add_connection() failed.\n");
+      errorCount |= 32;
+      break;
+    }
+    /* The numbers of the connections are updated by the workers */
+    if (0 != wait_connections (d, i + 1))
+    {
+      fprintf (stderr, "The added connection is not processed.\n");
+      errorCount |= 64;
+    }
+  }
+
+  if ( (0 == errorCount) &&
+       (MHD_WD_LEAST_CONNECTIONS == policy) )
+  {
+    for (i = 0; i < POOL_SIZE; i++)
+    {
+      if (CONN_PER_WORKER != worker_connections (d, i))
+      {
+        fprintf (stderr, "Thread %u has %d connections instead of %d.\n",
+                 i, worker_connections (d, i), CONN_PER_WORKER);
+        errorCount |= 128;
+      }
+    }
+  }
+
+  MHD_stop_daemon (d);
+  for (i = 0; i < NUM_CONN; i++)
+  {
+    if (MHD_INVALID_SOCKET != clients[i])
+      MHD_socket_close_chk_ (clients[i]);
+  }
+  MHD_socket_close_chk_ (lstn);
+  return errorCount;
+}
+
+
+int
+main (int argc, char *const *argv)
+{
+  unsigned int errorCount = 0;
+  (void) argc; (void) argv; /* Unused. Silent compiler warning. */
+
+  if (MHD_NO == MHD_is_feature_supported (MHD_FEATURE_THREADS))
+    return 77;
+  if (MHD_NO == MHD_is_feature_supported (MHD_FEATURE_AUTODETECT_BIND_PORT))
+    return 77;
+  errorCount += testDistribution (MHD_WD_LEAST_CONNECTIONS);
+  errorCount += testDistribution (MHD_WD_TWO_CHOICES);
+  errorCount += testDistribution (MHD_WD_INCOMING_CPU);
+  errorCount += testDistribution (MHD_WD_SOCKET);
+  if (errorCount != 0)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  return (0 == errorCount) ? 0 : 1;       /* 0 == pass */
+}
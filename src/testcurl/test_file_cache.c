@@ -0,0 +1,412 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     libmicrohttpd is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 2, or (at your
+     option) any later version.
+
+     libmicrohttpd is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with libmicrohttpd; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+
+/**
+ * @file test_file_cache.c
+ * @brief  Testcase for the cache of the file-based responses
+ */
+
+#include "MHD_config.h"
+#include "platform.h"
+#include <curl/curl.h>
+#include <microhttpd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#ifndef WINDOWS
+#include <unistd.h>
+#endif
+
+/**
+ * The number of the test files
+ */
+#define NUM_FILES (3)
+
+
+static char *filenames[NUM_FILES];
+
+static struct MHD_FileCache *cache;
+
+
+/**
+ * Write the content of the test file.
+ *
+ * @param idx the index of the file
+ * @param content the content of the file
+ * @return zero on success, non-zero otherwise
+ */
+static int
+write_file (unsigned int idx, const char *content)
+{
+  FILE *f;
+  const size_t len = strlen (content);
+
+  f = fopen (filenames[idx], "wb");
+  if (NULL == f)
+    return 1;
+  if (len != fwrite (content, 1, len, f))
+  {
+    fclose (f);
+    return 1;
+  }
+  return (0 == fclose (f)) ? 0 : 1;
+}
+
+
+static enum MHD_Result
+ahc_echo (void *cls,
+          struct MHD_Connection *connection,
+          const char *url,
+          const char *method,
+          const char *version,
+          const char *upload_data, size_t *upload_data_size,
+          void **req_cls)
+{
+  static int marker;
+  struct MHD_Response *response;
+  enum MHD_Result ret;
+  (void) cls; (void) url; (void) version; /* Unused. Silent compiler warning. */
+  (void) upload_data; (void) upload_data_size; /* Unused. */
+
+  if (0 != strcmp (MHD_HTTP_METHOD_GET, method))
+    return MHD_NO;              /* unexpected method */
+  if (&marker != *req_cls)
+  {
+    *req_cls = &marker;
+    return MHD_YES;
+  }
+  *req_cls = NULL;
+  response = MHD_file_cache_get_response (cache, filenames[0]);
+  if (NULL == response)
+    return MHD_NO;
+  ret = MHD_queue_response (connection, MHD_HTTP_OK, response);
+  MHD_destroy_response (response);
+  return ret;
+}
+
+
+/**
+ * Check the caching of the responses without the daemon.
+ *
+ * @return zero on success, error code otherwise
+ */
+static unsigned int
+testCacheDirect (void)
+{
+  struct MHD_FileCache *c;
+  struct MHD_Response *r[NUM_FILES];
+  struct MHD_Response *r2;
+  unsigned int ret = 0;
+  unsigned int i;
+
+  if (NULL != MHD_file_cache_create (0, 1000, 10, MHD_RF_NONE))
+    return 1;
+  /* The limit of two entries, the long check interval */
+  c = MHD_file_cache_create (2, 1000, 3600, MHD_RF_NONE);
+  if (NULL == c)
+    return 2;
+  for (i = 0; i < NUM_FILES; ++i)
+  {
+    r[i] = MHD_file_cache_get_response (c, filenames[i]);
+    if (NULL == r[i])
+    {
+      fprintf (stderr, "Failed to get the response for '%s'.\n",
+               filenames[i]);
+      ret |= 4;
+    }
+  }
+  if (0 == ret)
+  {
+    /* The most recent entries are cached */
+    r2 = MHD_file_cache_get_response (c, filenames[2]);
+    if (r2 != r[2])
+      ret |= 8;
+    if (NULL != r2)
+      MHD_destroy_response (r2);
+    r2 = MHD_file_cache_get_response (c, filenames[1]);
+    if (r2 != r[1])
+      ret |= 8;
+    if (NULL != r2)
+      MHD_destroy_response (r2);
+    /* The least recently used entry has been removed */
+    r2 = MHD_file_cache_get_response (c, filenames[0]);
+    if ((NULL == r2) || (r2 == r[0]))
+      ret |= 16;
+    if (NULL != r2)
+      MHD_destroy_response (r2);
+  }
+  for (i = 0; i < NUM_FILES; ++i)
+  {
+    if (NULL != r[i])
+      MHD_destroy_response (r[i]);
+  }
+  if (NULL != MHD_file_cache_get_response (c, "no-such-file-for-mhd-test"))
+    ret |= 32;
+  if (NULL != MHD_file_cache_get_response (c, "."))
+    ret |= 64; /* Directory must not be served */
+  MHD_file_cache_destroy (c);
+
+  /* The large files are not cached */
+  c = MHD_file_cache_create (10, 4, 3600, MHD_RF_NONE);
+  if (NULL == c)
+    return ret | 2;
+  r[0] = MHD_file_cache_get_response (c, filenames[0]);
+  r2 = MHD_file_cache_get_response (c, filenames[0]);
+  if ((NULL == r[0]) || (NULL == r2) || (r[0] == r2))
+    ret |= 128;
+  if (NULL != r[0])
+    MHD_destroy_response (r[0]);
+  if (NULL != r2)
+    MHD_destroy_response (r2);
+  MHD_file_cache_destroy (c);
+  if (0 != ret)
+    fprintf (stderr, "Direct cache test failed (code: %u).\n", ret);
+  return ret;
+}
+
+
+/**
+ * The data received by the client
+ */
+struct ReplyData
+{
+  char buf[256];
+  size_t size;
+  char etag[128];
+};
+
+
+static size_t
+copyBuffer (void *ptr, size_t size, size_t nmemb, void *ctx)
+{
+  struct ReplyData *rd = ctx;
+  const size_t len = size * nmemb;
+
+  if (rd->size + len >= sizeof(rd->buf))
+    return 0;
+  memcpy (rd->buf + rd->size, ptr, len);
+  rd->size += len;
+  rd->buf[rd->size] = 0;
+  return len;
+}
+
+
+static size_t
+headerCb (char *ptr, size_t size, size_t nmemb, void *ctx)
+{
+  struct ReplyData *rd = ctx;
+  const size_t len = size * nmemb;
+  static const char etag_hdr[] = MHD_HTTP_HEADER_ETAG ": ";
+
+  if ((len > sizeof(etag_hdr) - 1) &&
+      (0 == strncmp (ptr, etag_hdr, sizeof(etag_hdr) - 1)))
+  {
+    size_t val_len = len - (sizeof(etag_hdr) - 1);
+
+    while ((0 != val_len) &&
+           (('\r' == ptr[sizeof(etag_hdr) - 1 + val_len - 1]) ||
+            ('\n' == ptr[sizeof(etag_hdr) - 1 + val_len - 1])))
+      val_len--;
+    if (val_len >= sizeof(rd->etag))
+      val_len = sizeof(rd->etag) - 1;
+    memcpy (rd->etag, ptr + sizeof(etag_hdr) - 1, val_len);
+    rd->etag[val_len] = 0;
+  }
+  return len;
+}
+
+
+/**
+ * Get the file from the daemon and check the reply.
+ *
+ * @param c the CURL handle to use
+ * @param port the port of the daemon
+ * @param inm the value of "If-None-Match" header, NULL to skip the header
+ * @param expected_code the expected status code
+ * @param expected_body the expected body
+ * @param[out] rd the received data
+ * @return zero on success, error code otherwise
+ */
+static unsigned int
+testGet (CURL *c, uint16_t port, const char *inm,
+         long expected_code, const char *expected_body,
+         struct ReplyData *rd)
+{
+  CURLcode errornum;
+  struct curl_slist *hdrs = NULL;
+  char buf[256];
+  long code;
+
+  memset (rd, 0, sizeof(*rd));
+  if (NULL != inm)
+  {
+    snprintf (buf, sizeof(buf), "If-None-Match: %s", inm);
+    hdrs = curl_slist_append (hdrs, buf);
+  }
+  curl_easy_setopt (c, CURLOPT_URL, "http://127.0.0.1/file");
+  curl_easy_setopt (c, CURLOPT_PORT, (long) port);
+  curl_easy_setopt (c, CURLOPT_WRITEFUNCTION, &copyBuffer);
+  curl_easy_setopt (c, CURLOPT_WRITEDATA, rd);
+  curl_easy_setopt (c, CURLOPT_HEADERFUNCTION, &headerCb);
+  curl_easy_setopt (c, CURLOPT_HEADERDATA, rd);
+  curl_easy_setopt (c, CURLOPT_HTTPHEADER, hdrs);
+  curl_easy_setopt (c, CURLOPT_TIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_CONNECTTIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_NOSIGNAL, 1L);
+  errornum = curl_easy_perform (c);
+  code = 0;
+  curl_easy_getinfo (c, CURLINFO_RESPONSE_CODE, &code);
+  curl_easy_setopt (c, CURLOPT_HTTPHEADER, NULL);
+  curl_slist_free_all (hdrs);
+  if (CURLE_OK != errornum)
+  {
+    fprintf (stderr,
+             "curl_easy_perform failed: `%s'\n",
+             curl_easy_strerror (errornum));
+    return 256;
+  }
+  if (expected_code != code)
+  {
+    fprintf (stderr, "Unexpected HTTP response code: %ld, expected: %ld\n",
+             code, expected_code);
+    return 512;
+  }
+  if (0 != strcmp (expected_body, rd->buf))
+  {
+    fprintf (stderr, "Wrong body: '%s', expected: '%s'\n",
+             rd->buf, expected_body);
+    return 1024;
+  }
+  return 0;
+}
+
+
+static unsigned int
+testDaemon (void)
+{
+  struct MHD_Daemon *d;
+  CURL *c;
+  struct ReplyData rd;
+  unsigned int errorCount = 0;
+  uint16_t port;
+
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_AUTODETECT_BIND_PORT))
+    port = 0;
+  else
+    port = 1616;
+
+  /* Check the file every time */
+  cache = MHD_file_cache_create (16, 1024 * 1024, 0, MHD_RF_NONE);
+  if (NULL == cache)
+    return 2048;
+  d = MHD_start_daemon (MHD_USE_INTERNAL_POLLING_THREAD | MHD_USE_ERROR_LOG,
+                        port,
+                        NULL, NULL, &ahc_echo, NULL,
+                        MHD_OPTION_END);
+  if (d == NULL)
+  {
+    MHD_file_cache_destroy (cache);
+    return 4096;
+  }
+  if (0 == port)
+  {
+    const union MHD_DaemonInfo *dinfo;
+    dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_BIND_PORT);
+    if ((NULL == dinfo) || (0 == dinfo->port) )
+    {
+      MHD_stop_daemon (d);
+      MHD_file_cache_destroy (cache);
+      return 8192;
+    }
+    port = dinfo->port;
+  }
+  c = curl_easy_init ();
+  if (NULL == c)
+  {
+    MHD_stop_daemon (d);
+    MHD_file_cache_destroy (cache);
+    return 16384;
+  }
+  errorCount += testGet (c, port, NULL, MHD_HTTP_OK, "file0", &rd);
+  if ((0 == errorCount) && ('"' != rd.etag[0]))
+    errorCount += 32768;
+  if (0 == errorCount)
+  {
+    char etag[128];
+
+    strcpy (etag, rd.etag);
+    errorCount += testGet (c, port, etag, MHD_HTTP_NOT_MODIFIED, "", &rd);
+    /* The modified file must be served */
+    if (0 != write_file (0, "file0 modified"))
+      errorCount += 65536;
+    errorCount += testGet (c, port, NULL, MHD_HTTP_OK, "file0 modified", &rd);
+    errorCount += testGet (c, port, etag, MHD_HTTP_OK, "file0 modified",
+                           &rd);
+  }
+  curl_easy_cleanup (c);
+  MHD_stop_daemon (d);
+  MHD_file_cache_destroy (cache);
+  return errorCount;
+}
+
+
+int
+main (int argc, char *const *argv)
+{
+  unsigned int errorCount = 0;
+  const char *tmp;
+  unsigned int i;
+  (void) argc; (void) argv; /* Unused. Silent compiler warning. */
+
+  if ( (NULL == (tmp = getenv ("TMPDIR"))) &&
+       (NULL == (tmp = getenv ("TMP"))) &&
+       (NULL == (tmp = getenv ("TEMP"))) )
+    tmp = "/tmp";
+  for (i = 0; i < NUM_FILES; ++i)
+  {
+    char content[16];
+
+    filenames[i] = malloc (strlen (tmp) + 32);
+    if (NULL == filenames[i])
+      return 99;
+    snprintf (filenames[i], strlen (tmp) + 32, "%s/test-mhd-fcache%u",
+              tmp, i);
+    snprintf (content, sizeof(content), "file%u", i);
+    if (0 != write_file (i, content))
+    {
+      fprintf (stderr, "failed to write test file\n");
+      return 99;
+    }
+  }
+  if (0 != curl_global_init (CURL_GLOBAL_WIN32))
+    return 2;
+  errorCount += testCacheDirect ();
+  errorCount += testDaemon ();
+  if (errorCount != 0)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  curl_global_cleanup ();
+  for (i = 0; i < NUM_FILES; ++i)
+  {
+    unlink (filenames[i]);
+    free (filenames[i]);
+  }
+  return (0 == errorCount) ? 0 : 1;       /* 0 == pass */
+}
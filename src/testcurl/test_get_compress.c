@@ -0,0 +1,573 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     libmicrohttpd is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 2, or (at your
+     option) any later version.
+
+     libmicrohttpd is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with libmicrohttpd; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+
+/**
+ * @file test_get_compress.c
+ * @brief  Testcase for compression of the response body (MHD_RF_COMPRESS)
+ *         and for the encoded variants of the response body
+ */
+
+#include "MHD_config.h"
+#include "platform.h"
+#include <curl/curl.h>
+#include <microhttpd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <zlib.h>
+
+/**
+ * The size of the response body
+ */
+#define BODY_SIZE (300 * 1024)
+
+/**
+ * The size of the response body too small for compression
+ */
+#define SMALL_SIZE (100)
+
+/**
+ * The maximum size of the data returned by the content reader callback
+ */
+#define READER_PORTION (5000)
+
+
+/**
+ * The fake "br" variant of the body
+ */
+static const char br_variant[] = "This is not really brotli data";
+
+/**
+ * The entity-tag of the shared response
+ */
+#define SHARED_ETAG "\"shared\""
+
+static char *body;
+
+/**
+ * The response shared by all requests
+ */
+static struct MHD_Response *shared;
+
+
+static char
+pattern_byte (size_t pos)
+{
+  return (char) ('a' + (pos * 7 + pos / 1000) % 26);
+}
+
+
+static ssize_t
+body_reader (void *cls, uint64_t pos, char *buf, size_t max)
+{
+  (void) cls; /* Unused. Silent compiler warning. */
+  if (BODY_SIZE <= pos)
+    return MHD_CONTENT_READER_END_OF_STREAM;
+  if (max > READER_PORTION)
+    max = READER_PORTION;
+  if (max > BODY_SIZE - pos)
+    max = (size_t) (BODY_SIZE - pos);
+  memcpy (buf, body + pos, max);
+  return (ssize_t) max;
+}
+
+
+static enum MHD_Result
+ahc_echo (void *cls,
+          struct MHD_Connection *connection,
+          const char *url,
+          const char *method,
+          const char *version,
+          const char *upload_data, size_t *upload_data_size,
+          void **req_cls)
+{
+  static int marker;
+  struct MHD_Response *response;
+  enum MHD_Result ret;
+  (void) cls; (void) version; /* Unused. Silent compiler warning. */
+  (void) upload_data; (void) upload_data_size; /* Unused. */
+
+  if (0 != strcmp (MHD_HTTP_METHOD_GET, method))
+    return MHD_NO;              /* unexpected method */
+  if (&marker != *req_cls)
+  {
+    *req_cls = &marker;
+    return MHD_YES;
+  }
+  *req_cls = NULL;
+  if (0 == strcmp ("/shared", url))
+    return MHD_queue_response (connection, MHD_HTTP_OK, shared);
+  if (0 == strcmp ("/buffer", url))
+    response = MHD_create_response_from_buffer_static (BODY_SIZE, body);
+  else if (0 == strcmp ("/small", url))
+    response = MHD_create_response_from_buffer_static (SMALL_SIZE, body);
+  else if (0 == strcmp ("/reader", url))
+    response = MHD_create_response_from_callback (BODY_SIZE, 4096,
+                                                  &body_reader, NULL, NULL);
+  else if (0 == strcmp ("/reader_unknown", url))
+    response = MHD_create_response_from_callback (MHD_SIZE_UNKNOWN, 4096,
+                                                  &body_reader, NULL, NULL);
+  else if (0 == strcmp ("/iov", url))
+  {
+    struct MHD_IoVec iov[3];
+
+    iov[0].iov_base = body;
+    iov[0].iov_len = 1000;
+    iov[1].iov_base = body + 1000;
+    iov[1].iov_len = 0;
+    iov[2].iov_base = body + 1000;
+    iov[2].iov_len = BODY_SIZE - 1000;
+    response = MHD_create_response_from_iovec (iov, 3, NULL, NULL);
+  }
+  else
+    return MHD_NO;
+  if (NULL == response)
+    return MHD_NO;
+  if (MHD_YES != MHD_set_response_options (response,
+                                           MHD_RF_COMPRESS,
+                                           MHD_RO_END))
+  {
+    MHD_destroy_response (response);
+    return MHD_NO;
+  }
+  ret = MHD_queue_response (connection, MHD_HTTP_OK, response);
+  MHD_destroy_response (response);
+  return ret;
+}
+
+
+/**
+ * The data received by the client
+ */
+struct ReplyData
+{
+  char *buf;
+  size_t size;
+  size_t alloc;
+  char encoding[32];
+  char etag[64];
+  int has_vary;
+  int has_length;
+};
+
+
+static size_t
+copyBuffer (void *ptr, size_t size, size_t nmemb, void *ctx)
+{
+  struct ReplyData *rd = ctx;
+  const size_t len = size * nmemb;
+
+  if (rd->size + len > rd->alloc)
+    return 0;
+  memcpy (rd->buf + rd->size, ptr, len);
+  rd->size += len;
+  return len;
+}
+
+
+/**
+ * Copy the value of the header line without the line termination.
+ *
+ * @param val the value of the header
+ * @param val_len the length of the @a val with the line termination
+ * @param[out] buf the buffer to copy the value to
+ * @param buf_size the size of the @a buf
+ */
+static void
+copyHeaderValue (const char *val, size_t val_len, char *buf, size_t buf_size)
+{
+  while ((0 != val_len) &&
+         (('\r' == val[val_len - 1]) || ('\n' == val[val_len - 1])))
+    val_len--;
+  if (val_len >= buf_size)
+    val_len = buf_size - 1;
+  memcpy (buf, val, val_len);
+  buf[val_len] = 0;
+}
+
+
+static size_t
+headerCb (char *ptr, size_t size, size_t nmemb, void *ctx)
+{
+  struct ReplyData *rd = ctx;
+  const size_t len = size * nmemb;
+  static const char enc_hdr[] = MHD_HTTP_HEADER_CONTENT_ENCODING ": ";
+  static const char etag_hdr[] = MHD_HTTP_HEADER_ETAG ": ";
+  static const char vary_hdr[] = MHD_HTTP_HEADER_VARY ": "
+                                 MHD_HTTP_HEADER_ACCEPT_ENCODING;
+  static const char len_hdr[] = MHD_HTTP_HEADER_CONTENT_LENGTH ":";
+
+  if ((len > sizeof(enc_hdr) - 1) &&
+      (0 == strncmp (ptr, enc_hdr, sizeof(enc_hdr) - 1)))
+    copyHeaderValue (ptr + sizeof(enc_hdr) - 1, len - (sizeof(enc_hdr) - 1),
+                     rd->encoding, sizeof(rd->encoding));
+  else if ((len > sizeof(etag_hdr) - 1) &&
+           (0 == strncmp (ptr, etag_hdr, sizeof(etag_hdr) - 1)))
+    copyHeaderValue (ptr + sizeof(etag_hdr) - 1, len - (sizeof(etag_hdr) - 1),
+                     rd->etag, sizeof(rd->etag));
+  else if ((len >= sizeof(vary_hdr) - 1) &&
+           (0 == strncmp (ptr, vary_hdr, sizeof(vary_hdr) - 1)))
+    rd->has_vary = 1;
+  else if ((len >= sizeof(len_hdr) - 1) &&
+           (0 == strncmp (ptr, len_hdr, sizeof(len_hdr) - 1)))
+    rd->has_length = 1;
+  return len;
+}
+
+
+/**
+ * Decompress the reply and check the content.
+ *
+ * @param rd the received data
+ * @param gzip if non-zero then "gzip" format is expected, "deflate" otherwise
+ * @param expected_size the expected size of the decompressed data
+ * @return zero on success, non-zero otherwise
+ */
+static unsigned int
+check_compressed (const struct ReplyData *rd, int gzip, size_t expected_size)
+{
+  z_stream strm;
+  char *plain;
+  size_t i;
+  int ret;
+
+  plain = malloc (expected_size + 1);
+  if (NULL == plain)
+    return 1;
+  memset (&strm, 0, sizeof(strm));
+  if (Z_OK != inflateInit2 (&strm, gzip ? (MAX_WBITS + 16) : MAX_WBITS))
+  {
+    free (plain);
+    return 1;
+  }
+  strm.next_in = (Bytef *) rd->buf;
+  strm.avail_in = (uInt) rd->size;
+  strm.next_out = (Bytef *) plain;
+  strm.avail_out = (uInt) (expected_size + 1);
+  ret = inflate (&strm, Z_FINISH);
+  inflateEnd (&strm);
+  if ((Z_STREAM_END != ret) || (0 != strm.avail_in) ||
+      (expected_size != strm.total_out))
+  {
+    fprintf (stderr, "Failed to decompress the reply: %d, "
+             "decompressed size: %lu.\n",
+             ret, (unsigned long) strm.total_out);
+    free (plain);
+    return 1;
+  }
+  for (i = 0; i < expected_size; i++)
+  {
+    if (pattern_byte (i) != plain[i])
+    {
+      fprintf (stderr, "Wrong byte at position %lu.\n", (unsigned long) i);
+      free (plain);
+      return 1;
+    }
+  }
+  free (plain);
+  if (rd->size >= expected_size)
+  {
+    fprintf (stderr, "The data is not compressed.\n");
+    return 1;
+  }
+  return 0;
+}
+
+
+/**
+ * Get the resource and check the reply.
+ *
+ * @param c the CURL handle to use (re-used for keep-alive)
+ * @param port the port of the daemon
+ * @param url the path of the resource
+ * @param accept_enc the value of "Accept-Encoding" header, NULL to skip
+ *                   the header
+ * @param expected_enc the expected content coding, NULL if the reply
+ *                     must not be compressed
+ * @param expected_size the expected size of the response content
+ * @return zero on success, error code otherwise
+ */
+static unsigned int
+testGet (CURL *c, uint16_t port,
+         const char *url,
+         const char *accept_enc,
+         const char *expected_enc,
+         size_t expected_size)
+{
+  struct ReplyData rd;
+  CURLcode errornum;
+  struct curl_slist *hdrs = NULL;
+  char buf[256];
+  long code;
+
+  memset (&rd, 0, sizeof(rd));
+  rd.alloc = 2 * BODY_SIZE;
+  rd.buf = malloc (rd.alloc);
+  if (NULL == rd.buf)
+    return 1;
+  if (NULL != accept_enc)
+  {
+    snprintf (buf, sizeof(buf), "Accept-Encoding: %s", accept_enc);
+    hdrs = curl_slist_append (hdrs, buf);
+  }
+  snprintf (buf, sizeof(buf), "http://127.0.0.1%s", url);
+  curl_easy_setopt (c, CURLOPT_URL, buf);
+  curl_easy_setopt (c, CURLOPT_PORT, (long) port);
+  curl_easy_setopt (c, CURLOPT_WRITEFUNCTION, &copyBuffer);
+  curl_easy_setopt (c, CURLOPT_WRITEDATA, &rd);
+  curl_easy_setopt (c, CURLOPT_HEADERFUNCTION, &headerCb);
+  curl_easy_setopt (c, CURLOPT_HEADERDATA, &rd);
+  curl_easy_setopt (c, CURLOPT_HTTPHEADER, hdrs);
+  curl_easy_setopt (c, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+  curl_easy_setopt (c, CURLOPT_TIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_CONNECTTIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_NOSIGNAL, 1L);
+  errornum = curl_easy_perform (c);
+  code = 0;
+  curl_easy_getinfo (c, CURLINFO_RESPONSE_CODE, &code);
+  curl_easy_setopt (c, CURLOPT_HTTPHEADER, NULL);
+  curl_slist_free_all (hdrs);
+  if (CURLE_OK != errornum)
+  {
+    fprintf (stderr,
+             "curl_easy_perform failed: `%s'\n",
+             curl_easy_strerror (errornum));
+    free (rd.buf);
+    return 2;
+  }
+  if (MHD_HTTP_OK != code)
+  {
+    fprintf (stderr, "Unexpected HTTP response code: %ld\n", code);
+    free (rd.buf);
+    return 4;
+  }
+  if (! rd.has_vary)
+  {
+    fprintf (stderr, "No 'Vary' header in the reply for '%s'.\n", url);
+    free (rd.buf);
+    return 8;
+  }
+  if (0 == strcmp (url, "/shared"))
+  {
+    /* Each variant has its own entity-tag */
+    if (NULL == expected_enc)
+      snprintf (buf, sizeof(buf), "%s", SHARED_ETAG);
+    else
+      snprintf (buf, sizeof(buf), "\"shared-%s\"", expected_enc);
+    if (0 != strcmp (buf, rd.etag))
+    {
+      fprintf (stderr, "Wrong 'ETag' of the reply for '%s': '%s', "
+               "expected: '%s'.\n", url, rd.etag, buf);
+      free (rd.buf);
+      return 8;
+    }
+  }
+  if (NULL == expected_enc)
+  {
+    if ((0 != rd.encoding[0]) || (expected_size != rd.size) ||
+        (0 != memcmp (rd.buf, body, expected_size)))
+    {
+      fprintf (stderr, "Wrong uncompressed reply for '%s' "
+               "(Accept-Encoding: %s).\n", url,
+               (NULL == accept_enc) ? "none" : accept_enc);
+      free (rd.buf);
+      return 16;
+    }
+    free (rd.buf);
+    return 0;
+  }
+  if (0 != strcmp (expected_enc, rd.encoding))
+  {
+    fprintf (stderr, "Wrong content coding of the reply for '%s': '%s', "
+             "expected: '%s'.\n", url, rd.encoding, expected_enc);
+    free (rd.buf);
+    return 32;
+  }
+  /* The buffer-based responses are compressed once and sent with
+     "Content-Length", other responses are compressed on the fly */
+  if (((0 == strcmp (url, "/buffer")) || (0 == strcmp (url, "/shared"))) !=
+      (0 != rd.has_length))
+  {
+    fprintf (stderr, "Wrong 'Content-Length' header use for '%s'.\n", url);
+    free (rd.buf);
+    return 64;
+  }
+  if (0 == strcmp ("br", expected_enc))
+  {
+    if ((sizeof(br_variant) - 1 != rd.size) ||
+        (0 != memcmp (rd.buf, br_variant, rd.size)))
+    {
+      fprintf (stderr, "Wrong 'br' variant of the reply.\n");
+      free (rd.buf);
+      return 128;
+    }
+    free (rd.buf);
+    return 0;
+  }
+  if (0 != check_compressed (&rd,
+                             (0 == strcmp ("gzip", expected_enc)),
+                             expected_size))
+  {
+    fprintf (stderr, "Wrong compressed reply for '%s'.\n", url);
+    free (rd.buf);
+    return 128;
+  }
+  free (rd.buf);
+  return 0;
+}
+
+
+static unsigned int
+testDaemon (unsigned int flags, unsigned int pool_size, int level)
+{
+  struct MHD_Daemon *d;
+  CURL *c;
+  unsigned int errorCount = 0;
+  uint16_t port;
+
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_AUTODETECT_BIND_PORT))
+    port = 0;
+  else
+    port = 1612;
+
+  if (0 != pool_size)
+    d = MHD_start_daemon (flags | MHD_USE_ERROR_LOG,
+                          port,
+                          NULL, NULL, &ahc_echo, NULL,
+                          MHD_OPTION_THREAD_POOL_SIZE, pool_size,
+                          MHD_OPTION_RESPONSE_COMPRESSION_LEVEL, level,
+                          MHD_OPTION_END);
+  else
+    d = MHD_start_daemon (flags | MHD_USE_ERROR_LOG,
+                          port,
+                          NULL, NULL, &ahc_echo, NULL,
+                          MHD_OPTION_RESPONSE_COMPRESSION_LEVEL, level,
+                          MHD_OPTION_END);
+  if (d == NULL)
+    return 1024;
+  if (0 == port)
+  {
+    const union MHD_DaemonInfo *dinfo;
+    dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_BIND_PORT);
+    if ((NULL == dinfo) || (0 == dinfo->port) )
+    {
+      MHD_stop_daemon (d); return 2048;
+    }
+    port = dinfo->port;
+  }
+  c = curl_easy_init ();
+  if (NULL == c)
+  {
+    MHD_stop_daemon (d);
+    return 4096;
+  }
+  /* The same connection is used for all requests, the compressor
+     is reused */
+  errorCount += testGet (c, port, "/buffer", "gzip", "gzip", BODY_SIZE);
+  errorCount += testGet (c, port, "/buffer", "deflate", "deflate",
+                         BODY_SIZE);
+  errorCount += testGet (c, port, "/buffer", "deflate;q=0.5, gzip;q=0.8",
+                         "gzip", BODY_SIZE);
+  errorCount += testGet (c, port, "/buffer", "gzip;q=0.2, deflate",
+                         "deflate", BODY_SIZE);
+  errorCount += testGet (c, port, "/buffer", "gzip;q=0, *", "deflate",
+                         BODY_SIZE);
+  errorCount += testGet (c, port, "/buffer", NULL, NULL, BODY_SIZE);
+  errorCount += testGet (c, port, "/buffer", "br", NULL, BODY_SIZE);
+  errorCount += testGet (c, port, "/buffer", "identity, gzip;q=0", NULL,
+                         BODY_SIZE);
+  errorCount += testGet (c, port, "/small", "gzip", NULL, SMALL_SIZE);
+  errorCount += testGet (c, port, "/reader", "gzip", "gzip", BODY_SIZE);
+  errorCount += testGet (c, port, "/reader_unknown", "x-gzip, deflate",
+                         "gzip", BODY_SIZE);
+  errorCount += testGet (c, port, "/reader_unknown", "deflate", "deflate",
+                         BODY_SIZE);
+  errorCount += testGet (c, port, "/iov", "gzip", "gzip", BODY_SIZE);
+  errorCount += testGet (c, port, "/iov", NULL, NULL, BODY_SIZE);
+  /* The shared response with the "br" variant, compressed once */
+  errorCount += testGet (c, port, "/shared", "gzip, deflate, br", "br", 0);
+  errorCount += testGet (c, port, "/shared", "gzip, br;q=0.9", "gzip",
+                         BODY_SIZE);
+  errorCount += testGet (c, port, "/shared", "gzip, br;q=0.9", "gzip",
+                         BODY_SIZE);
+  errorCount += testGet (c, port, "/shared", "deflate", "deflate",
+                         BODY_SIZE);
+  errorCount += testGet (c, port, "/shared", "*", "br", 0);
+  errorCount += testGet (c, port, "/shared", "identity", NULL, BODY_SIZE);
+  curl_easy_cleanup (c);
+  MHD_stop_daemon (d);
+  return errorCount;
+}
+
+
+int
+main (int argc, char *const *argv)
+{
+  unsigned int errorCount = 0;
+  size_t i;
+  (void) argc; (void) argv; /* Unused. Silent compiler warning. */
+
+  if (MHD_NO == MHD_is_feature_supported (MHD_FEATURE_RESPONSE_COMPRESSION))
+    return 77;
+  body = malloc (BODY_SIZE);
+  if (NULL == body)
+    return 99;
+  for (i = 0; i < BODY_SIZE; i++)
+    body[i] = pattern_byte (i);
+  shared = MHD_create_response_from_buffer_static (BODY_SIZE, body);
+  if ((NULL == shared) ||
+      (MHD_YES != MHD_set_response_options (shared,
+                                            MHD_RF_COMPRESS,
+                                            MHD_RO_END)) ||
+      (MHD_YES != MHD_add_response_header (shared, MHD_HTTP_HEADER_ETAG,
+                                           SHARED_ETAG)) ||
+      (MHD_YES != MHD_add_response_variant_static (shared, "br",
+                                                   sizeof(br_variant) - 1,
+                                                   br_variant)) ||
+      (MHD_NO != MHD_add_response_variant_static (shared, "BR",
+                                                  sizeof(br_variant) - 1,
+                                                  br_variant)) ||
+      (MHD_NO != MHD_add_response_variant_static (shared, "identity",
+                                                  sizeof(br_variant) - 1,
+                                                  br_variant)))
+  {
+    MHD_destroy_response (shared);
+    free (body);
+    return 99;
+  }
+  if (0 != curl_global_init (CURL_GLOBAL_WIN32))
+  {
+    MHD_destroy_response (shared);
+    free (body);
+    return 2;
+  }
+  errorCount += testDaemon (MHD_USE_INTERNAL_POLLING_THREAD, 0, 0);
+  errorCount += testDaemon (MHD_USE_INTERNAL_POLLING_THREAD, 2, 1);
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_THREADS))
+    errorCount += testDaemon (MHD_USE_THREAD_PER_CONNECTION
+                              | MHD_USE_INTERNAL_POLLING_THREAD, 0, 9);
+  if (errorCount != 0)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  curl_global_cleanup ();
+  MHD_destroy_response (shared);
+  free (body);
+  return (0 == errorCount) ? 0 : 1;       /* 0 == pass */
+}
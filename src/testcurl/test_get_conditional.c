@@ -0,0 +1,480 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     libmicrohttpd is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 2, or (at your
+     option) any later version.
+
+     libmicrohttpd is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with libmicrohttpd; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+
+/**
+ * @file test_get_conditional.c
+ * @brief  Testcase for automatic processing of conditional requests
+ *         (MHD_RO_ETAG, MHD_RO_LAST_MODIFIED, MHD_RO_VALIDATORS_FROM_FD)
+ */
+
+#include "MHD_config.h"
+#include "platform.h"
+#include <curl/curl.h>
+#include <microhttpd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <errno.h>
+#ifndef WINDOWS
+#include <unistd.h>
+#endif
+
+/**
+ * The size of the response body
+ */
+#define BODY_SIZE (10000)
+
+/**
+ * The entity-tag of the buffer response
+ */
+#define BODY_ETAG "\"v1\""
+
+/**
+ * The modification time of the buffer response
+ */
+#define BODY_MTIME ((uint64_t) 784111777)
+
+/**
+ * The modification time of the buffer response as HTTP date
+ */
+#define BODY_DATE "Sun, 06 Nov 1994 08:49:37 GMT"
+
+
+static char *body;
+
+static char *sourcefile;
+
+
+static enum MHD_Result
+ahc_echo (void *cls,
+          struct MHD_Connection *connection,
+          const char *url,
+          const char *method,
+          const char *version,
+          const char *upload_data, size_t *upload_data_size,
+          void **req_cls)
+{
+  static int marker;
+  struct MHD_Response *response;
+  enum MHD_Result ret;
+  (void) cls; (void) version; /* Unused. Silent compiler warning. */
+  (void) upload_data; (void) upload_data_size; /* Unused. */
+
+  if ( (0 != strcmp (MHD_HTTP_METHOD_GET, method)) &&
+       (0 != strcmp (MHD_HTTP_METHOD_HEAD, method)) )
+    return MHD_NO;              /* unexpected method */
+  if (&marker != *req_cls)
+  {
+    *req_cls = &marker;
+    return MHD_YES;
+  }
+  *req_cls = NULL;
+  if (0 == strcmp ("/buffer", url))
+  {
+    response = MHD_create_response_from_buffer_static (BODY_SIZE, body);
+    if ( (NULL != response) &&
+         (MHD_YES != MHD_set_response_options (response,
+                                               MHD_RF_NONE,
+                                               MHD_RO_ETAG, BODY_ETAG,
+                                               MHD_RO_LAST_MODIFIED,
+                                               BODY_MTIME,
+                                               MHD_RO_END)) )
+    {
+      fprintf (stderr, "Failed to set the validators.\n");
+      MHD_destroy_response (response);
+      return MHD_NO;
+    }
+  }
+  else if (0 == strcmp ("/file", url))
+  {
+    int fd;
+
+    fd = open (sourcefile, O_RDONLY);
+    if (-1 == fd)
+    {
+      fprintf (stderr, "Failed to open `%s': %s\n",
+               sourcefile,
+               strerror (errno));
+      return MHD_NO;
+    }
+    response = MHD_create_response_from_fd (BODY_SIZE, fd);
+    if ( (NULL != response) &&
+         (MHD_YES != MHD_set_response_options (response,
+                                               MHD_RF_NONE,
+                                               MHD_RO_VALIDATORS_FROM_FD,
+                                               MHD_RO_END)) )
+    {
+      fprintf (stderr, "Failed to set the validators from the file.\n");
+      MHD_destroy_response (response);
+      return MHD_NO;
+    }
+  }
+  else if (0 == strcmp ("/plain", url))
+    response = MHD_create_response_from_buffer_static (BODY_SIZE, body);
+  else
+    return MHD_NO;
+  if (NULL == response)
+    return MHD_NO;
+  ret = MHD_queue_response (connection, MHD_HTTP_OK, response);
+  MHD_destroy_response (response);
+  return ret;
+}
+
+
+/**
+ * The data received by the client
+ */
+struct ReplyData
+{
+  char *buf;
+  size_t size;
+  size_t alloc;
+  char etag[128];
+  char last_modified[128];
+};
+
+
+static size_t
+copyBuffer (void *ptr, size_t size, size_t nmemb, void *ctx)
+{
+  struct ReplyData *rd = ctx;
+  const size_t len = size * nmemb;
+
+  if (rd->size + len > rd->alloc)
+    return 0;
+  memcpy (rd->buf + rd->size, ptr, len);
+  rd->size += len;
+  return len;
+}
+
+
+/**
+ * Copy the value of the header, if the header line has the required name.
+ *
+ * @param line the header line
+ * @param len the length of the @a line
+ * @param name the name of the header with ": "
+ * @param[out] value the buffer for the value
+ * @param value_size the size of the @a value buffer
+ */
+static void
+get_header_value (const char *line, size_t len, const char *name,
+                  char *value, size_t value_size)
+{
+  const size_t name_len = strlen (name);
+  size_t val_len;
+
+  if ((len <= name_len) || (0 != strncmp (line, name, name_len)))
+    return;
+  val_len = len - name_len;
+  while ((0 != val_len) && (('\r' == line[name_len + val_len - 1]) ||
+                            ('\n' == line[name_len + val_len - 1])))
+    val_len--;
+  if (val_len >= value_size)
+    val_len = value_size - 1;
+  memcpy (value, line + name_len, val_len);
+  value[val_len] = 0;
+}
+
+
+static size_t
+headerCb (char *ptr, size_t size, size_t nmemb, void *ctx)
+{
+  struct ReplyData *rd = ctx;
+  const size_t len = size * nmemb;
+
+  get_header_value (ptr, len, MHD_HTTP_HEADER_ETAG ": ",
+                    rd->etag, sizeof(rd->etag));
+  get_header_value (ptr, len, MHD_HTTP_HEADER_LAST_MODIFIED ": ",
+                    rd->last_modified, sizeof(rd->last_modified));
+  return len;
+}
+
+
+/**
+ * Get the resource and check the reply.
+ *
+ * @param c the CURL handle to use (re-used for keep-alive)
+ * @param port the port of the daemon
+ * @param url the path of the resource
+ * @param inm the value of "If-None-Match" header, NULL to skip the header
+ * @param ims the value of "If-Modified-Since" header, NULL to skip
+ *            the header
+ * @param expected_code the expected status code
+ * @param[out] rd_out if not NULL, set to the received data (the body
+ *                    buffer is freed)
+ * @return zero on success, error code otherwise
+ */
+static unsigned int
+testGet (CURL *c, uint16_t port,
+         const char *url,
+         const char *inm,
+         const char *ims,
+         long expected_code,
+         struct ReplyData *rd_out)
+{
+  struct ReplyData rd;
+  CURLcode errornum;
+  struct curl_slist *hdrs = NULL;
+  char buf[256];
+  long code;
+  unsigned int ret;
+
+  memset (&rd, 0, sizeof(rd));
+  rd.alloc = 2 * BODY_SIZE;
+  rd.buf = malloc (rd.alloc);
+  if (NULL == rd.buf)
+    return 1;
+  if (NULL != inm)
+  {
+    snprintf (buf, sizeof(buf), "If-None-Match: %s", inm);
+    hdrs = curl_slist_append (hdrs, buf);
+  }
+  if (NULL != ims)
+  {
+    snprintf (buf, sizeof(buf), "If-Modified-Since: %s", ims);
+    hdrs = curl_slist_append (hdrs, buf);
+  }
+  snprintf (buf, sizeof(buf), "http://127.0.0.1%s", url);
+  curl_easy_setopt (c, CURLOPT_URL, buf);
+  curl_easy_setopt (c, CURLOPT_PORT, (long) port);
+  curl_easy_setopt (c, CURLOPT_WRITEFUNCTION, &copyBuffer);
+  curl_easy_setopt (c, CURLOPT_WRITEDATA, &rd);
+  curl_easy_setopt (c, CURLOPT_HEADERFUNCTION, &headerCb);
+  curl_easy_setopt (c, CURLOPT_HEADERDATA, &rd);
+  curl_easy_setopt (c, CURLOPT_HTTPHEADER, hdrs);
+  curl_easy_setopt (c, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+  curl_easy_setopt (c, CURLOPT_TIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_CONNECTTIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_NOSIGNAL, 1L);
+  errornum = curl_easy_perform (c);
+  code = 0;
+  curl_easy_getinfo (c, CURLINFO_RESPONSE_CODE, &code);
+  curl_easy_setopt (c, CURLOPT_HTTPHEADER, NULL);
+  curl_slist_free_all (hdrs);
+  if (CURLE_OK != errornum)
+  {
+    fprintf (stderr,
+             "curl_easy_perform failed: `%s'\n",
+             curl_easy_strerror (errornum));
+    free (rd.buf);
+    return 2;
+  }
+  ret = 0;
+  if (expected_code != code)
+  {
+    fprintf (stderr, "Unexpected HTTP response code for '%s' "
+             "(If-None-Match: %s, If-Modified-Since: %s): %ld, "
+             "expected: %ld\n", url,
+             (NULL == inm) ? "none" : inm,
+             (NULL == ims) ? "none" : ims,
+             code, expected_code);
+    ret = 4;
+  }
+  else if (MHD_HTTP_NOT_MODIFIED == code)
+  {
+    if ((0 != rd.size) || (0 == rd.etag[0]) || (0 == rd.last_modified[0]))
+    {
+      fprintf (stderr, "Wrong 'Not Modified' reply for '%s'.\n", url);
+      ret = 8;
+    }
+  }
+  else if ((BODY_SIZE != rd.size) || (0 != memcmp (rd.buf, body, BODY_SIZE)))
+  {
+    fprintf (stderr, "Wrong full reply for '%s'.\n", url);
+    ret = 16;
+  }
+  free (rd.buf);
+  if (NULL != rd_out)
+  {
+    *rd_out = rd;
+    rd_out->buf = NULL;
+  }
+  return ret;
+}
+
+
+/**
+ * Test the replies for one resource with the validators.
+ *
+ * @param c the CURL handle to use
+ * @param port the port of the daemon
+ * @param url the path of the resource
+ * @return zero on success, error code otherwise
+ */
+static unsigned int
+testResource (CURL *c, uint16_t port, const char *url)
+{
+  struct ReplyData rd;
+  char buf[256];
+  unsigned int errorCount = 0;
+
+  errorCount += testGet (c, port, url, NULL, NULL, MHD_HTTP_OK, &rd);
+  if ((0 != errorCount) || ('"' != rd.etag[0]) || (0 == rd.last_modified[0]))
+  {
+    fprintf (stderr, "No validators in the reply for '%s'.\n", url);
+    return errorCount + 32;
+  }
+  errorCount += testGet (c, port, url, rd.etag, NULL,
+                         MHD_HTTP_NOT_MODIFIED, NULL);
+  errorCount += testGet (c, port, url, "\"other\"", NULL,
+                         MHD_HTTP_OK, NULL);
+  snprintf (buf, sizeof(buf), "\"other\", W/\"x,y\",%s", rd.etag);
+  errorCount += testGet (c, port, url, buf, NULL,
+                         MHD_HTTP_NOT_MODIFIED, NULL);
+  snprintf (buf, sizeof(buf), "W/%s", rd.etag);
+  errorCount += testGet (c, port, url, buf, NULL,
+                         MHD_HTTP_NOT_MODIFIED, NULL);
+  errorCount += testGet (c, port, url, "*", NULL,
+                         MHD_HTTP_NOT_MODIFIED, NULL);
+  errorCount += testGet (c, port, url, NULL, rd.last_modified,
+                         MHD_HTTP_NOT_MODIFIED, NULL);
+  errorCount += testGet (c, port, url, NULL, "Fri, 31 Dec 9999 23:59:59 GMT",
+                         MHD_HTTP_NOT_MODIFIED, NULL);
+  errorCount += testGet (c, port, url, NULL, "Sun, 06 Nov 1994 08:49:36 GMT",
+                         MHD_HTTP_OK, NULL);
+  errorCount += testGet (c, port, url, NULL, "not a date",
+                         MHD_HTTP_OK, NULL);
+  /* "If-Modified-Since" is ignored when "If-None-Match" is present */
+  errorCount += testGet (c, port, url, "\"other\"", rd.last_modified,
+                         MHD_HTTP_OK, NULL);
+  return errorCount;
+}
+
+
+static unsigned int
+testDaemon (unsigned int flags)
+{
+  struct MHD_Daemon *d;
+  CURL *c;
+  unsigned int errorCount = 0;
+  uint16_t port;
+
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_AUTODETECT_BIND_PORT))
+    port = 0;
+  else
+    port = 1615;
+
+  d = MHD_start_daemon (flags | MHD_USE_ERROR_LOG,
+                        port,
+                        NULL, NULL, &ahc_echo, NULL,
+                        MHD_OPTION_END);
+  if (d == NULL)
+    return 1024;
+  if (0 == port)
+  {
+    const union MHD_DaemonInfo *dinfo;
+    dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_BIND_PORT);
+    if ((NULL == dinfo) || (0 == dinfo->port) )
+    {
+      MHD_stop_daemon (d); return 2048;
+    }
+    port = dinfo->port;
+  }
+  c = curl_easy_init ();
+  if (NULL == c)
+  {
+    MHD_stop_daemon (d);
+    return 4096;
+  }
+  errorCount += testResource (c, port, "/buffer");
+  errorCount += testResource (c, port, "/file");
+  if (1)
+  {
+    struct ReplyData rd;
+
+    if (0 != testGet (c, port, "/buffer", NULL, NULL, MHD_HTTP_OK, &rd))
+      errorCount += 64;
+    else if ((0 != strcmp (BODY_ETAG, rd.etag)) ||
+             (0 != strcmp (BODY_DATE, rd.last_modified)))
+    {
+      fprintf (stderr, "Wrong validators: '%s', '%s'.\n",
+               rd.etag, rd.last_modified);
+      errorCount += 64;
+    }
+  }
+  /* The response without validators is always sent in full */
+  errorCount += testGet (c, port, "/plain", "*", NULL, MHD_HTTP_OK, NULL);
+  errorCount += testGet (c, port, "/plain", NULL, BODY_DATE,
+                         MHD_HTTP_OK, NULL);
+  curl_easy_cleanup (c);
+  MHD_stop_daemon (d);
+  return errorCount;
+}
+
+
+int
+main (int argc, char *const *argv)
+{
+  unsigned int errorCount = 0;
+  const char *tmp;
+  FILE *f;
+  size_t i;
+  (void) argc; (void) argv; /* Unused. Silent compiler warning. */
+
+  body = malloc (BODY_SIZE);
+  if (NULL == body)
+    return 99;
+  for (i = 0; i < BODY_SIZE; i++)
+    body[i] = (char) ('a' + i % 26);
+  if ( (NULL == (tmp = getenv ("TMPDIR"))) &&
+       (NULL == (tmp = getenv ("TMP"))) &&
+       (NULL == (tmp = getenv ("TEMP"))) )
+    tmp = "/tmp";
+  sourcefile = malloc (strlen (tmp) + 32);
+  if (NULL == sourcefile)
+  {
+    free (body);
+    return 99;
+  }
+  snprintf (sourcefile, strlen (tmp) + 32, "%s/%s", tmp, "test-mhd-cond");
+  f = fopen (sourcefile, "wb");
+  if ((NULL == f) || (1 != fwrite (body, BODY_SIZE, 1, f)))
+  {
+    fprintf (stderr, "failed to write test file\n");
+    if (NULL != f)
+      fclose (f);
+    free (sourcefile);
+    free (body);
+    return 99;
+  }
+  fclose (f);
+  if (0 != curl_global_init (CURL_GLOBAL_WIN32))
+  {
+    unlink (sourcefile);
+    free (sourcefile);
+    free (body);
+    return 2;
+  }
+  errorCount += testDaemon (MHD_USE_INTERNAL_POLLING_THREAD);
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_THREADS))
+    errorCount += testDaemon (MHD_USE_THREAD_PER_CONNECTION
+                              | MHD_USE_INTERNAL_POLLING_THREAD);
+  if (errorCount != 0)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  curl_global_cleanup ();
+  unlink (sourcefile);
+  free (sourcefile);
+  free (body);
+  return (0 == errorCount) ? 0 : 1;       /* 0 == pass */
+}
@@ -0,0 +1,378 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     libmicrohttpd is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 2, or (at your
+     option) any later version.
+
+     libmicrohttpd is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with libmicrohttpd; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+
+/**
+ * @file test_get_content_pending.c
+ * @brief  Testcase for the content reader waiting for the data
+ *         (MHD_CONTENT_READER_PENDING, MHD_content_reader_ready())
+ */
+
+#include "MHD_config.h"
+#include "platform.h"
+#include <curl/curl.h>
+#include <microhttpd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#ifndef WINDOWS
+#include <unistd.h>
+#endif
+
+/**
+ * The number of the pieces of the response data
+ */
+#define NUM_PIECES 10
+
+/**
+ * The size of the piece of the response data
+ */
+#define PIECE_SIZE 1000
+
+/**
+ * The delay between the pieces produced by the producer thread,
+ * in microseconds
+ */
+#define PIECE_DELAY_US 20000
+
+
+/**
+ * The state of the response data shared with the producer thread
+ */
+struct Producer
+{
+  pthread_mutex_t lock;
+  pthread_t tid;
+  struct MHD_Connection *connection;
+  /**
+   * The number of the pieces produced so far
+   */
+  unsigned int produced;
+  /**
+   * The number of the times the content reader has returned
+   * #MHD_CONTENT_READER_PENDING
+   */
+  unsigned int pending;
+  int started;
+};
+
+static struct Producer producer;
+
+/**
+ * Set to use the compression of the response
+ */
+static int use_compress;
+
+
+static void *
+produce_data (void *cls)
+{
+  struct Producer *p = cls;
+  unsigned int i;
+
+  for (i = 0; i < NUM_PIECES; i++)
+  {
+    usleep (PIECE_DELAY_US);
+    pthread_mutex_lock (&p->lock);
+    p->produced++;
+    pthread_mutex_unlock (&p->lock);
+    MHD_content_reader_ready (p->connection);
+  }
+  return NULL;
+}
+
+
+static char
+piece_char (uint64_t pos)
+{
+  return (char) ('a' + (pos / PIECE_SIZE + pos * 3) % 26);
+}
+
+
+static ssize_t
+content_reader (void *cls, uint64_t pos, char *buf, size_t max)
+{
+  struct Producer *p = cls;
+  unsigned int produced;
+  size_t size;
+  size_t i;
+
+  if (NUM_PIECES * PIECE_SIZE == pos)
+    return MHD_CONTENT_READER_END_OF_STREAM;
+  pthread_mutex_lock (&p->lock);
+  produced = p->produced;
+  if ((uint64_t) produced * PIECE_SIZE <= pos)
+    p->pending++;
+  pthread_mutex_unlock (&p->lock);
+  if ((uint64_t) produced * PIECE_SIZE <= pos)
+    return MHD_CONTENT_READER_PENDING;
+  size = (size_t) ((uint64_t) produced * PIECE_SIZE - pos);
+  if (size > max)
+    size = max;
+  for (i = 0; i < size; i++)
+    buf[i] = piece_char (pos + i);
+  return (ssize_t) size;
+}
+
+
+static enum MHD_Result
+ahc_echo (void *cls,
+          struct MHD_Connection *connection,
+          const char *url,
+          const char *method,
+          const char *version,
+          const char *upload_data, size_t *upload_data_size,
+          void **req_cls)
+{
+  static int marker;
+  struct MHD_Response *response;
+  enum MHD_Result ret;
+  (void) cls; (void) url; (void) version; /* Unused. Silent compiler warning. */
+  (void) upload_data; (void) upload_data_size; /* Unused. */
+
+  if (0 != strcmp (MHD_HTTP_METHOD_GET, method))
+    return MHD_NO;              /* unexpected method */
+  if (&marker != *req_cls)
+  {
+    *req_cls = &marker;
+    return MHD_YES;
+  }
+  *req_cls = NULL;
+  response = MHD_create_response_from_callback (MHD_SIZE_UNKNOWN,
+                                                PIECE_SIZE,
+                                                &content_reader,
+                                                &producer,
+                                                NULL);
+  if (NULL == response)
+    return MHD_NO;
+  if ( (use_compress) &&
+       (MHD_YES != MHD_set_response_options (response,
+                                             MHD_RF_COMPRESS,
+                                             MHD_RO_END)) )
+  {
+    MHD_destroy_response (response);
+    return MHD_NO;
+  }
+  ret = MHD_queue_response (connection, MHD_HTTP_OK, response);
+  MHD_destroy_response (response);
+  if (MHD_YES != ret)
+    return ret;
+  producer.connection = connection;
+  if (0 != pthread_create (&producer.tid, NULL, &produce_data, &producer))
+    return MHD_NO;
+  producer.started = 1;
+  return MHD_YES;
+}
+
+
+/**
+ * The data received by the client
+ */
+struct ReplyData
+{
+  char buf[NUM_PIECES * PIECE_SIZE + 1];
+  size_t size;
+};
+
+
+static size_t
+copyBuffer (void *ptr, size_t size, size_t nmemb, void *ctx)
+{
+  struct ReplyData *rd = ctx;
+  const size_t len = size * nmemb;
+
+  if (rd->size + len > sizeof(rd->buf))
+    return 0;
+  memcpy (rd->buf + rd->size, ptr, len);
+  rd->size += len;
+  return len;
+}
+
+
+/**
+ * Get the response and check the reply.
+ *
+ * @param c the CURL handle to use (re-used for keep-alive)
+ * @param port the port of the daemon
+ * @return zero on success, error code otherwise
+ */
+static unsigned int
+testGet (CURL *c, uint16_t port)
+{
+  static struct ReplyData rd;
+  CURLcode errornum;
+  long code;
+  unsigned int ret;
+  size_t i;
+
+  rd.size = 0;
+  producer.produced = 0;
+  producer.pending = 0;
+  producer.started = 0;
+  curl_easy_setopt (c, CURLOPT_URL, "http://127.0.0.1/stream");
+  curl_easy_setopt (c, CURLOPT_PORT, (long) port);
+  curl_easy_setopt (c, CURLOPT_WRITEFUNCTION, &copyBuffer);
+  curl_easy_setopt (c, CURLOPT_WRITEDATA, &rd);
+  curl_easy_setopt (c, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+  if (use_compress)
+    curl_easy_setopt (c, CURLOPT_ACCEPT_ENCODING, "gzip");
+  curl_easy_setopt (c, CURLOPT_TIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_CONNECTTIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_NOSIGNAL, 1L);
+  errornum = curl_easy_perform (c);
+  code = 0;
+  curl_easy_getinfo (c, CURLINFO_RESPONSE_CODE, &code);
+  if (producer.started)
+    pthread_join (producer.tid, NULL);
+  if (CURLE_OK != errornum)
+  {
+    fprintf (stderr,
+             "curl_easy_perform failed: `%s'\n",
+             curl_easy_strerror (errornum));
+    return 2;
+  }
+  ret = 0;
+  if (MHD_HTTP_OK != code)
+  {
+    fprintf (stderr, "Unexpected HTTP response code: %ld\n", code);
+    ret |= 4;
+  }
+  if (NUM_PIECES * PIECE_SIZE != rd.size)
+  {
+    fprintf (stderr, "Wrong reply size: %u bytes received.\n",
+             (unsigned int) rd.size);
+    ret |= 8;
+  }
+  else
+  {
+    for (i = 0; i < rd.size; i++)
+    {
+      if (piece_char (i) != rd.buf[i])
+      {
+        fprintf (stderr, "Wrong reply data at position %u.\n",
+                 (unsigned int) i);
+        ret |= 8;
+        break;
+      }
+    }
+  }
+  /* The content reader is not called again until the producer has
+     signalled the next piece.  It waits once for each piece, the
+     compression may ask for more data after each piece once more. */
+  if (2 * NUM_PIECES < producer.pending)
+  {
+    fprintf (stderr, "Too many waits for the data: %u.\n",
+             producer.pending);
+    ret |= 16;
+  }
+  return ret;
+}
+
+
+static unsigned int
+testDaemon (unsigned int flags, unsigned int pool_size)
+{
+  struct MHD_Daemon *d;
+  CURL *c;
+  unsigned int errorCount = 0;
+  uint16_t port;
+
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_AUTODETECT_BIND_PORT))
+    port = 0;
+  else
+    port = 1619;
+
+  d = MHD_start_daemon (flags | MHD_USE_ITC | MHD_USE_ERROR_LOG,
+                        port,
+                        NULL, NULL, &ahc_echo, NULL,
+                        MHD_OPTION_THREAD_POOL_SIZE, pool_size,
+                        MHD_OPTION_END);
+  if (d == NULL)
+    return 1024;
+  if (0 == port)
+  {
+    const union MHD_DaemonInfo *dinfo;
+    dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_BIND_PORT);
+    if ((NULL == dinfo) || (0 == dinfo->port) )
+    {
+      MHD_stop_daemon (d); return 2048;
+    }
+    port = dinfo->port;
+  }
+  c = curl_easy_init ();
+  if (NULL == c)
+  {
+    MHD_stop_daemon (d);
+    return 4096;
+  }
+  /* Two requests over the same connection */
+  errorCount += testGet (c, port);
+  errorCount += testGet (c, port);
+  curl_easy_cleanup (c);
+  MHD_stop_daemon (d);
+  return errorCount;
+}
+
+
+static unsigned int
+testAllModes (void)
+{
+  unsigned int errorCount = 0;
+
+  errorCount += testDaemon (MHD_USE_INTERNAL_POLLING_THREAD, 0);
+  errorCount += testDaemon (MHD_USE_INTERNAL_POLLING_THREAD, 4);
+  errorCount += testDaemon (MHD_USE_THREAD_PER_CONNECTION
+                            | MHD_USE_INTERNAL_POLLING_THREAD, 0);
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_POLL))
+    errorCount += testDaemon (MHD_USE_INTERNAL_POLLING_THREAD
+                              | MHD_USE_POLL, 0);
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_EPOLL))
+    errorCount += testDaemon (MHD_USE_INTERNAL_POLLING_THREAD
+                              | MHD_USE_EPOLL, 0);
+  return errorCount;
+}
+
+
+int
+main (int argc, char *const *argv)
+{
+  unsigned int errorCount = 0;
+  (void) argc; (void) argv; /* Unused. Silent compiler warning. */
+
+  if (MHD_NO == MHD_is_feature_supported (MHD_FEATURE_THREADS))
+    return 77;
+  if (0 != pthread_mutex_init (&producer.lock, NULL))
+    return 99;
+  if (0 != curl_global_init (CURL_GLOBAL_WIN32))
+    return 2;
+  use_compress = 0;
+  errorCount += testAllModes ();
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_RESPONSE_COMPRESSION))
+  {
+    use_compress = 1;
+    errorCount += testAllModes ();
+  }
+  if (errorCount != 0)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  curl_global_cleanup ();
+  pthread_mutex_destroy (&producer.lock);
+  return (0 == errorCount) ? 0 : 1;       /* 0 == pass */
+}
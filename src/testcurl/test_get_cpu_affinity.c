@@ -0,0 +1,296 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     libmicrohttpd is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 2, or (at your
+     option) any later version.
+
+     libmicrohttpd is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with libmicrohttpd; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+
+/**
+ * @file test_get_cpu_affinity.c
+ * @brief  Testcase for binding of the daemon threads to the CPUs
+ *         (MHD_OPTION_THREAD_CPU_AFFINITY)
+ */
+
+#include "MHD_config.h"
+#include "platform.h"
+#include <curl/curl.h>
+#include <microhttpd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+#ifdef HAVE_PTHREAD_NP_H
+#include <pthread_np.h>
+#endif
+#include <sched.h>
+#endif /* HAVE_PTHREAD_SETAFFINITY_NP */
+
+#define EXPECTED_REPLY "CPU affinity test"
+
+/**
+ * The CPU the daemon threads are bound to
+ */
+static unsigned int test_cpu;
+
+/**
+ * Set to non-zero if the request was processed by the thread not
+ * bound to the @a test_cpu
+ */
+static volatile int wrong_cpu;
+
+/**
+ * The number of the processed requests
+ */
+static volatile unsigned int num_requests;
+
+
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+/**
+ * Check whether the current thread is bound to the @a cpu only.
+ *
+ * @param cpu the number of the CPU
+ * @return non-zero if the thread is bound to the @a cpu only,
+ *         zero otherwise
+ */
+static int
+is_bound_to_cpu (unsigned int cpu)
+{
+  cpu_set_t cpu_set;
+  unsigned int i;
+
+  if (0 != pthread_getaffinity_np (pthread_self (), sizeof (cpu_set),
+                                   &cpu_set))
+    return 0;
+  for (i = 0; i < CPU_SETSIZE; i++)
+  {
+    if ((i == cpu) != (0 != CPU_ISSET (i, &cpu_set)))
+      return 0;
+  }
+  return ! 0;
+}
+
+
+#endif /* HAVE_PTHREAD_SETAFFINITY_NP */
+
+
+static enum MHD_Result
+ahc_echo (void *cls,
+          struct MHD_Connection *connection,
+          const char *url,
+          const char *method,
+          const char *version,
+          const char *upload_data, size_t *upload_data_size,
+          void **req_cls)
+{
+  static int marker;
+  struct MHD_Response *response;
+  enum MHD_Result ret;
+  (void) cls; (void) url; (void) version; /* Unused. Silent compiler warning. */
+  (void) upload_data; (void) upload_data_size; /* Unused. */
+
+  if (0 != strcmp (MHD_HTTP_METHOD_GET, method))
+    return MHD_NO;              /* unexpected method */
+  if (&marker != *req_cls)
+  {
+    *req_cls = &marker;
+    return MHD_YES;
+  }
+  *req_cls = NULL;
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+  if (! is_bound_to_cpu (test_cpu))
+    wrong_cpu = ! 0;
+#endif /* HAVE_PTHREAD_SETAFFINITY_NP */
+  num_requests++;
+  response =
+    MHD_create_response_from_buffer_static (strlen (EXPECTED_REPLY),
+                                            EXPECTED_REPLY);
+  if (NULL == response)
+    return MHD_NO;
+  ret = MHD_queue_response (connection, MHD_HTTP_OK, response);
+  MHD_destroy_response (response);
+  return ret;
+}
+
+
+static size_t
+discardBuffer (void *ptr, size_t size, size_t nmemb, void *ctx)
+{
+  (void) ptr; (void) ctx; /* Unused. Silent compiler warning. */
+  return size * nmemb;
+}
+
+
+/**
+ * Perform the request to the daemon.
+ *
+ * @param port the port of the daemon
+ * @return zero on success, error code otherwise
+ */
+static unsigned int
+testGet (uint16_t port)
+{
+  CURL *c;
+  CURLcode errornum;
+  long code;
+
+  c = curl_easy_init ();
+  if (NULL == c)
+    return 4096;
+  curl_easy_setopt (c, CURLOPT_URL, "http://127.0.0.1/affinity");
+  curl_easy_setopt (c, CURLOPT_PORT, (long) port);
+  curl_easy_setopt (c, CURLOPT_WRITEFUNCTION, &discardBuffer);
+  curl_easy_setopt (c, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+  curl_easy_setopt (c, CURLOPT_TIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_CONNECTTIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_NOSIGNAL, 1L);
+  /* Do not re-use the connection, so the next request could be
+     processed by other thread of the pool */
+  curl_easy_setopt (c, CURLOPT_FORBID_REUSE, 1L);
+  errornum = curl_easy_perform (c);
+  code = 0;
+  curl_easy_getinfo (c, CURLINFO_RESPONSE_CODE, &code);
+  curl_easy_cleanup (c);
+  if (CURLE_OK != errornum)
+  {
+    fprintf (stderr,
+             "curl_easy_perform failed: `%s'\n",
+             curl_easy_strerror (errornum));
+    return 2;
+  }
+  if (MHD_HTTP_OK != code)
+  {
+    fprintf (stderr, "Unexpected HTTP response code: %ld\n", code);
+    return 4;
+  }
+  return 0;
+}
+
+
+static unsigned int
+testDaemon (unsigned int flags, unsigned int pool_size)
+{
+  struct MHD_Daemon *d;
+  unsigned int errorCount = 0;
+  unsigned int cpus[2];
+  uint16_t port;
+  unsigned int i;
+
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_AUTODETECT_BIND_PORT))
+    port = 0;
+  else
+    port = 1620;
+
+  cpus[0] = test_cpu;
+  cpus[1] = test_cpu;
+  wrong_cpu = 0;
+  num_requests = 0;
+  d = MHD_start_daemon (flags | MHD_USE_ERROR_LOG,
+                        port,
+                        NULL, NULL, &ahc_echo, NULL,
+                        MHD_OPTION_THREAD_POOL_SIZE, pool_size,
+                        MHD_OPTION_THREAD_CPU_AFFINITY,
+                        (unsigned int) (sizeof(cpus) / sizeof(cpus[0])), cpus,
+                        MHD_OPTION_END);
+  if (d == NULL)
+    return 1024;
+  if (0 == port)
+  {
+    const union MHD_DaemonInfo *dinfo;
+    dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_BIND_PORT);
+    if ((NULL == dinfo) || (0 == dinfo->port) )
+    {
+      MHD_stop_daemon (d); return 2048;
+    }
+    port = dinfo->port;
+  }
+  for (i = 0; i < 4; i++)
+    errorCount += testGet (port);
+  MHD_stop_daemon (d);
+  if (4 != num_requests)
+  {
+    fprintf (stderr, "Wrong number of requests processed: %u.\n",
+             num_requests);
+    errorCount |= 8;
+  }
+  if (wrong_cpu)
+  {
+    fprintf (stderr, "The request is processed by the thread not bound "
+             "to CPU %u.\n", test_cpu);
+    errorCount |= 16;
+  }
+  return errorCount;
+}
+
+
+int
+main (int argc, char *const *argv)
+{
+  unsigned int errorCount = 0;
+  struct MHD_Daemon *d;
+  unsigned int cpu;
+  (void) argc; (void) argv; /* Unused. Silent compiler warning. */
+
+  if (MHD_NO == MHD_is_feature_supported (MHD_FEATURE_THREADS))
+    return 77;
+  if (MHD_NO == MHD_is_feature_supported (MHD_FEATURE_THREAD_CPU_AFFINITY))
+    return 77;
+  test_cpu = 0;
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+  if (1)
+  {
+    /* Use the CPU available for this process */
+    cpu_set_t cpu_set;
+
+    if (0 != pthread_getaffinity_np (pthread_self (), sizeof (cpu_set),
+                                     &cpu_set))
+      return 99;
+    for (test_cpu = 0; test_cpu < CPU_SETSIZE; test_cpu++)
+    {
+      if (CPU_ISSET (test_cpu, &cpu_set))
+        break;
+    }
+    if (CPU_SETSIZE == test_cpu)
+      return 99;
+  }
+#endif /* HAVE_PTHREAD_SETAFFINITY_NP */
+  /* The option is not compatible with thread-per-connection mode */
+  cpu = test_cpu;
+  d = MHD_start_daemon (MHD_USE_INTERNAL_POLLING_THREAD
+                        | MHD_USE_THREAD_PER_CONNECTION,
+                        0, NULL, NULL, &ahc_echo, NULL,
+                        MHD_OPTION_THREAD_CPU_AFFINITY, 1u, &cpu,
+                        MHD_OPTION_END);
+  if (NULL != d)
+  {
+    fprintf (stderr, "The daemon is started in thread-per-connection mode "
+             "with MHD_OPTION_THREAD_CPU_AFFINITY.\n");
+    MHD_stop_daemon (d);
+    errorCount |= 32;
+  }
+  if (0 != curl_global_init (CURL_GLOBAL_WIN32))
+    return 2;
+  errorCount += testDaemon (MHD_USE_INTERNAL_POLLING_THREAD, 0);
+  errorCount += testDaemon (MHD_USE_INTERNAL_POLLING_THREAD, 2);
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_EPOLL))
+    errorCount += testDaemon (MHD_USE_INTERNAL_POLLING_THREAD
+                              | MHD_USE_EPOLL, 2);
+  if (errorCount != 0)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  curl_global_cleanup ();
+  return (0 == errorCount) ? 0 : 1;       /* 0 == pass */
+}
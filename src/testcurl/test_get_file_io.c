@@ -0,0 +1,302 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     libmicrohttpd is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 2, or (at your
+     option) any later version.
+
+     libmicrohttpd is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with libmicrohttpd; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+
+/**
+ * @file test_get_file_io.c
+ * @brief  Testcase for reading the file-based responses by the I/O threads
+ *         (MHD_OPTION_FILE_IO_THREADS)
+ */
+
+#include "MHD_config.h"
+#include "platform.h"
+#include <curl/curl.h>
+#include <microhttpd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <errno.h>
+#ifndef WINDOWS
+#include <unistd.h>
+#endif
+
+/**
+ * The size of the test file, several windows of the I/O threads and
+ * the incomplete last window
+ */
+#define BODY_SIZE (1000000 + 123)
+
+
+static char *body;
+
+static char *sourcefile;
+
+
+/**
+ * Remove the data of the test file from the page cache, so the data is
+ * read by the I/O threads.
+ */
+static void
+drop_file_cache (void)
+{
+#ifdef HAVE_POSIX_FADVISE
+  int fd;
+
+  fd = open (sourcefile, O_RDONLY);
+  if (-1 == fd)
+    return;
+  (void) posix_fadvise (fd, 0, 0, POSIX_FADV_DONTNEED);
+  close (fd);
+#endif /* HAVE_POSIX_FADVISE */
+}
+
+
+static enum MHD_Result
+ahc_echo (void *cls,
+          struct MHD_Connection *connection,
+          const char *url,
+          const char *method,
+          const char *version,
+          const char *upload_data, size_t *upload_data_size,
+          void **req_cls)
+{
+  static int marker;
+  struct MHD_Response *response;
+  enum MHD_Result ret;
+  int fd;
+  (void) cls; (void) url; (void) version; /* Unused. Silent compiler warning. */
+  (void) upload_data; (void) upload_data_size; /* Unused. */
+
+  if (0 != strcmp (MHD_HTTP_METHOD_GET, method))
+    return MHD_NO;              /* unexpected method */
+  if (&marker != *req_cls)
+  {
+    *req_cls = &marker;
+    return MHD_YES;
+  }
+  *req_cls = NULL;
+  fd = open (sourcefile, O_RDONLY);
+  if (-1 == fd)
+  {
+    fprintf (stderr, "Failed to open `%s': %s\n",
+             sourcefile,
+             strerror (errno));
+    return MHD_NO;
+  }
+  response = MHD_create_response_from_fd (BODY_SIZE, fd);
+  if (NULL == response)
+    return MHD_NO;
+  ret = MHD_queue_response (connection, MHD_HTTP_OK, response);
+  MHD_destroy_response (response);
+  return ret;
+}
+
+
+/**
+ * The data received by the client
+ */
+struct ReplyData
+{
+  char *buf;
+  size_t size;
+  size_t alloc;
+};
+
+
+static size_t
+copyBuffer (void *ptr, size_t size, size_t nmemb, void *ctx)
+{
+  struct ReplyData *rd = ctx;
+  const size_t len = size * nmemb;
+
+  if (rd->size + len > rd->alloc)
+    return 0;
+  memcpy (rd->buf + rd->size, ptr, len);
+  rd->size += len;
+  return len;
+}
+
+
+/**
+ * Get the file and check the reply.
+ *
+ * @param c the CURL handle to use (re-used for keep-alive)
+ * @param port the port of the daemon
+ * @return zero on success, error code otherwise
+ */
+static unsigned int
+testGet (CURL *c, uint16_t port)
+{
+  struct ReplyData rd;
+  CURLcode errornum;
+  long code;
+  unsigned int ret;
+
+  rd.size = 0;
+  rd.alloc = BODY_SIZE + 1;
+  rd.buf = malloc (rd.alloc);
+  if (NULL == rd.buf)
+    return 1;
+  drop_file_cache ();
+  curl_easy_setopt (c, CURLOPT_URL, "http://127.0.0.1/file");
+  curl_easy_setopt (c, CURLOPT_PORT, (long) port);
+  curl_easy_setopt (c, CURLOPT_WRITEFUNCTION, &copyBuffer);
+  curl_easy_setopt (c, CURLOPT_WRITEDATA, &rd);
+  curl_easy_setopt (c, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+  curl_easy_setopt (c, CURLOPT_TIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_CONNECTTIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_NOSIGNAL, 1L);
+  errornum = curl_easy_perform (c);
+  code = 0;
+  curl_easy_getinfo (c, CURLINFO_RESPONSE_CODE, &code);
+  if (CURLE_OK != errornum)
+  {
+    fprintf (stderr,
+             "curl_easy_perform failed: `%s'\n",
+             curl_easy_strerror (errornum));
+    free (rd.buf);
+    return 2;
+  }
+  ret = 0;
+  if (MHD_HTTP_OK != code)
+  {
+    fprintf (stderr, "Unexpected HTTP response code: %ld\n", code);
+    ret = 4;
+  }
+  else if ((BODY_SIZE != rd.size) || (0 != memcmp (rd.buf, body, BODY_SIZE)))
+  {
+    fprintf (stderr, "Wrong reply, %u bytes received.\n",
+             (unsigned int) rd.size);
+    ret = 8;
+  }
+  free (rd.buf);
+  return ret;
+}
+
+
+static unsigned int
+testDaemon (unsigned int flags, unsigned int pool_size)
+{
+  struct MHD_Daemon *d;
+  CURL *c;
+  unsigned int errorCount = 0;
+  uint16_t port;
+  unsigned int i;
+
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_AUTODETECT_BIND_PORT))
+    port = 0;
+  else
+    port = 1618;
+
+  d = MHD_start_daemon (flags | MHD_USE_ERROR_LOG,
+                        port,
+                        NULL, NULL, &ahc_echo, NULL,
+                        MHD_OPTION_FILE_IO_THREADS, 2u,
+                        MHD_OPTION_THREAD_POOL_SIZE, pool_size,
+                        MHD_OPTION_END);
+  if (d == NULL)
+    return 1024;
+  if (0 == port)
+  {
+    const union MHD_DaemonInfo *dinfo;
+    dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_BIND_PORT);
+    if ((NULL == dinfo) || (0 == dinfo->port) )
+    {
+      MHD_stop_daemon (d); return 2048;
+    }
+    port = dinfo->port;
+  }
+  c = curl_easy_init ();
+  if (NULL == c)
+  {
+    MHD_stop_daemon (d);
+    return 4096;
+  }
+  for (i = 0; i < 3; i++)
+    errorCount += testGet (c, port);
+  curl_easy_cleanup (c);
+  MHD_stop_daemon (d);
+  return errorCount;
+}
+
+
+int
+main (int argc, char *const *argv)
+{
+  unsigned int errorCount = 0;
+  const char *tmp;
+  FILE *f;
+  size_t i;
+  (void) argc; (void) argv; /* Unused. Silent compiler warning. */
+
+  if (MHD_NO == MHD_is_feature_supported (MHD_FEATURE_FILE_IO_THREADS))
+    return 77;
+  body = malloc (BODY_SIZE);
+  if (NULL == body)
+    return 99;
+  for (i = 0; i < BODY_SIZE; i++)
+    body[i] = (char) ('a' + (i * 7 + i / 1000) % 26);
+  if ( (NULL == (tmp = getenv ("TMPDIR"))) &&
+       (NULL == (tmp = getenv ("TMP"))) &&
+       (NULL == (tmp = getenv ("TEMP"))) )
+    tmp = "/tmp";
+  sourcefile = malloc (strlen (tmp) + 32);
+  if (NULL == sourcefile)
+  {
+    free (body);
+    return 99;
+  }
+  snprintf (sourcefile, strlen (tmp) + 32, "%s/%s", tmp, "test-mhd-file-io");
+  f = fopen (sourcefile, "wb");
+  if ((NULL == f) || (1 != fwrite (body, BODY_SIZE, 1, f)))
+  {
+    fprintf (stderr, "failed to write test file\n");
+    if (NULL != f)
+      fclose (f);
+    free (sourcefile);
+    free (body);
+    return 99;
+  }
+  fclose (f);
+  if (0 != curl_global_init (CURL_GLOBAL_WIN32))
+  {
+    unlink (sourcefile);
+    free (sourcefile);
+    free (body);
+    return 2;
+  }
+  errorCount += testDaemon (MHD_USE_INTERNAL_POLLING_THREAD, 0);
+  errorCount += testDaemon (MHD_USE_INTERNAL_POLLING_THREAD, 4);
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_EPOLL))
+    errorCount += testDaemon (MHD_USE_INTERNAL_POLLING_THREAD
+                              | MHD_USE_EPOLL, 0);
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_POLL))
+    errorCount += testDaemon (MHD_USE_INTERNAL_POLLING_THREAD
+                              | MHD_USE_POLL, 0);
+  if (errorCount != 0)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  curl_global_cleanup ();
+  unlink (sourcefile);
+  free (sourcefile);
+  free (body);
+  return (0 == errorCount) ? 0 : 1;       /* 0 == pass */
+}
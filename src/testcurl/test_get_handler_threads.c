@@ -0,0 +1,384 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     libmicrohttpd is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 2, or (at your
+     option) any later version.
+
+     libmicrohttpd is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with libmicrohttpd; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+
+/**
+ * @file test_get_handler_threads.c
+ * @brief  Testcase for calling of the access handler by the handler
+ *         threads (MHD_OPTION_HANDLER_THREADS)
+ */
+
+#include "MHD_config.h"
+#include "platform.h"
+#include <curl/curl.h>
+#include <microhttpd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#ifndef WINDOWS
+#include <unistd.h>
+#endif
+
+#define EXPECTED_REPLY "Handler threads test"
+
+/**
+ * The maximum number of the parallel requests
+ */
+#define MAX_CLIENTS 4
+
+/**
+ * The body of the POST request
+ */
+#define POST_DATA "Some data for the handler"
+
+/**
+ * The lock for the counters of the handlers
+ */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * The number of the handlers waiting at the same time
+ */
+static unsigned int num_waiting;
+
+/**
+ * The maximum number of the handlers waiting at the same time
+ */
+static unsigned int max_waiting;
+
+/**
+ * The number of the handlers to wait for
+ */
+static unsigned int wait_for;
+
+/**
+ * The state of the request
+ */
+struct RequestState
+{
+  /**
+   * Set to non-zero when the request has been suspended by the handler
+   */
+  int suspended;
+
+  /**
+   * The size of the received request body
+   */
+  size_t body_size;
+};
+
+
+/**
+ * Wait until @a wait_for handlers are waiting at the same time or
+ * the timeout expires.
+ */
+static void
+wait_for_handlers (void)
+{
+  int i;
+
+  pthread_mutex_lock (&lock);
+  num_waiting++;
+  if (max_waiting < num_waiting)
+    max_waiting = num_waiting;
+  pthread_mutex_unlock (&lock);
+  for (i = 0; i < 500; i++)
+  {
+    unsigned int w;
+
+    pthread_mutex_lock (&lock);
+    w = max_waiting;
+    pthread_mutex_unlock (&lock);
+    if (w >= wait_for)
+      break;
+    (void) usleep (10000);
+  }
+  pthread_mutex_lock (&lock);
+  num_waiting--;
+  pthread_mutex_unlock (&lock);
+}
+
+
+static void *
+resume_later (void *cls)
+{
+  struct MHD_Connection *const connection = (struct MHD_Connection *) cls;
+
+  (void) usleep (100000);
+  MHD_resume_connection (connection);
+  return NULL;
+}
+
+
+static enum MHD_Result
+ahc_echo (void *cls,
+          struct MHD_Connection *connection,
+          const char *url,
+          const char *method,
+          const char *version,
+          const char *upload_data, size_t *upload_data_size,
+          void **req_cls)
+{
+  struct RequestState *rs;
+  struct MHD_Response *response;
+  enum MHD_Result ret;
+  (void) cls; (void) version; (void) upload_data; /* Unused. */
+
+  if (NULL == *req_cls)
+  {
+    rs = (struct RequestState *) calloc (1, sizeof(*rs));
+    if (NULL == rs)
+      return MHD_NO;
+    *req_cls = rs;
+    return MHD_YES;
+  }
+  rs = (struct RequestState *) *req_cls;
+  if (0 != *upload_data_size)
+  {
+    rs->body_size += *upload_data_size;
+    *upload_data_size = 0;
+    return MHD_YES;
+  }
+  if (0 == strcmp (url, "/fail"))
+    return MHD_NO;
+  if ( (0 == strcmp (url, "/suspend")) &&
+       (! rs->suspended) )
+  {
+    pthread_t thr;
+
+    rs->suspended = ! 0;
+    MHD_suspend_connection (connection);
+    if (0 != pthread_create (&thr, NULL, &resume_later, connection))
+      abort ();
+    (void) pthread_detach (thr);
+    return MHD_YES;
+  }
+  if ( (0 == strcmp (MHD_HTTP_METHOD_POST, method)) &&
+       (strlen (POST_DATA) != rs->body_size) )
+    return MHD_NO;
+  if (0 == strcmp (url, "/wait"))
+    wait_for_handlers ();
+  response =
+    MHD_create_response_from_buffer_static (strlen (EXPECTED_REPLY),
+                                            EXPECTED_REPLY);
+  if (NULL == response)
+    return MHD_NO;
+  ret = MHD_queue_response (connection, MHD_HTTP_OK, response);
+  MHD_destroy_response (response);
+  return ret;
+}
+
+
+static void
+request_completed (void *cls,
+                   struct MHD_Connection *connection,
+                   void **req_cls,
+                   enum MHD_RequestTerminationCode toe)
+{
+  (void) cls; (void) connection; (void) toe; /* Unused. */
+  free (*req_cls);
+  *req_cls = NULL;
+}
+
+
+static size_t
+discardBuffer (void *ptr, size_t size, size_t nmemb, void *ctx)
+{
+  (void) ptr; (void) ctx; /* Unused. Silent compiler warning. */
+  return size * nmemb;
+}
+
+
+/**
+ * The request made by the client thread
+ */
+struct Request
+{
+  /**
+   * The port of the daemon
+   */
+  uint16_t port;
+
+  /**
+   * The path of the URL
+   */
+  const char *path;
+
+  /**
+   * Set to non-zero to send POST request
+   */
+  int post;
+
+  /**
+   * The HTTP response code, zero if failed
+   */
+  long code;
+};
+
+
+static void *
+doRequest (void *cls)
+{
+  struct Request *const r = (struct Request *) cls;
+  char url[128];
+  CURL *c;
+
+  r->code = 0;
+  c = curl_easy_init ();
+  if (NULL == c)
+    return NULL;
+  snprintf (url, sizeof(url), "http://127.0.0.1%s", r->path);
+  curl_easy_setopt (c, CURLOPT_URL, url);
+  curl_easy_setopt (c, CURLOPT_PORT, (long) r->port);
+  curl_easy_setopt (c, CURLOPT_WRITEFUNCTION, &discardBuffer);
+  curl_easy_setopt (c, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+  curl_easy_setopt (c, CURLOPT_TIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_CONNECTTIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_NOSIGNAL, 1L);
+  if (r->post)
+    curl_easy_setopt (c, CURLOPT_POSTFIELDS, POST_DATA);
+  if (CURLE_OK == curl_easy_perform (c))
+    curl_easy_getinfo (c, CURLINFO_RESPONSE_CODE, &r->code);
+  curl_easy_cleanup (c);
+  return NULL;
+}
+
+
+/**
+ * Make the requests in parallel.
+ *
+ * @param port the port of the daemon
+ * @param path the path of the URL
+ * @param post non-zero to send POST requests
+ * @param num the number of the requests
+ * @param expected_code the expected HTTP response code, zero if
+ *                      the requests are expected to fail
+ * @return zero on success, error code otherwise
+ */
+static unsigned int
+testRequests (uint16_t port, const char *path, int post,
+              unsigned int num, long expected_code)
+{
+  struct Request r[MAX_CLIENTS];
+  pthread_t thr[MAX_CLIENTS];
+  unsigned int errorCount = 0;
+  unsigned int i;
+
+  for (i = 0; i < num; i++)
+  {
+    r[i].port = port;
+    r[i].path = path;
+    r[i].post = post;
+    if (0 != pthread_create (&thr[i], NULL, &doRequest, &r[i]))
+      abort ();
+  }
+  for (i = 0; i < num; i++)
+  {
+    if (0 != pthread_join (thr[i], NULL))
+      abort ();
+    if (expected_code != r[i].code)
+    {
+      fprintf (stderr, "Request to '%s' got response code %ld instead "
+               "of %ld.\n", path, r[i].code, expected_code);
+      errorCount |= 4;
+    }
+  }
+  return errorCount;
+}
+
+
+static unsigned int
+testDaemon (unsigned int flags, unsigned int threads, unsigned int queue)
+{
+  struct MHD_Daemon *d;
+  unsigned int errorCount = 0;
+  uint16_t port;
+
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_AUTODETECT_BIND_PORT))
+    port = 0;
+  else
+    port = 1622;
+
+  d = MHD_start_daemon (flags | MHD_USE_INTERNAL_POLLING_THREAD
+                        | MHD_USE_ERROR_LOG,
+                        port,
+                        NULL, NULL, &ahc_echo, NULL,
+                        MHD_OPTION_NOTIFY_COMPLETED, &request_completed, NULL,
+                        MHD_OPTION_HANDLER_THREADS, threads,
+                        MHD_OPTION_HANDLER_QUEUE_SIZE, queue,
+                        MHD_OPTION_END);
+  if (d == NULL)
+    return 1024;
+  if (0 == port)
+  {
+    const union MHD_DaemonInfo *dinfo;
+    dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_BIND_PORT);
+    if ((NULL == dinfo) || (0 == dinfo->port) )
+    {
+      MHD_stop_daemon (d); return 2048;
+    }
+    port = dinfo->port;
+  }
+
+  /* The handlers must run in parallel with the single polling thread */
+  max_waiting = 0;
+  wait_for = (threads < MAX_CLIENTS) ? threads : MAX_CLIENTS;
+  errorCount += testRequests (port, "/wait", 0, wait_for, MHD_HTTP_OK);
+  if (wait_for != max_waiting)
+  {
+    fprintf (stderr, "%u handlers were called in parallel instead "
+             "of %u.\n", max_waiting, wait_for);
+    errorCount |= 8;
+  }
+  /* More requests than the queue, the handlers are called by
+     the polling thread when the queue is full */
+  max_waiting = 0;
+  wait_for = 0;
+  errorCount += testRequests (port, "/wait", 0, MAX_CLIENTS, MHD_HTTP_OK);
+  errorCount += testRequests (port, "/post", ! 0, 2, MHD_HTTP_OK);
+  errorCount += testRequests (port, "/suspend", 0, 2, MHD_HTTP_OK);
+  errorCount += testRequests (port, "/fail", 0, 1, 0);
+  MHD_stop_daemon (d);
+  return errorCount;
+}
+
+
+int
+main (int argc, char *const *argv)
+{
+  unsigned int errorCount = 0;
+  (void) argc; (void) argv; /* Unused. Silent compiler warning. */
+
+  if (MHD_NO == MHD_is_feature_supported (MHD_FEATURE_THREADS))
+    return 77;
+  if (MHD_NO == MHD_is_feature_supported (MHD_FEATURE_HANDLER_THREADS))
+    return 77;
+  if (0 != curl_global_init (CURL_GLOBAL_WIN32))
+    return 2;
+  errorCount += testDaemon (0, 2, 0);
+  errorCount += testDaemon (0, 1, 1);
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_EPOLL))
+    errorCount += testDaemon (MHD_USE_EPOLL, 2, 0);
+  if (errorCount != 0)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  curl_global_cleanup ();
+  return (0 == errorCount) ? 0 : 1;       /* 0 == pass */
+}
@@ -0,0 +1,595 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     libmicrohttpd is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 2, or (at your
+     option) any later version.
+
+     libmicrohttpd is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with libmicrohttpd; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+
+/**
+ * @file test_get_range.c
+ * @brief  Testcase for automatic processing of "Range" requests
+ *         (MHD_RF_ACCEPT_RANGES)
+ */
+
+#include "MHD_config.h"
+#include "platform.h"
+#include <curl/curl.h>
+#include <microhttpd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <errno.h>
+#ifndef WINDOWS
+#include <unistd.h>
+#endif
+
+/**
+ * The size of the response body
+ */
+#define BODY_SIZE (100000)
+
+/**
+ * The content type of the response
+ */
+#define BODY_TYPE "text/plain"
+
+/**
+ * The entity-tag of the response
+ */
+#define BODY_ETAG "\"v1\""
+
+/**
+ * The maximum number of the parts in the tested replies
+ */
+#define MAX_PARTS (4)
+
+
+static char *body;
+
+static char *sourcefile;
+
+
+static char
+pattern_byte (size_t pos)
+{
+  return (char) ('a' + (pos * 7 + pos / 1000) % 26);
+}
+
+
+static enum MHD_Result
+ahc_echo (void *cls,
+          struct MHD_Connection *connection,
+          const char *url,
+          const char *method,
+          const char *version,
+          const char *upload_data, size_t *upload_data_size,
+          void **req_cls)
+{
+  static int marker;
+  struct MHD_Response *response;
+  enum MHD_Result ret;
+  enum MHD_ResponseFlags flags;
+  (void) cls; (void) version; /* Unused. Silent compiler warning. */
+  (void) upload_data; (void) upload_data_size; /* Unused. */
+
+  if (0 != strcmp (MHD_HTTP_METHOD_GET, method))
+    return MHD_NO;              /* unexpected method */
+  if (&marker != *req_cls)
+  {
+    *req_cls = &marker;
+    return MHD_YES;
+  }
+  *req_cls = NULL;
+  flags = MHD_RF_ACCEPT_RANGES;
+  if (0 == strcmp ("/buffer", url))
+    response = MHD_create_response_from_buffer_static (BODY_SIZE, body);
+  else if (0 == strcmp ("/noflag", url))
+  {
+    response = MHD_create_response_from_buffer_static (BODY_SIZE, body);
+    flags = MHD_RF_NONE;
+  }
+  else if (0 == strcmp ("/iov", url))
+  {
+    struct MHD_IoVec iov[3];
+
+    iov[0].iov_base = body;
+    iov[0].iov_len = 1000;
+    iov[1].iov_base = body + 1000;
+    iov[1].iov_len = 10;
+    iov[2].iov_base = body + 1010;
+    iov[2].iov_len = BODY_SIZE - 1010;
+    response = MHD_create_response_from_iovec (iov, 3, NULL, NULL);
+  }
+  else if (0 == strcmp ("/file", url))
+  {
+    int fd;
+
+    fd = open (sourcefile, O_RDONLY);
+    if (-1 == fd)
+    {
+      fprintf (stderr, "Failed to open `%s': %s\n",
+               sourcefile,
+               strerror (errno));
+      return MHD_NO;
+    }
+    response = MHD_create_response_from_fd (BODY_SIZE, fd);
+  }
+  else
+    return MHD_NO;
+  if (NULL == response)
+    return MHD_NO;
+  if ( (MHD_YES != MHD_set_response_options (response,
+                                             flags,
+                                             MHD_RO_END)) ||
+       (MHD_YES != MHD_add_response_header (response,
+                                            MHD_HTTP_HEADER_CONTENT_TYPE,
+                                            BODY_TYPE)) ||
+       (MHD_YES != MHD_add_response_header (response,
+                                            MHD_HTTP_HEADER_ETAG,
+                                            BODY_ETAG)) )
+  {
+    MHD_destroy_response (response);
+    return MHD_NO;
+  }
+  ret = MHD_queue_response (connection, MHD_HTTP_OK, response);
+  MHD_destroy_response (response);
+  return ret;
+}
+
+
+/**
+ * The data received by the client
+ */
+struct ReplyData
+{
+  char *buf;
+  size_t size;
+  size_t alloc;
+  char content_type[128];
+  char content_range[128];
+  int has_accept_ranges;
+};
+
+
+static size_t
+copyBuffer (void *ptr, size_t size, size_t nmemb, void *ctx)
+{
+  struct ReplyData *rd = ctx;
+  const size_t len = size * nmemb;
+
+  if (rd->size + len > rd->alloc)
+    return 0;
+  memcpy (rd->buf + rd->size, ptr, len);
+  rd->size += len;
+  return len;
+}
+
+
+/**
+ * Copy the value of the header, if the header line has the required name.
+ *
+ * @param line the header line
+ * @param len the length of the @a line
+ * @param name the name of the header with ": "
+ * @param[out] value the buffer for the value
+ * @param value_size the size of the @a value buffer
+ */
+static void
+get_header_value (const char *line, size_t len, const char *name,
+                  char *value, size_t value_size)
+{
+  const size_t name_len = strlen (name);
+  size_t val_len;
+
+  if ((len <= name_len) || (0 != strncmp (line, name, name_len)))
+    return;
+  val_len = len - name_len;
+  while ((0 != val_len) && (('\r' == line[name_len + val_len - 1]) ||
+                            ('\n' == line[name_len + val_len - 1])))
+    val_len--;
+  if (val_len >= value_size)
+    val_len = value_size - 1;
+  memcpy (value, line + name_len, val_len);
+  value[val_len] = 0;
+}
+
+
+static size_t
+headerCb (char *ptr, size_t size, size_t nmemb, void *ctx)
+{
+  struct ReplyData *rd = ctx;
+  const size_t len = size * nmemb;
+  static const char ar_hdr[] = MHD_HTTP_HEADER_ACCEPT_RANGES ": bytes";
+
+  get_header_value (ptr, len, MHD_HTTP_HEADER_CONTENT_TYPE ": ",
+                    rd->content_type, sizeof(rd->content_type));
+  get_header_value (ptr, len, MHD_HTTP_HEADER_CONTENT_RANGE ": ",
+                    rd->content_range, sizeof(rd->content_range));
+  if ((len >= sizeof(ar_hdr) - 1) &&
+      (0 == strncmp (ptr, ar_hdr, sizeof(ar_hdr) - 1)))
+    rd->has_accept_ranges = 1;
+  return len;
+}
+
+
+/**
+ * The expected part of the body
+ */
+struct Part
+{
+  size_t start;
+  size_t len;
+};
+
+
+/**
+ * Check the "multipart/byteranges" reply.
+ *
+ * @param rd the received data
+ * @param parts the expected parts
+ * @param num_parts the number of the @a parts
+ * @return zero on success, non-zero otherwise
+ */
+static unsigned int
+check_multipart (const struct ReplyData *rd,
+                 const struct Part *parts,
+                 unsigned int num_parts)
+{
+  static const char mp_type[] = "multipart/byteranges; boundary=";
+  const char *boundary;
+  char *expected;
+  size_t pos;
+  unsigned int i;
+  unsigned int ret;
+
+  if (0 != strncmp (rd->content_type, mp_type, sizeof(mp_type) - 1))
+  {
+    fprintf (stderr, "Wrong multipart content type: '%s'.\n",
+             rd->content_type);
+    return 1;
+  }
+  boundary = rd->content_type + sizeof(mp_type) - 1;
+  expected = malloc (BODY_SIZE + num_parts * 256 + 256);
+  if (NULL == expected)
+    return 1;
+  pos = 0;
+  for (i = 0; i < num_parts; ++i)
+  {
+    pos += (size_t) sprintf (expected + pos,
+                             "%s--%s\r\n"
+                             MHD_HTTP_HEADER_CONTENT_TYPE ": " BODY_TYPE "\r\n"
+                             MHD_HTTP_HEADER_CONTENT_RANGE ": bytes %u-%u/%u"
+                             "\r\n\r\n",
+                             (0 == i) ? "" : "\r\n",
+                             boundary,
+                             (unsigned int) parts[i].start,
+                             (unsigned int) (parts[i].start + parts[i].len
+                                             - 1),
+                             (unsigned int) BODY_SIZE);
+    memcpy (expected + pos, body + parts[i].start, parts[i].len);
+    pos += parts[i].len;
+  }
+  pos += (size_t) sprintf (expected + pos, "\r\n--%s--\r\n", boundary);
+  ret = ((pos == rd->size) && (0 == memcmp (expected, rd->buf, pos))) ? 0 : 1;
+  if (0 != ret)
+    fprintf (stderr, "Wrong multipart body (size: %u, expected: %u).\n",
+             (unsigned int) rd->size, (unsigned int) pos);
+  free (expected);
+  return ret;
+}
+
+
+/**
+ * Get the resource and check the reply.
+ *
+ * @param c the CURL handle to use (re-used for keep-alive)
+ * @param port the port of the daemon
+ * @param url the path of the resource
+ * @param range the value of "Range" header, NULL to skip the header
+ * @param if_range the value of "If-Range" header, NULL to skip the header
+ * @param expected_code the expected status code
+ * @param parts the expected parts of the body, NULL if the full body is
+ *              expected
+ * @param num_parts the number of the @a parts
+ * @return zero on success, error code otherwise
+ */
+static unsigned int
+testGet (CURL *c, uint16_t port,
+         const char *url,
+         const char *range,
+         const char *if_range,
+         long expected_code,
+         const struct Part *parts,
+         unsigned int num_parts)
+{
+  struct ReplyData rd;
+  CURLcode errornum;
+  struct curl_slist *hdrs = NULL;
+  char buf[256];
+  long code;
+  unsigned int ret;
+
+  memset (&rd, 0, sizeof(rd));
+  rd.alloc = 2 * BODY_SIZE;
+  rd.buf = malloc (rd.alloc);
+  if (NULL == rd.buf)
+    return 1;
+  if (NULL != range)
+  {
+    snprintf (buf, sizeof(buf), "Range: %s", range);
+    hdrs = curl_slist_append (hdrs, buf);
+  }
+  if (NULL != if_range)
+  {
+    snprintf (buf, sizeof(buf), "If-Range: %s", if_range);
+    hdrs = curl_slist_append (hdrs, buf);
+  }
+  snprintf (buf, sizeof(buf), "http://127.0.0.1%s", url);
+  curl_easy_setopt (c, CURLOPT_URL, buf);
+  curl_easy_setopt (c, CURLOPT_PORT, (long) port);
+  curl_easy_setopt (c, CURLOPT_WRITEFUNCTION, &copyBuffer);
+  curl_easy_setopt (c, CURLOPT_WRITEDATA, &rd);
+  curl_easy_setopt (c, CURLOPT_HEADERFUNCTION, &headerCb);
+  curl_easy_setopt (c, CURLOPT_HEADERDATA, &rd);
+  curl_easy_setopt (c, CURLOPT_HTTPHEADER, hdrs);
+  curl_easy_setopt (c, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+  curl_easy_setopt (c, CURLOPT_TIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_CONNECTTIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_NOSIGNAL, 1L);
+  errornum = curl_easy_perform (c);
+  code = 0;
+  curl_easy_getinfo (c, CURLINFO_RESPONSE_CODE, &code);
+  curl_easy_setopt (c, CURLOPT_HTTPHEADER, NULL);
+  curl_slist_free_all (hdrs);
+  if (CURLE_OK != errornum)
+  {
+    fprintf (stderr,
+             "curl_easy_perform failed: `%s'\n",
+             curl_easy_strerror (errornum));
+    free (rd.buf);
+    return 2;
+  }
+  ret = 0;
+  if (expected_code != code)
+  {
+    fprintf (stderr, "Unexpected HTTP response code for '%s' "
+             "(Range: %s): %ld, expected: %ld\n", url,
+             (NULL == range) ? "none" : range, code, expected_code);
+    ret = 4;
+  }
+  else if ((MHD_HTTP_RANGE_NOT_SATISFIABLE != code) &&
+           ((0 == strcmp ("/noflag", url)) == (0 != rd.has_accept_ranges)))
+  {
+    fprintf (stderr, "Wrong 'Accept-Ranges' header use for '%s'.\n", url);
+    ret = 8;
+  }
+  else if (MHD_HTTP_RANGE_NOT_SATISFIABLE == code)
+  {
+    snprintf (buf, sizeof(buf), "bytes */%u", (unsigned int) BODY_SIZE);
+    if ((0 != strcmp (buf, rd.content_range)) || (0 != rd.size))
+    {
+      fprintf (stderr, "Wrong 'Range Not Satisfiable' reply: '%s'.\n",
+               rd.content_range);
+      ret = 16;
+    }
+  }
+  else if (NULL == parts)
+  {
+    if ((BODY_SIZE != rd.size) || (0 != memcmp (rd.buf, body, BODY_SIZE)) ||
+        (0 != rd.content_range[0]))
+    {
+      fprintf (stderr, "Wrong full reply for '%s'.\n", url);
+      ret = 32;
+    }
+  }
+  else if (1 == num_parts)
+  {
+    snprintf (buf, sizeof(buf), "bytes %u-%u/%u",
+              (unsigned int) parts[0].start,
+              (unsigned int) (parts[0].start + parts[0].len - 1),
+              (unsigned int) BODY_SIZE);
+    if ((0 != strcmp (buf, rd.content_range)) ||
+        (0 != strcmp (BODY_TYPE, rd.content_type)) ||
+        (parts[0].len != rd.size) ||
+        (0 != memcmp (rd.buf, body + parts[0].start, parts[0].len)))
+    {
+      fprintf (stderr, "Wrong partial reply for '%s' (Range: %s), "
+               "Content-Range: '%s'.\n", url, range, rd.content_range);
+      ret = 64;
+    }
+  }
+  else if (0 != check_multipart (&rd, parts, num_parts))
+  {
+    fprintf (stderr, "Wrong multipart reply for '%s' (Range: %s).\n",
+             url, range);
+    ret = 128;
+  }
+  free (rd.buf);
+  return ret;
+}
+
+
+/**
+ * Test the replies for one resource.
+ *
+ * @param c the CURL handle to use
+ * @param port the port of the daemon
+ * @param url the path of the resource
+ * @return zero on success, error code otherwise
+ */
+static unsigned int
+testResource (CURL *c, uint16_t port, const char *url)
+{
+  static const struct Part first100[] = {{0, 100}};
+  static const struct Part last500[] = {{BODY_SIZE - 500, 500}};
+  static const struct Part tail[] = {{BODY_SIZE - 10, 10}};
+  static const struct Part cross[] = {{990, 30}};
+  static const struct Part three[] = {{0, 10}, {50000, 100},
+    {BODY_SIZE - 10, 10}};
+  static const struct Part two[] = {{999, 2}, {1009, 2}};
+  unsigned int errorCount = 0;
+
+  errorCount += testGet (c, port, url, NULL, NULL, MHD_HTTP_OK, NULL, 0);
+  errorCount += testGet (c, port, url, "bytes=0-99", NULL,
+                         MHD_HTTP_PARTIAL_CONTENT, first100, 1);
+  errorCount += testGet (c, port, url, "bytes=-500", NULL,
+                         MHD_HTTP_PARTIAL_CONTENT, last500, 1);
+  errorCount += testGet (c, port, url, "bytes=99990-", NULL,
+                         MHD_HTTP_PARTIAL_CONTENT, tail, 1);
+  errorCount += testGet (c, port, url, "bytes=99990-2000000", NULL,
+                         MHD_HTTP_PARTIAL_CONTENT, tail, 1);
+  errorCount += testGet (c, port, url, "bytes=990-1019", NULL,
+                         MHD_HTTP_PARTIAL_CONTENT, cross, 1);
+  errorCount += testGet (c, port, url, "bytes=0-9, 50000-50099,-10", NULL,
+                         MHD_HTTP_PARTIAL_CONTENT, three, 3);
+  errorCount += testGet (c, port, url, "bytes=999-1000,,1009-1010", NULL,
+                         MHD_HTTP_PARTIAL_CONTENT, two, 2);
+  /* The unsatisfiable ranges are skipped */
+  errorCount += testGet (c, port, url, "bytes=200000-300000, 0-99", NULL,
+                         MHD_HTTP_PARTIAL_CONTENT, first100, 1);
+  errorCount += testGet (c, port, url, "bytes=200000-", NULL,
+                         MHD_HTTP_RANGE_NOT_SATISFIABLE, NULL, 0);
+  errorCount += testGet (c, port, url, "bytes=-0", NULL,
+                         MHD_HTTP_RANGE_NOT_SATISFIABLE, NULL, 0);
+  /* Wrong or unsupported ranges are ignored */
+  errorCount += testGet (c, port, url, "bytes=abc", NULL,
+                         MHD_HTTP_OK, NULL, 0);
+  errorCount += testGet (c, port, url, "bytes=10-5", NULL,
+                         MHD_HTTP_OK, NULL, 0);
+  errorCount += testGet (c, port, url, "items=0-5", NULL,
+                         MHD_HTTP_OK, NULL, 0);
+  errorCount += testGet (c, port, url, "bytes=0-,0-", NULL,
+                         MHD_HTTP_OK, NULL, 0);
+  /* Conditional ranges */
+  errorCount += testGet (c, port, url, "bytes=0-99", BODY_ETAG,
+                         MHD_HTTP_PARTIAL_CONTENT, first100, 1);
+  errorCount += testGet (c, port, url, "bytes=0-99", "\"v2\"",
+                         MHD_HTTP_OK, NULL, 0);
+  errorCount += testGet (c, port, url, "bytes=0-99", "W/" BODY_ETAG,
+                         MHD_HTTP_OK, NULL, 0);
+  errorCount += testGet (c, port, url, "bytes=0-99",
+                         "Tue, 15 Nov 1994 08:12:31 GMT",
+                         MHD_HTTP_OK, NULL, 0);
+  return errorCount;
+}
+
+
+static unsigned int
+testDaemon (unsigned int flags)
+{
+  struct MHD_Daemon *d;
+  CURL *c;
+  unsigned int errorCount = 0;
+  uint16_t port;
+
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_AUTODETECT_BIND_PORT))
+    port = 0;
+  else
+    port = 1614;
+
+  d = MHD_start_daemon (flags | MHD_USE_ERROR_LOG,
+                        port,
+                        NULL, NULL, &ahc_echo, NULL,
+                        MHD_OPTION_END);
+  if (d == NULL)
+    return 1024;
+  if (0 == port)
+  {
+    const union MHD_DaemonInfo *dinfo;
+    dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_BIND_PORT);
+    if ((NULL == dinfo) || (0 == dinfo->port) )
+    {
+      MHD_stop_daemon (d); return 2048;
+    }
+    port = dinfo->port;
+  }
+  c = curl_easy_init ();
+  if (NULL == c)
+  {
+    MHD_stop_daemon (d);
+    return 4096;
+  }
+  errorCount += testResource (c, port, "/buffer");
+  errorCount += testResource (c, port, "/iov");
+  errorCount += testResource (c, port, "/file");
+  errorCount += testGet (c, port, "/noflag", NULL, NULL,
+                         MHD_HTTP_OK, NULL, 0);
+  errorCount += testGet (c, port, "/noflag", "bytes=0-99", NULL,
+                         MHD_HTTP_OK, NULL, 0);
+  curl_easy_cleanup (c);
+  MHD_stop_daemon (d);
+  return errorCount;
+}
+
+
+int
+main (int argc, char *const *argv)
+{
+  unsigned int errorCount = 0;
+  const char *tmp;
+  FILE *f;
+  size_t i;
+  (void) argc; (void) argv; /* Unused. Silent compiler warning. */
+
+  body = malloc (BODY_SIZE);
+  if (NULL == body)
+    return 99;
+  for (i = 0; i < BODY_SIZE; i++)
+    body[i] = pattern_byte (i);
+  if ( (NULL == (tmp = getenv ("TMPDIR"))) &&
+       (NULL == (tmp = getenv ("TMP"))) &&
+       (NULL == (tmp = getenv ("TEMP"))) )
+    tmp = "/tmp";
+  sourcefile = malloc (strlen (tmp) + 32);
+  if (NULL == sourcefile)
+  {
+    free (body);
+    return 99;
+  }
+  snprintf (sourcefile, strlen (tmp) + 32, "%s/%s", tmp, "test-mhd-range");
+  f = fopen (sourcefile, "wb");
+  if ((NULL == f) || (1 != fwrite (body, BODY_SIZE, 1, f)))
+  {
+    fprintf (stderr, "failed to write test file\n");
+    if (NULL != f)
+      fclose (f);
+    free (sourcefile);
+    free (body);
+    return 99;
+  }
+  fclose (f);
+  if (0 != curl_global_init (CURL_GLOBAL_WIN32))
+  {
+    unlink (sourcefile);
+    free (sourcefile);
+    free (body);
+    return 2;
+  }
+  errorCount += testDaemon (MHD_USE_INTERNAL_POLLING_THREAD);
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_THREADS))
+    errorCount += testDaemon (MHD_USE_THREAD_PER_CONNECTION
+                              | MHD_USE_INTERNAL_POLLING_THREAD);
+  if (errorCount != 0)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  curl_global_cleanup ();
+  unlink (sourcefile);
+  free (sourcefile);
+  free (body);
+  return (0 == errorCount) ? 0 : 1;       /* 0 == pass */
+}
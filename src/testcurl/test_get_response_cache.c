@@ -0,0 +1,339 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     libmicrohttpd is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 2, or (at your
+     option) any later version.
+
+     libmicrohttpd is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with libmicrohttpd; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+
+/**
+ * @file test_get_response_cache.c
+ * @brief  Testcase for the response cache of the daemon
+ *         (MHD_OPTION_RESPONSE_CACHE_SIZE, MHD_RO_CACHE_TTL)
+ */
+
+#include "MHD_config.h"
+#include "platform.h"
+#include <curl/curl.h>
+#include <microhttpd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+/**
+ * The TTL of the cached responses
+ */
+#define CACHE_TTL (600)
+
+/**
+ * The number of the calls of the handler with the complete request
+ */
+static unsigned int num_calls;
+
+
+static enum MHD_Result
+ahc_echo (void *cls,
+          struct MHD_Connection *connection,
+          const char *url,
+          const char *method,
+          const char *version,
+          const char *upload_data, size_t *upload_data_size,
+          void **req_cls)
+{
+  static int marker;
+  struct MHD_Response *response;
+  enum MHD_Result ret;
+  const char *lang;
+  char buf[256];
+  unsigned int ttl;
+  (void) cls; (void) version; /* Unused. Silent compiler warning. */
+  (void) upload_data; (void) upload_data_size; /* Unused. */
+
+  if (0 != strcmp (MHD_HTTP_METHOD_GET, method))
+    return MHD_NO;              /* unexpected method */
+  if (&marker != *req_cls)
+  {
+    *req_cls = &marker;
+    return MHD_YES;
+  }
+  *req_cls = NULL;
+  num_calls++;
+  lang = MHD_lookup_connection_value (connection, MHD_HEADER_KIND,
+                                      MHD_HTTP_HEADER_ACCEPT_LANGUAGE);
+  snprintf (buf, sizeof(buf), "call %u, url %s, arg %s, lang %s",
+            num_calls, url,
+            (NULL != MHD_lookup_connection_value (connection,
+                                                  MHD_GET_ARGUMENT_KIND,
+                                                  "a")) ?
+            MHD_lookup_connection_value (connection,
+                                         MHD_GET_ARGUMENT_KIND,
+                                         "a") : "none",
+            (NULL != lang) ? lang : "none");
+  response = MHD_create_response_from_buffer_copy (strlen (buf), buf);
+  if (NULL == response)
+    return MHD_NO;
+  ttl = (0 == strcmp ("/nocache", url)) ? 0 : CACHE_TTL;
+  if (MHD_YES != MHD_set_response_options (response,
+                                           MHD_RF_NONE,
+                                           MHD_RO_CACHE_TTL, ttl,
+                                           MHD_RO_END))
+  {
+    fprintf (stderr, "Failed to set the cache TTL.\n");
+    MHD_destroy_response (response);
+    return MHD_NO;
+  }
+  if ( ((0 == strcmp ("/vary", url)) &&
+        (MHD_YES != MHD_add_response_header (response,
+                                             MHD_HTTP_HEADER_VARY,
+                                             "Accept-Encoding, "
+                                             "Accept-Language"))) ||
+       ((0 == strcmp ("/private", url)) &&
+        (MHD_YES != MHD_add_response_header (response,
+                                             MHD_HTTP_HEADER_VARY,
+                                             "Authorization"))) ||
+       ((0 == strcmp ("/star", url)) &&
+        (MHD_YES != MHD_add_response_header (response,
+                                             MHD_HTTP_HEADER_VARY,
+                                             "*"))) )
+  {
+    fprintf (stderr, "Failed to add the 'Vary' header.\n");
+    MHD_destroy_response (response);
+    return MHD_NO;
+  }
+  ret = MHD_queue_response (connection, MHD_HTTP_OK, response);
+  MHD_destroy_response (response);
+  return ret;
+}
+
+
+/**
+ * The data received by the client
+ */
+struct ReplyData
+{
+  char buf[256];
+  size_t size;
+};
+
+
+static size_t
+copyBuffer (void *ptr, size_t size, size_t nmemb, void *ctx)
+{
+  struct ReplyData *rd = ctx;
+  const size_t len = size * nmemb;
+
+  if (rd->size + len >= sizeof(rd->buf))
+    return 0;
+  memcpy (rd->buf + rd->size, ptr, len);
+  rd->size += len;
+  rd->buf[rd->size] = 0;
+  return len;
+}
+
+
+/**
+ * Get the resource and check the reply.
+ *
+ * @param c the CURL handle to use (re-used for keep-alive)
+ * @param port the port of the daemon
+ * @param url the path of the resource with the query
+ * @param hdr the additional request header line, NULL to skip
+ *            the header
+ * @param expected_call the number of the call of the handler, which
+ *                      should have generated the reply
+ * @return zero on success, error code otherwise
+ */
+static unsigned int
+testGet (CURL *c, uint16_t port,
+         const char *url,
+         const char *hdr,
+         unsigned int expected_call)
+{
+  struct ReplyData rd;
+  CURLcode errornum;
+  struct curl_slist *hdrs = NULL;
+  char buf[256];
+  long code;
+
+  memset (&rd, 0, sizeof(rd));
+  if (NULL != hdr)
+    hdrs = curl_slist_append (hdrs, hdr);
+  snprintf (buf, sizeof(buf), "http://127.0.0.1%s", url);
+  curl_easy_setopt (c, CURLOPT_URL, buf);
+  curl_easy_setopt (c, CURLOPT_PORT, (long) port);
+  curl_easy_setopt (c, CURLOPT_WRITEFUNCTION, &copyBuffer);
+  curl_easy_setopt (c, CURLOPT_WRITEDATA, &rd);
+  curl_easy_setopt (c, CURLOPT_HTTPHEADER, hdrs);
+  curl_easy_setopt (c, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+  curl_easy_setopt (c, CURLOPT_TIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_CONNECTTIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_NOSIGNAL, 1L);
+  errornum = curl_easy_perform (c);
+  code = 0;
+  curl_easy_getinfo (c, CURLINFO_RESPONSE_CODE, &code);
+  curl_easy_setopt (c, CURLOPT_HTTPHEADER, NULL);
+  curl_slist_free_all (hdrs);
+  if (CURLE_OK != errornum)
+  {
+    fprintf (stderr,
+             "curl_easy_perform failed: `%s'\n",
+             curl_easy_strerror (errornum));
+    return 2;
+  }
+  if (MHD_HTTP_OK != code)
+  {
+    fprintf (stderr, "Unexpected HTTP response code for '%s': %ld\n",
+             url, code);
+    return 4;
+  }
+  snprintf (buf, sizeof(buf), "call %u, ", expected_call);
+  if (0 != strncmp (rd.buf, buf, strlen (buf)))
+  {
+    fprintf (stderr, "Wrong reply for '%s' (%s): '%s', "
+             "expected the reply of the call %u.\n", url,
+             (NULL == hdr) ? "no header" : hdr, rd.buf, expected_call);
+    return 8;
+  }
+  return 0;
+}
+
+
+/**
+ * Get the counter of the response cache.
+ *
+ * @param d the daemon to use
+ * @param info_type the type of the counter
+ * @return the value of the counter
+ */
+static uint64_t
+get_counter (struct MHD_Daemon *d, enum MHD_DaemonInfoType info_type)
+{
+  const union MHD_DaemonInfo *dinfo;
+
+  dinfo = MHD_get_daemon_info (d, info_type);
+  if (NULL == dinfo)
+    return (uint64_t) -1;
+  return dinfo->num_requests;
+}
+
+
+static unsigned int
+testDaemon (unsigned int flags)
+{
+  struct MHD_Daemon *d;
+  CURL *c;
+  unsigned int errorCount = 0;
+  uint16_t port;
+  uint64_t hits;
+  uint64_t misses;
+
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_AUTODETECT_BIND_PORT))
+    port = 0;
+  else
+    port = 1617;
+
+  num_calls = 0;
+  d = MHD_start_daemon (flags | MHD_USE_ERROR_LOG,
+                        port,
+                        NULL, NULL, &ahc_echo, NULL,
+                        MHD_OPTION_RESPONSE_CACHE_SIZE,
+                        (size_t) (1024 * 1024),
+                        MHD_OPTION_END);
+  if (d == NULL)
+    return 1024;
+  if (0 == port)
+  {
+    const union MHD_DaemonInfo *dinfo;
+    dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_BIND_PORT);
+    if ((NULL == dinfo) || (0 == dinfo->port) )
+    {
+      MHD_stop_daemon (d); return 2048;
+    }
+    port = dinfo->port;
+  }
+  c = curl_easy_init ();
+  if (NULL == c)
+  {
+    MHD_stop_daemon (d);
+    return 4096;
+  }
+  /* The query arguments are the part of the key */
+  errorCount += testGet (c, port, "/cached?a=1", NULL, 1);
+  errorCount += testGet (c, port, "/cached?a=1", NULL, 1);
+  errorCount += testGet (c, port, "/cached?a=2", NULL, 2);
+  errorCount += testGet (c, port, "/cached?a=1", NULL, 1);
+  errorCount += testGet (c, port, "/cached?a=2", NULL, 2);
+  errorCount += testGet (c, port, "/cached?a", NULL, 3);
+  errorCount += testGet (c, port, "/cached", NULL, 4);
+  errorCount += testGet (c, port, "/cached?a", NULL, 3);
+  /* The headers listed in "Vary" are matched */
+  errorCount += testGet (c, port, "/vary", "Accept-Language: en", 5);
+  errorCount += testGet (c, port, "/vary", "Accept-Language: en", 5);
+  errorCount += testGet (c, port, "/vary", "Accept-Language: de", 6);
+  errorCount += testGet (c, port, "/vary", NULL, 7);
+  errorCount += testGet (c, port, "/vary", "Accept-Language: en", 5);
+  errorCount += testGet (c, port, "/vary", "Accept-Language: de", 6);
+  errorCount += testGet (c, port, "/vary", NULL, 7);
+  /* Not cached responses */
+  errorCount += testGet (c, port, "/nocache", NULL, 8);
+  errorCount += testGet (c, port, "/nocache", NULL, 9);
+  errorCount += testGet (c, port, "/star", NULL, 10);
+  errorCount += testGet (c, port, "/star", NULL, 11);
+  /* The host is the part of the key */
+  errorCount += testGet (c, port, "/cached?a=1", "Host: other.example", 12);
+  errorCount += testGet (c, port, "/cached?a=1", "Host: other.example", 12);
+  /* The credentials and the cookies are used only if listed in "Vary" */
+  errorCount += testGet (c, port, "/cached?a=1", "Cookie: s=1", 13);
+  errorCount += testGet (c, port, "/cached?a=1", "Cookie: s=1", 14);
+  errorCount += testGet (c, port, "/cached?a=1", NULL, 1);
+  errorCount += testGet (c, port, "/private", "Authorization: Basic YQ==", 15);
+  errorCount += testGet (c, port, "/private", "Authorization: Basic YQ==", 15);
+  errorCount += testGet (c, port, "/private", "Authorization: Basic Yg==", 16);
+  errorCount += testGet (c, port, "/private", NULL, 17);
+  errorCount += testGet (c, port, "/private", NULL, 17);
+  curl_easy_cleanup (c);
+
+  hits = get_counter (d, MHD_DAEMON_INFO_RESPONSE_CACHE_HITS);
+  misses = get_counter (d, MHD_DAEMON_INFO_RESPONSE_CACHE_MISSES);
+  if ((12 != hits) || (17 != misses))
+  {
+    fprintf (stderr, "Wrong cache counters: %lu hits, %lu misses, "
+             "expected: 12 hits, 17 misses.\n",
+             (unsigned long) hits, (unsigned long) misses);
+    errorCount += 8192;
+  }
+  MHD_stop_daemon (d);
+  return errorCount;
+}
+
+
+int
+main (int argc, char *const *argv)
+{
+  unsigned int errorCount = 0;
+  (void) argc; (void) argv; /* Unused. Silent compiler warning. */
+
+  if (0 != curl_global_init (CURL_GLOBAL_WIN32))
+    return 2;
+  errorCount += testDaemon (MHD_USE_INTERNAL_POLLING_THREAD);
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_THREADS))
+    errorCount += testDaemon (MHD_USE_THREAD_PER_CONNECTION
+                              | MHD_USE_INTERNAL_POLLING_THREAD);
+  if (errorCount != 0)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  curl_global_cleanup ();
+  return (0 == errorCount) ? 0 : 1;       /* 0 == pass */
+}
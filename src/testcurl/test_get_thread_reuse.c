@@ -0,0 +1,240 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     libmicrohttpd is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 2, or (at your
+     option) any later version.
+
+     libmicrohttpd is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with libmicrohttpd; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+
+/**
+ * @file test_get_thread_reuse.c
+ * @brief  Testcase for the reuse of the connection threads in
+ *         thread-per-connection mode
+ *         (MHD_OPTION_CONNECTION_THREADS_IDLE_MAX)
+ */
+
+#include "MHD_config.h"
+#include "platform.h"
+#include <curl/curl.h>
+#include <microhttpd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#ifndef WINDOWS
+#include <unistd.h>
+#endif
+
+#define EXPECTED_REPLY "Thread reuse test"
+
+/**
+ * The number of the requests made to the daemon
+ */
+#define NUM_REQUESTS 5
+
+/**
+ * The threads processed the requests
+ */
+static pthread_t threads[NUM_REQUESTS];
+
+/**
+ * The number of the processed requests
+ */
+static volatile unsigned int num_requests;
+
+
+static enum MHD_Result
+ahc_echo (void *cls,
+          struct MHD_Connection *connection,
+          const char *url,
+          const char *method,
+          const char *version,
+          const char *upload_data, size_t *upload_data_size,
+          void **req_cls)
+{
+  static int marker;
+  struct MHD_Response *response;
+  enum MHD_Result ret;
+  (void) cls; (void) url; (void) version; /* Unused. Silent compiler warning. */
+  (void) upload_data; (void) upload_data_size; /* Unused. */
+
+  if (0 != strcmp (MHD_HTTP_METHOD_GET, method))
+    return MHD_NO;              /* unexpected method */
+  if (&marker != *req_cls)
+  {
+    *req_cls = &marker;
+    return MHD_YES;
+  }
+  *req_cls = NULL;
+  if (NUM_REQUESTS > num_requests)
+    threads[num_requests] = pthread_self ();
+  num_requests++;
+  response =
+    MHD_create_response_from_buffer_static (strlen (EXPECTED_REPLY),
+                                            EXPECTED_REPLY);
+  if (NULL == response)
+    return MHD_NO;
+  ret = MHD_queue_response (connection, MHD_HTTP_OK, response);
+  MHD_destroy_response (response);
+  return ret;
+}
+
+
+static size_t
+discardBuffer (void *ptr, size_t size, size_t nmemb, void *ctx)
+{
+  (void) ptr; (void) ctx; /* Unused. Silent compiler warning. */
+  return size * nmemb;
+}
+
+
+/**
+ * Perform the request to the daemon.
+ *
+ * @param port the port of the daemon
+ * @return zero on success, error code otherwise
+ */
+static unsigned int
+testGet (uint16_t port)
+{
+  CURL *c;
+  CURLcode errornum;
+  long code;
+
+  c = curl_easy_init ();
+  if (NULL == c)
+    return 4096;
+  curl_easy_setopt (c, CURLOPT_URL, "http://127.0.0.1/reuse");
+  curl_easy_setopt (c, CURLOPT_PORT, (long) port);
+  curl_easy_setopt (c, CURLOPT_WRITEFUNCTION, &discardBuffer);
+  curl_easy_setopt (c, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+  curl_easy_setopt (c, CURLOPT_TIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_CONNECTTIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_NOSIGNAL, 1L);
+  /* Each request uses the new connection */
+  curl_easy_setopt (c, CURLOPT_FORBID_REUSE, 1L);
+  errornum = curl_easy_perform (c);
+  code = 0;
+  curl_easy_getinfo (c, CURLINFO_RESPONSE_CODE, &code);
+  curl_easy_cleanup (c);
+  if (CURLE_OK != errornum)
+  {
+    fprintf (stderr,
+             "curl_easy_perform failed: `%s'\n",
+             curl_easy_strerror (errornum));
+    return 2;
+  }
+  if (MHD_HTTP_OK != code)
+  {
+    fprintf (stderr, "Unexpected HTTP response code: %ld\n", code);
+    return 4;
+  }
+  /* Give the thread the time to release the closed connection */
+  (void) usleep (100000);
+  return 0;
+}
+
+
+static unsigned int
+testDaemon (unsigned int flags, unsigned int idle_max,
+            unsigned int idle_timeout)
+{
+  struct MHD_Daemon *d;
+  unsigned int errorCount = 0;
+  uint16_t port;
+  unsigned int i;
+  unsigned int reused;
+
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_AUTODETECT_BIND_PORT))
+    port = 0;
+  else
+    port = 1621;
+
+  num_requests = 0;
+  d = MHD_start_daemon (flags | MHD_USE_ERROR_LOG,
+                        port,
+                        NULL, NULL, &ahc_echo, NULL,
+                        MHD_OPTION_CONNECTION_THREADS_IDLE_MAX, idle_max,
+                        MHD_OPTION_CONNECTION_THREADS_IDLE_TIMEOUT,
+                        idle_timeout,
+                        MHD_OPTION_END);
+  if (d == NULL)
+    return 1024;
+  if (0 == port)
+  {
+    const union MHD_DaemonInfo *dinfo;
+    dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_BIND_PORT);
+    if ((NULL == dinfo) || (0 == dinfo->port) )
+    {
+      MHD_stop_daemon (d); return 2048;
+    }
+    port = dinfo->port;
+  }
+  for (i = 0; i < NUM_REQUESTS; i++)
+  {
+    errorCount += testGet (port);
+    if ( (1 == i) && (0 != idle_timeout) )
+      (void) sleep (idle_timeout + 1); /* Let the parked thread exit */
+  }
+  MHD_stop_daemon (d);
+  if (NUM_REQUESTS != num_requests)
+  {
+    fprintf (stderr, "Wrong number of requests processed: %u.\n",
+             num_requests);
+    return errorCount | 8;
+  }
+  reused = 0;
+  for (i = 1; i < NUM_REQUESTS; i++)
+  {
+    if (pthread_equal (threads[i - 1], threads[i]))
+      reused++;
+  }
+  if ( (MHD_USE_THREAD_PER_CONNECTION & flags) && (0 != idle_max) &&
+       (0 == reused) )
+  {
+    fprintf (stderr, "The connection threads are not reused.\n");
+    errorCount |= 16;
+  }
+  return errorCount;
+}
+
+
+int
+main (int argc, char *const *argv)
+{
+  unsigned int errorCount = 0;
+  (void) argc; (void) argv; /* Unused. Silent compiler warning. */
+
+  if (MHD_NO == MHD_is_feature_supported (MHD_FEATURE_THREADS))
+    return 77;
+  if (MHD_NO ==
+      MHD_is_feature_supported (MHD_FEATURE_CONNECTION_THREADS_REUSE))
+    return 77;
+  if (0 != curl_global_init (CURL_GLOBAL_WIN32))
+    return 2;
+  errorCount += testDaemon (MHD_USE_INTERNAL_POLLING_THREAD
+                            | MHD_USE_THREAD_PER_CONNECTION, 2, 0);
+  errorCount += testDaemon (MHD_USE_INTERNAL_POLLING_THREAD
+                            | MHD_USE_THREAD_PER_CONNECTION, 1, 1);
+  errorCount += testDaemon (MHD_USE_INTERNAL_POLLING_THREAD
+                            | MHD_USE_THREAD_PER_CONNECTION, 0, 0);
+  /* The option is ignored without thread-per-connection mode */
+  errorCount += testDaemon (MHD_USE_INTERNAL_POLLING_THREAD, 2, 0);
+  if (errorCount != 0)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  curl_global_cleanup ();
+  return (0 == errorCount) ? 0 : 1;       /* 0 == pass */
+}
@@ -39,6 +39,13 @@
 #include <unistd.h>
 #endif
 
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif /* ! _WIN32 */
+
 #ifdef _WIN32
 #ifndef WIN32_LEAN_AND_MEAN
 #define WIN32_LEAN_AND_MEAN 1
@@ -341,6 +348,462 @@ testMultithreadedPoolGet (void)
   return 0;
 }
 
+static unsigned int
+testRateLimit (void)
+{
+  struct MHD_Daemon *d;
+  char buf[2048];
+  struct CBC cbc;
+  CURL *c;
+  unsigned int i;
+  uint16_t port;
+  static const long expected[3] =
+  { MHD_HTTP_OK, MHD_HTTP_OK, MHD_HTTP_TOO_MANY_REQUESTS };
+
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_AUTODETECT_BIND_PORT))
+    port = 0;
+  else
+  {
+    port = 1270;
+    if (oneone)
+      port += 5;
+  }
+
+  /* Test only valid for HTTP/1.1 (uses persistent connections) */
+  if (! oneone)
+    return 0;
+
+  /* One request per second, two requests burst */
+  d = MHD_start_daemon (MHD_USE_INTERNAL_POLLING_THREAD | MHD_USE_ERROR_LOG,
+                        port, NULL, NULL,
+                        &ahc_echo, NULL,
+                        MHD_OPTION_PER_IP_RATE_LIMIT, (unsigned int) 1,
+                        MHD_OPTION_PER_IP_RATE_BURST, (unsigned int) 2,
+                        MHD_OPTION_END);
+  if (d == NULL)
+    return 16;
+  if (0 == port)
+  {
+    const union MHD_DaemonInfo *dinfo;
+    dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_BIND_PORT);
+    if ((NULL == dinfo) || (0 == dinfo->port) )
+    {
+      MHD_stop_daemon (d); return 32;
+    }
+    port = dinfo->port;
+  }
+
+  c = curl_easy_init ();
+  curl_easy_setopt (c, CURLOPT_URL, "http://127.0.0.1/hello_world");
+  curl_easy_setopt (c, CURLOPT_PORT, (long) port);
+  curl_easy_setopt (c, CURLOPT_WRITEFUNCTION, &copyBuffer);
+  curl_easy_setopt (c, CURLOPT_WRITEDATA, &cbc);
+  curl_easy_setopt (c, CURLOPT_TIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_FORBID_REUSE, 0L);
+  curl_easy_setopt (c, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+  curl_easy_setopt (c, CURLOPT_CONNECTTIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_NOSIGNAL, 1L);
+
+  /* The same connection is re-used, the limit is applied per request */
+  for (i = 0; i < 3; ++i)
+  {
+    long code;
+
+    cbc.buf = buf;
+    cbc.size = sizeof(buf);
+    cbc.pos = 0;
+    if (CURLE_OK != curl_easy_perform (c))
+    {
+      curl_easy_cleanup (c);
+      MHD_stop_daemon (d);
+      return 64;
+    }
+    if ( (CURLE_OK != curl_easy_getinfo (c, CURLINFO_RESPONSE_CODE, &code)) ||
+         (expected[i] != code) )
+    {
+      fprintf (stderr,
+               "Request %u: got HTTP status %ld, expected %ld\n",
+               i, code, expected[i]);
+      curl_easy_cleanup (c);
+      MHD_stop_daemon (d);
+      return 128;
+    }
+  }
+  curl_easy_cleanup (c);
+  MHD_stop_daemon (d);
+  return 0;
+}
+
+
+#ifndef _WIN32
+/**
+ * The maximum number of connections with distinct addresses
+ */
+#define DISTINCT_ADDR_MAX 4000
+
+
+/**
+ * Add connection to the daemon using one end of the new socketpair,
+ * pretending that connection is from the specified address.
+ *
+ * @param d the daemon to use
+ * @param sa the address of the client
+ * @param sa_len the size of the @a sa
+ * @param[out] peer set to the other end of the socketpair, or to -1
+ *                  if connection was not added
+ * @return #MHD_YES if connection has been added, #MHD_NO otherwise
+ */
+static enum MHD_Result
+add_conn_from_addr (struct MHD_Daemon *d,
+                    const struct sockaddr *sa,
+                    socklen_t sa_len,
+                    int *peer)
+{
+  int sv[2];
+  enum MHD_Result ret;
+
+  *peer = -1;
+  if (0 != socketpair (AF_UNIX, SOCK_STREAM, 0, sv))
+  {
+    fprintf (stderr, "socketpair() failed: %s\n", strerror (errno));
+    return MHD_NO;
+  }
+  /* On failure the socket is closed by MHD */
+  ret = MHD_add_connection (d, sv[0], sa, sa_len);
+  if (MHD_YES == ret)
+    *peer = sv[1];
+  else
+    close (sv[1]);
+  return ret;
+}
+
+
+/**
+ * Add connection to the daemon using one end of the new socketpair,
+ * pretending that connection is from the specified IPv4 address.
+ *
+ * @param d the daemon to use
+ * @param ip the IPv4 address in host byte order
+ * @param[out] peer set to the other end of the socketpair, or to -1
+ *                  if connection was not added
+ * @return #MHD_YES if connection has been added, #MHD_NO otherwise
+ */
+static enum MHD_Result
+add_conn_from (struct MHD_Daemon *d,
+               uint32_t ip,
+               int *peer)
+{
+  struct sockaddr_in sa;
+
+  memset (&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_port = htons (80);
+  sa.sin_addr.s_addr = htonl (ip);
+  return add_conn_from_addr (d, (const struct sockaddr *) &sa,
+                             (socklen_t) sizeof(sa), peer);
+}
+
+
+/**
+ * Get the number of the connections processed by the daemon.
+ *
+ * @param d the daemon to use
+ * @return the number of the connections
+ */
+static unsigned int
+get_num_connections (struct MHD_Daemon *d)
+{
+  const union MHD_DaemonInfo *dinfo;
+
+  dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_CURRENT_CONNECTIONS);
+  if (NULL == dinfo)
+    return 0;
+  return dinfo->num_connections;
+}
+
+
+/**
+ * Check that the per-IP limit is enforced for the single address when
+ * many clients with distinct addresses are connected.
+ *
+ * @return zero on success
+ */
+static unsigned int
+testDistinctAddrLimit (void)
+{
+  static int peers[DISTINCT_ADDR_MAX + 3];
+  struct MHD_Daemon *d;
+  struct rlimit rl;
+  unsigned int num;
+  unsigned int i;
+  unsigned int ret;
+
+  num = DISTINCT_ADDR_MAX;
+  if (0 == getrlimit (RLIMIT_NOFILE, &rl))
+  {
+    if ((rl.rlim_cur != RLIM_INFINITY) && (rl.rlim_cur < rl.rlim_max))
+    {
+      rl.rlim_cur = rl.rlim_max;
+      (void) setrlimit (RLIMIT_NOFILE, &rl);
+      (void) getrlimit (RLIMIT_NOFILE, &rl);
+    }
+    if ((rl.rlim_cur != RLIM_INFINITY) &&
+        (rl.rlim_cur < (rlim_t) (num * 2 + 64)))
+      num = (unsigned int) ((rl.rlim_cur - 64) / 2);
+  }
+  if (MHD_NO == MHD_is_feature_supported (MHD_FEATURE_EPOLL))
+  {
+    /* select() is limited by FD_SETSIZE */
+    if (num > 200)
+      num = 200;
+  }
+  if (num < 16)
+    return 0; /* Not enough FDs, skip the test */
+
+  d = MHD_start_daemon (MHD_USE_ERROR_LOG | MHD_USE_NO_LISTEN_SOCKET
+                        | ((MHD_NO != MHD_is_feature_supported (
+                              MHD_FEATURE_EPOLL)) ? MHD_USE_EPOLL : 0),
+                        0, NULL, NULL,
+                        &ahc_echo, NULL,
+                        MHD_OPTION_PER_IP_CONNECTION_LIMIT, (unsigned int) 2,
+                        MHD_OPTION_CONNECTION_LIMIT, (unsigned int) (num + 8),
+                        MHD_OPTION_CONNECTION_TIMEOUT, (unsigned int) 0,
+                        MHD_OPTION_END);
+  if (NULL == d)
+    return 256;
+
+  for (i = 0; i < num + 3; ++i)
+    peers[i] = -1;
+  ret = 0;
+  for (i = 0; i < num; ++i)
+  {
+    /* 10.0.0.0/8 addresses */
+    if (MHD_YES != add_conn_from (d, 0x0A000000U + i, peers + i))
+    {
+      fprintf (stderr, "Failed to add connection #%u\n", i);
+      ret = 512;
+      break;
+    }
+  }
+  /* The added connections are processed by MHD_run() */
+  if ( (0 == ret) &&
+       ( (MHD_YES != MHD_run (d)) ||
+         (num != get_num_connections (d)) ) )
+  {
+    fprintf (stderr, "Wrong number of connections: %u instead of %u\n",
+             get_num_connections (d), num);
+    ret = 512;
+  }
+
+  if (0 == ret)
+  {
+    /* The limit must still work for the single address */
+    for (i = 0; i < 3; ++i)
+    {
+      const enum MHD_Result res = add_conn_from (d, 0xC0000201U /* 192.0.2.1 */,
+                                                 peers + num + i);
+
+      if ( ((2 > i) && (MHD_YES != res)) ||
+           ((2 == i) && (MHD_NO != res)) )
+      {
+        fprintf (stderr, "Per-IP limit is not enforced properly\n");
+        ret = 1024;
+      }
+    }
+    if ( (MHD_YES != MHD_run (d)) ||
+         (num + 2 != get_num_connections (d)) )
+    {
+      fprintf (stderr, "Wrong number of connections: %u instead of %u\n",
+               get_num_connections (d), num + 2);
+      ret |= 1024;
+    }
+  }
+
+  MHD_stop_daemon (d);
+  for (i = 0; i < num + 3; ++i)
+  {
+    if (0 <= peers[i])
+      close (peers[i]);
+  }
+  return ret;
+}
+
+
+
+
+/**
+ * The number of the distinct client addresses used to fill the table of
+ * the rate limiting buckets
+ */
+#define RATE_ADDR_NUM 16384
+
+/**
+ * The request sent by the clients
+ */
+#define RATE_REQUEST "GET / HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n"
+
+
+/**
+ * Make single request from the specified address.
+ *
+ * @param d the daemon to use
+ * @param sa the address of the client
+ * @param sa_len the size of the @a sa
+ * @return the HTTP status of the reply,
+ *         zero if the connection has not been accepted or closed without
+ *         reply
+ */
+static unsigned int
+request_from (struct MHD_Daemon *d,
+              const struct sockaddr *sa,
+              socklen_t sa_len)
+{
+  int peer;
+  char buf[256];
+  ssize_t res;
+  unsigned int code;
+  unsigned int i;
+
+  if (MHD_YES != add_conn_from_addr (d, sa, sa_len, &peer))
+    return 0;
+  code = 0;
+  if ((ssize_t) strlen (RATE_REQUEST) ==
+      send (peer, RATE_REQUEST, strlen (RATE_REQUEST), 0))
+  {
+    for (i = 0; i < 100; ++i)
+    {
+      if (MHD_YES != MHD_run (d))
+        break;
+      res = recv (peer, buf, sizeof(buf) - 1, MSG_DONTWAIT);
+      if (0 == res)
+        break;  /* Closed without reply */
+      if (0 < res)
+      {
+        buf[res] = 0;
+        if (1 != sscanf (buf, "HTTP/1.1 %u ", &code))
+          code = 0;
+        break;
+      }
+    }
+  }
+  close (peer);
+  (void) MHD_run (d); /* Clean up the connection */
+  return code;
+}
+
+
+/**
+ * Check that an unrelated client is not limited after many other clients
+ * used all their requests, and that the clients cycling through the IPv6
+ * addresses of one network are limited.
+ *
+ * @return zero on success
+ */
+static unsigned int
+testRateLimitManyAddrs (void)
+{
+  struct MHD_Daemon *d;
+  struct sockaddr_in sa4;
+  unsigned int code;
+  unsigned int i;
+  unsigned int ret;
+
+  /* One request per second, one request burst.
+     No error log: the socket options cannot be set for the socketpairs */
+  d = MHD_start_daemon (MHD_USE_NO_LISTEN_SOCKET,
+                        0, NULL, NULL,
+                        &ahc_echo, NULL,
+                        MHD_OPTION_PER_IP_RATE_LIMIT, (unsigned int) 1,
+                        MHD_OPTION_PER_IP_RATE_BURST, (unsigned int) 1,
+                        MHD_OPTION_CONNECTION_TIMEOUT, (unsigned int) 0,
+                        MHD_OPTION_END);
+  if (NULL == d)
+    return 2048;
+
+  ret = 0;
+  memset (&sa4, 0, sizeof(sa4));
+  sa4.sin_family = AF_INET;
+  sa4.sin_port = htons (80);
+  /* Each client uses its only request, the buckets of the clients are
+     replaced by the buckets of the next clients */
+  for (i = 0; i < RATE_ADDR_NUM; ++i)
+  {
+    sa4.sin_addr.s_addr = htonl (0x0A000000U + i); /* 10.0.0.0/8 */
+    code = request_from (d, (const struct sockaddr *) &sa4,
+                         (socklen_t) sizeof(sa4));
+    if (MHD_HTTP_OK != code)
+    {
+      fprintf (stderr, "New client #%u got HTTP status %u\n", i, code);
+      ret = 2048;
+      break;
+    }
+  }
+  if (0 == ret)
+  {
+    sa4.sin_addr.s_addr = htonl (0xC0000201U); /* 192.0.2.1 */
+    code = request_from (d, (const struct sockaddr *) &sa4,
+                         (socklen_t) sizeof(sa4));
+    if (MHD_HTTP_OK != code)
+    {
+      fprintf (stderr, "Unrelated client got HTTP status %u\n", code);
+      ret = 2048;
+    }
+    else if (MHD_HTTP_OK == request_from (d,
+                                          (const struct sockaddr *) &sa4,
+                                          (socklen_t) sizeof(sa4)))
+    {
+      fprintf (stderr, "The limit is not enforced for the client\n");
+      ret = 2048;
+    }
+  }
+#ifdef HAVE_INET6
+  if ( (0 == ret) &&
+       (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_IPv6)) )
+  {
+    struct sockaddr_in6 sa6;
+
+    memset (&sa6, 0, sizeof(sa6));
+    sa6.sin6_family = AF_INET6;
+    sa6.sin6_port = htons (80);
+    sa6.sin6_addr.s6_addr[0] = 0x20; /* 2001:db8:0:1::/64 */
+    sa6.sin6_addr.s6_addr[1] = 0x01;
+    sa6.sin6_addr.s6_addr[2] = 0x0d;
+    sa6.sin6_addr.s6_addr[3] = 0xb8;
+    sa6.sin6_addr.s6_addr[7] = 0x01;
+    /* The network is limited to 16 times of the single client burst */
+    for (i = 1; i <= 17; ++i)
+    {
+      sa6.sin6_addr.s6_addr[15] = (uint8_t) i;
+      code = request_from (d, (const struct sockaddr *) &sa6,
+                           (socklen_t) sizeof(sa6));
+      if ( ((17 > i) && (MHD_HTTP_OK != code)) ||
+           ((17 == i) && (MHD_HTTP_OK == code)) )
+      {
+        fprintf (stderr, "IPv6 client #%u got HTTP status %u\n", i, code);
+        ret = 4096;
+        break;
+      }
+    }
+    /* The other network is not limited */
+    sa6.sin6_addr.s6_addr[7] = 0x02;
+    if ( (0 == ret) &&
+         (MHD_HTTP_OK != (code = request_from (d,
+                                               (const struct sockaddr *) &sa6,
+                                               (socklen_t) sizeof(sa6)))) )
+    {
+      fprintf (stderr, "IPv6 client in other network got HTTP status %u\n",
+               code);
+      ret = 4096;
+    }
+  }
+#endif /* HAVE_INET6 */
+  MHD_stop_daemon (d);
+  return ret;
+}
+
+
+#endif /* ! _WIN32 */
+
 
 int
 main (int argc, char *const *argv)
@@ -355,6 +818,11 @@ main (int argc, char *const *argv)
     return 2;
   errorCount |= testMultithreadedGet ();
   errorCount |= testMultithreadedPoolGet ();
+  errorCount |= testRateLimit ();
+#ifndef _WIN32
+  errorCount |= testDistinctAddrLimit ();
+  errorCount |= testRateLimitManyAddrs ();
+#endif /* ! _WIN32 */
   if (errorCount != 0)
     fprintf (stderr, "Error (code: %u)\n", errorCount);
   curl_global_cleanup ();
@@ -0,0 +1,365 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     libmicrohttpd is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 2, or (at your
+     option) any later version.
+
+     libmicrohttpd is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with libmicrohttpd; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+
+/**
+ * @file test_post_in_place.c
+ * @brief  Testcase for MHD_post_process_in_place() with the POST body
+ *         received into the application's buffer
+ */
+
+#include "MHD_config.h"
+#include "platform.h"
+#include <curl/curl.h>
+#include <microhttpd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+/**
+ * The number of the fields in the POST body
+ */
+#define NUM_FIELDS 20000
+
+/**
+ * The size of the application's receive buffer, smaller than the body
+ * to get the body in several portions, but large enough to take the part
+ * of the body received together with the headers
+ */
+#define RECV_BUF_SIZE (64 * 1024)
+
+/**
+ * The size of the buffers for the body and for the decoded fields
+ */
+#define DATA_BUF_SIZE (NUM_FIELDS * 64)
+
+
+/**
+ * The state of the request processing
+ */
+struct PostState
+{
+  /**
+   * The post processor of the request
+   */
+  struct MHD_PostProcessor *pp;
+
+  /**
+   * The application's receive buffer
+   */
+  char *buf;
+
+  /**
+   * The decoded fields, in the "key=value&key=value" form
+   */
+  char *fields;
+
+  /**
+   * The length of the data in @a fields
+   */
+  size_t fields_len;
+
+  /**
+   * The number of the values given to the iterator directly from
+   * the receive buffer
+   */
+  unsigned int num_in_buf;
+
+  /**
+   * Set to non-zero if any error has been detected
+   */
+  int error;
+};
+
+
+/**
+ * The url-encoded body of the request
+ */
+static char *post_body;
+
+/**
+ * The expected decoded fields
+ */
+static char *expected_fields;
+
+
+static size_t
+discardBuffer (void *ptr, size_t size, size_t nmemb, void *ctx)
+{
+  (void) ptr; (void) ctx;  /* Unused. Silent compiler warning. */
+  return size * nmemb;
+}
+
+
+static enum MHD_Result
+post_iterator (void *cls,
+               enum MHD_ValueKind kind,
+               const char *key,
+               const char *filename,
+               const char *content_type,
+               const char *transfer_encoding,
+               const char *data, uint64_t off, size_t size)
+{
+  struct PostState *st = cls;
+  size_t key_len;
+  (void) kind; (void) filename; (void) content_type;
+  (void) transfer_encoding;  /* Unused. Silent compiler warning. */
+
+  key_len = (0 == off) ? strlen (key) + 2 : 0;
+  if (st->fields_len + key_len + size > DATA_BUF_SIZE)
+  {
+    fprintf (stderr, "Too much decoded data.\n");
+    st->error = 1;
+    return MHD_NO;
+  }
+  if (0 == off)
+  {
+    if (0 != st->fields_len)
+      st->fields[st->fields_len++] = '&';
+    memcpy (st->fields + st->fields_len, key, key_len - 2);
+    st->fields_len += key_len - 2;
+    st->fields[st->fields_len++] = '=';
+  }
+  if ((data >= st->buf) && (data + size <= st->buf + RECV_BUF_SIZE))
+    st->num_in_buf++;
+  memcpy (st->fields + st->fields_len, data, size);
+  st->fields_len += size;
+  return MHD_YES;
+}
+
+
+static enum MHD_Result
+ahc_post (void *cls,
+          struct MHD_Connection *connection,
+          const char *url,
+          const char *method,
+          const char *version,
+          const char *upload_data, size_t *upload_data_size,
+          void **req_cls)
+{
+  static int marker;
+  struct PostState *st = cls;
+  struct MHD_Response *response;
+  enum MHD_Result ret;
+  unsigned int code;
+  (void) url; (void) version;  /* Unused. Silent compiler warning. */
+
+  if (0 != strcmp (MHD_HTTP_METHOD_POST, method))
+    return MHD_NO;              /* unexpected method */
+  if (NULL == *req_cls)
+  {
+    st->pp = MHD_create_post_processor (connection, 1024,
+                                        &post_iterator, st);
+    if (NULL == st->pp)
+    {
+      fprintf (stderr, "Failed to create the post processor.\n");
+      return MHD_NO;
+    }
+    if (MHD_YES !=
+        MHD_set_connection_option (connection,
+                                   MHD_CONNECTION_OPTION_UPLOAD_BUFFER,
+                                   (void *) st->buf,
+                                   (size_t) RECV_BUF_SIZE))
+    {
+      fprintf (stderr, "Failed to set the upload buffer.\n");
+      MHD_destroy_post_processor (st->pp);
+      st->pp = NULL;
+      return MHD_NO;
+    }
+    *req_cls = &marker;
+    return MHD_YES;
+  }
+  if (0 != *upload_data_size)
+  {
+    if ((upload_data < st->buf) ||
+        (upload_data + *upload_data_size > st->buf + RECV_BUF_SIZE))
+    {
+      fprintf (stderr, "The upload data is not in the application's "
+               "buffer.\n");
+      st->error = 1;
+    }
+    /* The same data, but by the application's own writable pointer */
+    else if (MHD_YES !=
+             MHD_post_process_in_place (st->pp,
+                                        st->buf + (upload_data - st->buf),
+                                        *upload_data_size))
+    {
+      fprintf (stderr, "MHD_post_process_in_place() failed.\n");
+      st->error = 1;
+    }
+    *upload_data_size = 0;
+    return MHD_YES;
+  }
+  *req_cls = NULL;
+  MHD_destroy_post_processor (st->pp);
+  st->pp = NULL;
+  code = st->error ? MHD_HTTP_INTERNAL_SERVER_ERROR : MHD_HTTP_OK;
+  response = MHD_create_response_empty (MHD_RF_NONE);
+  ret = MHD_queue_response (connection, code, response);
+  MHD_destroy_response (response);
+  return ret;
+}
+
+
+static unsigned int
+testPostInPlace (unsigned int flags)
+{
+  struct MHD_Daemon *d;
+  CURL *c;
+  struct PostState st;
+  CURLcode errornum;
+  long code;
+  uint16_t port;
+  unsigned int errorCount = 0;
+
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_AUTODETECT_BIND_PORT))
+    port = 0;
+  else
+    port = 1602;
+
+  memset (&st, 0, sizeof(st));
+  st.buf = malloc (RECV_BUF_SIZE);
+  st.fields = malloc (DATA_BUF_SIZE);
+  if ((NULL == st.buf) || (NULL == st.fields))
+  {
+    free (st.buf);
+    free (st.fields);
+    return 1;
+  }
+  d = MHD_start_daemon (flags | MHD_USE_ERROR_LOG,
+                        port,
+                        NULL, NULL, &ahc_post, &st, MHD_OPTION_END);
+  if (d == NULL)
+  {
+    free (st.buf);
+    free (st.fields);
+    return 1;
+  }
+  if (0 == port)
+  {
+    const union MHD_DaemonInfo *dinfo;
+    dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_BIND_PORT);
+    if ((NULL == dinfo) || (0 == dinfo->port) )
+    {
+      MHD_stop_daemon (d); free (st.buf); free (st.fields); return 32;
+    }
+    port = dinfo->port;
+  }
+  c = curl_easy_init ();
+  curl_easy_setopt (c, CURLOPT_URL, "http://127.0.0.1/post");
+  curl_easy_setopt (c, CURLOPT_PORT, (long) port);
+  curl_easy_setopt (c, CURLOPT_WRITEFUNCTION, &discardBuffer);
+  curl_easy_setopt (c, CURLOPT_POSTFIELDS, post_body);
+  curl_easy_setopt (c, CURLOPT_POSTFIELDSIZE, (long) strlen (post_body));
+  curl_easy_setopt (c, CURLOPT_POST, 1L);
+  curl_easy_setopt (c, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+  curl_easy_setopt (c, CURLOPT_TIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_CONNECTTIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_NOSIGNAL, 1L);
+  if (CURLE_OK != (errornum = curl_easy_perform (c)))
+  {
+    fprintf (stderr,
+             "curl_easy_perform failed: `%s'\n",
+             curl_easy_strerror (errornum));
+    curl_easy_cleanup (c);
+    MHD_stop_daemon (d);
+    free (st.buf);
+    free (st.fields);
+    return 2;
+  }
+  code = 0;
+  curl_easy_getinfo (c, CURLINFO_RESPONSE_CODE, &code);
+  curl_easy_cleanup (c);
+  MHD_stop_daemon (d);
+  if (MHD_HTTP_OK != code)
+  {
+    fprintf (stderr, "Unexpected HTTP response code: %ld\n", code);
+    errorCount |= 4;
+  }
+  else if ((strlen (expected_fields) != st.fields_len) ||
+           (0 != memcmp (expected_fields, st.fields, st.fields_len)))
+  {
+    fprintf (stderr, "Wrong decoded fields.\n");
+    errorCount |= 8;
+  }
+  else if (0 == st.num_in_buf)
+  {
+    fprintf (stderr, "The values have not been decoded in place.\n");
+    errorCount |= 16;
+  }
+  free (st.buf);
+  free (st.fields);
+  return errorCount;
+}
+
+
+int
+main (int argc, char *const *argv)
+{
+  unsigned int errorCount = 0;
+  size_t body_len;
+  size_t fields_len;
+  unsigned int i;
+  (void) argc; (void) argv; /* Unused. Silent compiler warning. */
+
+  post_body = malloc (DATA_BUF_SIZE);
+  expected_fields = malloc (DATA_BUF_SIZE);
+  if ((NULL == post_body) || (NULL == expected_fields))
+  {
+    free (post_body);
+    free (expected_fields);
+    return 99;
+  }
+  /* The escaped characters are split between the portions of the body */
+  body_len = 0;
+  fields_len = 0;
+  for (i = 0; i < NUM_FIELDS; i++)
+  {
+    body_len += (size_t) snprintf (post_body + body_len,
+                                   DATA_BUF_SIZE - body_len,
+                                   "%sf%u=value+%u%%2Fx%%2By%%26z",
+                                   (0 == i) ? "" : "&", i, i);
+    fields_len += (size_t) snprintf (expected_fields + fields_len,
+                                     DATA_BUF_SIZE - fields_len,
+                                     "%sf%u=value %u/x+y&z",
+                                     (0 == i) ? "" : "&", i, i);
+  }
+  if (0 != curl_global_init (CURL_GLOBAL_WIN32))
+  {
+    free (post_body);
+    free (expected_fields);
+    return 2;
+  }
+  errorCount += testPostInPlace (MHD_USE_INTERNAL_POLLING_THREAD);
+  errorCount += testPostInPlace (MHD_USE_THREAD_PER_CONNECTION
+                                 | MHD_USE_INTERNAL_POLLING_THREAD);
+  if (MHD_YES == MHD_is_feature_supported (MHD_FEATURE_POLL))
+    errorCount += testPostInPlace (MHD_USE_INTERNAL_POLLING_THREAD
+                                   | MHD_USE_POLL);
+  if (MHD_YES == MHD_is_feature_supported (MHD_FEATURE_EPOLL))
+    errorCount += testPostInPlace (MHD_USE_INTERNAL_POLLING_THREAD
+                                   | MHD_USE_EPOLL);
+  if (errorCount != 0)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  curl_global_cleanup ();
+  free (post_body);
+  free (expected_fields);
+  return (0 == errorCount) ? 0 : 1;       /* 0 == pass */
+}
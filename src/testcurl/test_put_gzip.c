@@ -0,0 +1,460 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     libmicrohttpd is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 2, or (at your
+     option) any later version.
+
+     libmicrohttpd is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with libmicrohttpd; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+
+/**
+ * @file test_put_gzip.c
+ * @brief  Testcase for decoding of the compressed request body
+ *         (MHD_OPTION_DECOMPRESS_REQUEST_BODY)
+ */
+
+#include "MHD_config.h"
+#include "platform.h"
+#include <curl/curl.h>
+#include <microhttpd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <zlib.h>
+
+/**
+ * The size of the decoded body
+ */
+#define BODY_SIZE (1024 * 1024)
+
+/**
+ * The size of the portions of the compressed data sent by the client
+ */
+#define SEND_PORTION (1000)
+
+/**
+ * The access handler processes all the data
+ */
+#define PROC_ALL 0
+
+/**
+ * The access handler leaves some data unprocessed
+ */
+#define PROC_PARTIAL 1
+
+/**
+ * The access handler does not process the end of the decoded body
+ * the first times it is given
+ */
+#define PROC_STALL 2
+
+/**
+ * The access handler leaves some data unprocessed and suspends
+ * the connection, the connection is resumed immediately
+ */
+#define PROC_SUSPEND 3
+
+
+/**
+ * The state of the upload
+ */
+struct UploadState
+{
+  /**
+   * The compressed data to send
+   */
+  const unsigned char *data;
+
+  /**
+   * The size of the @a data
+   */
+  size_t size;
+
+  /**
+   * The position of the upload
+   */
+  size_t pos;
+
+  /**
+   * The number of the decoded bytes received by the access handler
+   */
+  size_t received;
+
+  /**
+   * The number of the access handler calls with the upload data
+   */
+  unsigned long calls;
+
+  /**
+   * The processing mode of the access handler, one of PROC_* values
+   */
+  int mode;
+
+  /**
+   * The number of the access handler calls left not processed
+   */
+  unsigned int stalls;
+
+  /**
+   * Set to non-zero if any error has been detected
+   */
+  int error;
+};
+
+
+static unsigned char
+pattern_byte (size_t pos)
+{
+  return (unsigned char) ((pos * 7 + pos / 1000) & 0xFF);
+}
+
+
+/**
+ * Compress the test body.
+ *
+ * @param gzip if non-zero then "gzip" format is used, "deflate" otherwise
+ * @param members the number of gzip members to split the body into
+ * @param[out] out_size the size of the compressed data
+ * @return the malloc()ed compressed data, NULL on error
+ */
+static unsigned char *
+compress_body (int gzip, unsigned int members, size_t *out_size)
+{
+  unsigned char *plain;
+  unsigned char *out;
+  size_t out_alloc;
+  size_t pos;
+  size_t i;
+  unsigned int m;
+
+  plain = malloc (BODY_SIZE);
+  if (NULL == plain)
+    return NULL;
+  for (i = 0; i < BODY_SIZE; i++)
+    plain[i] = pattern_byte (i);
+  out_alloc = compressBound (BODY_SIZE) + 64 * members;
+  out = malloc (out_alloc);
+  if (NULL == out)
+  {
+    free (plain);
+    return NULL;
+  }
+  pos = 0;
+  for (m = 0; m < members; m++)
+  {
+    z_stream strm;
+    const size_t start = (BODY_SIZE / members) * m;
+    const size_t end = (m + 1 == members) ?
+                       BODY_SIZE : (BODY_SIZE / members) * (m + 1);
+
+    memset (&strm, 0, sizeof(strm));
+    if (Z_OK != deflateInit2 (&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                              gzip ? (MAX_WBITS + 16) : MAX_WBITS,
+                              8, Z_DEFAULT_STRATEGY))
+    {
+      free (plain);
+      free (out);
+      return NULL;
+    }
+    strm.next_in = plain + start;
+    strm.avail_in = (uInt) (end - start);
+    strm.next_out = out + pos;
+    strm.avail_out = (uInt) (out_alloc - pos);
+    if (Z_STREAM_END != deflate (&strm, Z_FINISH))
+    {
+      deflateEnd (&strm);
+      free (plain);
+      free (out);
+      return NULL;
+    }
+    pos = out_alloc - strm.avail_out;
+    deflateEnd (&strm);
+  }
+  free (plain);
+  *out_size = pos;
+  return out;
+}
+
+
+static size_t
+putBuffer (void *stream, size_t size, size_t nmemb, void *ptr)
+{
+  struct UploadState *st = ptr;
+  size_t wrt;
+
+  wrt = size * nmemb;
+  if (wrt > SEND_PORTION)
+    wrt = SEND_PORTION;
+  if (wrt > st->size - st->pos)
+    wrt = st->size - st->pos;
+  memcpy (stream, st->data + st->pos, wrt);
+  st->pos += wrt;
+  return wrt;
+}
+
+
+static size_t
+discardBuffer (void *ptr, size_t size, size_t nmemb, void *ctx)
+{
+  (void) ptr; (void) ctx;  /* Unused. Silent compiler warning. */
+  return size * nmemb;
+}
+
+
+static enum MHD_Result
+ahc_upload (void *cls,
+            struct MHD_Connection *connection,
+            const char *url,
+            const char *method,
+            const char *version,
+            const char *upload_data, size_t *upload_data_size,
+            void **req_cls)
+{
+  static int marker;
+  struct UploadState *st = cls;
+  struct MHD_Response *response;
+  enum MHD_Result ret;
+  unsigned int code;
+  size_t processed;
+  size_t i;
+  (void) url; (void) version;  /* Unused. Silent compiler warning. */
+
+  if (0 != strcmp (MHD_HTTP_METHOD_PUT, method))
+    return MHD_NO;              /* unexpected method */
+  if (NULL == *req_cls)
+  {
+    *req_cls = &marker;
+    return MHD_YES;
+  }
+  if (0 != *upload_data_size)
+  {
+    st->calls++;
+    processed = *upload_data_size;
+    if ((PROC_STALL == st->mode) && (0 != st->stalls) &&
+        (BODY_SIZE == st->received + processed))
+    {
+      st->stalls--;
+      return MHD_YES; /* Nothing processed, the data must be given again */
+    }
+    if ((PROC_ALL != st->mode) && (1 < processed) && (0 != (st->calls % 2)))
+      processed /= 2;
+    if (st->received + processed > BODY_SIZE)
+    {
+      fprintf (stderr, "Too much decoded data.\n");
+      st->error = 1;
+      processed = 0;
+    }
+    for (i = 0; i < processed; i++)
+    {
+      if (pattern_byte (st->received + i) !=
+          (unsigned char) upload_data[i])
+      {
+        if (! st->error) /* Report only the first mismatch */
+          fprintf (stderr, "Wrong byte at position %lu.\n",
+                   (unsigned long) (st->received + i));
+        st->error = 1;
+        break;
+      }
+    }
+    st->received += processed;
+    *upload_data_size -= processed;
+    if ((PROC_SUSPEND == st->mode) && (0 != *upload_data_size))
+    {
+      /* The rest of the data must be given after resume even if
+         no more data is received from the client */
+      MHD_suspend_connection (connection);
+      MHD_resume_connection (connection);
+    }
+    return MHD_YES;
+  }
+  *req_cls = NULL;
+  code = ((BODY_SIZE == st->received) && ! st->error) ?
+         MHD_HTTP_OK : MHD_HTTP_INTERNAL_SERVER_ERROR;
+  response = MHD_create_response_empty (MHD_RF_NONE);
+  ret = MHD_queue_response (connection, code, response);
+  MHD_destroy_response (response);
+  return ret;
+}
+
+
+/**
+ * Upload the compressed body and check the reply.
+ *
+ * @param encoding the value of "Content-Encoding" header
+ * @param data the data to upload
+ * @param size the size of the @a data
+ * @param chunked if non-zero, the chunked encoding is used for the upload
+ * @param mode the processing mode of the access handler, one of PROC_*
+ * @param limit the limit of the decoded size
+ * @param expected_code the expected HTTP response code
+ * @return zero on success, error code otherwise
+ */
+static unsigned int
+testUpload (const char *encoding,
+            const unsigned char *data, size_t size,
+            int chunked, int mode,
+            size_t limit,
+            long expected_code)
+{
+  struct MHD_Daemon *d;
+  CURL *c;
+  struct UploadState st;
+  CURLcode errornum;
+  struct curl_slist *hdrs = NULL;
+  char enc_hdr[64];
+  long code;
+  uint16_t port;
+
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_AUTODETECT_BIND_PORT))
+    port = 0;
+  else
+    port = 1611;
+
+  memset (&st, 0, sizeof(st));
+  st.data = data;
+  st.size = size;
+  st.mode = mode;
+  st.stalls = 2; /* The second time is after the end of the upload */
+  d = MHD_start_daemon (MHD_USE_INTERNAL_POLLING_THREAD | MHD_USE_ERROR_LOG
+                        | MHD_ALLOW_SUSPEND_RESUME,
+                        port,
+                        NULL, NULL, &ahc_upload, &st,
+                        MHD_OPTION_DECOMPRESS_REQUEST_BODY, limit,
+                        MHD_OPTION_END);
+  if (d == NULL)
+    return 1;
+  if (0 == port)
+  {
+    const union MHD_DaemonInfo *dinfo;
+    dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_BIND_PORT);
+    if ((NULL == dinfo) || (0 == dinfo->port) )
+    {
+      MHD_stop_daemon (d); return 32;
+    }
+    port = dinfo->port;
+  }
+  c = curl_easy_init ();
+  snprintf (enc_hdr, sizeof(enc_hdr), "Content-Encoding: %s", encoding);
+  hdrs = curl_slist_append (hdrs, enc_hdr);
+  if (chunked)
+    hdrs = curl_slist_append (hdrs, "Transfer-Encoding: chunked");
+  else
+    curl_easy_setopt (c, CURLOPT_INFILESIZE_LARGE, (curl_off_t) size);
+  curl_easy_setopt (c, CURLOPT_URL, "http://127.0.0.1/upload");
+  curl_easy_setopt (c, CURLOPT_PORT, (long) port);
+  curl_easy_setopt (c, CURLOPT_WRITEFUNCTION, &discardBuffer);
+  curl_easy_setopt (c, CURLOPT_READFUNCTION, &putBuffer);
+  curl_easy_setopt (c, CURLOPT_READDATA, &st);
+  curl_easy_setopt (c, CURLOPT_UPLOAD, 1L);
+  curl_easy_setopt (c, CURLOPT_HTTPHEADER, hdrs);
+  curl_easy_setopt (c, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+  curl_easy_setopt (c, CURLOPT_TIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_CONNECTTIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_NOSIGNAL, 1L);
+  errornum = curl_easy_perform (c);
+  code = 0;
+  curl_easy_getinfo (c, CURLINFO_RESPONSE_CODE, &code);
+  curl_easy_cleanup (c);
+  curl_slist_free_all (hdrs);
+  MHD_stop_daemon (d);
+  if ((CURLE_OK != errornum) &&
+      ((MHD_HTTP_OK == expected_code) || (0 == code)))
+  {
+    /* The error response could be sent before the end of the upload,
+       then the server closes the connection, but the code must be
+       received */
+    fprintf (stderr,
+             "curl_easy_perform failed: `%s'\n",
+             curl_easy_strerror (errornum));
+    return 2;
+  }
+  if (expected_code != code)
+  {
+    fprintf (stderr, "Unexpected HTTP response code: %ld, expected: %ld "
+             "(encoding '%s', chunked: %d, mode: %d)\n",
+             code, expected_code, encoding, chunked, mode);
+    return 4;
+  }
+  if ((MHD_HTTP_OK == expected_code) && (0 == st.calls))
+  {
+    fprintf (stderr, "The decoded data has not been received.\n");
+    return 8;
+  }
+  return 0;
+}
+
+
+int
+main (int argc, char *const *argv)
+{
+  unsigned int errorCount = 0;
+  unsigned char *gz;
+  unsigned char *gz_multi;
+  unsigned char *defl;
+  size_t gz_size;
+  size_t gz_multi_size;
+  size_t defl_size;
+  (void) argc; (void) argv; /* Unused. Silent compiler warning. */
+
+  if (MHD_NO == MHD_is_feature_supported (MHD_FEATURE_BODY_DECODING))
+    return 77;
+  gz = compress_body (1, 1, &gz_size);
+  gz_multi = compress_body (1, 3, &gz_multi_size);
+  defl = compress_body (0, 1, &defl_size);
+  if ((NULL == gz) || (NULL == gz_multi) || (NULL == defl))
+  {
+    free (gz);
+    free (gz_multi);
+    free (defl);
+    return 99;
+  }
+  if (0 != curl_global_init (CURL_GLOBAL_WIN32))
+    return 2;
+  errorCount += testUpload ("gzip", gz, gz_size, 0, PROC_ALL,
+                            BODY_SIZE, MHD_HTTP_OK);
+  errorCount += testUpload ("gzip", gz, gz_size, 1, PROC_PARTIAL,
+                            BODY_SIZE, MHD_HTTP_OK);
+  errorCount += testUpload ("gzip", gz, gz_size, 0, PROC_STALL,
+                            BODY_SIZE, MHD_HTTP_OK);
+  errorCount += testUpload ("gzip", gz, gz_size, 1, PROC_SUSPEND,
+                            BODY_SIZE, MHD_HTTP_OK);
+  errorCount += testUpload ("x-gzip", gz_multi, gz_multi_size, 0,
+                            PROC_PARTIAL, BODY_SIZE, MHD_HTTP_OK);
+  errorCount += testUpload ("deflate", defl, defl_size, 0, PROC_ALL,
+                            BODY_SIZE, MHD_HTTP_OK);
+  errorCount += testUpload ("Deflate", defl, defl_size, 1, PROC_PARTIAL,
+                            BODY_SIZE, MHD_HTTP_OK);
+  /* The decoded body is larger than allowed */
+  errorCount += testUpload ("gzip", gz, gz_size, 0, PROC_ALL,
+                            BODY_SIZE / 2, MHD_HTTP_CONTENT_TOO_LARGE);
+  /* Truncated compressed data */
+  errorCount += testUpload ("gzip", gz, gz_size - 16, 0, PROC_ALL,
+                            BODY_SIZE, MHD_HTTP_BAD_REQUEST);
+  /* Broken compressed data */
+  gz[gz_size / 2] ^= 0x55;
+  gz[gz_size / 2 + 1] ^= 0xAA;
+  errorCount += testUpload ("gzip", gz, gz_size, 0, PROC_ALL,
+                            4 * BODY_SIZE, MHD_HTTP_BAD_REQUEST);
+  /* "deflate" data labelled as "gzip" */
+  errorCount += testUpload ("gzip", defl, defl_size, 1, PROC_ALL,
+                            BODY_SIZE, MHD_HTTP_BAD_REQUEST);
+  if (errorCount != 0)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  curl_global_cleanup ();
+  free (gz);
+  free (gz_multi);
+  free (defl);
+  return (0 == errorCount) ? 0 : 1;       /* 0 == pass */
+}
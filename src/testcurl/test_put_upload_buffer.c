@@ -0,0 +1,331 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     libmicrohttpd is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 2, or (at your
+     option) any later version.
+
+     libmicrohttpd is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with libmicrohttpd; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+
+/**
+ * @file test_put_upload_buffer.c
+ * @brief  Testcase for receiving of the PUT body into the application's buffer
+ */
+
+#include "MHD_config.h"
+#include "platform.h"
+#include <curl/curl.h>
+#include <microhttpd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+/**
+ * The size of the uploaded body
+ */
+#define UPLOAD_SIZE (4 * 1024 * 1024)
+
+/**
+ * The size of the small uploaded body
+ */
+#define UPLOAD_SIZE_SMALL (3000)
+
+/**
+ * The size of the application's receive buffer
+ */
+#define RECV_BUF_SIZE (1024 * 1024)
+
+
+/**
+ * The state of the upload
+ */
+struct UploadState
+{
+  /**
+   * The size of the body to send
+   */
+  size_t size;
+
+  /**
+   * The position of the upload
+   */
+  size_t pos;
+
+  /**
+   * The number of the bytes received by the access handler
+   */
+  size_t received;
+
+  /**
+   * Set to non-zero if any error has been detected
+   */
+  int error;
+
+  /**
+   * The application's receive buffer
+   */
+  char *buf;
+
+  /**
+   * Set to non-zero to queue the response in the same call where
+   * the buffer is set
+   */
+  int early_reply;
+};
+
+
+static char
+pattern_byte (size_t pos)
+{
+  return (char) ((pos * 7 + pos / 1000) & 0xFF);
+}
+
+
+static size_t
+putBuffer (void *stream, size_t size, size_t nmemb, void *ptr)
+{
+  struct UploadState *st = ptr;
+  char *const buf = (char *) stream;
+  size_t wrt;
+  size_t i;
+
+  wrt = size * nmemb;
+  if (wrt > st->size - st->pos)
+    wrt = st->size - st->pos;
+  for (i = 0; i < wrt; i++)
+    buf[i] = pattern_byte (st->pos + i);
+  st->pos += wrt;
+  return wrt;
+}
+
+
+static size_t
+discardBuffer (void *ptr, size_t size, size_t nmemb, void *ctx)
+{
+  (void) ptr; (void) ctx;  /* Unused. Silent compiler warning. */
+  return size * nmemb;
+}
+
+
+static enum MHD_Result
+ahc_upload (void *cls,
+            struct MHD_Connection *connection,
+            const char *url,
+            const char *method,
+            const char *version,
+            const char *upload_data, size_t *upload_data_size,
+            void **req_cls)
+{
+  static int marker;
+  struct UploadState *st = cls;
+  struct MHD_Response *response;
+  enum MHD_Result ret;
+  unsigned int code;
+  size_t i;
+  (void) url; (void) version;  /* Unused. Silent compiler warning. */
+
+  if (0 != strcmp (MHD_HTTP_METHOD_PUT, method))
+    return MHD_NO;              /* unexpected method */
+  if (NULL == *req_cls)
+  {
+    if (MHD_YES !=
+        MHD_set_connection_option (connection,
+                                   MHD_CONNECTION_OPTION_UPLOAD_BUFFER,
+                                   (void *) st->buf,
+                                   (size_t) RECV_BUF_SIZE))
+    {
+      fprintf (stderr, "Failed to set the upload buffer.\n");
+      return MHD_NO;
+    }
+    if (MHD_NO !=
+        MHD_set_connection_option (connection,
+                                   MHD_CONNECTION_OPTION_UPLOAD_BUFFER,
+                                   (void *) st->buf,
+                                   (size_t) RECV_BUF_SIZE))
+    {
+      fprintf (stderr, "The upload buffer has been set twice.\n");
+      return MHD_NO;
+    }
+    if (st->early_reply)
+    {
+      /* The body is not read, the buffer is dropped */
+      response = MHD_create_response_empty (MHD_RF_NONE);
+      ret = MHD_queue_response (connection, MHD_HTTP_ACCEPTED, response);
+      MHD_destroy_response (response);
+      return ret;
+    }
+    *req_cls = &marker;
+    return MHD_YES;
+  }
+  if (0 != *upload_data_size)
+  {
+    if ((upload_data < st->buf) ||
+        (upload_data + *upload_data_size > st->buf + RECV_BUF_SIZE))
+    {
+      fprintf (stderr, "The upload data is not in the application's "
+               "buffer.\n");
+      st->error = 1;
+    }
+    for (i = 0; i < *upload_data_size; i++)
+    {
+      if (pattern_byte (st->received + i) != upload_data[i])
+      {
+        fprintf (stderr, "Wrong byte at position %lu.\n",
+                 (unsigned long) (st->received + i));
+        st->error = 1;
+        break;
+      }
+    }
+    st->received += *upload_data_size;
+    *upload_data_size = 0;
+    return MHD_YES;
+  }
+  *req_cls = NULL;
+  code = ((st->size == st->received) && ! st->error) ?
+         MHD_HTTP_OK : MHD_HTTP_INTERNAL_SERVER_ERROR;
+  response = MHD_create_response_empty (MHD_RF_NONE);
+  ret = MHD_queue_response (connection, code, response);
+  MHD_destroy_response (response);
+  return ret;
+}
+
+
+static unsigned int
+testUpload (unsigned int flags, size_t size, int chunked, int early_reply)
+{
+  struct MHD_Daemon *d;
+  CURL *c;
+  struct UploadState st;
+  CURLcode errornum;
+  struct curl_slist *hdrs = NULL;
+  long code;
+  uint16_t port;
+
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_AUTODETECT_BIND_PORT))
+    port = 0;
+  else
+    port = 1600;
+
+  memset (&st, 0, sizeof(st));
+  st.size = size;
+  st.early_reply = early_reply;
+  st.buf = malloc (RECV_BUF_SIZE);
+  if (NULL == st.buf)
+    return 1;
+  d = MHD_start_daemon (flags | MHD_USE_ERROR_LOG,
+                        port,
+                        NULL, NULL, &ahc_upload, &st, MHD_OPTION_END);
+  if (d == NULL)
+  {
+    free (st.buf);
+    return 1;
+  }
+  if (0 == port)
+  {
+    const union MHD_DaemonInfo *dinfo;
+    dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_BIND_PORT);
+    if ((NULL == dinfo) || (0 == dinfo->port) )
+    {
+      MHD_stop_daemon (d); free (st.buf); return 32;
+    }
+    port = dinfo->port;
+  }
+  c = curl_easy_init ();
+  curl_easy_setopt (c, CURLOPT_URL, "http://127.0.0.1/upload");
+  curl_easy_setopt (c, CURLOPT_PORT, (long) port);
+  curl_easy_setopt (c, CURLOPT_WRITEFUNCTION, &discardBuffer);
+  curl_easy_setopt (c, CURLOPT_READFUNCTION, &putBuffer);
+  curl_easy_setopt (c, CURLOPT_READDATA, &st);
+  curl_easy_setopt (c, CURLOPT_UPLOAD, 1L);
+  if (chunked)
+  {
+    hdrs = curl_slist_append (hdrs, "Transfer-Encoding: chunked");
+    curl_easy_setopt (c, CURLOPT_HTTPHEADER, hdrs);
+  }
+  else
+    curl_easy_setopt (c, CURLOPT_INFILESIZE_LARGE, (curl_off_t) size);
+  if (early_reply)
+  {
+    /* Wait for the reply before sending the body */
+    hdrs = curl_slist_append (hdrs, "Expect: 100-continue");
+    curl_easy_setopt (c, CURLOPT_HTTPHEADER, hdrs);
+  }
+  curl_easy_setopt (c, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+  curl_easy_setopt (c, CURLOPT_TIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_CONNECTTIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_NOSIGNAL, 1L);
+  if (CURLE_OK != (errornum = curl_easy_perform (c)))
+  {
+    fprintf (stderr,
+             "curl_easy_perform failed: `%s'\n",
+             curl_easy_strerror (errornum));
+    curl_easy_cleanup (c);
+    curl_slist_free_all (hdrs);
+    MHD_stop_daemon (d);
+    free (st.buf);
+    return 2;
+  }
+  code = 0;
+  curl_easy_getinfo (c, CURLINFO_RESPONSE_CODE, &code);
+  curl_easy_cleanup (c);
+  curl_slist_free_all (hdrs);
+  MHD_stop_daemon (d);
+  free (st.buf);
+  if ((early_reply ? MHD_HTTP_ACCEPTED : MHD_HTTP_OK) != code)
+  {
+    fprintf (stderr, "Unexpected HTTP response code: %ld\n", code);
+    return 4;
+  }
+  return 0;
+}
+
+
+static unsigned int
+testUploadAll (unsigned int flags)
+{
+  unsigned int errorCount = 0;
+
+  errorCount += testUpload (flags, UPLOAD_SIZE, 0, 0);
+  errorCount += testUpload (flags, UPLOAD_SIZE, 1, 0);
+  errorCount += testUpload (flags, UPLOAD_SIZE_SMALL, 0, 0);
+  errorCount += testUpload (flags, UPLOAD_SIZE_SMALL, 0, 1);
+  errorCount += testUpload (flags, UPLOAD_SIZE_SMALL, 1, 1);
+  return errorCount;
+}
+
+
+int
+main (int argc, char *const *argv)
+{
+  unsigned int errorCount = 0;
+  (void) argc; (void) argv; /* Unused. Silent compiler warning. */
+
+  if (0 != curl_global_init (CURL_GLOBAL_WIN32))
+    return 2;
+  errorCount += testUploadAll (MHD_USE_INTERNAL_POLLING_THREAD);
+  errorCount += testUploadAll (MHD_USE_THREAD_PER_CONNECTION
+                               | MHD_USE_INTERNAL_POLLING_THREAD);
+  if (MHD_YES == MHD_is_feature_supported (MHD_FEATURE_POLL))
+    errorCount += testUploadAll (MHD_USE_INTERNAL_POLLING_THREAD
+                                 | MHD_USE_POLL);
+  if (MHD_YES == MHD_is_feature_supported (MHD_FEATURE_EPOLL))
+    errorCount += testUploadAll (MHD_USE_INTERNAL_POLLING_THREAD
+                                 | MHD_USE_EPOLL);
+  if (errorCount != 0)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  curl_global_cleanup ();
+  return (0 == errorCount) ? 0 : 1;       /* 0 == pass */
+}
@@ -0,0 +1,318 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     libmicrohttpd is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 2, or (at your
+     option) any later version.
+
+     libmicrohttpd is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with libmicrohttpd; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+
+/**
+ * @file test_put_upload_fd.c
+ * @brief  Testcase for writing of the PUT body directly to the file
+ */
+
+#include "MHD_config.h"
+#include "platform.h"
+#include <curl/curl.h>
+#include <microhttpd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+/**
+ * The size of the uploaded body
+ */
+#define UPLOAD_SIZE (4 * 1024 * 1024)
+
+/**
+ * The size of the small uploaded body (written without splice())
+ */
+#define UPLOAD_SIZE_SMALL (3000)
+
+
+/**
+ * The state of the upload
+ */
+struct UploadState
+{
+  /**
+   * The size of the body to send
+   */
+  size_t size;
+
+  /**
+   * The position of the upload
+   */
+  size_t pos;
+
+  /**
+   * Set to non-zero if the handler got any upload data
+   */
+  int got_data;
+};
+
+
+static char
+pattern_byte (size_t pos)
+{
+  return (char) ((pos * 7 + pos / 1000) & 0xFF);
+}
+
+
+static size_t
+putBuffer (void *stream, size_t size, size_t nmemb, void *ptr)
+{
+  struct UploadState *st = ptr;
+  char *const buf = (char *) stream;
+  size_t wrt;
+  size_t i;
+
+  wrt = size * nmemb;
+  if (wrt > st->size - st->pos)
+    wrt = st->size - st->pos;
+  for (i = 0; i < wrt; i++)
+    buf[i] = pattern_byte (st->pos + i);
+  st->pos += wrt;
+  return wrt;
+}
+
+
+static size_t
+discardBuffer (void *ptr, size_t size, size_t nmemb, void *ctx)
+{
+  (void) ptr; (void) ctx;  /* Unused. Silent compiler warning. */
+  return size * nmemb;
+}
+
+
+/**
+ * Check that the file has the expected content.
+ *
+ * @param f the file to check
+ * @param size the expected size
+ * @return zero if file is valid, non-zero otherwise
+ */
+static int
+check_file (FILE *f, size_t size)
+{
+  static char buf[65536];
+  size_t pos;
+
+  if (0 != fseek (f, 0, SEEK_SET))
+    return 1;
+  pos = 0;
+  while (1)
+  {
+    size_t got;
+    size_t i;
+
+    got = fread (buf, 1, sizeof(buf), f);
+    if (0 == got)
+      break;
+    for (i = 0; i < got; i++)
+    {
+      if (pattern_byte (pos + i) != buf[i])
+      {
+        fprintf (stderr, "Wrong byte at position %lu.\n",
+                 (unsigned long) (pos + i));
+        return 1;
+      }
+    }
+    pos += got;
+  }
+  if (size != pos)
+  {
+    fprintf (stderr, "Wrong file size: %lu, expected %lu.\n",
+             (unsigned long) pos, (unsigned long) size);
+    return 1;
+  }
+  return 0;
+}
+
+
+static enum MHD_Result
+ahc_upload (void *cls,
+            struct MHD_Connection *connection,
+            const char *url,
+            const char *method,
+            const char *version,
+            const char *upload_data, size_t *upload_data_size,
+            void **req_cls)
+{
+  struct UploadState *st = cls;
+  FILE *f = *req_cls;
+  struct MHD_Response *response;
+  enum MHD_Result ret;
+  unsigned int code;
+  (void) url; (void) version; (void) upload_data; /* Unused. Silent compiler warning. */
+
+  if (0 != strcmp (MHD_HTTP_METHOD_PUT, method))
+    return MHD_NO;              /* unexpected method */
+  if (NULL == f)
+  {
+    f = tmpfile ();
+    if (NULL == f)
+    {
+      fprintf (stderr, "tmpfile() failed.\n");
+      return MHD_NO;
+    }
+    if (MHD_YES != MHD_set_connection_upload_fd (connection, fileno (f)))
+    {
+      fprintf (stderr, "MHD_set_connection_upload_fd() failed.\n");
+      fclose (f);
+      return MHD_NO;
+    }
+    if (MHD_NO != MHD_set_connection_upload_fd (connection, fileno (f)))
+    {
+      fprintf (stderr, "Second MHD_set_connection_upload_fd() succeeded.\n");
+      fclose (f);
+      return MHD_NO;
+    }
+    *req_cls = f;
+    return MHD_YES;
+  }
+  if (0 != *upload_data_size)
+  {
+    st->got_data = 1;
+    *upload_data_size = 0;
+    return MHD_YES;
+  }
+  *req_cls = NULL;
+  code = (0 == check_file (f, st->size)) ?
+         MHD_HTTP_OK : MHD_HTTP_INTERNAL_SERVER_ERROR;
+  fclose (f);
+  response = MHD_create_response_empty (MHD_RF_NONE);
+  ret = MHD_queue_response (connection, code, response);
+  MHD_destroy_response (response);
+  return ret;
+}
+
+
+static unsigned int
+testUpload (unsigned int flags, size_t size, int chunked)
+{
+  struct MHD_Daemon *d;
+  CURL *c;
+  struct UploadState st;
+  CURLcode errornum;
+  struct curl_slist *hdrs = NULL;
+  long code;
+  uint16_t port;
+
+  if (MHD_NO != MHD_is_feature_supported (MHD_FEATURE_AUTODETECT_BIND_PORT))
+    port = 0;
+  else
+    port = 1590;
+
+  memset (&st, 0, sizeof(st));
+  st.size = size;
+  d = MHD_start_daemon (flags | MHD_USE_ERROR_LOG,
+                        port,
+                        NULL, NULL, &ahc_upload, &st, MHD_OPTION_END);
+  if (d == NULL)
+    return 1;
+  if (0 == port)
+  {
+    const union MHD_DaemonInfo *dinfo;
+    dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_BIND_PORT);
+    if ((NULL == dinfo) || (0 == dinfo->port) )
+    {
+      MHD_stop_daemon (d); return 32;
+    }
+    port = dinfo->port;
+  }
+  c = curl_easy_init ();
+  curl_easy_setopt (c, CURLOPT_URL, "http://127.0.0.1/upload");
+  curl_easy_setopt (c, CURLOPT_PORT, (long) port);
+  curl_easy_setopt (c, CURLOPT_WRITEFUNCTION, &discardBuffer);
+  curl_easy_setopt (c, CURLOPT_READFUNCTION, &putBuffer);
+  curl_easy_setopt (c, CURLOPT_READDATA, &st);
+  curl_easy_setopt (c, CURLOPT_UPLOAD, 1L);
+  if (chunked)
+  {
+    hdrs = curl_slist_append (hdrs, "Transfer-Encoding: chunked");
+    curl_easy_setopt (c, CURLOPT_HTTPHEADER, hdrs);
+  }
+  else
+    curl_easy_setopt (c, CURLOPT_INFILESIZE_LARGE, (curl_off_t) size);
+  curl_easy_setopt (c, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+  curl_easy_setopt (c, CURLOPT_TIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_CONNECTTIMEOUT, 150L);
+  curl_easy_setopt (c, CURLOPT_NOSIGNAL, 1L);
+  if (CURLE_OK != (errornum = curl_easy_perform (c)))
+  {
+    fprintf (stderr,
+             "curl_easy_perform failed: `%s'\n",
+             curl_easy_strerror (errornum));
+    curl_easy_cleanup (c);
+    curl_slist_free_all (hdrs);
+    MHD_stop_daemon (d);
+    return 2;
+  }
+  code = 0;
+  curl_easy_getinfo (c, CURLINFO_RESPONSE_CODE, &code);
+  curl_easy_cleanup (c);
+  curl_slist_free_all (hdrs);
+  MHD_stop_daemon (d);
+  if (MHD_HTTP_OK != code)
+  {
+    fprintf (stderr, "Unexpected HTTP response code: %ld\n", code);
+    return 4;
+  }
+  if (st.got_data)
+  {
+    fprintf (stderr, "Access handler got the upload data.\n");
+    return 8;
+  }
+  return 0;
+}
+
+
+static unsigned int
+testUploadAll (unsigned int flags)
+{
+  unsigned int errorCount = 0;
+
+  errorCount += testUpload (flags, UPLOAD_SIZE, 0);
+  errorCount += testUpload (flags, UPLOAD_SIZE, 1);
+  errorCount += testUpload (flags, UPLOAD_SIZE_SMALL, 0);
+  return errorCount;
+}
+
+
+int
+main (int argc, char *const *argv)
+{
+  unsigned int errorCount = 0;
+  (void) argc; (void) argv; /* Unused. Silent compiler warning. */
+
+  if (0 != curl_global_init (CURL_GLOBAL_WIN32))
+    return 2;
+  errorCount += testUploadAll (MHD_USE_INTERNAL_POLLING_THREAD);
+  errorCount += testUploadAll (MHD_USE_THREAD_PER_CONNECTION
+                               | MHD_USE_INTERNAL_POLLING_THREAD);
+  if (MHD_YES == MHD_is_feature_supported (MHD_FEATURE_POLL))
+    errorCount += testUploadAll (MHD_USE_INTERNAL_POLLING_THREAD
+                                 | MHD_USE_POLL);
+  if (MHD_YES == MHD_is_feature_supported (MHD_FEATURE_EPOLL))
+    errorCount += testUploadAll (MHD_USE_INTERNAL_POLLING_THREAD
+                                 | MHD_USE_EPOLL);
+  if (errorCount != 0)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  curl_global_cleanup ();
+  return (0 == errorCount) ? 0 : 1;       /* 0 == pass */
+}
@@ -0,0 +1,222 @@
+/*
+     This file is part of libmicrohttpd
+     Copyright (C) 2026 libmicrohttpd developers
+
+     libmicrohttpd is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published
+     by the Free Software Foundation; either version 2, or (at your
+     option) any later version.
+
+     libmicrohttpd is distributed in the hope that it will be useful, but
+     WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+     General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with libmicrohttpd; see the file COPYING.  If not, write to the
+     Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+     Boston, MA 02110-1301, USA.
+*/
+
+
+/**
+ * @file test_select_closed_conn.c
+ * @brief  Testcase for processing of all ready connections by select()
+ *         loop when one of the connections is closed during the loop
+ */
+
+#include "MHD_config.h"
+#include "platform.h"
+#include <microhttpd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#ifndef WINDOWS
+#include <unistd.h>
+#endif
+#include "mhd_sockets.h" /* only macros used */
+
+#ifndef MHD_STATICSTR_LEN_
+/**
+ * Determine length of static string / macro strings at compile time.
+ */
+#define MHD_STATICSTR_LEN_(macro) (sizeof(macro) / sizeof(char) - 1)
+#endif /* ! MHD_STATICSTR_LEN_ */
+
+/**
+ * The request sent by the client
+ */
+#define REQUEST "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n"
+
+/**
+ * The number of the calls of the handler with the complete request
+ */
+static unsigned int num_calls;
+
+
+static enum MHD_Result
+ahc_echo (void *cls,
+          struct MHD_Connection *connection,
+          const char *url,
+          const char *method,
+          const char *version,
+          const char *upload_data, size_t *upload_data_size,
+          void **req_cls)
+{
+  static int marker;
+  static const char page[] = "Reply";
+  struct MHD_Response *response;
+  enum MHD_Result ret;
+  (void) cls; (void) url; (void) method; (void) version;
+  (void) upload_data; (void) upload_data_size; /* Unused. */
+
+  if (&marker != *req_cls)
+  {
+    *req_cls = &marker;
+    return MHD_YES;
+  }
+  *req_cls = NULL;
+  num_calls++;
+  response = MHD_create_response_from_buffer_static (sizeof(page) - 1,
+                                                     page);
+  if (NULL == response)
+    return MHD_NO;
+  ret = MHD_queue_response (connection, MHD_HTTP_OK, response);
+  MHD_destroy_response (response);
+  return ret;
+}
+
+
+/**
+ * Get the number of the connections of the daemon.
+ *
+ * @param d the daemon
+ * @return the number of the connections, -1 on error
+ */
+static int
+num_connections (struct MHD_Daemon *d)
+{
+  const union MHD_DaemonInfo *dinfo;
+
+  dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_CURRENT_CONNECTIONS);
+  if (NULL == dinfo)
+    return -1;
+  return (int) dinfo->num_connections;
+}
+
+
+/**
+ * Connect the client to the daemon and let the daemon accept it.
+ *
+ * @param d the daemon
+ * @param sa the address of the daemon
+ * @param expected the expected number of the connections after accepting
+ * @return the client socket, #MHD_INVALID_SOCKET on error
+ */
+static MHD_socket
+connect_client (struct MHD_Daemon *d,
+                const struct sockaddr_in *sa,
+                int expected)
+{
+  MHD_socket s;
+
+  s = socket (AF_INET, SOCK_STREAM, 0);
+  if (MHD_INVALID_SOCKET == s)
+    return MHD_INVALID_SOCKET;
+  if ( (0 != connect (s, (const struct sockaddr *) sa, sizeof(*sa))) ||
+       (MHD_YES != MHD_run (d)) ||
+       (expected != num_connections (d)) )
+  {
+    fprintf (stderr, "Failed to connect the client.\n");
+    MHD_socket_close_chk_ (s);
+    return MHD_INVALID_SOCKET;
+  }
+  return s;
+}
+
+
+static unsigned int
+testClosedInLoop (void)
+{
+  struct MHD_Daemon *d;
+  const union MHD_DaemonInfo *dinfo;
+  struct sockaddr_in sa;
+  MHD_socket old_client;
+  MHD_socket new_client;
+  unsigned int errorCount = 0;
+
+  num_calls = 0;
+  d = MHD_start_daemon (MHD_USE_ERROR_LOG,
+                        0,
+                        NULL, NULL, &ahc_echo, NULL,
+                        MHD_OPTION_CONNECTION_TIMEOUT, 0u,
+                        MHD_OPTION_END);
+  if (NULL == d)
+    return 2;
+  dinfo = MHD_get_daemon_info (d, MHD_DAEMON_INFO_BIND_PORT);
+  if ((NULL == dinfo) || (0 == dinfo->port) )
+  {
+    MHD_stop_daemon (d);
+    return 4;
+  }
+  memset (&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  sa.sin_port = htons (dinfo->port);
+
+  /* The connections are processed from the oldest one */
+  old_client = connect_client (d, &sa, 1);
+  if (MHD_INVALID_SOCKET == old_client)
+  {
+    MHD_stop_daemon (d);
+    return 8;
+  }
+  new_client = connect_client (d, &sa, 2);
+  if (MHD_INVALID_SOCKET == new_client)
+  {
+    MHD_socket_close_chk_ (old_client);
+    MHD_stop_daemon (d);
+    return 8;
+  }
+  /* The old connection is closed by the daemon in the same loop where
+     the request on the new connection is ready */
+  MHD_socket_close_chk_ (old_client);
+  if ((ssize_t) MHD_STATICSTR_LEN_ (REQUEST) !=
+      send (new_client, REQUEST, MHD_STATICSTR_LEN_ (REQUEST), 0))
+    errorCount |= 16;
+  else
+  {
+    (void) usleep (100000); /* Let the data and the close reach the daemon */
+    if (MHD_YES != MHD_run (d))
+      errorCount |= 32;
+    else if (1 != num_calls)
+    {
+      fprintf (stderr, "The request on the other connection has not been "
+               "processed in the same loop.\n");
+      errorCount |= 64;
+    }
+    else if (1 != num_connections (d))
+    {
+      fprintf (stderr, "The closed connection has not been cleaned up.\n");
+      errorCount |= 128;
+    }
+  }
+  MHD_socket_close_chk_ (new_client);
+  MHD_stop_daemon (d);
+  return errorCount;
+}
+
+
+int
+main (int argc, char *const *argv)
+{
+  unsigned int errorCount = 0;
+  (void) argc; (void) argv; /* Unused. Silent compiler warning. */
+
+  if (MHD_NO == MHD_is_feature_supported (MHD_FEATURE_AUTODETECT_BIND_PORT))
+    return 77;
+  errorCount += testClosedInLoop ();
+  if (errorCount != 0)
+    fprintf (stderr, "Error (code: %u)\n", errorCount);
+  return (0 == errorCount) ? 0 : 1;       /* 0 == pass */
+}